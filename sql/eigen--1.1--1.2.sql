@@ -0,0 +1,2376 @@
+--------------------------------------------------------------------------------
+-------------- VECTOR3D: FIXED-LENGTH BASE TYPE REPLACES THE DOMAIN -------------
+--------------------------------------------------------------------------------
+
+-- THE OLD ARRAY DOMAIN IS KEPT UNDER A NEW NAME SO THAT EXISTING COLUMNS REMAIN
+-- VALID; THEY CAN BE MIGRATED WITH
+--
+--     ALTER TABLE ... ALTER COLUMN ... TYPE vector3d USING column::vector3d;
+--
+-- AND THE DOMAIN DROPPED ONCE NO COLUMN USES IT ANYMORE.
+
+ALTER DOMAIN vector3d RENAME TO vector3d_array;
+
+DROP AGGREGATE concat(vector3d_array);
+DROP AGGREGATE avg(vector3d_array);
+DROP AGGREGATE sum(vector3d_array);
+
+DROP FUNCTION three_point_normal(DOUBLE PRECISION[]);
+DROP FUNCTION matrixxd_hstack(matrixxd, vector3d_array);
+DROP FUNCTION matrixxd_vstack(matrixxd, vector3d_array);
+
+DROP OPERATOR +(vector3d_array, vector3d_array);
+DROP OPERATOR -(vector3d_array, vector3d_array);
+DROP OPERATOR /(vector3d_array, DOUBLE PRECISION);
+DROP OPERATOR *(vector3d_array, DOUBLE PRECISION);
+DROP OPERATOR *(vector3d_array, vector3d_array);
+DROP OPERATOR |(NONE, vector3d_array);
+DROP OPERATOR ^(NONE, vector3d_array);
+DROP OPERATOR #(vector3d_array, vector3d_array);
+DROP OPERATOR ->(vector3d_array, vector3d_array);
+DROP OPERATOR @(vector3d_array, vector3d_array);
+DROP OPERATOR @+(vector3d_array, vector3d_array);
+
+DROP FUNCTION vector3d_constant(DOUBLE PRECISION);
+DROP FUNCTION vector3d_random();
+DROP FUNCTION vector3d_add(vector3d_array, vector3d_array);
+DROP FUNCTION vector3d_subtract(vector3d_array, vector3d_array);
+DROP FUNCTION vector3d_scalar_division(vector3d_array, DOUBLE PRECISION);
+DROP FUNCTION vector3d_scalar_product(vector3d_array, DOUBLE PRECISION);
+DROP FUNCTION vector3d_dot(vector3d_array, vector3d_array);
+DROP FUNCTION vector3d_norm(vector3d_array);
+DROP FUNCTION vector3d_normalized(vector3d_array);
+DROP FUNCTION vector3d_cross(vector3d_array, vector3d_array);
+DROP FUNCTION vector3d_distance(vector3d_array, vector3d_array);
+DROP FUNCTION vector3d_angle(vector3d_array, vector3d_array);
+DROP FUNCTION vector3d_abs_angle(vector3d_array, vector3d_array);
+
+
+CREATE  TYPE vector3d;
+
+CREATE  FUNCTION vector3d_in(cstring)
+        RETURNS vector3d
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_in(cstring) IS
+    'Parses a vector3d from its text representation (x,y,z); {x,y,z} is accepted as well.';
+
+
+CREATE  FUNCTION vector3d_out(vector3d)
+        RETURNS cstring
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_out(vector3d) IS
+    'Returns the text representation (x,y,z) of the vector3d.';
+
+
+CREATE  FUNCTION vector3d_recv(internal)
+        RETURNS vector3d
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_recv(internal) IS
+    'Binary input function of the vector3d type.';
+
+
+CREATE  FUNCTION vector3d_send(vector3d)
+        RETURNS bytea
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_send(vector3d) IS
+    'Binary output function of the vector3d type.';
+
+
+CREATE  TYPE vector3d (
+        INTERNALLENGTH = 24,
+        INPUT = vector3d_in,
+        OUTPUT = vector3d_out,
+        RECEIVE = vector3d_recv,
+        SEND = vector3d_send,
+        ALIGNMENT = double,
+        STORAGE = plain);
+
+COMMENT ON TYPE vector3d IS
+    'three-dimensional vector of double precision floats.';
+
+
+CREATE  FUNCTION vector3d(DOUBLE PRECISION[])
+        RETURNS vector3d
+        AS '$libdir/eigen','vector3d_from_array'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d(DOUBLE PRECISION[]) IS
+    'Converts a one-dimensional array with three elements into a vector3d.';
+
+
+CREATE  FUNCTION float8_array(vector3d)
+        RETURNS DOUBLE PRECISION[]
+        AS '$libdir/eigen','vector3d_to_array'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION float8_array(vector3d) IS
+    'Converts the vector3d into a one-dimensional array of three elements.';
+
+
+CREATE  CAST (DOUBLE PRECISION[] AS vector3d)
+        WITH FUNCTION vector3d(DOUBLE PRECISION[])
+        AS ASSIGNMENT;
+
+CREATE  CAST (vector3d AS DOUBLE PRECISION[])
+        WITH FUNCTION float8_array(vector3d)
+        AS ASSIGNMENT;
+
+
+CREATE  FUNCTION vector3d_constant(value DOUBLE PRECISION)
+        RETURNS vector3d
+        AS '$libdir/eigen'
+        LANGUAGE C VOLATILE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_constant(DOUBLE PRECISION) IS
+    'Returns a vector with constant elements.';
+
+
+CREATE  FUNCTION vector3d_random()
+        RETURNS vector3d
+        AS '$libdir/eigen'
+        LANGUAGE C VOLATILE STRICT PARALLEL RESTRICTED;
+
+COMMENT ON FUNCTION vector3d_random() IS
+    'Returns a vector with random elements.';
+
+
+CREATE  FUNCTION vector3d_add(vector3d, vector3d)
+        RETURNS vector3d
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_add(vector3d, vector3d) IS
+    'Adds two vectors together.';
+
+
+CREATE  OPERATOR + (
+        PROCEDURE = vector3d_add,
+        LEFTARG = vector3d,
+        RIGHTARG = vector3d,
+        COMMUTATOR = +);
+
+COMMENT ON OPERATOR +(vector3d, vector3d) IS
+    'Adds two vectors together.';
+
+
+CREATE  FUNCTION vector3d_subtract(vector3d, vector3d)
+        RETURNS vector3d
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_subtract(vector3d, vector3d) IS
+    'Subtracts one vector from the other.';
+
+
+CREATE  OPERATOR - (
+        PROCEDURE = vector3d_subtract,
+        LEFTARG = vector3d,
+        RIGHTARG = vector3d);
+
+COMMENT ON OPERATOR -(vector3d, vector3d) IS
+    'Subtracts one vector from the other.';
+
+
+CREATE  FUNCTION vector3d_scalar_division(vector3d, DOUBLE PRECISION)
+        RETURNS vector3d
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_scalar_division(vector3d, DOUBLE PRECISION) IS
+    'Divides a vector by a scalar.';
+
+
+CREATE  OPERATOR / (
+        PROCEDURE = vector3d_scalar_division,
+        LEFTARG = vector3d,
+        RIGHTARG = DOUBLE PRECISION);
+
+COMMENT ON OPERATOR /(vector3d, DOUBLE PRECISION) IS
+    'Divides a vector by a scalar.';
+
+
+CREATE  FUNCTION vector3d_scalar_product(vector3d, DOUBLE PRECISION)
+        RETURNS vector3d
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_scalar_product(vector3d, DOUBLE PRECISION) IS
+    'Multiplication of a vector with scalar.';
+
+
+CREATE  OPERATOR * (
+        PROCEDURE = vector3d_scalar_product,
+        LEFTARG = vector3d,
+        RIGHTARG = DOUBLE PRECISION);
+
+COMMENT ON OPERATOR *(vector3d, DOUBLE PRECISION) IS
+    'Multiplication of a vector with scalar.';
+
+
+CREATE  FUNCTION vector3d_dot(vector3d, vector3d)
+        RETURNS DOUBLE PRECISION
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_dot(vector3d, vector3d) IS
+    'Dot product between two vectors.';
+
+
+CREATE  OPERATOR * (
+        PROCEDURE = vector3d_dot,
+        LEFTARG = vector3d,
+        RIGHTARG = vector3d,
+        COMMUTATOR = *);
+
+COMMENT ON OPERATOR * (vector3d, vector3d) IS
+    'Dot product between two vectors.';
+
+
+CREATE  FUNCTION vector3d_norm(vector3d)
+        RETURNS DOUBLE PRECISION
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_norm(vector3d) IS
+    'Length/Norm of the vector.';
+
+
+CREATE  OPERATOR | (
+        PROCEDURE = vector3d_norm,
+        RIGHTARG = vector3d
+        );
+
+COMMENT ON OPERATOR |(NONE, vector3d) IS
+    'Length/Norm of the vector.';
+
+
+CREATE  FUNCTION vector3d_normalized(vector3d)
+        RETURNS vector3d
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_normalized(vector3d) IS
+    'Normalizes vector.';
+
+CREATE  OPERATOR ^ (
+        PROCEDURE = vector3d_normalized,
+        RIGHTARG = vector3d
+        );
+
+COMMENT ON FUNCTION vector3d_normalized(vector3d) IS
+    'Normalizes vector.';
+
+
+CREATE  FUNCTION vector3d_cross(vector3d, vector3d)
+        RETURNS vector3d
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_cross(vector3d, vector3d) IS
+    'Cross product between two vectors.';
+
+
+CREATE  OPERATOR # (
+        PROCEDURE = vector3d_cross,
+        LEFTARG = vector3d,
+        RIGHTARG = vector3d
+        );
+
+COMMENT ON OPERATOR #(vector3d, vector3d) IS
+    'Cross product between two vectors.';
+
+
+CREATE  FUNCTION vector3d_distance(vector3d, vector3d)
+        RETURNS DOUBLE PRECISION
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_distance(vector3d, vector3d) IS
+    'Euclidean distance between two vectors.';
+
+
+CREATE  OPERATOR -> (
+        PROCEDURE = vector3d_distance,
+        LEFTARG = vector3d,
+        RIGHTARG = vector3d
+        );
+
+COMMENT ON OPERATOR ->(vector3d, vector3d) IS
+    'Euclidean distance between two vectors.';
+
+
+CREATE  FUNCTION vector3d_angle(vector3d, vector3d)
+        RETURNS DOUBLE PRECISION
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_angle(vector3d, vector3d) IS
+    'Angle between two vectors in radians.';
+
+
+CREATE  OPERATOR @ (
+        PROCEDURE = vector3d_angle,
+        LEFTARG = vector3d,
+        RIGHTARG = vector3d
+        );
+
+COMMENT ON OPERATOR @(vector3d, vector3d) IS
+    'Angle between two vectors in radians.';
+
+
+CREATE  FUNCTION vector3d_abs_angle(vector3d, vector3d)
+        RETURNS DOUBLE PRECISION
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_abs_angle(vector3d, vector3d) IS
+    'Absolute angle (0 < angle < PI/2) between two vectors in radians.';
+
+
+CREATE  OPERATOR @+ (
+        PROCEDURE = vector3d_abs_angle,
+        LEFTARG = vector3d,
+        RIGHTARG = vector3d
+        );
+
+COMMENT ON OPERATOR @+(vector3d, vector3d) IS
+    'Absolute angle (0 < angle < PI/2) between two vectors in radians.';
+
+
+CREATE  FUNCTION vector3d_sum_accum(internal, vector3d)
+        RETURNS internal
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_sum_accum(internal, vector3d) IS
+    'Transition function of the sum(vector3d) and avg(vector3d) aggregates.';
+
+
+CREATE  FUNCTION vector3d_sum_combine(internal, internal)
+        RETURNS internal
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_sum_combine(internal, internal) IS
+    'Combines two partial sums of the sum(vector3d) and avg(vector3d) aggregates.';
+
+
+CREATE  FUNCTION vector3d_sum_serialize(internal)
+        RETURNS bytea
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_sum_serialize(internal) IS
+    'Serializes the partial sum of the sum(vector3d) and avg(vector3d) aggregates.';
+
+
+CREATE  FUNCTION vector3d_sum_deserialize(bytea, internal)
+        RETURNS internal
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_sum_deserialize(bytea, internal) IS
+    'Deserializes the partial sum of the sum(vector3d) and avg(vector3d) aggregates.';
+
+
+CREATE  FUNCTION vector3d_sum_final(internal)
+        RETURNS vector3d
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_sum_final(internal) IS
+    'Final function of the sum(vector3d) aggregate.';
+
+
+CREATE  AGGREGATE sum(vector3d) (
+        SFUNC = vector3d_sum_accum,
+        STYPE = internal,
+        FINALFUNC = vector3d_sum_final,
+        COMBINEFUNC = vector3d_sum_combine,
+        SERIALFUNC = vector3d_sum_serialize,
+        DESERIALFUNC = vector3d_sum_deserialize,
+        PARALLEL = SAFE);
+
+COMMENT ON AGGREGATE sum(vector3d) IS
+    'Sums vectors.';
+   
+
+CREATE  FUNCTION three_point_normal(DOUBLE PRECISION[]) RETURNS vector3d AS
+        $$
+        DECLARE
+            vectors ALIAS FOR $1;
+            A vector3d;
+            B vector3d;
+            C vector3d;
+            AB vector3d;
+            AC vector3d;
+            normal vector3d;
+        BEGIN
+            A := vectors[1:3];
+            B := vectors[4:6];
+            C := vectors[7:9];
+
+            AB := A - B;
+            AC := A - C;
+
+            -- NORMALIZED CROSS PRODUCT
+            normal := vector3d_normalized(AB # AC);
+
+            RETURN normal;
+        END;
+        $$
+        LANGUAGE plpgsql PARALLEL SAFE;
+
+COMMENT ON FUNCTION three_point_normal(DOUBLE PRECISION[]) IS
+    'Calculates the normal vector of a PLANAR ring using the first three atoms.';
+
+
+CREATE  FUNCTION matrixxd_hstack(matrixxd, vector3d)
+        RETURNS matrixxd
+        AS '$libdir/eigen','matrixxd_hstack_vector3d'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION matrixxd_hstack(matrixxd, vector3d) IS
+    'horizontally stacks the vector3d onto the matrixxd';
+
+
+CREATE  FUNCTION matrixxd_vstack(matrixxd, vector3d)
+        RETURNS matrixxd
+        AS '$libdir/eigen','matrixxd_vstack_vector3d'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION matrixxd_vstack(matrixxd, vector3d) IS
+    'vertically stacks the vector3d onto the matrixxd';
+
+    
+CREATE  FUNCTION vector3d_avg_final(internal)
+        RETURNS matrixxd
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_avg_final(internal) IS
+    'Final function of the avg(vector3d) aggregate.';
+
+
+CREATE  AGGREGATE avg(vector3d) (
+        SFUNC = vector3d_sum_accum,
+        STYPE = internal,
+        FINALFUNC = vector3d_avg_final,
+        COMBINEFUNC = vector3d_sum_combine,
+        SERIALFUNC = vector3d_sum_serialize,
+        DESERIALFUNC = vector3d_sum_deserialize,
+        PARALLEL = SAFE);
+
+COMMENT ON AGGREGATE avg(vector3d) IS
+    'Returns the mean of the vectors, e.g. the centroid of a set of coordinates.';
+
+
+CREATE  FUNCTION vector3d_concat_accum(internal, vector3d)
+        RETURNS internal
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_concat_accum(internal, vector3d) IS
+    'Transition function of the concat(vector3d) aggregate.';
+
+
+CREATE  FUNCTION vector3d_concat_combine(internal, internal)
+        RETURNS internal
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_concat_combine(internal, internal) IS
+    'Combines two partial results of the concat(vector3d) aggregate.';
+
+
+CREATE  FUNCTION vector3d_concat_serialize(internal)
+        RETURNS bytea
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_concat_serialize(internal) IS
+    'Serializes the partial result of the concat(vector3d) aggregate.';
+
+
+CREATE  FUNCTION vector3d_concat_deserialize(bytea, internal)
+        RETURNS internal
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_concat_deserialize(bytea, internal) IS
+    'Deserializes the partial result of the concat(vector3d) aggregate.';
+
+
+CREATE  FUNCTION vector3d_concat_final(internal)
+        RETURNS matrixxd
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_concat_final(internal) IS
+    'Final function of the concat(vector3d) aggregate.';
+
+
+CREATE  AGGREGATE concat(vector3d) (
+        SFUNC = vector3d_concat_accum,
+        STYPE = internal,
+        FINALFUNC = vector3d_concat_final,
+        COMBINEFUNC = vector3d_concat_combine,
+        SERIALFUNC = vector3d_concat_serialize,
+        DESERIALFUNC = vector3d_concat_deserialize,
+        PARALLEL = SAFE);
+
+COMMENT ON AGGREGATE concat(vector3d) IS
+    'Concatenates vectors vertically into a matrix with one row per vector.';
+
+
+
+--------------------------------------------------------------------------------
+------------------ FINGERPRINT: BIT-PACKED BINARY FINGERPRINT ------------------
+--------------------------------------------------------------------------------
+
+
+
+CREATE  TYPE fingerprint;
+
+CREATE  FUNCTION fingerprint_in(cstring)
+        RETURNS fingerprint
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION fingerprint_in(cstring) IS
+    'Parses a fingerprint from a string of zeros and ones.';
+
+
+CREATE  FUNCTION fingerprint_out(fingerprint)
+        RETURNS cstring
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION fingerprint_out(fingerprint) IS
+    'Returns the fingerprint as string of zeros and ones.';
+
+
+CREATE  FUNCTION fingerprint_recv(internal)
+        RETURNS fingerprint
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION fingerprint_recv(internal) IS
+    'Binary input function of the fingerprint type.';
+
+
+CREATE  FUNCTION fingerprint_send(fingerprint)
+        RETURNS bytea
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION fingerprint_send(fingerprint) IS
+    'Binary output function of the fingerprint type.';
+
+
+CREATE  TYPE fingerprint (
+        INPUT = fingerprint_in,
+        OUTPUT = fingerprint_out,
+        RECEIVE = fingerprint_recv,
+        SEND = fingerprint_send,
+        ALIGNMENT = double,
+        STORAGE = extended);
+
+COMMENT ON TYPE fingerprint IS
+    'Binary fingerprint stored as packed bits; one bit per element of the corresponding binary arrayxi.';
+
+
+CREATE  FUNCTION fingerprint(INTEGER[])
+        RETURNS fingerprint
+        AS '$libdir/eigen','fingerprint_from_array'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION fingerprint(INTEGER[]) IS
+    'Converts an array into a fingerprint: all elements > 0 are set, i.e. the same semantics as arrayxi_binary().';
+
+
+CREATE  FUNCTION arrayxi(fingerprint)
+        RETURNS arrayxi
+        AS '$libdir/eigen','fingerprint_to_array'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION arrayxi(fingerprint) IS
+    'Converts the fingerprint into a binary array of zeros and ones.';
+
+
+CREATE  CAST (INTEGER[] AS fingerprint)
+        WITH FUNCTION fingerprint(INTEGER[])
+        AS ASSIGNMENT;
+
+CREATE  CAST (fingerprint AS INTEGER[])
+        WITH FUNCTION arrayxi(fingerprint);
+
+
+-------------------------FINGERPRINT PROPERTIES---------------------------------
+
+
+CREATE  FUNCTION fingerprint_size(fingerprint)
+        RETURNS INTEGER
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION fingerprint_size(fingerprint) IS
+    'Returns the number of bits in the fingerprint.';
+
+
+CREATE  OPERATOR #(
+        PROCEDURE = fingerprint_size,
+        RIGHTARG = fingerprint);
+
+COMMENT ON OPERATOR #(None, fingerprint) IS 'Returns the number of bits in the fingerprint.';
+
+
+CREATE  FUNCTION fingerprint_nonzeros(fingerprint)
+        RETURNS INTEGER
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION fingerprint_nonzeros(fingerprint) IS
+    'Returns the number of bits that are set in the fingerprint.';
+
+
+-----------------------NORMALIZED SIMILARITY METRICS----------------------------
+
+
+CREATE  FUNCTION fingerprint_dice(fingerprint, fingerprint)
+        RETURNS DOUBLE PRECISION
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION fingerprint_dice(fingerprint, fingerprint) IS
+    'Returns the Dice similarity between the fingerprints.';
+
+
+CREATE  FUNCTION fingerprint_euclidean(fingerprint, fingerprint)
+        RETURNS DOUBLE PRECISION
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION fingerprint_euclidean(fingerprint, fingerprint) IS
+    'Returns the Euclidean similarity between the fingerprints.';
+
+
+CREATE  OPERATOR -> (
+        PROCEDURE = fingerprint_euclidean,
+        LEFTARG = fingerprint,
+        RIGHTARG = fingerprint,
+        COMMUTATOR = ->);
+
+COMMENT ON OPERATOR ->(fingerprint, fingerprint) IS
+    'Returns the Euclidean similarity between the fingerprints.';
+
+
+CREATE  FUNCTION fingerprint_kulcz(fingerprint, fingerprint)
+        RETURNS DOUBLE PRECISION
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION fingerprint_kulcz(fingerprint, fingerprint) IS
+    'Returns the Kulczynski similarity between the fingerprints.';
+
+
+CREATE  OPERATOR % (
+        PROCEDURE = fingerprint_kulcz,
+        LEFTARG = fingerprint,
+        RIGHTARG = fingerprint,
+        COMMUTATOR = %);
+
+COMMENT ON OPERATOR %(fingerprint, fingerprint) IS
+    'Returns the Kulczynski similarity between the fingerprints.';
+
+
+CREATE  FUNCTION fingerprint_manhattan(fingerprint, fingerprint)
+        RETURNS DOUBLE PRECISION
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION fingerprint_manhattan(fingerprint, fingerprint) IS
+    'Returns the Manhattan similarity between the fingerprints.';
+
+
+CREATE  OPERATOR ~> (
+        PROCEDURE = fingerprint_manhattan,
+        LEFTARG = fingerprint,
+        RIGHTARG = fingerprint,
+        COMMUTATOR = ~>);
+
+COMMENT ON OPERATOR ~>(fingerprint, fingerprint) IS
+    'Returns the Manhattan similarity between the fingerprints.';
+
+
+CREATE  FUNCTION fingerprint_ochiai(fingerprint, fingerprint)
+        RETURNS DOUBLE PRECISION
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION fingerprint_ochiai(fingerprint, fingerprint) IS
+    'Returns the Ochiai/Cosine similarity between the fingerprints.';
+
+
+CREATE  OPERATOR @ (
+        PROCEDURE = fingerprint_ochiai,
+        LEFTARG = fingerprint,
+        RIGHTARG = fingerprint,
+        COMMUTATOR = @);
+
+COMMENT ON OPERATOR @(fingerprint, fingerprint) IS
+    'Returns the Ochiai/Cosine similarity between the fingerprints.';
+
+
+CREATE  FUNCTION fingerprint_russell_rao(fingerprint, fingerprint)
+        RETURNS DOUBLE PRECISION
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION fingerprint_russell_rao(fingerprint, fingerprint) IS
+    'Returns the Russell-Rao similarity between the fingerprints.';
+
+
+CREATE  OPERATOR ^ (
+        PROCEDURE = fingerprint_russell_rao,
+        LEFTARG = fingerprint,
+        RIGHTARG = fingerprint,
+        COMMUTATOR = ^);
+
+COMMENT ON OPERATOR ^(fingerprint, fingerprint) IS
+    'Returns the Russell-Rao similarity between the fingerprints.';
+
+
+CREATE  FUNCTION fingerprint_simpson(fingerprint, fingerprint)
+        RETURNS DOUBLE PRECISION
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION fingerprint_simpson(fingerprint, fingerprint) IS
+    'Returns the Simpson similarity between the fingerprints.';
+
+
+CREATE  OPERATOR ^^ (
+        PROCEDURE = fingerprint_simpson,
+        LEFTARG = fingerprint,
+        RIGHTARG = fingerprint,
+        COMMUTATOR = ^^);
+
+COMMENT ON OPERATOR ^^(fingerprint, fingerprint) IS
+    'Returns the Simpson similarity between the fingerprints.';
+
+
+CREATE  FUNCTION fingerprint_simpson_global(fingerprint, fingerprint)
+        RETURNS DOUBLE PRECISION
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION fingerprint_simpson_global(fingerprint, fingerprint) IS
+    'Returns the global Simpson similarity between the fingerprints.';
+
+
+CREATE  FUNCTION fingerprint_tanimoto(fingerprint, fingerprint)
+        RETURNS DOUBLE PRECISION
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION fingerprint_tanimoto(fingerprint, fingerprint) IS
+    'Returns the Tanimoto similarity between the fingerprints.';
+
+
+CREATE  FUNCTION fingerprint_tversky(fingerprint, fingerprint)
+        RETURNS DOUBLE PRECISION
+        AS '$libdir/eigen'
+        LANGUAGE C STABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION fingerprint_tversky(fingerprint, fingerprint) IS
+    'Returns the Tversky similarity between the fingerprints.';
+
+
+CREATE  OPERATOR %^ (
+        PROCEDURE = fingerprint_tversky,
+        LEFTARG = fingerprint,
+        RIGHTARG = fingerprint,
+        COMMUTATOR = %^);
+
+COMMENT ON OPERATOR %^(fingerprint, fingerprint) IS
+    'Returns the Tversky similarity between the fingerprints.';
+
+
+CREATE  FUNCTION fingerprint_fuzcavsim_global(fingerprint, fingerprint)
+        RETURNS DOUBLE PRECISION
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION fingerprint_fuzcavsim_global(fingerprint, fingerprint) IS
+    'Returns the FuzCav global similarity between the fingerprints.';
+
+
+CREATE  FUNCTION fingerprint_mean_hamming_dist(fingerprint, fingerprint)
+        RETURNS DOUBLE PRECISION
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION fingerprint_mean_hamming_dist(fingerprint, fingerprint) IS
+    'Returns the mean Hamming distance between the fingerprints.';
+
+
+--FINGERPRINT BOOLEAN METRICS: COMPARES THE SIMILARITY WITH THE USER-SET LIMIT--
+--------------------THE LIMITS ARE SHARED WITH THE ARRAYXI METRICS--------------
+
+
+CREATE FUNCTION fingerprint_dice_is_above_limit(fingerprint, fingerprint)
+    RETURNS BOOLEAN
+    AS '$libdir/eigen'
+    LANGUAGE C STRICT STABLE PARALLEL SAFE;
+
+COMMENT ON FUNCTION fingerprint_dice_is_above_limit(fingerprint, fingerprint) IS
+    'Returns true if the Dice similarity between two fingerprints is above the user-set limit.';
+
+
+CREATE  OPERATOR #? (
+        PROCEDURE = fingerprint_dice_is_above_limit,
+        LEFTARG = fingerprint,
+        RIGHTARG = fingerprint,
+        RESTRICT = contsel,
+        JOIN = contjoinsel);
+
+COMMENT ON OPERATOR #?(fingerprint, fingerprint) IS
+    'Returns true if the Dice similarity between two fingerprints is above the user-set limit.';
+
+
+CREATE FUNCTION fingerprint_euclidean_is_above_limit(fingerprint, fingerprint)
+    RETURNS BOOLEAN
+    AS '$libdir/eigen'
+    LANGUAGE C STRICT STABLE PARALLEL SAFE;
+
+COMMENT ON FUNCTION fingerprint_euclidean_is_above_limit(fingerprint, fingerprint) IS
+    'Returns true if the Euclidean similarity between two fingerprints is above the user-set limit.';
+
+
+CREATE  OPERATOR ->? (
+        PROCEDURE = fingerprint_euclidean_is_above_limit,
+        LEFTARG = fingerprint,
+        RIGHTARG = fingerprint,
+        RESTRICT = contsel,
+        JOIN = contjoinsel);
+
+COMMENT ON OPERATOR ->?(fingerprint, fingerprint) IS
+    'Returns true if the Euclidean similarity between two fingerprints is above the user-set limit.';
+
+
+CREATE FUNCTION fingerprint_kulcz_is_above_limit(fingerprint, fingerprint)
+    RETURNS BOOLEAN
+    AS '$libdir/eigen'
+    LANGUAGE C STRICT STABLE PARALLEL SAFE;
+
+COMMENT ON FUNCTION fingerprint_kulcz_is_above_limit(fingerprint, fingerprint) IS
+    'Returns true if the Kulczynski similarity between two fingerprints is above the user-set limit.';
+
+
+CREATE  OPERATOR %? (
+        PROCEDURE = fingerprint_kulcz_is_above_limit,
+        LEFTARG = fingerprint,
+        RIGHTARG = fingerprint,
+        RESTRICT = contsel,
+        JOIN = contjoinsel);
+
+COMMENT ON OPERATOR %?(fingerprint, fingerprint) IS
+    'Returns true if the Kulczynski similarity between two fingerprints is above the user-set limit.';
+
+
+CREATE FUNCTION fingerprint_manhattan_is_above_limit(fingerprint, fingerprint)
+    RETURNS BOOLEAN
+    AS '$libdir/eigen'
+    LANGUAGE C STRICT STABLE PARALLEL SAFE;
+
+COMMENT ON FUNCTION fingerprint_manhattan_is_above_limit(fingerprint, fingerprint) IS
+    'Returns true if the Manhattan similarity between two fingerprints is above the user-set limit.';
+
+
+CREATE  OPERATOR ~>? (
+        PROCEDURE = fingerprint_manhattan_is_above_limit,
+        LEFTARG = fingerprint,
+        RIGHTARG = fingerprint,
+        RESTRICT = contsel,
+        JOIN = contjoinsel);
+
+COMMENT ON OPERATOR ~>?(fingerprint, fingerprint) IS
+    'Returns true if the Manhattan similarity between two fingerprints is above the user-set limit.';
+
+
+CREATE FUNCTION fingerprint_ochiai_is_above_limit(fingerprint, fingerprint)
+    RETURNS BOOLEAN
+    AS '$libdir/eigen'
+    LANGUAGE C STRICT STABLE PARALLEL SAFE;
+
+COMMENT ON FUNCTION fingerprint_ochiai_is_above_limit(fingerprint, fingerprint) IS
+    'Returns true if the Ochiai similarity between two fingerprints is above the user-set limit.';
+
+
+CREATE  OPERATOR @? (
+        PROCEDURE = fingerprint_ochiai_is_above_limit,
+        LEFTARG = fingerprint,
+        RIGHTARG = fingerprint,
+        RESTRICT = contsel,
+        JOIN = contjoinsel);
+
+COMMENT ON OPERATOR @?(fingerprint, fingerprint) IS
+    'Returns true if the Ochiai similarity between two fingerprints is above the user-set limit.';
+
+
+CREATE FUNCTION fingerprint_russell_rao_is_above_limit(fingerprint, fingerprint)
+    RETURNS BOOLEAN
+    AS '$libdir/eigen'
+    LANGUAGE C STRICT STABLE PARALLEL SAFE;
+
+COMMENT ON FUNCTION fingerprint_russell_rao_is_above_limit(fingerprint, fingerprint) IS
+    'Returns true if the Russell-Rao similarity between two fingerprints is above the user-set limit.';
+
+
+CREATE  OPERATOR ^? (
+        PROCEDURE = fingerprint_russell_rao_is_above_limit,
+        LEFTARG = fingerprint,
+        RIGHTARG = fingerprint,
+        RESTRICT = contsel,
+        JOIN = contjoinsel);
+
+COMMENT ON OPERATOR ^?(fingerprint, fingerprint) IS
+    'Returns true if the Russell-Rao similarity between two fingerprints is above the user-set limit.';
+
+
+CREATE FUNCTION fingerprint_simpson_is_above_limit(fingerprint, fingerprint)
+    RETURNS BOOLEAN
+    AS '$libdir/eigen'
+    LANGUAGE C STRICT STABLE PARALLEL SAFE;
+
+COMMENT ON FUNCTION fingerprint_simpson_is_above_limit(fingerprint, fingerprint) IS
+    'Returns true if the Simpson similarity between two fingerprints is above the user-set limit.';
+
+
+CREATE  OPERATOR ^^? (
+        PROCEDURE = fingerprint_simpson_is_above_limit,
+        LEFTARG = fingerprint,
+        RIGHTARG = fingerprint,
+        RESTRICT = contsel,
+        JOIN = contjoinsel);
+
+COMMENT ON OPERATOR ^^?(fingerprint, fingerprint) IS
+    'Returns true if the Simpson similarity between two fingerprints is above the user-set limit.';
+
+
+CREATE FUNCTION fingerprint_tanimoto_is_above_limit(fingerprint, fingerprint)
+    RETURNS BOOLEAN
+    AS '$libdir/eigen'
+    LANGUAGE C STRICT STABLE PARALLEL SAFE;
+
+COMMENT ON FUNCTION fingerprint_tanimoto_is_above_limit(fingerprint, fingerprint) IS
+    'Returns true if the Tanimoto similarity between two fingerprints is above the user-set limit.';
+
+
+CREATE FUNCTION fingerprint_tversky_is_above_limit(fingerprint, fingerprint)
+    RETURNS BOOLEAN
+    AS '$libdir/eigen'
+    LANGUAGE C STRICT STABLE PARALLEL SAFE;
+
+COMMENT ON FUNCTION fingerprint_tversky_is_above_limit(fingerprint, fingerprint) IS
+    'Returns true if the Tversky similarity between two fingerprints is above the user-set limit.';
+
+
+CREATE  OPERATOR %^? (
+        PROCEDURE = fingerprint_tversky_is_above_limit,
+        LEFTARG = fingerprint,
+        RIGHTARG = fingerprint,
+        RESTRICT = contsel,
+        JOIN = contjoinsel);
+
+COMMENT ON OPERATOR %^?(fingerprint, fingerprint) IS
+    'Returns true if the Tversky similarity between two fingerprints is above the user-set limit.';
+
+
+----BATCH SIMILARITY METRICS: ONE QUERY AGAINST EVERY ROW OF A TWO-DIMENSIONAL ARRAY----
+
+
+CREATE  FUNCTION arrayxi_dice_many(query arrayxi, targets INTEGER[])
+        RETURNS DOUBLE PRECISION[]
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION arrayxi_dice_many(arrayxi, INTEGER[]) IS
+    'Returns the Dice similarity between the query and every row of the targets.';
+
+
+CREATE  FUNCTION arrayxi_euclidean_many(query arrayxi, targets INTEGER[])
+        RETURNS DOUBLE PRECISION[]
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION arrayxi_euclidean_many(arrayxi, INTEGER[]) IS
+    'Returns the normalized Euclidean similarity between the query and every row of the targets.';
+
+
+CREATE  FUNCTION arrayxi_kulcz_many(query arrayxi, targets INTEGER[])
+        RETURNS DOUBLE PRECISION[]
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION arrayxi_kulcz_many(arrayxi, INTEGER[]) IS
+    'Returns the Kulczynski similarity between the query and every row of the targets.';
+
+
+CREATE  FUNCTION arrayxi_manhattan_many(query arrayxi, targets INTEGER[])
+        RETURNS DOUBLE PRECISION[]
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION arrayxi_manhattan_many(arrayxi, INTEGER[]) IS
+    'Returns the normalized Manhattan similarity between the query and every row of the targets.';
+
+
+CREATE  FUNCTION arrayxi_ochiai_many(query arrayxi, targets INTEGER[])
+        RETURNS DOUBLE PRECISION[]
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION arrayxi_ochiai_many(arrayxi, INTEGER[]) IS
+    'Returns the Ochiai/Cosine similarity between the query and every row of the targets.';
+
+
+CREATE  FUNCTION arrayxi_russell_rao_many(query arrayxi, targets INTEGER[])
+        RETURNS DOUBLE PRECISION[]
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION arrayxi_russell_rao_many(arrayxi, INTEGER[]) IS
+    'Returns the Russell-Rao similarity between the query and every row of the targets.';
+
+
+CREATE  FUNCTION arrayxi_simpson_many(query arrayxi, targets INTEGER[])
+        RETURNS DOUBLE PRECISION[]
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION arrayxi_simpson_many(arrayxi, INTEGER[]) IS
+    'Returns the Simpson similarity between the query and every row of the targets.';
+
+
+CREATE  FUNCTION arrayxi_simpson_global_many(query arrayxi, targets INTEGER[])
+        RETURNS DOUBLE PRECISION[]
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION arrayxi_simpson_global_many(arrayxi, INTEGER[]) IS
+    'Returns the global Simpson similarity between the query and every row of the targets.';
+
+
+CREATE  FUNCTION arrayxi_tanimoto_many(query arrayxi, targets INTEGER[])
+        RETURNS DOUBLE PRECISION[]
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION arrayxi_tanimoto_many(arrayxi, INTEGER[]) IS
+    'Returns the Tanimoto similarity between the query and every row of the targets.';
+
+
+CREATE  FUNCTION arrayxi_tversky_many(query arrayxi, targets INTEGER[])
+        RETURNS DOUBLE PRECISION[]
+        AS '$libdir/eigen'
+        LANGUAGE C STABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION arrayxi_tversky_many(arrayxi, INTEGER[]) IS
+    'Returns the Tversky similarity between the query and every row of the targets.';
+
+
+CREATE  FUNCTION arrayxi_fuzcavsim_global_many(query arrayxi, targets INTEGER[])
+        RETURNS DOUBLE PRECISION[]
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION arrayxi_fuzcavsim_global_many(arrayxi, INTEGER[]) IS
+    'Returns the FuzCav global similarity between the query and every row of the targets.';
+
+
+----BATCH DISTANCE METRICS: ONE QUERY AGAINST EVERY ROW OF A MATRIX----
+
+
+CREATE  FUNCTION arrayxd_euclidean_many(query arrayxd, targets matrixxd)
+        RETURNS DOUBLE PRECISION[]
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION arrayxd_euclidean_many(arrayxd, matrixxd) IS
+    'Returns the Euclidean distance between the query and every row of the targets.';
+
+
+CREATE  FUNCTION arrayxd_manhattan_many(query arrayxd, targets matrixxd)
+        RETURNS DOUBLE PRECISION[]
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION arrayxd_manhattan_many(arrayxd, matrixxd) IS
+    'Returns the Manhattan distance between the query and every row of the targets.';
+
+
+CREATE  FUNCTION arrayxd_usrsim_many(query arrayxd, targets matrixxd)
+        RETURNS DOUBLE PRECISION[]
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION arrayxd_usrsim_many(arrayxd, matrixxd) IS
+    'Returns the USR similarity between the query and every row of the targets.';
+
+
+
+--------POSTGRESQL ARRAYXI DATA TYPE GIST FUNCTIONS AND OPERATOR CLASS----------
+
+
+CREATE  FUNCTION gist_arrayxi_consistent(internal, arrayxi, smallint, oid, internal)
+        RETURNS bool
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION gist_arrayxi_consistent(internal, arrayxi, smallint, oid, internal) IS
+    'Returns false if no array below the GiST key can be above the limit of the similarity metric.';
+
+
+CREATE  FUNCTION gist_arrayxi_union(internal, internal)
+        RETURNS internal
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION gist_arrayxi_union(internal, internal) IS
+    'Returns the union of the arrayxi GiST keys.';
+
+
+CREATE  FUNCTION gist_arrayxi_compress(internal)
+        RETURNS internal
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION gist_arrayxi_compress(internal) IS
+    'Converts an array into its arrayxi GiST signature.';
+
+
+CREATE  FUNCTION gist_arrayxi_decompress(internal)
+        RETURNS internal
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION gist_arrayxi_decompress(internal) IS
+    'Detoasts an arrayxi GiST key.';
+
+
+CREATE  FUNCTION gist_arrayxi_penalty(internal, internal, internal)
+        RETURNS internal
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION gist_arrayxi_penalty(internal, internal, internal) IS
+    'Returns the cost of inserting an arrayxi GiST key below another one.';
+
+
+CREATE  FUNCTION gist_arrayxi_picksplit(internal, internal)
+        RETURNS internal
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION gist_arrayxi_picksplit(internal, internal) IS
+    'Splits a page of arrayxi GiST keys into two groups.';
+
+
+CREATE  FUNCTION gist_arrayxi_same(internal, internal, internal)
+        RETURNS internal
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION gist_arrayxi_same(internal, internal, internal) IS
+    'Returns true if both arrayxi GiST keys are identical.';
+
+
+CREATE  FUNCTION gist_arrayxi_distance(internal, arrayxi, smallint, oid, internal)
+        RETURNS float8
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION gist_arrayxi_distance(internal, arrayxi, smallint, oid, internal) IS
+    'Returns the smallest distance between the query and any array below the GiST key.';
+
+
+-- DEFAULT OPERATOR CLASSES ARE LOOKED UP FOR THE BASE TYPE OF THE ARRAYXI DOMAIN,
+-- SO A DEFAULT CLASS WOULD NEVER BE PICKED
+
+CREATE  OPERATOR CLASS arrayxi_gist_ops
+FOR TYPE arrayxi USING gist AS
+        OPERATOR  1  #?   (arrayxi, arrayxi), -- DICE SIMILARITY ABOVE LIMIT?
+        OPERATOR  2  ->?  (arrayxi, arrayxi), -- EUCLIDEAN ...
+        OPERATOR  3  %?   (arrayxi, arrayxi), -- KULCZ ...
+        OPERATOR  4  ~>?  (arrayxi, arrayxi), -- MANHATTAN ...
+        OPERATOR  5  @?   (arrayxi, arrayxi), -- OCHIAI ..
+        OPERATOR  6  ^?   (arrayxi, arrayxi), -- RUSSELL RAO ...
+        OPERATOR  7  ^^?  (arrayxi, arrayxi), -- SIMPSON ...
+        OPERATOR  8  %^?  (arrayxi, arrayxi), -- TVERSKY ...
+        OPERATOR  9  <#>  (arrayxi, arrayxi) FOR ORDER BY pg_catalog.float_ops, -- DICE KNN-GIST
+        OPERATOR 10  <->  (arrayxi, arrayxi) FOR ORDER BY pg_catalog.float_ops, -- EUCLIDEAN KNN-GIST
+        OPERATOR 11  <%>  (arrayxi, arrayxi) FOR ORDER BY pg_catalog.float_ops, -- KULCZ KNN-GIST
+        OPERATOR 12  <~>  (arrayxi, arrayxi) FOR ORDER BY pg_catalog.float_ops, -- MANHATTAN KNN-GIST
+        OPERATOR 13  <@>  (arrayxi, arrayxi) FOR ORDER BY pg_catalog.float_ops, -- OCHIAI KNN-GIST
+        OPERATOR 14  <^>  (arrayxi, arrayxi) FOR ORDER BY pg_catalog.float_ops, -- RUSSELL-RAO KNN-GIST
+        OPERATOR 15  <^^> (arrayxi, arrayxi) FOR ORDER BY pg_catalog.float_ops, -- SIMPSON KNN-GIST
+        OPERATOR 16  <%^> (arrayxi, arrayxi) FOR ORDER BY pg_catalog.float_ops, -- TVERSKY KNN-GIST
+        FUNCTION  1  gist_arrayxi_consistent(internal, arrayxi, smallint, oid, internal),
+        FUNCTION  2  gist_arrayxi_union(internal, internal),
+        FUNCTION  3  gist_arrayxi_compress(internal),
+        FUNCTION  4  gist_arrayxi_decompress(internal),
+        FUNCTION  5  gist_arrayxi_penalty(internal, internal, internal),
+        FUNCTION  6  gist_arrayxi_picksplit(internal, internal),
+        FUNCTION  7  gist_arrayxi_same(internal, internal, internal),
+        FUNCTION  8  gist_arrayxi_distance(internal, arrayxi, smallint, oid, internal);
+
+COMMENT ON OPERATOR CLASS arrayxi_gist_ops USING gist IS
+    'GiST operator class for the arrayxi similarity and KNN operators. It is not the default operator class because arrayxi is a domain, so it has to be named in CREATE INDEX.';
+
+
+
+--------------------------------------------------------------------------------
+---------------- PARALLEL SAFETY OF THE FUNCTIONS FROM VERSION 1.1 -------------
+--------------------------------------------------------------------------------
+
+
+-- THE SIMILARITY LIMITS ARE CONFIGURATION PARAMETERS NOW AND ARE PASSED ON TO
+-- PARALLEL WORKERS, SO ALL FUNCTIONS THAT WERE NOT RECREATED ABOVE ARE SAFE
+DO $$
+DECLARE
+    func regprocedure;
+BEGIN
+    FOR func IN
+        SELECT p.oid::regprocedure
+          FROM pg_catalog.pg_proc p
+          JOIN pg_catalog.pg_depend d ON d.classid = 'pg_catalog.pg_proc'::regclass AND d.objid = p.oid
+         WHERE d.refclassid = 'pg_catalog.pg_extension'::regclass
+           AND d.refobjid = (SELECT oid FROM pg_catalog.pg_extension WHERE extname = 'eigen')
+           AND d.deptype = 'e'
+           AND p.proparallel = 'u'
+           AND NOT EXISTS (SELECT 1 FROM pg_catalog.pg_aggregate a WHERE a.aggfnoid = p.oid)
+    LOOP
+        EXECUTE format('ALTER FUNCTION %s PARALLEL SAFE', func);
+    END LOOP;
+END;
+$$;
+
+
+-- EXCEPTIONS: SETTING A LIMIT CHANGES A CONFIGURATION PARAMETER, WHICH IS NOT
+-- ALLOWED IN PARALLEL MODE, AND RANDOM NUMBERS DEPEND ON THE BACKEND STATE
+ALTER FUNCTION set_arrayxi_similarity_limit(float4, text) VOLATILE PARALLEL UNSAFE;
+ALTER FUNCTION arrayxi_random(INTEGER) PARALLEL RESTRICTED;
+ALTER FUNCTION matrixxd_random(INTEGER, INTEGER) VOLATILE PARALLEL RESTRICTED;
+
+
+-- FUNCTIONS THAT READ THE LIMITS OR TVERSKY WEIGHTS DEPEND ON THE SETTINGS
+ALTER FUNCTION show_arrayxi_similarity_limit(text) STABLE;
+ALTER FUNCTION arrayxi_tversky(arrayxi, arrayxi) STABLE;
+ALTER FUNCTION arrayxi_tversky_dist(arrayxi, arrayxi) STABLE;
+ALTER FUNCTION arrayxi_dice_is_above_limit(arrayxi, arrayxi) STABLE;
+ALTER FUNCTION arrayxi_euclidean_is_above_limit(arrayxi, arrayxi) STABLE;
+ALTER FUNCTION arrayxi_kulcz_is_above_limit(arrayxi, arrayxi) STABLE;
+ALTER FUNCTION arrayxi_manhattan_is_above_limit(arrayxi, arrayxi) STABLE;
+ALTER FUNCTION arrayxi_ochiai_is_above_limit(arrayxi, arrayxi) STABLE;
+ALTER FUNCTION arrayxi_russell_rao_is_above_limit(arrayxi, arrayxi) STABLE;
+ALTER FUNCTION arrayxi_simpson_is_above_limit(arrayxi, arrayxi) STABLE;
+ALTER FUNCTION arrayxi_tversky_is_above_limit(arrayxi, arrayxi) STABLE;
+
+
+COMMENT ON FUNCTION show_arrayxi_similarity_limit(metric text) IS
+    'Show the current similarity limit (or Tversky factor) for a given metric.
+    Valid values: dice, euclidean, kulczynski, manhattan, ochiai, russell-rao, simpson,
+    tanimoto, tversky, tversky_alpha, tversky_beta. The limits are also available as
+    the configuration parameters eigen.<metric>_threshold, eigen.tversky_alpha and
+    eigen.tversky_beta.';
+
+
+COMMENT ON FUNCTION set_arrayxi_similarity_limit(sim_limit float4, metric text) IS
+    'Set the similarity limit (or Tversky factor) for a given metric.
+    Valid values: dice, euclidean, kulczynski, manhattan, ochiai, russell-rao, simpson,
+    tanimoto, tversky, tversky_alpha, tversky_beta. This is the same as setting the
+    configuration parameter eigen.<metric>_threshold, eigen.tversky_alpha or
+    eigen.tversky_beta with SET.';
+
+
+--------------------------------------------------------------------------------
+-- GIST INDEX FOR VECTOR3D
+--------------------------------------------------------------------------------
+
+CREATE  TYPE vector3d_box;
+
+CREATE  FUNCTION vector3d_box_in(cstring)
+        RETURNS vector3d_box
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_box_in(cstring) IS
+    'Parses an axis-aligned box from two opposite corners (x,y,z),(x,y,z).';
+
+
+CREATE  FUNCTION vector3d_box_out(vector3d_box)
+        RETURNS cstring
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_box_out(vector3d_box) IS
+    'Returns the text representation (x,y,z),(x,y,z) of the lower and upper corner of the box.';
+
+
+CREATE  TYPE vector3d_box (
+        INTERNALLENGTH = 48,
+        INPUT = vector3d_box_in,
+        OUTPUT = vector3d_box_out,
+        ALIGNMENT = double,
+        STORAGE = plain);
+
+COMMENT ON TYPE vector3d_box IS
+    'axis-aligned bounding box of vector3d coordinates; the key type of vector3d_gist_ops.';
+
+
+CREATE  TYPE vector3d_sphere;
+
+CREATE  FUNCTION vector3d_sphere_in(cstring)
+        RETURNS vector3d_sphere
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_sphere_in(cstring) IS
+    'Parses a sphere from its text representation <(x,y,z),radius>.';
+
+
+CREATE  FUNCTION vector3d_sphere_out(vector3d_sphere)
+        RETURNS cstring
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_sphere_out(vector3d_sphere) IS
+    'Returns the text representation <(x,y,z),radius> of the sphere.';
+
+
+CREATE  FUNCTION vector3d_sphere_recv(internal)
+        RETURNS vector3d_sphere
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_sphere_recv(internal) IS
+    'Binary input function of the vector3d_sphere type.';
+
+
+CREATE  FUNCTION vector3d_sphere_send(vector3d_sphere)
+        RETURNS bytea
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_sphere_send(vector3d_sphere) IS
+    'Binary output function of the vector3d_sphere type.';
+
+
+CREATE  TYPE vector3d_sphere (
+        INTERNALLENGTH = 32,
+        INPUT = vector3d_sphere_in,
+        OUTPUT = vector3d_sphere_out,
+        RECEIVE = vector3d_sphere_recv,
+        SEND = vector3d_sphere_send,
+        ALIGNMENT = double,
+        STORAGE = plain);
+
+COMMENT ON TYPE vector3d_sphere IS
+    'sphere given by a vector3d center and a radius, used for radius searches.';
+
+
+CREATE  FUNCTION vector3d_sphere(center vector3d, radius DOUBLE PRECISION)
+        RETURNS vector3d_sphere
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_sphere(vector3d, DOUBLE PRECISION) IS
+    'Creates a sphere with the given center and radius.';
+
+
+CREATE  FUNCTION vector3d_within(vector3d, vector3d_sphere)
+        RETURNS BOOLEAN
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_within(vector3d, vector3d_sphere) IS
+    'Returns true if the vector lies within the sphere, including its surface.';
+
+
+CREATE  FUNCTION vector3d_sphere_contains(vector3d_sphere, vector3d)
+        RETURNS BOOLEAN
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_sphere_contains(vector3d_sphere, vector3d) IS
+    'Returns true if the sphere contains the vector, including its surface.';
+
+
+CREATE  OPERATOR <@ (
+        PROCEDURE = vector3d_within,
+        LEFTARG = vector3d,
+        RIGHTARG = vector3d_sphere,
+        COMMUTATOR = '@>',
+        RESTRICT = contsel,
+        JOIN = contjoinsel
+        );
+
+COMMENT ON OPERATOR <@(vector3d, vector3d_sphere) IS
+    'Returns true if the vector lies within the sphere.';
+
+
+CREATE  OPERATOR @> (
+        PROCEDURE = vector3d_sphere_contains,
+        LEFTARG = vector3d_sphere,
+        RIGHTARG = vector3d,
+        COMMUTATOR = '<@',
+        RESTRICT = contsel,
+        JOIN = contjoinsel
+        );
+
+COMMENT ON OPERATOR @>(vector3d_sphere, vector3d) IS
+    'Returns true if the sphere contains the vector.';
+
+
+CREATE  FUNCTION gist_vector3d_consistent(internal, vector3d_sphere, smallint, oid, internal)
+        RETURNS bool
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION gist_vector3d_consistent(internal, vector3d_sphere, smallint, oid, internal) IS
+    'Returns false if no vector below the GiST key can lie within the query sphere.';
+
+
+CREATE  FUNCTION gist_vector3d_union(internal, internal)
+        RETURNS vector3d_box
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION gist_vector3d_union(internal, internal) IS
+    'Returns the bounding box of all GiST keys.';
+
+
+CREATE  FUNCTION gist_vector3d_compress(internal)
+        RETURNS internal
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION gist_vector3d_compress(internal) IS
+    'Converts a vector3d into a box without extent.';
+
+
+CREATE  FUNCTION gist_vector3d_decompress(internal)
+        RETURNS internal
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION gist_vector3d_decompress(internal) IS
+    'Returns the GiST key as it is.';
+
+
+CREATE  FUNCTION gist_vector3d_penalty(internal, internal, internal)
+        RETURNS internal
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION gist_vector3d_penalty(internal, internal, internal) IS
+    'Returns the growth of the box margin caused by inserting the new key.';
+
+
+CREATE  FUNCTION gist_vector3d_picksplit(internal, internal)
+        RETURNS internal
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION gist_vector3d_picksplit(internal, internal) IS
+    'Splits a page in halves along the longest axis of its bounding box.';
+
+
+CREATE  FUNCTION gist_vector3d_same(vector3d_box, vector3d_box, internal)
+        RETURNS internal
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION gist_vector3d_same(vector3d_box, vector3d_box, internal) IS
+    'Returns true if both GiST keys are identical.';
+
+
+CREATE  FUNCTION gist_vector3d_distance(internal, vector3d, smallint, oid, internal)
+        RETURNS float8
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION gist_vector3d_distance(internal, vector3d, smallint, oid, internal) IS
+    'Returns the smallest distance between the query and any vector below the GiST key.';
+
+
+CREATE  FUNCTION gist_vector3d_fetch(internal)
+        RETURNS internal
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION gist_vector3d_fetch(internal) IS
+    'Returns the vector3d of a leaf key for index-only scans.';
+
+
+CREATE  OPERATOR CLASS vector3d_gist_ops
+DEFAULT FOR TYPE vector3d USING gist AS
+        OPERATOR  8  <@  (vector3d, vector3d_sphere), -- WITHIN RADIUS
+        OPERATOR 15  ->  (vector3d, vector3d) FOR ORDER BY pg_catalog.float_ops, -- KNN-GIST
+        FUNCTION  1  gist_vector3d_consistent(internal, vector3d_sphere, smallint, oid, internal),
+        FUNCTION  2  gist_vector3d_union(internal, internal),
+        FUNCTION  3  gist_vector3d_compress(internal),
+        FUNCTION  4  gist_vector3d_decompress(internal),
+        FUNCTION  5  gist_vector3d_penalty(internal, internal, internal),
+        FUNCTION  6  gist_vector3d_picksplit(internal, internal),
+        FUNCTION  7  gist_vector3d_same(vector3d_box, vector3d_box, internal),
+        FUNCTION  8  gist_vector3d_distance(internal, vector3d, smallint, oid, internal),
+        FUNCTION  9  gist_vector3d_fetch(internal),
+        STORAGE vector3d_box;
+
+COMMENT ON OPERATOR CLASS vector3d_gist_ops USING gist IS
+    'GiST operator class for radius searches with <@ and nearest-neighbour searches ordered by ->.';
+
+
+---------------------------------SUPERPOSITION----------------------------------
+
+
+CREATE  FUNCTION matrixxd_kabsch(a matrixxd, b matrixxd, OUT rotation matrixxd, OUT translation vector3d)
+        RETURNS RECORD
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION matrixxd_kabsch(matrixxd, matrixxd) IS
+    'Returns the rotation matrix and translation that optimally superpose the Nx3 coordinates a onto b (Kabsch algorithm). A row r of a is moved onto b with r * rotation^T + translation.';
+
+
+CREATE  FUNCTION matrixxd_rmsd(a matrixxd, b matrixxd, superpose boolean DEFAULT true)
+        RETURNS DOUBLE PRECISION
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION matrixxd_rmsd(matrixxd, matrixxd, boolean) IS
+    'Returns the root-mean-square deviation of two Nx3 coordinate matrices, by default after their optimal superposition.';
+
+
+CREATE  FUNCTION matrixxd_rmsd_many(reference matrixxd, targets DOUBLE PRECISION[], superpose boolean DEFAULT true)
+        RETURNS DOUBLE PRECISION[]
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION matrixxd_rmsd_many(matrixxd, DOUBLE PRECISION[], boolean) IS
+    'Returns the RMSD of the reference against every Nx3 matrix of a three-dimensional array of stacked coordinate matrices, e.g. array_agg(coords).';
+
+
+------------------------------PAIRWISE DISTANCES--------------------------------
+
+
+CREATE  FUNCTION matrixxd_pairwise_distance(a matrixxd, b matrixxd, metric text DEFAULT 'euclidean')
+        RETURNS matrixxd
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION matrixxd_pairwise_distance(matrixxd, matrixxd, text) IS
+    'Returns the NxM matrix of the distances between all rows of the two matrices. Valid metrics: euclidean, manhattan.';
+
+
+-----------------------------------CONTACTS-------------------------------------
+
+
+CREATE  FUNCTION matrixxd_contacts(a matrixxd, b matrixxd, cutoff DOUBLE PRECISION,
+                                   OUT i INTEGER, OUT j INTEGER, OUT distance DOUBLE PRECISION)
+        RETURNS SETOF RECORD
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+        ROWS 1000;
+
+COMMENT ON FUNCTION matrixxd_contacts(matrixxd, matrixxd, DOUBLE PRECISION) IS
+    'Returns the row numbers i and j and the distance of all pairs of coordinates of two Nx3 matrices that are closer than the cutoff. The second matrix is binned into a uniform grid, so that only nearby coordinates are compared.';
+
+
+----USR DESCRIPTORS: SHAPE MOMENTS CALCULATED FROM NX3 COORDINATES----
+
+
+CREATE  FUNCTION usr_descriptor(coords matrixxd)
+        RETURNS arrayxd
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION usr_descriptor(matrixxd) IS
+    'Returns the 12 USR moments (mean, standard deviation and cube root of the skewness of the atomic distances to the centroid and three extreme atoms) of the Nx3 coordinates.';
+
+
+CREATE  FUNCTION usrcat_descriptor(coords matrixxd, hydrophobic arrayxi, aromatic arrayxi,
+                                   acceptor arrayxi, donor arrayxi)
+        RETURNS arrayxd
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION usrcat_descriptor(matrixxd, arrayxi, arrayxi, arrayxi, arrayxi) IS
+    'Returns the 60 USRCAT moments of the Nx3 coordinates: the USR moments of all atoms followed by those of the hydrophobic, aromatic, acceptor and donor atoms. Each mask has one element per atom; non-zero elements mark the members of the subset.';
+
+
+----ARRAYXF: SINGLE PRECISION USR AND USRCAT DESCRIPTORS----
+
+
+CREATE  DOMAIN arrayxf AS _float4
+        CONSTRAINT onedimensional CHECK(ARRAY_NDIMS(VALUE) = 1)
+        CONSTRAINT nonulls CHECK(array_has_nulls(VALUE) = FALSE);
+
+COMMENT ON TYPE arrayxf IS
+    'One-dimensional array of single precision floats; halves the storage of USR and USRCAT descriptors.';
+
+
+CREATE  FUNCTION arrayxf_usrsim(arrayxf, arrayxf)
+        RETURNS DOUBLE PRECISION
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION arrayxf_usrsim(arrayxf, arrayxf) IS
+    'Returns the USR similarity of two single precision descriptors with 12 moments each.';
+
+
+CREATE  FUNCTION arrayxf_usrcatsim(arrayxf, arrayxf, ow REAL DEFAULT 1.0,
+                                   hw REAL DEFAULT 0.25, rw REAL DEFAULT 0.25,
+                                   aw REAL DEFAULT 0.25, dw REAL DEFAULT 0.25)
+        RETURNS DOUBLE PRECISION
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION arrayxf_usrcatsim(arrayxf, arrayxf, REAL, REAL, REAL, REAL, REAL) IS
+    'Returns the USRCAT similarity of two single precision descriptors with 60 moments each, with optional weights for atom types.';
+
+
+CREATE  FUNCTION arrayxi_topk(tbl regclass, col name, query arrayxi, k INTEGER, metric text DEFAULT 'tanimoto',
+                              OUT ctid tid, OUT similarity DOUBLE PRECISION)
+        RETURNS SETOF RECORD
+        AS '$libdir/eigen'
+        LANGUAGE C STABLE STRICT PARALLEL RESTRICTED;
+
+COMMENT ON FUNCTION arrayxi_topk(regclass, name, arrayxi, INTEGER, text) IS
+    'Returns the ctid and similarity of the k rows of the table whose arrayxi column is most similar to the query, most similar first. Rows whose number of non-zero elements alone rules them out are skipped without a full comparison. Valid metrics: dice, kulczynski, ochiai, russell-rao, simpson, tanimoto, tversky.';
+
+
+------------------------------FINGERPRINT ARENA---------------------------------
+
+
+CREATE  FUNCTION arrayxi_arena_load(tbl regclass, col name)
+        RETURNS BIGINT
+        AS '$libdir/eigen'
+        LANGUAGE C VOLATILE STRICT PARALLEL UNSAFE;
+
+COMMENT ON FUNCTION arrayxi_arena_load(regclass, name) IS
+    'Replaces the content of the shared-memory fingerprint arena with the arrayxi column of the table and returns the number of fingerprints. Requires eigen in shared_preload_libraries and eigen.arena_size > 0.';
+
+-- THE ARENA IS SHARED BY ALL DATABASES, SO ONLY TRUSTED ROLES MAY REPLACE IT
+REVOKE ALL ON FUNCTION arrayxi_arena_load(regclass, name) FROM PUBLIC;
+
+
+CREATE  FUNCTION arrayxi_arena_search(query arrayxi, threshold DOUBLE PRECISION, metric text DEFAULT 'tanimoto',
+                                      OUT ctid tid, OUT similarity DOUBLE PRECISION)
+        RETURNS SETOF RECORD
+        AS '$libdir/eigen'
+        LANGUAGE C VOLATILE STRICT PARALLEL RESTRICTED;
+
+COMMENT ON FUNCTION arrayxi_arena_search(arrayxi, DOUBLE PRECISION, text) IS
+    'Returns the ctid and similarity of all fingerprints in the arena whose similarity to the query reaches the threshold, most similar first. The search runs in eigen.arena_threads threads. Valid metrics: dice, kulczynski, ochiai, russell-rao, simpson, tanimoto, tversky.';
+
+
+CREATE TABLE eigen_arena_queue
+(
+    id          BIGSERIAL PRIMARY KEY,
+    relid       OID NOT NULL,
+    op          "char" NOT NULL,
+    rowid       TID NOT NULL,
+    fp          arrayxi,
+    queued_at   TIMESTAMPTZ NOT NULL DEFAULT clock_timestamp()
+);
+
+COMMENT ON TABLE eigen_arena_queue IS
+    'Committed changes of the relation of the fingerprint arena that the background worker has not applied yet.';
+
+
+-- THE TRIGGER RUNS AS THE OWNER OF THE QUEUE, SO THAT WRITERS OF THE TABLE NEED
+-- NO PRIVILEGES ON IT; THE SEARCH PATH OF THE CALLER MUST NOT APPLY
+CREATE  FUNCTION arrayxi_arena_trigger()
+        RETURNS trigger
+        AS '$libdir/eigen'
+        LANGUAGE C SECURITY DEFINER
+        SET search_path = pg_catalog, pg_temp;
+
+COMMENT ON FUNCTION arrayxi_arena_trigger() IS
+    'Row trigger that queues the changes of an arrayxi column for the fingerprint arena while the arena holds the table: CREATE TRIGGER ... AFTER INSERT OR UPDATE OR DELETE ON tbl FOR EACH ROW EXECUTE PROCEDURE arrayxi_arena_trigger(''col''). TRUNCATE is not tracked; reload the arena after it.';
+
+
+CREATE  FUNCTION arrayxi_arena_info(OUT relation regclass, OUT col name, OUT fingerprints BIGINT,
+                                    OUT appended BIGINT, OUT deleted BIGINT, OUT capacity BIGINT,
+                                    OUT generation BIGINT, OUT size_bytes BIGINT, OUT used_bytes BIGINT,
+                                    OUT synced_at TIMESTAMPTZ, OUT worker_pid INTEGER)
+        RETURNS RECORD
+        AS '$libdir/eigen'
+        LANGUAGE C VOLATILE PARALLEL RESTRICTED;
+
+COMMENT ON FUNCTION arrayxi_arena_info() IS
+    'Returns the state of the fingerprint arena. The generation is incremented whenever the content of the arena changes.';
+
+
+CREATE VIEW arrayxi_arena_status AS
+     SELECT a.*, q.queued, COALESCE(clock_timestamp() - q.oldest, interval '0') AS lag
+       FROM arrayxi_arena_info() a
+  LEFT JOIN LATERAL (SELECT count(*) AS queued, min(queued_at) AS oldest
+                       FROM eigen_arena_queue
+                      WHERE relid = a.relation) q ON true;
+
+COMMENT ON VIEW arrayxi_arena_status IS
+    'State of the fingerprint arena with the number of queued changes and the age of the oldest one.';
+
+
+-- ALTER OPERATOR CANNOT CHANGE THE COMMUTATOR, NEGATOR OR HASHES OF AN EXISTING
+-- OPERATOR, SO BOTH ARE CREATED AGAIN; THE COMMUTATOR OF = USED TO BE != BY
+-- MISTAKE. OBJECTS OUTSIDE OF THE EXTENSION THAT USE THEM HAVE TO BE DROPPED
+-- BEFORE THE UPDATE
+
+DROP OPERATOR =(arrayxi, arrayxi);
+DROP OPERATOR !=(arrayxi, arrayxi);
+
+CREATE  OPERATOR = (
+        PROCEDURE = arrayxi_eq,
+        LEFTARG = arrayxi,
+        RIGHTARG = arrayxi,
+        COMMUTATOR = =,
+        NEGATOR = !=,
+        RESTRICT = eqsel,
+        JOIN = eqjoinsel,
+        HASHES,
+        MERGES);
+
+COMMENT ON OPERATOR =(arrayxi, arrayxi) IS
+    'Returns true if the elements in both arrays are equal.';
+
+
+CREATE  OPERATOR != (
+        PROCEDURE = arrayxi_ne,
+        LEFTARG = arrayxi,
+        RIGHTARG = arrayxi,
+        COMMUTATOR = !=,
+        NEGATOR = =,
+        RESTRICT = neqsel,
+        JOIN = neqjoinsel);
+
+COMMENT ON OPERATOR !=(arrayxi, arrayxi) IS
+    'Returns true if the arrays are distinct.';
+
+
+CREATE  FUNCTION arrayxi_hash(arrayxi)
+        RETURNS INTEGER
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION arrayxi_hash(arrayxi) IS
+    'Returns the hash of the elements of the array; used by hash joins, hash aggregates and hash indexes.';
+
+
+-- ARRAYXI IS A DOMAIN: THE PLANNER LOOKS UP DEFAULT OPERATOR CLASSES FOR ITS BASE
+-- TYPE INTEGER[], SO A DEFAULT CLASS WOULD NEVER BE PICKED. HASH JOINS FIND THE
+-- CLASS THROUGH THE = OPERATOR INSTEAD
+
+CREATE  OPERATOR CLASS arrayxi_hash_ops
+FOR TYPE arrayxi USING hash AS
+        OPERATOR  1  =  (arrayxi, arrayxi),
+        FUNCTION  1  arrayxi_hash(arrayxi);
+
+COMMENT ON OPERATOR CLASS arrayxi_hash_ops USING hash IS
+    'Hash operator class for the equality of arrayxi; used by hash joins on =(arrayxi, arrayxi). It is not the default operator class because arrayxi is a domain, so it has to be named in CREATE INDEX.';
+
+
+-----------------------------EQUALITY AND HASHING-------------------------------
+
+
+CREATE  FUNCTION fingerprint_eq(fingerprint, fingerprint)
+        RETURNS BOOLEAN
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION fingerprint_eq(fingerprint, fingerprint) IS
+    'Returns true if both fingerprints have the same bits.';
+
+
+CREATE  OPERATOR = (
+        PROCEDURE = fingerprint_eq,
+        LEFTARG = fingerprint,
+        RIGHTARG = fingerprint,
+        COMMUTATOR = =,
+        NEGATOR = !=,
+        RESTRICT = eqsel,
+        JOIN = eqjoinsel,
+        HASHES);
+
+COMMENT ON OPERATOR =(fingerprint, fingerprint) IS
+    'Returns true if both fingerprints have the same bits.';
+
+
+CREATE  FUNCTION fingerprint_ne(fingerprint, fingerprint)
+        RETURNS BOOLEAN
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION fingerprint_ne(fingerprint, fingerprint) IS
+    'Returns true if the fingerprints are distinct.';
+
+
+CREATE  OPERATOR != (
+        PROCEDURE = fingerprint_ne,
+        LEFTARG = fingerprint,
+        RIGHTARG = fingerprint,
+        COMMUTATOR = !=,
+        NEGATOR = =,
+        RESTRICT = neqsel,
+        JOIN = neqjoinsel);
+
+COMMENT ON OPERATOR !=(fingerprint, fingerprint) IS
+    'Returns true if the fingerprints are distinct.';
+
+
+CREATE  FUNCTION fingerprint_hash(fingerprint)
+        RETURNS INTEGER
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION fingerprint_hash(fingerprint) IS
+    'Returns the hash of the fingerprint; used by hash joins, hash aggregates and hash indexes.';
+
+
+CREATE  OPERATOR CLASS fingerprint_hash_ops
+DEFAULT FOR TYPE fingerprint USING hash AS
+        OPERATOR  1  =  (fingerprint, fingerprint),
+        FUNCTION  1  fingerprint_hash(fingerprint);
+
+COMMENT ON OPERATOR CLASS fingerprint_hash_ops USING hash IS
+    'Default hash operator class of fingerprint, so that GROUP BY, DISTINCT and equality joins can hash.';
+
+
+----------------------------------ARRAY ORDERING--------------------------------
+
+
+CREATE  FUNCTION arrayxi_lt(arrayxi, arrayxi)
+        RETURNS BOOLEAN
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION arrayxi_lt(arrayxi, arrayxi) IS
+    'Returns true if the first arrayxi is less than the second in the order of the B-tree operator class (number of non-zero elements first).';
+
+
+CREATE  OPERATOR < (
+        PROCEDURE = arrayxi_lt,
+        LEFTARG = arrayxi,
+        RIGHTARG = arrayxi,
+        COMMUTATOR = >,
+        NEGATOR = >=,
+        RESTRICT = scalarltsel,
+        JOIN = scalarltjoinsel);
+
+COMMENT ON OPERATOR <(arrayxi, arrayxi) IS
+    'Returns true if the first arrayxi is less than the second in the order of the B-tree operator class (number of non-zero elements first).';
+
+
+CREATE  FUNCTION arrayxi_le(arrayxi, arrayxi)
+        RETURNS BOOLEAN
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION arrayxi_le(arrayxi, arrayxi) IS
+    'Returns true if the first arrayxi is less than or equal to the second in the order of the B-tree operator class (number of non-zero elements first).';
+
+
+CREATE  OPERATOR <= (
+        PROCEDURE = arrayxi_le,
+        LEFTARG = arrayxi,
+        RIGHTARG = arrayxi,
+        COMMUTATOR = >=,
+        NEGATOR = >,
+        RESTRICT = scalarltsel,
+        JOIN = scalarltjoinsel);
+
+COMMENT ON OPERATOR <=(arrayxi, arrayxi) IS
+    'Returns true if the first arrayxi is less than or equal to the second in the order of the B-tree operator class (number of non-zero elements first).';
+
+
+CREATE  FUNCTION arrayxi_gt(arrayxi, arrayxi)
+        RETURNS BOOLEAN
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION arrayxi_gt(arrayxi, arrayxi) IS
+    'Returns true if the first arrayxi is greater than the second in the order of the B-tree operator class (number of non-zero elements first).';
+
+
+CREATE  OPERATOR > (
+        PROCEDURE = arrayxi_gt,
+        LEFTARG = arrayxi,
+        RIGHTARG = arrayxi,
+        COMMUTATOR = <,
+        NEGATOR = <=,
+        RESTRICT = scalargtsel,
+        JOIN = scalargtjoinsel);
+
+COMMENT ON OPERATOR >(arrayxi, arrayxi) IS
+    'Returns true if the first arrayxi is greater than the second in the order of the B-tree operator class (number of non-zero elements first).';
+
+
+CREATE  FUNCTION arrayxi_ge(arrayxi, arrayxi)
+        RETURNS BOOLEAN
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION arrayxi_ge(arrayxi, arrayxi) IS
+    'Returns true if the first arrayxi is greater than or equal to the second in the order of the B-tree operator class (number of non-zero elements first).';
+
+
+CREATE  OPERATOR >= (
+        PROCEDURE = arrayxi_ge,
+        LEFTARG = arrayxi,
+        RIGHTARG = arrayxi,
+        COMMUTATOR = <=,
+        NEGATOR = <,
+        RESTRICT = scalargtsel,
+        JOIN = scalargtjoinsel);
+
+COMMENT ON OPERATOR >=(arrayxi, arrayxi) IS
+    'Returns true if the first arrayxi is greater than or equal to the second in the order of the B-tree operator class (number of non-zero elements first).';
+
+
+CREATE  FUNCTION arrayxi_cmp(arrayxi, arrayxi)
+        RETURNS INTEGER
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION arrayxi_cmp(arrayxi, arrayxi) IS
+    'Returns -1, 0 or 1 if the first arrayxi is less than, equal to or greater than the second in the order of the B-tree operator class (number of non-zero elements first); support function of the B-tree operator class.';
+
+
+CREATE  FUNCTION arrayxi_sortsupport(internal)
+        RETURNS VOID
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION arrayxi_sortsupport(internal) IS
+    'Sort support function of the B-tree operator class that provides abbreviated keys.';
+
+
+-- NOT THE DEFAULT OPERATOR CLASS FOR THE SAME REASON AS ARRAYXI_HASH_OPS; MERGE
+-- JOINS AND ORDER BY ... USING < FIND IT THROUGH ITS OPERATORS
+
+CREATE  OPERATOR CLASS arrayxi_btree_ops
+FOR TYPE arrayxi USING btree AS
+        OPERATOR  1  <  (arrayxi, arrayxi),
+        OPERATOR  2  <= (arrayxi, arrayxi),
+        OPERATOR  3  =  (arrayxi, arrayxi),
+        OPERATOR  4  >= (arrayxi, arrayxi),
+        OPERATOR  5  >  (arrayxi, arrayxi),
+        FUNCTION  1  arrayxi_cmp(arrayxi, arrayxi),
+        FUNCTION  2  arrayxi_sortsupport(internal);
+
+COMMENT ON OPERATOR CLASS arrayxi_btree_ops USING btree IS
+    'B-tree operator class of arrayxi that orders arrays by their number of non-zero elements, then by the positions of the non-zero elements; sorts use abbreviated keys. It is not the default operator class because arrayxi is a domain, so it has to be named in CREATE INDEX and ORDER BY needs USING <.';
+
+
+-------------------------------VECTOR3D ORDERING--------------------------------
+
+
+CREATE  FUNCTION vector3d_eq(vector3d, vector3d)
+        RETURNS BOOLEAN
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_eq(vector3d, vector3d) IS
+    'Returns true if both vectors have the same coordinates.';
+
+
+CREATE  OPERATOR = (
+        PROCEDURE = vector3d_eq,
+        LEFTARG = vector3d,
+        RIGHTARG = vector3d,
+        COMMUTATOR = =,
+        NEGATOR = !=,
+        RESTRICT = eqsel,
+        JOIN = eqjoinsel,
+        MERGES);
+
+COMMENT ON OPERATOR =(vector3d, vector3d) IS
+    'Returns true if both vectors have the same coordinates.';
+
+
+CREATE  FUNCTION vector3d_ne(vector3d, vector3d)
+        RETURNS BOOLEAN
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_ne(vector3d, vector3d) IS
+    'Returns true if the vectors are distinct.';
+
+
+CREATE  OPERATOR != (
+        PROCEDURE = vector3d_ne,
+        LEFTARG = vector3d,
+        RIGHTARG = vector3d,
+        COMMUTATOR = !=,
+        NEGATOR = =,
+        RESTRICT = neqsel,
+        JOIN = neqjoinsel);
+
+COMMENT ON OPERATOR !=(vector3d, vector3d) IS
+    'Returns true if the vectors are distinct.';
+
+
+CREATE  FUNCTION vector3d_lt(vector3d, vector3d)
+        RETURNS BOOLEAN
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_lt(vector3d, vector3d) IS
+    'Returns true if the first vector3d is less than the second in Z-order.';
+
+
+CREATE  OPERATOR < (
+        PROCEDURE = vector3d_lt,
+        LEFTARG = vector3d,
+        RIGHTARG = vector3d,
+        COMMUTATOR = >,
+        NEGATOR = >=,
+        RESTRICT = scalarltsel,
+        JOIN = scalarltjoinsel);
+
+COMMENT ON OPERATOR <(vector3d, vector3d) IS
+    'Returns true if the first vector3d is less than the second in Z-order.';
+
+
+CREATE  FUNCTION vector3d_le(vector3d, vector3d)
+        RETURNS BOOLEAN
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_le(vector3d, vector3d) IS
+    'Returns true if the first vector3d is less than or equal to the second in Z-order.';
+
+
+CREATE  OPERATOR <= (
+        PROCEDURE = vector3d_le,
+        LEFTARG = vector3d,
+        RIGHTARG = vector3d,
+        COMMUTATOR = >=,
+        NEGATOR = >,
+        RESTRICT = scalarltsel,
+        JOIN = scalarltjoinsel);
+
+COMMENT ON OPERATOR <=(vector3d, vector3d) IS
+    'Returns true if the first vector3d is less than or equal to the second in Z-order.';
+
+
+CREATE  FUNCTION vector3d_gt(vector3d, vector3d)
+        RETURNS BOOLEAN
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_gt(vector3d, vector3d) IS
+    'Returns true if the first vector3d is greater than the second in Z-order.';
+
+
+CREATE  OPERATOR > (
+        PROCEDURE = vector3d_gt,
+        LEFTARG = vector3d,
+        RIGHTARG = vector3d,
+        COMMUTATOR = <,
+        NEGATOR = <=,
+        RESTRICT = scalargtsel,
+        JOIN = scalargtjoinsel);
+
+COMMENT ON OPERATOR >(vector3d, vector3d) IS
+    'Returns true if the first vector3d is greater than the second in Z-order.';
+
+
+CREATE  FUNCTION vector3d_ge(vector3d, vector3d)
+        RETURNS BOOLEAN
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_ge(vector3d, vector3d) IS
+    'Returns true if the first vector3d is greater than or equal to the second in Z-order.';
+
+
+CREATE  OPERATOR >= (
+        PROCEDURE = vector3d_ge,
+        LEFTARG = vector3d,
+        RIGHTARG = vector3d,
+        COMMUTATOR = <=,
+        NEGATOR = <,
+        RESTRICT = scalargtsel,
+        JOIN = scalargtjoinsel);
+
+COMMENT ON OPERATOR >=(vector3d, vector3d) IS
+    'Returns true if the first vector3d is greater than or equal to the second in Z-order.';
+
+
+CREATE  FUNCTION vector3d_cmp(vector3d, vector3d)
+        RETURNS INTEGER
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_cmp(vector3d, vector3d) IS
+    'Returns -1, 0 or 1 if the first vector3d is less than, equal to or greater than the second in Z-order; support function of the B-tree operator class.';
+
+
+CREATE  FUNCTION vector3d_sortsupport(internal)
+        RETURNS VOID
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION vector3d_sortsupport(internal) IS
+    'Sort support function of the B-tree operator class that provides abbreviated keys.';
+
+
+CREATE  OPERATOR CLASS vector3d_btree_ops
+DEFAULT FOR TYPE vector3d USING btree AS
+        OPERATOR  1  <  (vector3d, vector3d),
+        OPERATOR  2  <= (vector3d, vector3d),
+        OPERATOR  3  =  (vector3d, vector3d),
+        OPERATOR  4  >= (vector3d, vector3d),
+        OPERATOR  5  >  (vector3d, vector3d),
+        FUNCTION  1  vector3d_cmp(vector3d, vector3d),
+        FUNCTION  2  vector3d_sortsupport(internal);
+
+COMMENT ON OPERATOR CLASS vector3d_btree_ops USING btree IS
+    'Default B-tree operator class of vector3d that orders vectors along the Z-order curve of their coordinates; sorts use the Morton codes as abbreviated keys.';
+
+
+---------------POPCOUNT PARTITIONS: PRUNING WITH THE SIMILARITY BOUNDS----------
+
+
+CREATE  FUNCTION arrayxi_min_nonzeros(query arrayxi, metric TEXT)
+        RETURNS INTEGER
+        AS '$libdir/eigen'
+        LANGUAGE C STABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION arrayxi_min_nonzeros(arrayxi, TEXT) IS
+    'Returns the smallest number of non-zero elements an array can have to reach the current limit of the metric with the query.';
+
+
+CREATE  FUNCTION arrayxi_max_nonzeros(query arrayxi, metric TEXT)
+        RETURNS INTEGER
+        AS '$libdir/eigen'
+        LANGUAGE C STABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION arrayxi_max_nonzeros(arrayxi, TEXT) IS
+    'Returns the largest number of non-zero elements an array can have to reach the current limit of the metric with the query.';
+
+
+CREATE  FUNCTION arrayxi_threshold_support(internal)
+        RETURNS internal
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION arrayxi_threshold_support(internal) IS
+    'Planner support function of the threshold operators. Estimates their cost from the length of the arrays and adds the bounds of arrayxi_min_nonzeros() and arrayxi_max_nonzeros() as conditions on tables partitioned by arrayxi_nonzeros().';
+
+
+-- PLANNER SUPPORT FUNCTIONS EXIST FROM POSTGRESQL 12
+DO $$
+DECLARE
+    func TEXT;
+BEGIN
+    IF current_setting('server_version_num')::INTEGER >= 120000 THEN
+        FOREACH func IN ARRAY ARRAY['arrayxi_dice_is_above_limit', 'arrayxi_euclidean_is_above_limit',
+                                    'arrayxi_kulcz_is_above_limit', 'arrayxi_manhattan_is_above_limit',
+                                    'arrayxi_ochiai_is_above_limit', 'arrayxi_russell_rao_is_above_limit',
+                                    'arrayxi_simpson_is_above_limit', 'arrayxi_tversky_is_above_limit']
+        LOOP
+            EXECUTE format('ALTER FUNCTION %I(arrayxi, arrayxi) SUPPORT arrayxi_threshold_support', func);
+        END LOOP;
+    END IF;
+END;
+$$;
+
+
+CREATE  FUNCTION arrayxi_create_nonzeros_partitions(parent REGCLASS, width INTEGER, maxcount INTEGER)
+        RETURNS SETOF REGCLASS AS
+        $$
+        DECLARE
+            keyexpr     TEXT;
+            nspname     NAME;
+            relname     NAME;
+            defaultrel  REGCLASS;
+            partname    TEXT;
+            low         INTEGER;
+        BEGIN
+            IF width < 1 OR maxcount < 0 THEN
+                RAISE EXCEPTION 'the width of the partitions must be positive and the largest count must not be negative.';
+            END IF;
+
+            keyexpr := substring(pg_catalog.pg_get_partkeydef(parent) FROM '^RANGE \(([^,]*arrayxi_nonzeros\([^,]*\))\)$');
+
+            IF keyexpr IS NULL THEN
+                RAISE EXCEPTION 'relation % is not partitioned by RANGE (arrayxi_nonzeros(column)).', parent;
+            END IF;
+
+            SELECT n.nspname, c.relname INTO nspname, relname
+              FROM pg_catalog.pg_class c
+              JOIN pg_catalog.pg_namespace n ON n.oid = c.relnamespace
+             WHERE c.oid = parent;
+
+            SELECT i.inhrelid INTO defaultrel
+              FROM pg_catalog.pg_inherits i
+              JOIN pg_catalog.pg_class c ON c.oid = i.inhrelid
+             WHERE i.inhparent = parent
+               AND pg_catalog.pg_get_expr(c.relpartbound, c.oid) = 'DEFAULT';
+
+            -- ROWS OF A NEW RANGE THAT ARE ALREADY IN THE DEFAULT PARTITION HAVE TO BE
+            -- MOVED OUT BEFORE THE PARTITION CAN BE CREATED
+            IF defaultrel IS NOT NULL THEN
+                EXECUTE format('CREATE TEMPORARY TABLE arrayxi_moved_rows (LIKE %s) ON COMMIT DROP', parent);
+            END IF;
+
+            FOR low IN 0..maxcount BY width
+            LOOP
+                partname := format('%s_nonzeros_%s', relname, low);
+
+                CONTINUE WHEN to_regclass(format('%I.%I', nspname, partname)) IS NOT NULL;
+
+                IF defaultrel IS NOT NULL THEN
+                    EXECUTE format('WITH moved AS (DELETE FROM %s WHERE %s >= %s AND %s < %s RETURNING *) '
+                                   'INSERT INTO pg_temp.arrayxi_moved_rows SELECT * FROM moved',
+                                   defaultrel, keyexpr, low, keyexpr, low + width);
+                END IF;
+
+                EXECUTE format('CREATE TABLE %I.%I PARTITION OF %s FOR VALUES FROM (%s) TO (%s)',
+                               nspname, partname, parent, low, low + width);
+
+                IF defaultrel IS NOT NULL THEN
+                    EXECUTE format('INSERT INTO %s SELECT * FROM pg_temp.arrayxi_moved_rows', parent);
+                    TRUNCATE pg_temp.arrayxi_moved_rows;
+                END IF;
+
+                RETURN NEXT format('%I.%I', nspname, partname)::REGCLASS;
+            END LOOP;
+
+            IF defaultrel IS NOT NULL THEN
+                DROP TABLE pg_temp.arrayxi_moved_rows;
+            ELSE
+                partname := format('%s_nonzeros_default', relname);
+
+                EXECUTE format('CREATE TABLE %I.%I PARTITION OF %s DEFAULT', nspname, partname, parent);
+
+                RETURN NEXT format('%I.%I', nspname, partname)::REGCLASS;
+            END IF;
+        END;
+        $$
+        LANGUAGE plpgsql;
+
+COMMENT ON FUNCTION arrayxi_create_nonzeros_partitions(REGCLASS, INTEGER, INTEGER) IS
+    'Creates the missing partitions of a table partitioned by RANGE (arrayxi_nonzeros(column)), one for every WIDTH counts up to MAXCOUNT and a default partition for larger counts; rows of new ranges are moved out of the default partition. Returns the new partitions. Threshold searches on the table only scan the partitions that can reach the limit (PostgreSQL 12 or later).';
+
+
+CREATE  FUNCTION arrayxi_positions(arrayxi)
+        RETURNS INTEGER[]
+        AS '$libdir/eigen'
+        LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION arrayxi_positions(arrayxi) IS
+    'Returns the one-based positions of the non-zero elements in the array. The statistics of the expression are the histogram of the non-zero counts and the frequencies of the set bits, which the threshold operators use for their estimates.';
+
+
+CREATE  FUNCTION arrayxi_create_statistics(tbl REGCLASS, col NAME)
+        RETURNS VOID AS
+        $$
+        DECLARE
+            extnspname  NAME;
+            nspname     NAME;
+            relname     NAME;
+            func        TEXT;
+        BEGIN
+            -- THE FUNCTIONS ARE IN THE SCHEMA OF THE ARRAYXI TYPE, WHICH NEED NOT BE
+            -- IN THE SEARCH PATH
+            SELECT tn.nspname, n.nspname, c.relname INTO extnspname, nspname, relname
+              FROM pg_catalog.pg_attribute a
+              JOIN pg_catalog.pg_type t ON t.oid = a.atttypid
+              JOIN pg_catalog.pg_namespace tn ON tn.oid = t.typnamespace
+              JOIN pg_catalog.pg_class c ON c.oid = a.attrelid
+              JOIN pg_catalog.pg_namespace n ON n.oid = c.relnamespace
+             WHERE a.attrelid = tbl
+               AND a.attname = col
+               AND NOT a.attisdropped
+               AND t.typname = 'arrayxi';
+
+            IF extnspname IS NULL THEN
+                RAISE EXCEPTION 'relation % has no column % of type arrayxi.', tbl, col;
+            END IF;
+
+            -- STATISTICS ON EXPRESSIONS EXIST FROM POSTGRESQL 14
+            IF current_setting('server_version_num')::INTEGER < 140000 THEN
+                RAISE EXCEPTION 'statistics on expressions require PostgreSQL 14 or later.'
+                      USING HINT = format('Indexes on %I.arrayxi_positions(%I) and %I.arrayxi_nonzeros(%I) provide the same statistics.',
+                                          extnspname, col, extnspname, col);
+            END IF;
+
+            FOREACH func IN ARRAY ARRAY['positions', 'nonzeros']
+            LOOP
+                EXECUTE format('CREATE STATISTICS IF NOT EXISTS %I.%I ON (%I.%I(%I)) FROM %s',
+                               nspname, format('%s_%s_%s', relname, col, func),
+                               extnspname, 'arrayxi_' || func, col, tbl);
+            END LOOP;
+        END;
+        $$
+        LANGUAGE plpgsql;
+
+COMMENT ON FUNCTION arrayxi_create_statistics(REGCLASS, NAME) IS
+    'Creates statistics on arrayxi_positions(column) and arrayxi_nonzeros(column) of an arrayxi column (PostgreSQL 14 or later), which are gathered by the next ANALYZE. The threshold operators estimate their selectivity from the popcount histogram and the bit frequencies they contain, also for fingerprints too wide for the statistics of the column itself.';
+
+
+-------------------THRESHOLD OPERATORS: SELECTIVITY AND COST--------------------
+
+
+CREATE  FUNCTION arrayxi_threshold_sel(internal, oid, internal, integer)
+        RETURNS float8
+        AS '$libdir/eigen'
+        LANGUAGE C STABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION arrayxi_threshold_sel(internal, oid, internal, integer) IS
+    'Restriction selectivity of the threshold operators; evaluates the operator against the most common arrays and the histogram of the column. For a constant query the estimate is taken from the bit frequencies and popcount histogram of arrayxi_positions(column) if the column has no statistics of its own, and capped by the statistics of arrayxi_nonzeros(column); an index or, from PostgreSQL 14 on, arrayxi_create_statistics() provides them.';
+
+
+CREATE  FUNCTION arrayxi_threshold_joinsel(internal, oid, internal, smallint, internal)
+        RETURNS float8
+        AS '$libdir/eigen'
+        LANGUAGE C STABLE STRICT PARALLEL SAFE;
+
+COMMENT ON FUNCTION arrayxi_threshold_joinsel(internal, oid, internal, smallint, internal) IS
+    'Join selectivity of the threshold operators; evaluates the operator between the most common arrays and the histograms of both columns.';
+
+
+ALTER OPERATOR #?(arrayxi, arrayxi) SET (RESTRICT = arrayxi_threshold_sel, JOIN = arrayxi_threshold_joinsel);
+ALTER OPERATOR ->?(arrayxi, arrayxi) SET (RESTRICT = arrayxi_threshold_sel, JOIN = arrayxi_threshold_joinsel);
+ALTER OPERATOR %?(arrayxi, arrayxi) SET (RESTRICT = arrayxi_threshold_sel, JOIN = arrayxi_threshold_joinsel);
+ALTER OPERATOR ~>?(arrayxi, arrayxi) SET (RESTRICT = arrayxi_threshold_sel, JOIN = arrayxi_threshold_joinsel);
+ALTER OPERATOR @?(arrayxi, arrayxi) SET (RESTRICT = arrayxi_threshold_sel, JOIN = arrayxi_threshold_joinsel);
+ALTER OPERATOR ^?(arrayxi, arrayxi) SET (RESTRICT = arrayxi_threshold_sel, JOIN = arrayxi_threshold_joinsel);
+ALTER OPERATOR ^^?(arrayxi, arrayxi) SET (RESTRICT = arrayxi_threshold_sel, JOIN = arrayxi_threshold_joinsel);
+ALTER OPERATOR %^?(arrayxi, arrayxi) SET (RESTRICT = arrayxi_threshold_sel, JOIN = arrayxi_threshold_joinsel);
+
+
+ALTER FUNCTION arrayxi_dice_is_above_limit(arrayxi, arrayxi) COST 16;
+ALTER FUNCTION arrayxi_euclidean_is_above_limit(arrayxi, arrayxi) COST 16;
+ALTER FUNCTION arrayxi_kulcz_is_above_limit(arrayxi, arrayxi) COST 16;
+ALTER FUNCTION arrayxi_manhattan_is_above_limit(arrayxi, arrayxi) COST 16;
+ALTER FUNCTION arrayxi_ochiai_is_above_limit(arrayxi, arrayxi) COST 16;
+ALTER FUNCTION arrayxi_russell_rao_is_above_limit(arrayxi, arrayxi) COST 16;
+ALTER FUNCTION arrayxi_simpson_is_above_limit(arrayxi, arrayxi) COST 16;
+ALTER FUNCTION arrayxi_tversky_is_above_limit(arrayxi, arrayxi) COST 16;
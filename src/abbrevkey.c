@@ -0,0 +1,81 @@
+#include "abbrevkey.h"
+
+
+// MIXES THE BITS OF THE KEY FOR THE CARDINALITY ESTIMATE (FINALIZER OF SPLITMIX64)
+static uint32 abbrev_key_mix(uint64 key)
+{
+    key ^= key >> 30;
+    key *= UINT64CONST(0xbf58476d1ce4e5b9);
+    key ^= key >> 27;
+    key *= UINT64CONST(0x94d049bb133111eb);
+    key ^= key >> 31;
+
+    return (uint32) key;
+}
+
+// ABBREVIATED KEYS ARE COMPARED AS UNSIGNED INTEGERS
+static int abbrev_key_cmp(Datum x, Datum y, SortSupport ssup)
+{
+    if (x > y) return 1;
+    else if (x < y) return -1;
+
+    return 0;
+}
+
+/* Decides whether the sort should stop using abbreviated keys; the thresholds
+ * are the ones of the built-in uuid and numeric types: as long as there is at
+ * least one distinct key per 2000 values, the cheaper comparisons pay for the
+ * conversion.
+ */
+static bool abbrev_key_abort(int memtupcount, SortSupport ssup)
+{
+    AbbrevKeyState *state = (AbbrevKeyState *) ssup->ssup_extra;
+    double          abbr_card;
+
+    if (memtupcount < 10000 || state->input_count < 10000 || !state->estimating) return false;
+
+    abbr_card = estimateHyperLogLog(&state->abbr_card);
+
+    // ENOUGH DISTINCT KEYS; STOP ESTIMATING FOR THE REST OF THE SORT
+    if (abbr_card > 100000.0)
+    {
+        state->estimating = false;
+        return false;
+    }
+
+    return abbr_card < state->input_count / 2000.0 + 0.5;
+}
+
+void abbrev_key_setup(SortSupport ssup, Datum (*converter) (Datum original, SortSupport ssup))
+{
+    AbbrevKeyState *state;
+
+    if (!ssup->abbreviate) return;
+
+    state = (AbbrevKeyState *) MemoryContextAlloc(ssup->ssup_cxt, sizeof(AbbrevKeyState));
+
+    state->input_count = 0;
+    state->estimating = true;
+    initHyperLogLog(&state->abbr_card, 10);
+
+    ssup->ssup_extra = state;
+    ssup->abbrev_full_comparator = ssup->comparator;
+    ssup->comparator = abbrev_key_cmp;
+    ssup->abbrev_converter = converter;
+    ssup->abbrev_abort = abbrev_key_abort;
+}
+
+Datum abbrev_key_datum(uint64 key, SortSupport ssup)
+{
+    AbbrevKeyState *state = (AbbrevKeyState *) ssup->ssup_extra;
+
+    state->input_count++;
+
+    if (state->estimating) addHyperLogLog(&state->abbr_card, abbrev_key_mix(key));
+
+#if SIZEOF_DATUM == 8
+    return (Datum) key;
+#else
+    return (Datum) (key >> 32);
+#endif
+}
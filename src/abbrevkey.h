@@ -0,0 +1,40 @@
+#ifndef ABBREVKEY_H
+#define ABBREVKEY_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    #include "postgres.h"
+    #include "lib/hyperloglog.h"
+    #include "utils/sortsupport.h"
+
+    /* Abbreviated keys of the B-tree sort support functions. The kernels build
+     * 64-bit keys whose unsigned order agrees with the full comparator wherever
+     * two keys differ; on platforms with a 32-bit Datum only the leading half
+     * of the key is kept, which is still consistent.
+     *
+     * The number of distinct keys is estimated while the sort converts its
+     * input, so that abbreviation can be abandoned if the keys turn out to be
+     * useless, e.g. when all values share the same leading bits.
+     */
+    typedef struct
+    {
+        int64            input_count;   // NUMBER OF CONVERTED VALUES
+        bool             estimating;    // FALSE ONCE THE KEYS ARE KNOWN TO BE GOOD
+        hyperLogLogState abbr_card;     // CARDINALITY OF THE KEYS
+    } AbbrevKeyState;
+
+    // INSTALLS THE CONVERTER IF THE SORT CAN USE ABBREVIATED KEYS; THE FULL
+    // COMPARATOR HAS TO BE SET ALREADY
+    void  abbrev_key_setup(SortSupport ssup, Datum (*converter) (Datum original, SortSupport ssup));
+
+    // RETURNS THE 64-BIT KEY AS ABBREVIATED DATUM AND COUNTS IT
+    Datum abbrev_key_datum(uint64 key, SortSupport ssup);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
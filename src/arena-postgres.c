@@ -0,0 +1,543 @@
+#include "arena.h"
+#include "fmgr.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "access/htup_details.h"
+#include "catalog/pg_type.h"
+#include "executor/spi.h"
+#include "storage/ipc.h"
+#include "storage/lmgr.h"
+#include "storage/shmem.h"
+#include "utils/acl.h"
+#include "utils/builtins.h"
+#include "utils/guc.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/snapmgr.h"
+
+
+// NUMBER OF ROWS THAT ARE FETCHED FROM THE CURSOR AT ONCE
+#define ARENA_LOAD_BATCH_SIZE 1024
+
+// NUMBER OF FINGERPRINTS A SEARCH COMPARES BEFORE IT RELEASES THE LOCK OF THE
+// ARENA TO CHECK FOR INTERRUPTS
+#define ARENA_SEARCH_CHUNK_SIZE (INT64CONST(1) << 20)
+
+// SIZE OF THE ARENA IN MEGABYTES; THE ARENA IS ONLY CREATED IF THE LIBRARY IS
+// PRELOADED AND THE SIZE IS GREATER THAN ZERO
+static int arena_size = 0;
+
+// THE SIZE ACCEPTS UNITS LIKE '32GB' FROM POSTGRESQL 11; THE LIMIT IS THE ONE OF
+// SHARED_BUFFERS AND OTHER MEMORY PARAMETERS, ABOUT 2TB ON 64-BIT PLATFORMS
+#ifdef GUC_UNIT_MB
+#define ARENA_SIZE_FLAGS GUC_UNIT_MB
+#else
+#define ARENA_SIZE_FLAGS 0
+#endif
+
+#define ARENA_MAX_SIZE (MAX_KILOBYTES / 1024)
+
+// NUMBER OF THREADS OF A SEARCH, INCLUDING THE BACKEND ITSELF
+static int arena_threads = 4;
+
+ArenaHeader *fingerprint_arena = NULL;
+
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+#if PG_VERSION_NUM >= 150000
+static shmem_request_hook_type prev_shmem_request_hook = NULL;
+#endif
+
+// A ROW OF THE RESULT OF A SEARCH
+typedef struct
+{
+    double          similarity;
+    ItemPointerData ctid;
+} ArenaResult;
+
+
+//////////////////////////////////SHARED MEMORY/////////////////////////////////
+
+
+static Size arena_shmem_size(void)
+{
+    return add_size(offsetof(ArenaHeader, data), (Size) arena_size * 1024 * 1024);
+}
+
+static void arena_shmem_request(void)
+{
+#if PG_VERSION_NUM >= 150000
+    if (prev_shmem_request_hook) prev_shmem_request_hook();
+#endif
+
+    RequestAddinShmemSpace(arena_shmem_size());
+    RequestNamedLWLockTranche("eigen_arena", 1);
+}
+
+static void arena_shmem_startup(void)
+{
+    bool found;
+
+    if (prev_shmem_startup_hook) prev_shmem_startup_hook();
+
+    LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+    fingerprint_arena = (ArenaHeader *) ShmemInitStruct("eigen_arena", arena_shmem_size(), &found);
+
+    // THE ARENA IS EMPTY UNTIL IT IS LOADED
+    if (!found)
+    {
+        memset(fingerprint_arena, 0, offsetof(ArenaHeader, data));
+
+        fingerprint_arena->lock = &(GetNamedLWLockTranche("eigen_arena"))->lock;
+        fingerprint_arena->size = (Size) arena_size * 1024 * 1024;
+    }
+
+    LWLockRelease(AddinShmemInitLock);
+}
+
+// REGISTERS THE CONFIGURATION PARAMETERS OF THE ARENA AND REQUESTS ITS SHARED
+// MEMORY IF THE LIBRARY IS LOADED THROUGH SHARED_PRELOAD_LIBRARIES
+void arena_init(void)
+{
+    DefineCustomIntVariable("eigen.arena_size",
+                            "Size of the shared-memory fingerprint arena in megabytes.",
+                            "Requires eigen in shared_preload_libraries; 0 disables the arena.",
+                            &arena_size, 0, 0, ARENA_MAX_SIZE,
+                            PGC_POSTMASTER, ARENA_SIZE_FLAGS, NULL, NULL, NULL);
+
+    DefineCustomIntVariable("eigen.arena_threads",
+                            "Number of threads of a similarity search in the fingerprint arena.",
+                            NULL, &arena_threads, 4, 1, 64,
+                            PGC_USERSET, 0, NULL, NULL, NULL);
+
+    DefineCustomIntVariable("eigen.arena_naptime",
+                            "Milliseconds the fingerprint arena worker waits for new changes.",
+                            NULL, &arena_naptime, 200, 10, 60000,
+                            PGC_SIGHUP, 0, NULL, NULL, NULL);
+
+    if (!process_shared_preload_libraries_in_progress || arena_size == 0) return;
+
+#if PG_VERSION_NUM >= 150000
+    prev_shmem_request_hook = shmem_request_hook;
+    shmem_request_hook = arena_shmem_request;
+#else
+    arena_shmem_request();
+#endif
+
+    prev_shmem_startup_hook = shmem_startup_hook;
+    shmem_startup_hook = arena_shmem_startup;
+}
+
+static ArenaHeader *arena_check_available(void)
+{
+    if (fingerprint_arena == NULL)
+    {
+        ereport(ERROR, (errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+                        errmsg("the fingerprint arena is not available; add eigen to shared_preload_libraries and set eigen.arena_size.")));
+    }
+
+    return fingerprint_arena;
+}
+
+
+/////////////////////////////////////LOADING////////////////////////////////////
+
+
+/* Fingerprints of a column while it is scanned. The whole column is read into
+ * local memory before the arena is locked, so that searches are only blocked
+ * while the fingerprints are copied into the arena.
+ */
+typedef struct
+{
+    int              nbits;
+    int              nwords;
+    int64            count;
+    int64            capacity;
+    ItemPointerData *ctids;
+    int32           *popcounts;
+    uint64          *words;
+} ArenaLoad;
+
+static void arena_load_append(ArenaLoad *load, ItemPointer ctid, ArrayType *array)
+{
+    if (load->count == load->capacity)
+    {
+        load->capacity *= 2;
+
+        load->ctids = (ItemPointerData *) repalloc_huge(load->ctids, sizeof(ItemPointerData) * load->capacity);
+        load->popcounts = (int32 *) repalloc_huge(load->popcounts, sizeof(int32) * load->capacity);
+        load->words = (uint64 *) repalloc_huge(load->words, sizeof(uint64) * load->nwords * load->capacity);
+    }
+
+    ItemPointerCopy(ctid, &load->ctids[load->count]);
+    load->popcounts[load->count] = ArenaPack(array, load->words + load->count * load->nwords, load->nwords);
+    load->count++;
+}
+
+/* Reads all non-NULL values of the column of the relation. Queued changes of
+ * the relation are discarded first: they were committed before the scan starts
+ * and are part of it. Changes that are queued later are applied by the worker
+ * even if the scan saw them already, which is harmless because they replace
+ * the fingerprint of the same ctid. The scan uses a new snapshot, since the
+ * one of the statement is older than the writers that were waited for.
+ */
+static void arena_load_scan(ArenaLoad *load, Oid relid, const char *column, const char *queue)
+{
+    StringInfoData  sql;
+    Portal          portal;
+    MemoryContext   loadcontext = CurrentMemoryContext;
+    MemoryContext   batchcontext, oldcontext;
+    Oid             argtypes[1] = {OIDOID};
+    Datum           values[1] = {ObjectIdGetDatum(relid)};
+    uint64          i;
+
+    if (SPI_connect() != SPI_OK_CONNECT)
+    {
+        ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR), errmsg("SPI_connect failed")));
+    }
+
+    initStringInfo(&sql);
+    appendStringInfo(&sql, "DELETE FROM %s WHERE relid = $1", queue);
+
+    if (SPI_execute_with_args(sql.data, 1, argtypes, values, NULL, false, 0) != SPI_OK_DELETE)
+    {
+        ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR), errmsg("could not clear the fingerprint arena queue")));
+    }
+
+    resetStringInfo(&sql);
+    appendStringInfo(&sql, "SELECT ctid, %s FROM %s", quote_identifier(column),
+                     DatumGetCString(DirectFunctionCall1(regclassout, ObjectIdGetDatum(relid))));
+
+    // A READ-ONLY CURSOR RUNS WITH THE ACTIVE SNAPSHOT
+    PushActiveSnapshot(GetLatestSnapshot());
+    portal = SPI_cursor_open_with_args(NULL, sql.data, 0, NULL, NULL, NULL, true, 0);
+    PopActiveSnapshot();
+
+    // DETOASTED ARRAYS ARE FREED AFTER EVERY BATCH
+    batchcontext = AllocSetContextCreate(loadcontext, "arena load batch", ALLOCSET_DEFAULT_SIZES);
+
+    for (;;)
+    {
+        SPI_cursor_fetch(portal, true, ARENA_LOAD_BATCH_SIZE);
+
+        if (SPI_processed == 0) break;
+
+        if (getBaseType(SPI_gettypeid(SPI_tuptable->tupdesc, 2)) != INT4ARRAYOID)
+        {
+            ereport(ERROR, (errcode(ERRCODE_DATATYPE_MISMATCH),
+                            errmsg("column \"%s\" must be of type arrayxi or integer[].", column)));
+        }
+
+        for (i = 0; i < SPI_processed; i++)
+        {
+            HeapTuple   tuple = SPI_tuptable->vals[i];
+            bool        isnull;
+            Datum       ctid = SPI_getbinval(tuple, SPI_tuptable->tupdesc, 1, &isnull);
+            Datum       value = SPI_getbinval(tuple, SPI_tuptable->tupdesc, 2, &isnull);
+            ArrayType  *array;
+            int         nbits;
+
+            if (isnull) continue;
+
+            oldcontext = MemoryContextSwitchTo(batchcontext);
+            array = DatumGetArrayTypeP(value);
+
+            // INTEGER[] COLUMNS ARE NOT CHECKED BY THE ARRAYXI DOMAIN
+            arrayxi_check_array(array);
+            nbits = ArrayXiSize(array);
+
+            // THE FIRST ROW DETERMINES THE SIZE OF ALL FINGERPRINTS
+            if (load->ctids == NULL)
+            {
+                load->nbits = nbits;
+                load->nwords = (nbits + 63) / 64;
+                load->capacity = ARENA_LOAD_BATCH_SIZE;
+
+                load->ctids = (ItemPointerData *) MemoryContextAllocHuge(loadcontext, sizeof(ItemPointerData) * load->capacity);
+                load->popcounts = (int32 *) MemoryContextAllocHuge(loadcontext, sizeof(int32) * load->capacity);
+                load->words = (uint64 *) MemoryContextAllocHuge(loadcontext, sizeof(uint64) * load->nwords * load->capacity);
+            }
+            else if (nbits != load->nbits)
+            {
+                ereport(ERROR, (errcode(ERRCODE_DATA_EXCEPTION),
+                                errmsg("all values of column \"%s\" must have the same number of elements; found %d and %d.",
+                                       column, load->nbits, nbits)));
+            }
+
+            arena_load_append(load, (ItemPointer) DatumGetPointer(ctid), array);
+
+            MemoryContextSwitchTo(oldcontext);
+        }
+
+        MemoryContextReset(batchcontext);
+
+        SPI_freetuptable(SPI_tuptable);
+    }
+
+    SPI_cursor_close(portal);
+    SPI_finish();
+}
+
+/* Replaces the content of the arena with the arrayxi column of the relation and
+ * returns the number of fingerprints. The fingerprints are ordered by their
+ * population count (counting sort) and the start of every popcount bucket is
+ * stored in front of them. From now on the triggers of the relation queue its
+ * changes, which the background worker of the database applies to the arena.
+ */
+PG_FUNCTION_INFO_V1(arrayxi_arena_load);
+Datum arrayxi_arena_load(PG_FUNCTION_ARGS)
+{
+    Oid          relid = PG_GETARG_OID(0);
+    Name         column = PG_GETARG_NAME(1);
+    ArenaHeader *arena = arena_check_available();
+    char        *queue = arena_queue_name(get_func_namespace(fcinfo->flinfo->fn_oid));
+    ArenaLoad    load;
+    int64       *buckets, *next;
+    int64        capacity, i;
+    bool         startworker;
+
+    // CHANGES THAT ARE COMMITTED DURING THE SCAN MUST ALREADY BE QUEUED
+    LWLockAcquire(arena->lock, LW_EXCLUSIVE);
+    arena->syncdbid = MyDatabaseId;
+    arena->syncrelid = relid;
+    LWLockRelease(arena->lock);
+
+    memset(&load, 0, sizeof(ArenaLoad));
+
+    /* The relation is already synced, so a failed load must not leave the arena
+     * claiming to be in sync with it: the arena is marked as not loaded, which
+     * also stops the worker, and gets a new generation like any other change.
+     */
+    PG_TRY();
+    {
+        /* Writers whose triggers ran before the relation was synced did not
+         * queue their changes, which the scan would miss if they commit after
+         * its snapshot. They hold a ROW EXCLUSIVE lock until they end, so a
+         * SHARE lock waits for them; later writers see that the relation is
+         * synced. The lock is released right away, the scan does not have to
+         * block writers.
+         */
+        LockRelationOid(relid, ShareLock);
+        UnlockRelationOid(relid, ShareLock);
+
+        arena_load_scan(&load, relid, NameStr(*column), queue);
+
+        capacity = ArenaCapacity(arena->size, load.nbits);
+
+        if (load.count > capacity)
+        {
+            ereport(ERROR, (errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+                            errmsg("the fingerprint arena can only hold %lld fingerprints of this size but the column has %lld; increase eigen.arena_size.",
+                                   (long long) capacity, (long long) load.count)));
+        }
+    }
+    PG_CATCH();
+    {
+        LWLockAcquire(arena->lock, LW_EXCLUSIVE);
+        arena->syncdbid = arena->syncrelid = InvalidOid;
+        arena->dbid = arena->relid = InvalidOid;
+        arena->count = arena->nsorted = arena->ndeleted = 0;
+        arena->generation++;
+        LWLockRelease(arena->lock);
+
+        PG_RE_THROW();
+    }
+    PG_END_TRY();
+
+    next = (int64 *) palloc0(sizeof(int64) * (load.nbits + 2));
+
+    for (i = 0; i < load.count; i++) next[load.popcounts[i] + 1]++;
+    for (i = 1; i < load.nbits + 2; i++) next[i] += next[i - 1];
+
+    LWLockAcquire(arena->lock, LW_EXCLUSIVE);
+
+    arena->dbid = MyDatabaseId;
+    arena->relid = relid;
+    namestrcpy(&arena->column, NameStr(*column));
+    arena->nbits = load.nbits;
+    arena->nwords = load.nwords;
+    arena->count = arena->nsorted = load.count;
+    arena->ndeleted = 0;
+    arena->capacity = capacity;
+
+    buckets = ARENA_BUCKETS(arena);
+    memcpy(buckets, next, sizeof(int64) * ARENA_NBUCKETS(arena));
+
+    for (i = 0; i < load.count; i++)
+    {
+        int64 position = next[load.popcounts[i]]++;
+
+        ItemPointerCopy(&load.ctids[i], &ARENA_CTIDS(arena)[position]);
+        memcpy(ARENA_WORDS(arena) + position * load.nwords, load.words + i * load.nwords,
+               sizeof(uint64) * load.nwords);
+    }
+
+    arena->generation++;
+    arena->synced_at = GetCurrentTimestamp();
+
+    startworker = arena->workerpid == 0 || arena->workerdbid != MyDatabaseId;
+
+    LWLockRelease(arena->lock);
+
+    if (startworker) arena_start_worker();
+
+    PG_RETURN_INT64(load.count);
+}
+
+
+/////////////////////////////////////SEARCHING//////////////////////////////////
+
+
+// SORTS THE RESULT BY DECREASING SIMILARITY
+static int arena_result_cmp(const void *a, const void *b)
+{
+    double sa = ((const ArenaResult *) a)->similarity;
+    double sb = ((const ArenaResult *) b)->similarity;
+
+    return (sa < sb) - (sa > sb);
+}
+
+/* Searches the arena for all fingerprints whose similarity to the query reaches
+ * the threshold and returns their ctid in the loaded relation and their
+ * similarity, most similar first. The search itself is run by
+ * eigen.arena_threads threads while the backend holds the lock of the arena,
+ * which it releases after every chunk of fingerprints.
+ */
+PG_FUNCTION_INFO_V1(arrayxi_arena_search);
+Datum arrayxi_arena_search(PG_FUNCTION_ARGS)
+{
+    FuncCallContext *funcctx;
+    ArenaResult     *results = NULL;
+
+    if (SRF_IS_FIRSTCALL())
+    {
+        ArrayType      *query = PG_GETARG_ARRAYTYPE_P(0);
+        double          threshold = PG_GETARG_FLOAT8(1);
+        ArrayXiMetric   metric = arrayxi_ranking_metric(PG_GETARG_TEXT_AS_CSTRING(2));
+
+        ArenaHeader    *arena = arena_check_available();
+        MemoryContext   oldcontext;
+        TupleDesc       tupdesc;
+        ArenaHit       *hits;
+        uint64         *words = NULL;
+        uint64          generation = 0;
+        int64           begin = 0, total, nhits, nresults = 0, allocated = 0, i;
+
+        funcctx = SRF_FIRSTCALL_INIT();
+
+        // THE RESULT HAS TO SURVIVE UNTIL THE LAST CALL
+        oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+        if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+        {
+            ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                            errmsg("function returning record called in context that cannot accept type record")));
+        }
+
+        // INTEGER[] QUERIES ARE NOT CHECKED BY THE ARRAYXI DOMAIN
+        arrayxi_check_array(query);
+
+        /* The arena is searched in chunks, between which the lock is released
+         * to check for interrupts; a backend holding a lightweight lock cannot
+         * be cancelled. If the arena changes between two chunks, the search
+         * starts over, since the positions of the fingerprints have changed.
+         */
+        for (;;)
+        {
+            LWLockAcquire(arena->lock, LW_SHARED);
+
+            if (begin == 0 || arena->generation != generation)
+            {
+                if (!OidIsValid(arena->relid) || arena->dbid != MyDatabaseId)
+                {
+                    ereport(ERROR, (errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+                                    errmsg("the fingerprint arena has not been loaded in this database; use arrayxi_arena_load() first.")));
+                }
+
+                // THE RESULT REVEALS WHICH ROWS ARE SIMILAR TO THE QUERY
+                if (pg_class_aclcheck(arena->relid, GetUserId(), ACL_SELECT) != ACLCHECK_OK)
+                {
+                    ereport(ERROR, (errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+                                    errmsg("permission denied for the relation of the fingerprint arena.")));
+                }
+
+                if (ArrayXiSize(query) != arena->nbits)
+                {
+                    ereport(ERROR, (errcode(ERRCODE_DATA_EXCEPTION),
+                                    errmsg("the query has %d elements but the fingerprints of the arena have %d.",
+                                           ArrayXiSize(query), arena->nbits)));
+                }
+
+                if (words == NULL) words = (uint64 *) palloc(sizeof(uint64) * Max(arena->nwords, 1));
+                else words = (uint64 *) repalloc(words, sizeof(uint64) * Max(arena->nwords, 1));
+
+                ArenaPack(query, words, arena->nwords);
+
+                generation = arena->generation;
+                begin = 0;
+                nresults = 0;
+            }
+
+            hits = ArenaSearch(arena, words, metric, threshold, arena_threads,
+                               begin, begin + ARENA_SEARCH_CHUNK_SIZE, &total, &nhits);
+
+            if (results == NULL || nresults + nhits > allocated)
+            {
+                allocated = Max(2 * allocated, Max(nresults + nhits, 1));
+                results = (results == NULL)
+                    ? (ArenaResult *) MemoryContextAllocHuge(funcctx->multi_call_memory_ctx, sizeof(ArenaResult) * allocated)
+                    : (ArenaResult *) repalloc_huge(results, sizeof(ArenaResult) * allocated);
+            }
+
+            // THE CTIDS HAVE TO BE COPIED BEFORE THE ARENA CAN CHANGE
+            for (i = 0; i < nhits; i++)
+            {
+                ItemPointer ctid = &ARENA_CTIDS(arena)[hits[i].index];
+
+                // DELETED FINGERPRINTS THAT HAVE NOT BEEN COMPACTED YET
+                if (!ItemPointerIsValid(ctid)) continue;
+
+                results[nresults].similarity = hits[i].similarity;
+                ItemPointerCopy(ctid, &results[nresults].ctid);
+                nresults++;
+            }
+
+            LWLockRelease(arena->lock);
+
+            pfree(hits);
+
+            begin += ARENA_SEARCH_CHUNK_SIZE;
+
+            if (begin >= total) break;
+
+            CHECK_FOR_INTERRUPTS();
+        }
+
+        pfree(words);
+
+        qsort(results, nresults, sizeof(ArenaResult), arena_result_cmp);
+
+        funcctx->tuple_desc = BlessTupleDesc(tupdesc);
+        funcctx->user_fctx = results;
+        funcctx->max_calls = nresults;
+
+        MemoryContextSwitchTo(oldcontext);
+    }
+
+    funcctx = SRF_PERCALL_SETUP();
+    results = (ArenaResult *) funcctx->user_fctx;
+
+    if (funcctx->call_cntr < funcctx->max_calls)
+    {
+        ArenaResult *result = &results[funcctx->call_cntr];
+        Datum        values[2];
+        bool         nulls[2] = {false, false};
+
+        values[0] = PointerGetDatum(&result->ctid);
+        values[1] = Float8GetDatum(result->similarity);
+
+        SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(heap_form_tuple(funcctx->tuple_desc, values, nulls)));
+    }
+
+    SRF_RETURN_DONE(funcctx);
+}
@@ -0,0 +1,647 @@
+#include "arena.h"
+#include "fmgr.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "access/htup_details.h"
+#include "access/xact.h"
+#include "catalog/pg_type.h"
+#include "commands/trigger.h"
+#include "executor/spi.h"
+#include "postmaster/bgworker.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "utils/builtins.h"
+#include "utils/guc.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/snapmgr.h"
+
+
+// MAXIMUM NUMBER OF QUEUED CHANGES THAT ARE APPLIED AT ONCE
+#define ARENA_SYNC_BATCH_SIZE 10000
+
+// THE ARENA IS COMPACTED ONCE MORE THAN 1/ARENA_COMPACT_RATIO OF ITS FINGERPRINTS
+// ARE APPENDED OR DELETED
+#define ARENA_COMPACT_RATIO 8
+
+int arena_naptime = 200;
+
+static volatile sig_atomic_t arena_worker_sigterm = false;
+static volatile sig_atomic_t arena_worker_sighup = false;
+
+// A QUEUED CHANGE OF THE LOADED RELATION
+typedef struct
+{
+    int64            id;
+    bool             insert;        // INSERT OR DELETE
+    ItemPointerData  ctid;
+    ArrayType       *array;         // NULL FOR A DELETE OR A NULL VALUE
+} ArenaChange;
+
+// LATEST CHANGE OF A CTID
+typedef struct
+{
+    ItemPointerData  ctid;
+    int64            id;
+} ArenaChangeKey;
+
+
+/////////////////////////////////////QUEUEING///////////////////////////////////
+
+
+// RETURNS THE QUALIFIED NAME OF THE QUEUE TABLE IN THE SCHEMA OF THE EXTENSION
+char *arena_queue_name(Oid nspid)
+{
+    return quote_qualified_identifier(get_namespace_name(nspid), "eigen_arena_queue");
+}
+
+// TRUE IF THE CHANGES OF THE RELATION HAVE TO BE QUEUED FOR THE ARENA
+static bool arena_is_synced(Oid relid)
+{
+    bool synced;
+
+    if (fingerprint_arena == NULL) return false;
+
+    LWLockAcquire(fingerprint_arena->lock, LW_SHARED);
+    synced = fingerprint_arena->syncdbid == MyDatabaseId && fingerprint_arena->syncrelid == relid;
+    LWLockRelease(fingerprint_arena->lock);
+
+    return synced;
+}
+
+static void arena_queue_change(const char *queue, Oid relid, char op, HeapTuple tuple, TupleDesc tupdesc, int attnum)
+{
+    static SPIPlanPtr   plan = NULL;
+    static char        *plannedqueue = NULL;
+
+    Oid                 argtypes[4] = {OIDOID, CHAROID, TIDOID, INT4ARRAYOID};
+    Datum               values[4];
+    char                nulls[4] = {' ', ' ', ' ', ' '};
+    bool                isnull = true;
+
+    values[0] = ObjectIdGetDatum(relid);
+    values[1] = CharGetDatum(op);
+    values[2] = PointerGetDatum(&tuple->t_self);
+    values[3] = op == 'I' ? SPI_getbinval(tuple, tupdesc, attnum, &isnull) : (Datum) 0;
+
+    if (isnull) nulls[3] = 'n';
+    else if (op == 'I')
+    {
+        // INTEGER[] COLUMNS ARE NOT CHECKED BY THE ARRAYXI DOMAIN; THE WORKER
+        // PACKS THE VALUE AS A DENSE VECTOR OF ALL ITS ELEMENTS
+        arrayxi_check_array(DatumGetArrayTypeP(values[3]));
+    }
+
+    // THE PLAN IS KEPT FOR THE LIFETIME OF THE BACKEND
+    if (plan == NULL || strcmp(plannedqueue, queue) != 0)
+    {
+        StringInfoData sql;
+
+        initStringInfo(&sql);
+        appendStringInfo(&sql, "INSERT INTO %s (relid, op, rowid, fp) VALUES ($1, $2, $3, $4)", queue);
+
+        if (plan != NULL) SPI_freeplan(plan);
+
+        plan = SPI_prepare(sql.data, 4, argtypes);
+
+        if (plan == NULL || SPI_keepplan(plan) != 0)
+        {
+            ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR), errmsg("could not prepare the fingerprint arena queue insert")));
+        }
+
+        plannedqueue = MemoryContextStrdup(TopMemoryContext, queue);
+    }
+
+    if (SPI_execute_plan(plan, values, nulls, false, 0) != SPI_OK_INSERT)
+    {
+        ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR), errmsg("could not queue a change for the fingerprint arena")));
+    }
+}
+
+/* Row trigger that queues the changes of the arrayxi column named by its
+ * argument while the arena holds the relation. An update is queued as the
+ * deletion of the old row version and the insertion of the new one, since
+ * every row version has its own ctid. The queue is only read by the background
+ * worker after the transaction has committed.
+ */
+PG_FUNCTION_INFO_V1(arrayxi_arena_trigger);
+Datum arrayxi_arena_trigger(PG_FUNCTION_ARGS)
+{
+    TriggerData *trigdata = (TriggerData *) fcinfo->context;
+    TupleDesc    tupdesc;
+    Oid          relid;
+    int          attnum;
+    char        *queue;
+
+    if (!CALLED_AS_TRIGGER(fcinfo))
+    {
+        ereport(ERROR, (errcode(ERRCODE_E_R_I_E_TRIGGER_PROTOCOL_VIOLATED),
+                        errmsg("arrayxi_arena_trigger() must be called as a trigger.")));
+    }
+
+    if (!TRIGGER_FIRED_AFTER(trigdata->tg_event) || !TRIGGER_FIRED_FOR_ROW(trigdata->tg_event))
+    {
+        ereport(ERROR, (errcode(ERRCODE_E_R_I_E_TRIGGER_PROTOCOL_VIOLATED),
+                        errmsg("arrayxi_arena_trigger() must be fired AFTER ... FOR EACH ROW.")));
+    }
+
+    if (trigdata->tg_trigger->tgnargs != 1)
+    {
+        ereport(ERROR, (errcode(ERRCODE_E_R_I_E_TRIGGER_PROTOCOL_VIOLATED),
+                        errmsg("arrayxi_arena_trigger() expects the name of the arrayxi column as its only argument.")));
+    }
+
+    relid = RelationGetRelid(trigdata->tg_relation);
+
+    if (!arena_is_synced(relid)) return PointerGetDatum(NULL);
+
+    tupdesc = RelationGetDescr(trigdata->tg_relation);
+    attnum = SPI_fnumber(tupdesc, trigdata->tg_trigger->tgargs[0]);
+
+    if (attnum <= 0)
+    {
+        ereport(ERROR, (errcode(ERRCODE_UNDEFINED_COLUMN),
+                        errmsg("column \"%s\" does not exist.", trigdata->tg_trigger->tgargs[0])));
+    }
+
+    // THE VALUES ARE QUEUED AS INT4[] BY A SECURITY DEFINER FUNCTION, SO NO OTHER
+    // TYPE MAY BE PASSED ON
+    if (getBaseType(SPI_gettypeid(tupdesc, attnum)) != INT4ARRAYOID)
+    {
+        ereport(ERROR, (errcode(ERRCODE_DATATYPE_MISMATCH),
+                        errmsg("column \"%s\" must be of type arrayxi or integer[].", trigdata->tg_trigger->tgargs[0])));
+    }
+
+    queue = arena_queue_name(get_func_namespace(fcinfo->flinfo->fn_oid));
+
+    if (SPI_connect() != SPI_OK_CONNECT)
+    {
+        ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR), errmsg("SPI_connect failed")));
+    }
+
+    if (TRIGGER_FIRED_BY_INSERT(trigdata->tg_event))
+    {
+        arena_queue_change(queue, relid, 'I', trigdata->tg_trigtuple, tupdesc, attnum);
+    }
+    else if (TRIGGER_FIRED_BY_DELETE(trigdata->tg_event))
+    {
+        arena_queue_change(queue, relid, 'D', trigdata->tg_trigtuple, tupdesc, attnum);
+    }
+    else if (TRIGGER_FIRED_BY_UPDATE(trigdata->tg_event))
+    {
+        arena_queue_change(queue, relid, 'D', trigdata->tg_trigtuple, tupdesc, attnum);
+        arena_queue_change(queue, relid, 'I', trigdata->tg_newtuple, tupdesc, attnum);
+    }
+
+    SPI_finish();
+
+    return PointerGetDatum(NULL);
+}
+
+
+//////////////////////////////////APPLYING CHANGES//////////////////////////////
+
+
+static int arena_change_cmp(const void *a, const void *b)
+{
+    int64 ia = ((const ArenaChange *) a)->id;
+    int64 ib = ((const ArenaChange *) b)->id;
+
+    return (ia > ib) - (ia < ib);
+}
+
+// ORDERS THE KEYS BY CTID AND THE CHANGES OF A CTID BY ID
+static int arena_change_key_cmp(const void *a, const void *b)
+{
+    const ArenaChangeKey *ka = (const ArenaChangeKey *) a;
+    const ArenaChangeKey *kb = (const ArenaChangeKey *) b;
+    int32                 cmp = ItemPointerCompare((ItemPointer) &ka->ctid, (ItemPointer) &kb->ctid);
+
+    if (cmp != 0) return cmp;
+
+    return (ka->id > kb->id) - (ka->id < kb->id);
+}
+
+/* Applies the changes to the arena, which has to be locked exclusively, and
+ * returns false if it is full. New fingerprints are appended. Every change of
+ * a ctid deletes the fingerprints of that ctid that are older than the change,
+ * so an insertion replaces a stale fingerprint of the same ctid instead of
+ * duplicating it and changes that a reload has seen already are harmless.
+ */
+static bool arena_apply_changes(ArenaHeader *arena, ArenaChange *changes, int nchanges, uint64 *words)
+{
+    ItemPointerData *ctids;
+    ArenaChangeKey  *keys = (ArenaChangeKey *) palloc(sizeof(ArenaChangeKey) * nchanges);
+    int64           *appended = (int64 *) palloc(sizeof(int64) * nchanges);
+    int64            start, i;
+    int              ninserts = 0, nkeys = 0, c;
+
+    for (c = 0; c < nchanges; c++)
+    {
+        if (changes[c].insert && changes[c].array != NULL) ninserts++;
+    }
+
+    // ONLY DELETED FINGERPRINTS CAN MAKE ROOM
+    if (arena->count + ninserts > arena->capacity && arena->ndeleted > 0)
+    {
+        ArenaCompact(arena);
+    }
+
+    if (arena->count + ninserts > arena->capacity) return false;
+
+    ctids = ARENA_CTIDS(arena);
+    start = arena->count;
+
+    for (c = 0; c < nchanges; c++)
+    {
+        ItemPointerCopy(&changes[c].ctid, &keys[c].ctid);
+        keys[c].id = changes[c].id;
+
+        if (!changes[c].insert || changes[c].array == NULL) continue;
+
+        ItemPointerCopy(&changes[c].ctid, &ctids[arena->count]);
+        memcpy(ARENA_WORDS(arena) + arena->count * arena->nwords, words + (int64) c * arena->nwords,
+               sizeof(uint64) * arena->nwords);
+        appended[arena->count - start] = changes[c].id;
+        arena->count++;
+    }
+
+    // ONLY THE LATEST CHANGE OF EVERY CTID IS KEPT
+    qsort(keys, nchanges, sizeof(ArenaChangeKey), arena_change_key_cmp);
+
+    for (c = 0; c < nchanges; c++)
+    {
+        if (c + 1 < nchanges && ItemPointerEquals(&keys[c].ctid, &keys[c + 1].ctid)) continue;
+
+        keys[nkeys++] = keys[c];
+    }
+
+    for (i = 0; i < arena->count; i++)
+    {
+        int lo = 0, hi = nkeys;
+
+        if (!ItemPointerIsValid(&ctids[i])) continue;
+
+        // THE FIRST KEY THAT IS NOT SMALLER THAN THE CTID
+        while (lo < hi)
+        {
+            int mid = (lo + hi) / 2;
+
+            if (ItemPointerCompare(&keys[mid].ctid, &ctids[i]) < 0) lo = mid + 1;
+            else hi = mid;
+        }
+
+        if (lo == nkeys || !ItemPointerEquals(&keys[lo].ctid, &ctids[i])) continue;
+
+        // FINGERPRINTS THAT WERE THERE BEFORE THE BATCH ARE OLDER THAN ALL CHANGES
+        if (i < start || appended[i - start] < keys[lo].id)
+        {
+            ItemPointerSetInvalid(&ctids[i]);
+            arena->ndeleted++;
+        }
+    }
+
+    if ((arena->count - arena->nsorted) + arena->ndeleted > arena->nsorted / ARENA_COMPACT_RATIO)
+    {
+        ArenaCompact(arena);
+    }
+
+    arena->generation++;
+    arena->synced_at = GetCurrentTimestamp();
+
+    pfree(keys);
+    pfree(appended);
+
+    return true;
+}
+
+/* Takes the next batch of queued changes of the relation out of the queue and
+ * applies it to the arena. Returns the number of changes or -1 if the arena is
+ * full, in which case the transaction is rolled back and the changes stay in
+ * the queue.
+ */
+static int arena_worker_apply(Oid relid)
+{
+    ArenaHeader    *arena = fingerprint_arena;
+    StringInfoData  sql;
+    Oid             argtypes[1] = {OIDOID};
+    Datum           values[1] = {ObjectIdGetDatum(relid)};
+    ArenaChange    *changes;
+    uint64         *words;
+    char           *queue;
+    int             nchanges, nwords, nbits, c;
+    bool            applied = true;
+
+    if (SPI_execute("SELECT n.nspname FROM pg_catalog.pg_extension e "
+                    "JOIN pg_catalog.pg_namespace n ON n.oid = e.extnamespace WHERE e.extname = 'eigen'",
+                    true, 1) != SPI_OK_SELECT || SPI_processed == 0)
+    {
+        return 0;
+    }
+
+    queue = quote_qualified_identifier(SPI_getvalue(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 1),
+                                       "eigen_arena_queue");
+
+    initStringInfo(&sql);
+    appendStringInfo(&sql,
+                     "DELETE FROM %s WHERE id IN (SELECT id FROM %s WHERE relid = $1 ORDER BY id LIMIT %d) "
+                     "RETURNING id, op, rowid, fp", queue, queue, ARENA_SYNC_BATCH_SIZE);
+
+    if (SPI_execute_with_args(sql.data, 1, argtypes, values, NULL, false, 0) != SPI_OK_DELETE_RETURNING)
+    {
+        ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR), errmsg("could not read the fingerprint arena queue")));
+    }
+
+    nchanges = (int) SPI_processed;
+
+    if (nchanges == 0) return 0;
+
+    changes = (ArenaChange *) palloc(sizeof(ArenaChange) * nchanges);
+
+    for (c = 0; c < nchanges; c++)
+    {
+        HeapTuple   tuple = SPI_tuptable->vals[c];
+        TupleDesc   tupdesc = SPI_tuptable->tupdesc;
+        bool        isnull;
+        Datum       fp;
+
+        changes[c].id = DatumGetInt64(SPI_getbinval(tuple, tupdesc, 1, &isnull));
+        changes[c].insert = DatumGetChar(SPI_getbinval(tuple, tupdesc, 2, &isnull)) == 'I';
+        ItemPointerCopy((ItemPointer) DatumGetPointer(SPI_getbinval(tuple, tupdesc, 3, &isnull)), &changes[c].ctid);
+
+        fp = SPI_getbinval(tuple, tupdesc, 4, &isnull);
+        changes[c].array = isnull ? NULL : DatumGetArrayTypeP(fp);
+    }
+
+    qsort(changes, nchanges, sizeof(ArenaChange), arena_change_cmp);
+
+    // THE FINGERPRINTS ARE PACKED BEFORE THE ARENA IS LOCKED
+    LWLockAcquire(arena->lock, LW_SHARED);
+    nbits = arena->nbits;
+    nwords = arena->nwords;
+    LWLockRelease(arena->lock);
+
+    words = (uint64 *) MemoryContextAllocHuge(CurrentMemoryContext, sizeof(uint64) * Max(nwords, 1) * nchanges);
+
+    for (c = 0; c < nchanges; c++)
+    {
+        if (changes[c].array == NULL) continue;
+
+        // THE TRIGGER REJECTS SUCH VALUES, BUT THE QUEUE IS AN ORDINARY TABLE
+        if (ARR_NDIM(changes[c].array) > 1 || ARR_HASNULL(changes[c].array))
+        {
+            ereport(WARNING, (errmsg("fingerprint arena: ignoring a value that is not one-dimensional or has null elements.")));
+
+            changes[c].array = NULL;
+            continue;
+        }
+
+        if (ArrayXiSize(changes[c].array) != nbits)
+        {
+            ereport(WARNING, (errmsg("fingerprint arena: ignoring a value with %d elements instead of %d.",
+                                     ArrayXiSize(changes[c].array), nbits)));
+
+            // THE OLD FINGERPRINT OF THE CTID IS STILL DELETED
+            changes[c].array = NULL;
+            continue;
+        }
+
+        ArenaPack(changes[c].array, words + (int64) c * nwords, nwords);
+    }
+
+    LWLockAcquire(arena->lock, LW_EXCLUSIVE);
+
+    // THE ARENA MIGHT HAVE BEEN RELOADED IN THE MEANTIME
+    if (arena->dbid == MyDatabaseId && arena->relid == relid && arena->nbits == nbits)
+    {
+        applied = arena_apply_changes(arena, changes, nchanges, words);
+    }
+
+    LWLockRelease(arena->lock);
+
+    return applied ? nchanges : -1;
+}
+
+
+///////////////////////////////////BACKGROUND WORKER/////////////////////////////
+
+
+static void arena_worker_handle_sigterm(SIGNAL_ARGS)
+{
+    int save_errno = errno;
+
+    arena_worker_sigterm = true;
+    SetLatch(MyLatch);
+
+    errno = save_errno;
+}
+
+static void arena_worker_handle_sighup(SIGNAL_ARGS)
+{
+    int save_errno = errno;
+
+    arena_worker_sighup = true;
+    SetLatch(MyLatch);
+
+    errno = save_errno;
+}
+
+// FORGETS THE WORKER WHEN IT EXITS, UNLESS IT HAS BEEN REPLACED ALREADY
+static void arena_worker_exit(int code, Datum arg)
+{
+    LWLockAcquire(fingerprint_arena->lock, LW_EXCLUSIVE);
+
+    if (fingerprint_arena->workerpid == MyProcPid) fingerprint_arena->workerpid = 0;
+
+    LWLockRelease(fingerprint_arena->lock);
+}
+
+// STARTS A BACKGROUND WORKER THAT KEEPS THE ARENA IN SYNC FOR THE CURRENT DATABASE
+void arena_start_worker(void)
+{
+    BackgroundWorker        worker;
+    BackgroundWorkerHandle *handle;
+
+    memset(&worker, 0, sizeof(BackgroundWorker));
+
+    worker.bgw_flags = BGWORKER_SHMEM_ACCESS | BGWORKER_BACKEND_DATABASE_CONNECTION;
+    worker.bgw_start_time = BgWorkerStart_RecoveryFinished;
+    worker.bgw_restart_time = 10;
+    worker.bgw_main_arg = ObjectIdGetDatum(MyDatabaseId);
+    worker.bgw_notify_pid = 0;
+
+    snprintf(worker.bgw_library_name, BGW_MAXLEN, "eigen");
+    snprintf(worker.bgw_function_name, BGW_MAXLEN, "arena_worker_main");
+    snprintf(worker.bgw_name, BGW_MAXLEN, "eigen fingerprint arena sync");
+#if PG_VERSION_NUM >= 110000
+    snprintf(worker.bgw_type, BGW_MAXLEN, "eigen fingerprint arena sync");
+#endif
+
+    if (!RegisterDynamicBackgroundWorker(&worker, &handle))
+    {
+        ereport(WARNING, (errmsg("could not start the fingerprint arena worker; changes are not applied until max_worker_processes is increased and the arena is reloaded.")));
+    }
+}
+
+/* Main loop of the background worker: applies the queued changes of the loaded
+ * relation in batches and sleeps for eigen.arena_naptime when the queue is
+ * empty. Once the arena is full the worker stops applying changes until the
+ * arena is reloaded, which changes its generation; only the worker changes it
+ * otherwise. The worker exits when the arena is loaded in another database or
+ * another worker has taken over.
+ */
+void arena_worker_main(Datum main_arg)
+{
+    Oid     dbid = DatumGetObjectId(main_arg);
+    bool    full = false;
+    uint64  fullgeneration = 0;
+
+    pqsignal(SIGTERM, arena_worker_handle_sigterm);
+    pqsignal(SIGHUP, arena_worker_handle_sighup);
+    BackgroundWorkerUnblockSignals();
+
+#if PG_VERSION_NUM >= 110000
+    BackgroundWorkerInitializeConnectionByOid(dbid, InvalidOid, 0);
+#else
+    BackgroundWorkerInitializeConnectionByOid(dbid, InvalidOid);
+#endif
+
+    if (fingerprint_arena == NULL) proc_exit(0);
+
+    LWLockAcquire(fingerprint_arena->lock, LW_EXCLUSIVE);
+    fingerprint_arena->workerpid = MyProcPid;
+    fingerprint_arena->workerdbid = dbid;
+    LWLockRelease(fingerprint_arena->lock);
+
+    before_shmem_exit(arena_worker_exit, (Datum) 0);
+
+    while (!arena_worker_sigterm)
+    {
+        Oid     relid;
+        uint64  generation;
+        bool    stop;
+        int     applied = 0;
+
+        if (arena_worker_sighup)
+        {
+            arena_worker_sighup = false;
+            ProcessConfigFile(PGC_SIGHUP);
+        }
+
+        LWLockAcquire(fingerprint_arena->lock, LW_SHARED);
+        relid = fingerprint_arena->relid;
+        generation = fingerprint_arena->generation;
+        stop = fingerprint_arena->dbid != dbid || fingerprint_arena->workerpid != MyProcPid;
+        LWLockRelease(fingerprint_arena->lock);
+
+        if (stop) break;
+
+        // THE ARENA IS STILL FULL
+        if (full && generation == fullgeneration) applied = 0;
+        else
+        {
+            full = false;
+
+            SetCurrentStatementStartTimestamp();
+            StartTransactionCommand();
+            SPI_connect();
+            PushActiveSnapshot(GetTransactionSnapshot());
+            pgstat_report_activity(STATE_RUNNING, "applying fingerprint arena changes");
+
+            applied = arena_worker_apply(relid);
+
+            SPI_finish();
+            PopActiveSnapshot();
+
+            if (applied < 0) AbortCurrentTransaction();
+            else CommitTransactionCommand();
+
+            pgstat_report_stat(false);
+            pgstat_report_activity(STATE_IDLE, NULL);
+
+            if (applied < 0)
+            {
+                ereport(WARNING, (errmsg("the fingerprint arena is full; changes are not applied until the arena is reloaded.")));
+
+                full = true;
+                fullgeneration = generation;
+                applied = 0;
+            }
+        }
+
+        // A FULL BATCH MEANS THAT MORE CHANGES ARE WAITING
+        if (applied < ARENA_SYNC_BATCH_SIZE)
+        {
+#if PG_VERSION_NUM >= 100000
+            int rc = WaitLatch(MyLatch, WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH, arena_naptime, PG_WAIT_EXTENSION);
+#else
+            int rc = WaitLatch(MyLatch, WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH, arena_naptime);
+#endif
+
+            ResetLatch(MyLatch);
+
+            if (rc & WL_POSTMASTER_DEATH) proc_exit(1);
+        }
+
+        CHECK_FOR_INTERRUPTS();
+    }
+
+    proc_exit(0);
+}
+
+
+//////////////////////////////////////STATUS////////////////////////////////////
+
+
+/* Returns the relation and column of the arena, its number of live, appended
+ * and deleted fingerprints, its capacity, generation, size and used memory in
+ * bytes, the time of the last change and the pid of the background worker.
+ * Returns NULL if the arena is not available.
+ */
+PG_FUNCTION_INFO_V1(arrayxi_arena_info);
+Datum arrayxi_arena_info(PG_FUNCTION_ARGS)
+{
+    ArenaHeader *arena = fingerprint_arena;
+    TupleDesc    tupdesc;
+    Datum        values[11];
+    bool         nulls[11];
+    bool         loaded;
+
+    if (arena == NULL) PG_RETURN_NULL();
+
+    if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+    {
+        ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                        errmsg("function returning record called in context that cannot accept type record")));
+    }
+
+    memset(nulls, 0, sizeof(nulls));
+
+    LWLockAcquire(arena->lock, LW_SHARED);
+
+    loaded = OidIsValid(arena->relid) && arena->dbid == MyDatabaseId;
+
+    values[0] = ObjectIdGetDatum(arena->relid);
+    values[1] = NameGetDatum(&arena->column);
+    values[2] = Int64GetDatum(arena->count - arena->ndeleted);
+    values[3] = Int64GetDatum(arena->count - arena->nsorted);
+    values[4] = Int64GetDatum(arena->ndeleted);
+    values[5] = Int64GetDatum(arena->capacity);
+    values[6] = Int64GetDatum((int64) arena->generation);
+    values[7] = Int64GetDatum((int64) (offsetof(ArenaHeader, data) + arena->size));
+    values[8] = Int64GetDatum((int64) (ARENA_NBUCKETS(arena) * sizeof(int64) +
+                                       arena->count * (sizeof(ItemPointerData) + arena->nwords * sizeof(uint64))));
+    values[9] = TimestampTzGetDatum(arena->synced_at);
+    values[10] = Int32GetDatum(arena->workerpid);
+
+    // THE RELATION OF ANOTHER DATABASE WOULD BE MEANINGLESS HERE
+    nulls[0] = nulls[1] = !loaded;
+    nulls[9] = arena->synced_at == 0;
+    nulls[10] = arena->workerpid == 0;
+
+    LWLockRelease(arena->lock);
+
+    PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(BlessTupleDesc(tupdesc), values, nulls)));
+}
@@ -0,0 +1,354 @@
+#include "eigen.h"
+#include "arena.h"
+#include "similarity.h"
+
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+
+using namespace Eigen;
+
+// SMALLEST NUMBER OF FINGERPRINTS THAT IS WORTH ANOTHER THREAD
+#define ARENA_MIN_THREAD_WORK 4096
+
+// POPCOUNT OF THE RANGE OF APPENDED FINGERPRINTS, WHICH IS NOT SORTED
+#define ARENA_UNSORTED UINT_MAX
+
+// CONTIGUOUS RANGE OF FINGERPRINTS IN THE ARENA: A POPCOUNT BUCKET THAT CAN
+// REACH THE THRESHOLD OR THE APPENDED FINGERPRINTS
+struct ArenaRange
+{
+    int64        start;
+    int64        end;
+    unsigned int popcount;
+};
+
+/* Work of a thread of the search. The threads run without any PostgreSQL
+ * calls: they only read the arena, which is protected by the shared lock that
+ * the backend holds for them, and collect their hits in a buffer from malloc()
+ * that the backend copies into palloc'd memory after all threads have finished.
+ */
+struct ArenaTask
+{
+    const ArenaHeader *arena;
+    const uint64      *query;
+    unsigned int       B;
+    ArrayXiMetric      metric;
+    double             threshold;
+
+    const ArenaRange  *ranges;
+    int                nranges;
+    int64              begin;       // SLICE OF THE CONCATENATED RANGES
+    int64              end;
+
+    ArenaHit          *hits;
+    int64              nhits;
+    int64              capacity;
+    bool               failed;      // OUT OF MEMORY
+};
+
+// NUMBER OF BITS SET IN A 64-BIT WORD; COMPILES TO A SINGLE POPCNT INSTRUCTION
+// WITH -msse4.2 OR -march=native
+inline unsigned int arena_popcount(uint64 word)
+{
+    return __builtin_popcountll(word);
+}
+
+// COMPARES THE QUERY WITH ALL FINGERPRINTS IN THE SLICE OF THE TASK
+static void *arena_search_task(void *arg)
+{
+    ArenaTask *task = (ArenaTask *) arg;
+
+    const uint64    *words = ARENA_WORDS(task->arena);
+    int              nwords = task->arena->nwords;
+    unsigned int     n = task->arena->nbits;
+    int64            offset = 0;
+
+    for (int r = 0; r < task->nranges && !task->failed; r++)
+    {
+        const ArenaRange &range = task->ranges[r];
+
+        // INTERSECTION OF THE RANGE WITH THE SLICE
+        int64 first = std::max(task->begin - offset, (int64) 0) + range.start;
+        int64 last = std::min(task->end - offset, range.end - range.start) + range.start;
+
+        offset += range.end - range.start;
+
+        for (int64 i = first; i < last; i++)
+        {
+            const uint64 *fp = words + i * nwords;
+            unsigned int  c = 0;
+
+            unsigned int  A = range.popcount;
+
+            for (int w = 0; w < nwords; w++) c += arena_popcount(fp[w] & task->query[w]);
+
+            if (A == ARENA_UNSORTED)
+            {
+                A = 0;
+                for (int w = 0; w < nwords; w++) A += arena_popcount(fp[w]);
+            }
+
+            BinaryCounts counts = {A, task->B, c, n - (A + task->B - c), n};
+            double similarity = binary_similarity(counts, task->metric);
+
+            if (similarity < task->threshold) continue;
+
+            if (task->nhits == task->capacity)
+            {
+                int64     capacity = std::max(task->capacity * 2, (int64) 256);
+                ArenaHit *hits = (ArenaHit *) realloc(task->hits, capacity * sizeof(ArenaHit));
+
+                if (hits == NULL)
+                {
+                    task->failed = true;
+                    break;
+                }
+
+                task->hits = hits;
+                task->capacity = capacity;
+            }
+
+            task->hits[task->nhits].index = i;
+            task->hits[task->nhits].similarity = similarity;
+            task->nhits++;
+        }
+    }
+
+    return NULL;
+}
+
+
+/////////////////////////////FINGERPRINT KERNELS////////////////////////////////
+
+
+// WRITES THE BIT-PACKED FINGERPRINT OF THE ARRAY AND RETURNS ITS POPULATION COUNT
+extern "C"
+int ArenaPack(ArrayType *array, uint64 *words, int nwords)
+{
+    ArrayXiMap arrayxi = arraytype_to_arrayxi(array);
+
+    memset(words, 0, nwords * sizeof(uint64));
+
+    for (Index i = 0; i < arrayxi.size(); i++)
+    {
+        if (arrayxi(i) != 0) words[i / 64] |= UINT64CONST(1) << (i % 64);
+    }
+
+    return (arrayxi != 0).count();
+}
+
+// RETURNS THE NUMBER OF FINGERPRINTS WITH THE GIVEN NUMBER OF BITS THAT FIT INTO
+// A DATA AREA OF THE GIVEN SIZE
+extern "C"
+int64 ArenaCapacity(Size size, int nbits)
+{
+    Size fixed = (nbits + 2) * sizeof(int64) + MAXIMUM_ALIGNOF;
+    Size entry = sizeof(ItemPointerData) + ((nbits + 63) / 64) * sizeof(uint64);
+
+    return size > fixed ? (size - fixed) / entry : 0;
+}
+
+/* Removes the deleted fingerprints from the arena and sorts the appended ones
+ * into their popcount buckets. The fingerprints are copied into local memory
+ * first, so this needs as much memory as the arena uses.
+ *
+ * The caller has to hold the lock of the arena exclusively.
+ */
+extern "C"
+void ArenaCompact(ArenaHeader *arena)
+{
+    int64            *buckets = ARENA_BUCKETS(arena);
+    ItemPointerData  *ctids = ARENA_CTIDS(arena);
+    uint64           *words = ARENA_WORDS(arena);
+    int               nwords = arena->nwords;
+    int64             count = arena->count;
+
+    int32            *popcounts = (int32 *) MemoryContextAllocHuge(CurrentMemoryContext, sizeof(int32) * std::max(count, (int64) 1));
+    int64            *next = (int64 *) palloc0(sizeof(int64) * ARENA_NBUCKETS(arena));
+    int64             live = 0;
+
+    for (int A = 0; A <= arena->nbits; A++)
+    {
+        for (int64 i = buckets[A]; i < buckets[A + 1]; i++) popcounts[i] = A;
+    }
+
+    for (int64 i = arena->nsorted; i < count; i++)
+    {
+        popcounts[i] = 0;
+        for (int w = 0; w < nwords; w++) popcounts[i] += arena_popcount(words[i * nwords + w]);
+    }
+
+    for (int64 i = 0; i < count; i++)
+    {
+        if (!ItemPointerIsValid(&ctids[i])) continue;
+
+        next[popcounts[i] + 1]++;
+        live++;
+    }
+
+    for (int A = 1; A < ARENA_NBUCKETS(arena); A++) next[A] += next[A - 1];
+
+    ItemPointerData *sortedctids = (ItemPointerData *) MemoryContextAllocHuge(CurrentMemoryContext,
+                                                                              sizeof(ItemPointerData) * std::max(live, (int64) 1));
+    uint64          *sortedwords = (uint64 *) MemoryContextAllocHuge(CurrentMemoryContext,
+                                                                     sizeof(uint64) * nwords * std::max(live, (int64) 1));
+
+    memcpy(buckets, next, sizeof(int64) * ARENA_NBUCKETS(arena));
+
+    for (int64 i = 0; i < count; i++)
+    {
+        if (!ItemPointerIsValid(&ctids[i])) continue;
+
+        int64 position = next[popcounts[i]]++;
+
+        sortedctids[position] = ctids[i];
+        memcpy(sortedwords + position * nwords, words + i * nwords, sizeof(uint64) * nwords);
+    }
+
+    memcpy(ctids, sortedctids, sizeof(ItemPointerData) * live);
+    memcpy(words, sortedwords, sizeof(uint64) * nwords * live);
+
+    arena->count = arena->nsorted = live;
+    arena->ndeleted = 0;
+
+    pfree(popcounts);
+    pfree(next);
+    pfree(sortedctids);
+    pfree(sortedwords);
+}
+
+/* Returns the fingerprints of the arena whose similarity to the query reaches
+ * the threshold. Only the popcount buckets whose bound (the similarity of a
+ * fingerprint with that popcount that contains the query completely or is
+ * contained in it) reaches the threshold are visited. Only the slice from begin
+ * to end of their concatenated fingerprints is searched, so that the caller can
+ * release the lock between slices; the number of fingerprints of all visited
+ * buckets is stored in total. The slice is split into equal parts for the
+ * threads; the backend itself searches the first part. Deleted fingerprints are
+ * still compared and have to be skipped by the caller.
+ *
+ * The caller has to hold the lock of the arena.
+ */
+extern "C"
+ArenaHit *ArenaSearch(ArenaHeader *arena, const uint64 *query, ArrayXiMetric metric, double threshold,
+                      int nthreads, int64 begin, int64 end, int64 *total, int64 *nhits)
+{
+    const int64  *buckets = ARENA_BUCKETS(arena);
+    ArenaRange   *ranges = (ArenaRange *) palloc(sizeof(ArenaRange) * (arena->nbits + 2));
+    int           nranges = 0;
+    unsigned int  B = 0;
+
+    *total = 0;
+
+    for (int w = 0; w < arena->nwords; w++) B += arena_popcount(query[w]);
+
+    for (int A = 0; A <= arena->nbits; A++)
+    {
+        if (buckets[A] == buckets[A + 1]) continue;
+
+        ArrayXiBounds bounds = {(unsigned int) A, (unsigned int) A, B, std::min((unsigned int) A, B),
+                                (unsigned int) arena->nbits};
+
+        if (SimilarityUpperBound(&bounds, metric) < threshold) continue;
+
+        ArenaRange range = {buckets[A], buckets[A + 1], (unsigned int) A};
+
+        ranges[nranges++] = range;
+        *total += range.end - range.start;
+    }
+
+    // APPENDED FINGERPRINTS HAVE TO BE COMPARED ONE BY ONE
+    if (arena->count > arena->nsorted)
+    {
+        ArenaRange range = {arena->nsorted, arena->count, ARENA_UNSORTED};
+
+        ranges[nranges++] = range;
+        *total += range.end - range.start;
+    }
+
+    end = std::min(end, *total);
+    begin = std::min(begin, end);
+
+    nthreads = (int) std::max((int64) 1, std::min((int64) nthreads, (end - begin) / ARENA_MIN_THREAD_WORK));
+
+    ArenaTask *tasks = (ArenaTask *) palloc0(sizeof(ArenaTask) * nthreads);
+    pthread_t *threads = (pthread_t *) palloc(sizeof(pthread_t) * nthreads);
+    bool      *started = (bool *) palloc0(sizeof(bool) * nthreads);
+
+    for (int t = 0; t < nthreads; t++)
+    {
+        tasks[t].arena = arena;
+        tasks[t].query = query;
+        tasks[t].B = B;
+        tasks[t].metric = metric;
+        tasks[t].threshold = threshold;
+        tasks[t].ranges = ranges;
+        tasks[t].nranges = nranges;
+        tasks[t].begin = begin + (end - begin) * t / nthreads;
+        tasks[t].end = begin + (end - begin) * (t + 1) / nthreads;
+    }
+
+    // THE SIGNAL HANDLERS OF THE BACKEND MUST ONLY RUN IN THE BACKEND ITSELF, SO
+    // ALL SIGNALS ARE BLOCKED WHILE THE THREADS ARE CREATED, WHICH INHERIT THE MASK
+    sigset_t blocked, previous;
+
+    sigfillset(&blocked);
+    pthread_sigmask(SIG_SETMASK, &blocked, &previous);
+
+    for (int t = 1; t < nthreads; t++)
+    {
+        started[t] = pthread_create(&threads[t], NULL, arena_search_task, &tasks[t]) == 0;
+    }
+
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    // SLICES OF THREADS THAT COULD NOT BE STARTED ARE SEARCHED BY THE BACKEND
+    for (int t = 0; t < nthreads; t++)
+    {
+        if (!started[t]) arena_search_task(&tasks[t]);
+    }
+
+    for (int t = 1; t < nthreads; t++)
+    {
+        if (started[t]) pthread_join(threads[t], NULL);
+    }
+
+    bool failed = false;
+
+    *nhits = 0;
+
+    for (int t = 0; t < nthreads; t++)
+    {
+        *nhits += tasks[t].nhits;
+        failed |= tasks[t].failed;
+    }
+
+    ArenaHit *hits = failed ? NULL : (ArenaHit *) palloc(sizeof(ArenaHit) * std::max(*nhits, (int64) 1));
+    ArenaHit *next = hits;
+
+    for (int t = 0; t < nthreads; t++)
+    {
+        if (hits != NULL && tasks[t].nhits > 0)
+        {
+            memcpy(next, tasks[t].hits, sizeof(ArenaHit) * tasks[t].nhits);
+            next += tasks[t].nhits;
+        }
+
+        free(tasks[t].hits);
+    }
+
+    if (failed)
+    {
+        ereport(ERROR, (errcode(ERRCODE_OUT_OF_MEMORY),
+                        errmsg("out of memory while searching the fingerprint arena.")));
+    }
+
+    pfree(ranges);
+    pfree(tasks);
+    pfree(threads);
+    pfree(started);
+
+    return hits;
+}
@@ -0,0 +1,91 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    #include "postgres.h"
+    #include "storage/itemptr.h"
+    #include "storage/lwlock.h"
+    #include "utils/array.h"
+    #include "utils/timestamp.h"
+    #include "arrayxi.h"
+
+    /* Shared-memory arena of binary fingerprints for in-memory similarity
+     * searches. The arrayxi values of one column are stored as bit-packed
+     * fingerprints (non-zero elements are set) that are sorted by their
+     * population count, so that a search only has to visit the popcount
+     * buckets whose similarity bound can reach the threshold.
+     *
+     * Changes of the column are applied incrementally by a background worker:
+     * new fingerprints are appended behind the sorted ones and deleted ones
+     * are marked with an invalid ctid, until the arena is compacted again.
+     *
+     * The data area holds, in this order:
+     *     int64           buckets[nbits + 2]   START OF EVERY POPCOUNT BUCKET
+     *     ItemPointerData ctids[capacity]      ROW OF EVERY FINGERPRINT
+     *     uint64          words[capacity * nwords]
+     */
+    typedef struct
+    {
+        LWLock     *lock;           // PROTECTS EVERYTHING BELOW
+        Size        size;           // SIZE OF THE DATA AREA IN BYTES
+        Oid         dbid;           // DATABASE AND RELATION THE ARENA WAS LOADED FROM
+        Oid         relid;
+        NameData    column;
+        Oid         syncdbid;       // TRIGGERS QUEUE THE CHANGES OF THIS RELATION
+        Oid         syncrelid;
+        int32       nbits;          // NUMBER OF BITS OF ALL FINGERPRINTS
+        int32       nwords;
+        int64       count;          // NUMBER OF FINGERPRINTS, INCLUDING DELETED ONES
+        int64       nsorted;        // THE FIRST NSORTED FINGERPRINTS ARE SORTED BY POPCOUNT
+        int64       ndeleted;
+        int64       capacity;
+        uint64      generation;     // INCREMENTED WHENEVER THE CONTENT CHANGES
+        TimestampTz synced_at;      // LAST LOAD OR APPLIED CHANGES
+        Oid         workerdbid;     // DATABASE OF THE BACKGROUND WORKER
+        int         workerpid;
+        char        data[FLEXIBLE_ARRAY_MEMBER];
+    } ArenaHeader;
+
+    #define ARENA_NBUCKETS(arena)     ((arena)->nbits + 2)
+    #define ARENA_BUCKETS(arena)      ((int64 *) (arena)->data)
+    #define ARENA_CTIDS(arena)        ((ItemPointerData *) (ARENA_BUCKETS(arena) + ARENA_NBUCKETS(arena)))
+    #define ARENA_WORDS(arena)        ((uint64 *) MAXALIGN(ARENA_CTIDS(arena) + (arena)->capacity))
+
+    // THE ARENA IN SHARED MEMORY; NULL IF THE LIBRARY WAS NOT PRELOADED
+    extern ArenaHeader *fingerprint_arena;
+
+    // MILLISECONDS THE BACKGROUND WORKER SLEEPS WHEN THERE ARE NO CHANGES
+    extern int arena_naptime;
+
+    // A FINGERPRINT OF THE ARENA THAT REACHED THE THRESHOLD
+    typedef struct
+    {
+        int64  index;
+        double similarity;
+    } ArenaHit;
+
+    // SHARED MEMORY AND CONFIGURATION PARAMETERS, CALLED FROM _PG_INIT
+    void      arena_init(void);
+
+    // SYNCHRONISATION WITH THE LOADED RELATION
+    char     *arena_queue_name(Oid nspid);
+    void      arena_start_worker(void);
+
+    PGDLLEXPORT void arena_worker_main(Datum main_arg);
+
+    // FINGERPRINT KERNELS
+    int       ArenaPack(ArrayType *array, uint64 *words, int nwords);
+    int64     ArenaCapacity(Size size, int nbits);
+    void      ArenaCompact(ArenaHeader *arena);
+    ArenaHit *ArenaSearch(ArenaHeader *arena, const uint64 *query, ArrayXiMetric metric, double threshold,
+                          int nthreads, int64 begin, int64 end, int64 *total, int64 *nhits);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,4 +1,5 @@
 #include "arrayxd.h"
+#include "querycache.h"
 #include "fmgr.h"
 
 #ifdef PG_MODULE_MAGIC
@@ -161,8 +162,10 @@ Datum arrayxd_mul_scalar(PG_FUNCTION_ARGS)
 PG_FUNCTION_INFO_V1(arrayxd_euclidean);
 Datum arrayxd_euclidean(PG_FUNCTION_ARGS)
 {
-    ArrayType  *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType  *a2 = PG_GETARG_ARRAYTYPE_P(1);
+    ArrayType  *a1, *a2;
+
+    // THE QUERY ARRAY IS DETOASTED ONLY ONCE IF IT IS STABLE ACROSS CALLS
+    query_cache_getargs(fcinfo, &a1, &a2);
 
     PG_RETURN_FLOAT8(ArrayXdEuclidean(a1,a2));
 }
@@ -171,8 +174,9 @@ Datum arrayxd_euclidean(PG_FUNCTION_ARGS)
 PG_FUNCTION_INFO_V1(arrayxd_manhattan);
 Datum arrayxd_manhattan(PG_FUNCTION_ARGS)
 {
-    ArrayType  *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType  *a2 = PG_GETARG_ARRAYTYPE_P(1);
+    ArrayType  *a1, *a2;
+
+    query_cache_getargs(fcinfo, &a1, &a2);
 
     PG_RETURN_FLOAT8(ArrayXdManhattan(a1,a2));
 }
@@ -181,8 +185,9 @@ Datum arrayxd_manhattan(PG_FUNCTION_ARGS)
 PG_FUNCTION_INFO_V1(arrayxd_usrsim);
 Datum arrayxd_usrsim(PG_FUNCTION_ARGS)
 {
-    ArrayType  *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType  *a2 = PG_GETARG_ARRAYTYPE_P(1);
+    ArrayType  *a1, *a2;
+
+    query_cache_getargs(fcinfo, &a1, &a2);
 
     PG_RETURN_FLOAT8(ArrayXdUSRSim(a1,a2));
 }
@@ -191,13 +196,102 @@ Datum arrayxd_usrsim(PG_FUNCTION_ARGS)
 PG_FUNCTION_INFO_V1(arrayxd_usrcatsim);
 Datum arrayxd_usrcatsim(PG_FUNCTION_ARGS)
 {
-    ArrayType *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType *a2 = PG_GETARG_ARRAYTYPE_P(1);
+    ArrayType *a1, *a2;
     float      ow = PG_GETARG_FLOAT4(2);
     float      hw = PG_GETARG_FLOAT4(3);
     float      rw = PG_GETARG_FLOAT4(4);
     float      aw = PG_GETARG_FLOAT4(5);
     float      dw = PG_GETARG_FLOAT4(6);
 
+    query_cache_getargs(fcinfo, &a1, &a2);
+
     PG_RETURN_FLOAT8(ArrayXdUSRCatSim(a1,a2,ow,hw,rw,aw,dw));
+}
+
+
+// USR SIMILARITY OF SINGLE PRECISION DESCRIPTORS
+PG_FUNCTION_INFO_V1(arrayxf_usrsim);
+Datum arrayxf_usrsim(PG_FUNCTION_ARGS)
+{
+    ArrayType  *a1, *a2;
+
+    query_cache_getargs(fcinfo, &a1, &a2);
+
+    PG_RETURN_FLOAT8(ArrayXfUSRSim(a1,a2));
+}
+
+// USRCAT SIMILARITY OF SINGLE PRECISION DESCRIPTORS
+PG_FUNCTION_INFO_V1(arrayxf_usrcatsim);
+Datum arrayxf_usrcatsim(PG_FUNCTION_ARGS)
+{
+    ArrayType *a1, *a2;
+    float      ow = PG_GETARG_FLOAT4(2);
+    float      hw = PG_GETARG_FLOAT4(3);
+    float      rw = PG_GETARG_FLOAT4(4);
+    float      aw = PG_GETARG_FLOAT4(5);
+    float      dw = PG_GETARG_FLOAT4(6);
+
+    query_cache_getargs(fcinfo, &a1, &a2);
+
+    PG_RETURN_FLOAT8(ArrayXfUSRCatSim(a1,a2,ow,hw,rw,aw,dw));
+}
+
+
+/* USR DESCRIPTORS */
+
+
+// RETURNS THE USR DESCRIPTOR OF THE NX3 COORDINATES
+PG_FUNCTION_INFO_V1(usr_descriptor);
+Datum usr_descriptor(PG_FUNCTION_ARGS)
+{
+    ArrayType *coords = PG_GETARG_ARRAYTYPE_P(0);
+
+    PG_RETURN_ARRAYTYPE_P(ArrayXdUSRDescriptor(coords));
+}
+
+// RETURNS THE USRCAT DESCRIPTOR OF THE NX3 COORDINATES AND THE ATOM TYPE MASKS
+PG_FUNCTION_INFO_V1(usrcat_descriptor);
+Datum usrcat_descriptor(PG_FUNCTION_ARGS)
+{
+    ArrayType *coords = PG_GETARG_ARRAYTYPE_P(0);
+    ArrayType *hydrophobic = PG_GETARG_ARRAYTYPE_P(1);
+    ArrayType *aromatic = PG_GETARG_ARRAYTYPE_P(2);
+    ArrayType *acceptor = PG_GETARG_ARRAYTYPE_P(3);
+    ArrayType *donor = PG_GETARG_ARRAYTYPE_P(4);
+
+    PG_RETURN_ARRAYTYPE_P(ArrayXdUSRCatDescriptor(coords, hydrophobic, aromatic, acceptor, donor));
+}
+
+
+/* BATCH DISTANCE AND SIMILARITY METRICS */
+
+
+// RETURNS THE EUCLIDEAN DISTANCE BETWEEN THE QUERY AND EVERY ROW OF THE TARGETS
+PG_FUNCTION_INFO_V1(arrayxd_euclidean_many);
+Datum arrayxd_euclidean_many(PG_FUNCTION_ARGS)
+{
+    ArrayType *query = PG_GETARG_ARRAYTYPE_P(0);
+    ArrayType *targets = PG_GETARG_ARRAYTYPE_P(1);
+
+    PG_RETURN_ARRAYTYPE_P(ArrayXdEuclideanMany(query, targets));
+}
+
+// RETURNS THE MANHATTAN DISTANCE BETWEEN THE QUERY AND EVERY ROW OF THE TARGETS
+PG_FUNCTION_INFO_V1(arrayxd_manhattan_many);
+Datum arrayxd_manhattan_many(PG_FUNCTION_ARGS)
+{
+    ArrayType *query = PG_GETARG_ARRAYTYPE_P(0);
+    ArrayType *targets = PG_GETARG_ARRAYTYPE_P(1);
+
+    PG_RETURN_ARRAYTYPE_P(ArrayXdManhattanMany(query, targets));
+}
+
+// RETURNS THE USR SIMILARITY BETWEEN THE QUERY AND EVERY ROW OF THE TARGETS
+PG_FUNCTION_INFO_V1(arrayxd_usrsim_many);
+Datum arrayxd_usrsim_many(PG_FUNCTION_ARGS)
+{
+    ArrayType *query = PG_GETARG_ARRAYTYPE_P(0);
+    ArrayType *targets = PG_GETARG_ARRAYTYPE_P(1);
+
+    PG_RETURN_ARRAYTYPE_P(ArrayXdUSRSimMany(query, targets));
 }
\ No newline at end of file
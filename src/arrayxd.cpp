@@ -3,20 +3,103 @@
 
 using namespace Eigen;
 
-// CONVERTS A POSTGRESQL INTO AN EIGEN ARRAYXD
-inline ArrayXd arraytype_to_arrayxd(ArrayType *array)
+// KERNEL FOR THE EUCLIDEAN DISTANCE
+struct EuclideanKernel
 {
-    // MAP POSTGRESQL ARRAY TO EIGEN ARRAYXD
-    Map<ArrayXd> arrayxd((double *) ARR_DATA_PTR(array), arraytype_num_elems(array));
-    
-    return arrayxd;
+    typedef double Result;
+
+    template<typename Derived1, typename Derived2>
+    Result operator()(const ArrayBase<Derived1> &arrayxd1, const ArrayBase<Derived2> &arrayxd2) const
+    {
+        return sqrt((arrayxd1-arrayxd2).square().sum());
+    }
+};
+
+// KERNEL FOR THE MANHATTAN DISTANCE
+struct ManhattanKernel
+{
+    typedef double Result;
+
+    template<typename Derived1, typename Derived2>
+    Result operator()(const ArrayBase<Derived1> &arrayxd1, const ArrayBase<Derived2> &arrayxd2) const
+    {
+        return (arrayxd1-arrayxd2).abs().sum();
+    }
+};
+
+// KERNEL FOR THE USR SIMILARITY: INVERSE OF THE MEAN MANHATTAN DISTANCE
+struct USRKernel
+{
+    typedef double Result;
+
+    template<typename Derived1, typename Derived2>
+    Result operator()(const ArrayBase<Derived1> &arrayxd1, const ArrayBase<Derived2> &arrayxd2) const
+    {
+        return 1.0 / (1.0 + ManhattanKernel()(arrayxd1, arrayxd2) / arrayxd1.size());
+    }
+};
+
+// NUMBER OF VALUES OF THE USR AND USRCAT DESCRIPTORS
+#define USR_SIZE        12
+#define USRCAT_SIZE     60
+
+// FIXED-SIZE VIEWS ON USR AND USRCAT DESCRIPTORS. THE USRCAT DESCRIPTOR IS SEEN
+// AS A COLUMN-MAJOR 12X5 ARRAY, ONE COLUMN PER ATOM SUBSET, SO THAT THE WEIGHTS
+// CAN BE BROADCAST OVER THE COLUMNS
+template<typename Scalar> struct USRTypes
+{
+    typedef Map<const Array<Scalar, USR_SIZE, 1> >    USRMap;
+    typedef Map<const Array<Scalar, USR_SIZE, 5> >    USRCatMap;
+    typedef Array<Scalar, 1, 5>                       Weights;
+};
+
+// RETURNS THE USR SIMILARITY OF TWO DESCRIPTORS WITH EXACTLY 12 VALUES; THE SIZE
+// IS KNOWN AT COMPILE TIME, SO EIGEN UNROLLS THE REDUCTION COMPLETELY
+template<typename Scalar>
+inline double usr_similarity(const Scalar *data1, const Scalar *data2)
+{
+    typename USRTypes<Scalar>::USRMap usr1(data1), usr2(data2);
+
+    return 1.0 / (1.0 + (usr1 - usr2).abs().sum() / USR_SIZE);
+}
+
+/* Returns the USRCAT similarity of two descriptors with exactly 60 values. The
+ * weighted Manhattan distance of all five subsets is a single reduction over
+ * the 12x5 array with the weights broadcast over its columns.
+ *
+ * The scale term is used to normalize the distance between the moments by the
+ * USRCAT weights that were used. For example if all weights are 1.0 then the
+ * scale will be 60. On the other hand, if only ow is 1.0 and the rest 0 then
+ * the scale will be 12, defaulting to classic USR.
+ */
+template<typename Scalar>
+inline double usrcat_similarity(const Scalar *data1, const Scalar *data2,
+                                const typename USRTypes<Scalar>::Weights &weights)
+{
+    typename USRTypes<Scalar>::USRCatMap usrcat1(data1), usrcat2(data2);
+
+    double distance = ((usrcat1 - usrcat2).abs().rowwise() * weights).sum();
+    double scale = USR_SIZE * weights.sum();
+
+    return 1.0 / (1.0 + distance / scale);
+}
+
+// CHECKS IF BOTH ARRAYS ARE USRCAT DESCRIPTORS
+inline void usrcat_check_size(ArrayType *a1, ArrayType *a2)
+{
+    // both arrays must have exactly 60 elements otherwise bad things happen
+    if (arraytype_num_elems(a1) != USRCAT_SIZE || arraytype_num_elems(a2) != USRCAT_SIZE)
+    {
+        ereport(ERROR, (errcode(ERRCODE_DATA_EXCEPTION), 
+                        errmsg("cannot calculate USRCAT similarity: both arrays must have exactly 60 elements.")));
+    }
 }
 
 // RETURNS THE NUMBER OF COEFFICIENTS IN ARRAY
 extern "C"
 int ArrayXdSize(ArrayType *array)
 {
-    ArrayXd arrayxd = arraytype_to_arrayxd(array);
+    ArrayXdMap arrayxd = arraytype_to_arrayxd(array);
 
     // RETURNS THE SIZE FOR 1D ARRAY
     return arrayxd.size();
@@ -26,7 +109,7 @@ int ArrayXdSize(ArrayType *array)
 extern "C"
 int ArrayXdNonZeros(ArrayType *array)
 {
-    ArrayXd arrayxd = arraytype_to_arrayxd(array);
+    ArrayXdMap arrayxd = arraytype_to_arrayxd(array);
 
     return arrayxd.count();
 }
@@ -35,7 +118,7 @@ int ArrayXdNonZeros(ArrayType *array)
 extern "C"
 double ArrayXdMinCoeff(ArrayType *array)
 {
-    ArrayXd arrayxd = arraytype_to_arrayxd(array);
+    ArrayXdMap arrayxd = arraytype_to_arrayxd(array);
 
     return arrayxd.minCoeff();
 }
@@ -44,7 +127,7 @@ double ArrayXdMinCoeff(ArrayType *array)
 extern "C"
 double ArrayXdMaxCoeff(ArrayType *array)
 {
-    ArrayXd arrayxd = arraytype_to_arrayxd(array);
+    ArrayXdMap arrayxd = arraytype_to_arrayxd(array);
 
     return arrayxd.maxCoeff();
 }
@@ -53,7 +136,7 @@ double ArrayXdMaxCoeff(ArrayType *array)
 extern "C"
 double ArrayXdSum(ArrayType *array)
 {
-    ArrayXd arrayxd = arraytype_to_arrayxd(array);
+    ArrayXdMap arrayxd = arraytype_to_arrayxd(array);
 
     return arrayxd.sum();
 }
@@ -62,7 +145,7 @@ double ArrayXdSum(ArrayType *array)
 extern "C"
 double ArrayXdMean(ArrayType *array)
 {
-    ArrayXd arrayxd = arraytype_to_arrayxd(array);
+    ArrayXdMap arrayxd = arraytype_to_arrayxd(array);
 
     return arrayxd.mean();
 }
@@ -71,7 +154,7 @@ double ArrayXdMean(ArrayType *array)
 extern "C"
 ArrayType *ArrayXdAbs(ArrayType *array)
 {
-    ArrayXd arrayxd = arraytype_to_arrayxd(array);
+    ArrayXdMap arrayxd = arraytype_to_arrayxd(array);
 
     return densebase_to_float8_arraytype(arrayxd.abs());
 }
@@ -81,8 +164,8 @@ extern "C"
 ArrayType *ArrayXdAdd(ArrayType *a1, ArrayType *a2)
 {
     // MAP DATA TO EIGEN ARRAYS
-    ArrayXd arrayxd1 = arraytype_to_arrayxd(a1);
-    ArrayXd arrayxd2 = arraytype_to_arrayxd(a2);
+    ArrayXdMap arrayxd1 = arraytype_to_arrayxd(a1);
+    ArrayXdMap arrayxd2 = arraytype_to_arrayxd(a2);
 
     // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
     EigenBaseEqSize(arrayxd1,arrayxd2);
@@ -95,8 +178,8 @@ extern "C"
 ArrayType *ArrayXdSub(ArrayType *a1, ArrayType *a2)
 {
     // MAP DATA TO EIGEN ARRAYS
-    ArrayXd arrayxd1 = arraytype_to_arrayxd(a1);
-    ArrayXd arrayxd2 = arraytype_to_arrayxd(a2);
+    ArrayXdMap arrayxd1 = arraytype_to_arrayxd(a1);
+    ArrayXdMap arrayxd2 = arraytype_to_arrayxd(a2);
 
     // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
     EigenBaseEqSize(arrayxd1,arrayxd2);
@@ -109,8 +192,8 @@ extern "C"
 ArrayType *ArrayXdMul(ArrayType *a1, ArrayType *a2)
 {
     // MAP DATA TO EIGEN ARRAYS
-    ArrayXd arrayxd1 = arraytype_to_arrayxd(a1);
-    ArrayXd arrayxd2 = arraytype_to_arrayxd(a2);
+    ArrayXdMap arrayxd1 = arraytype_to_arrayxd(a1);
+    ArrayXdMap arrayxd2 = arraytype_to_arrayxd(a2);
 
     // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
     EigenBaseEqSize(arrayxd1,arrayxd2);
@@ -123,8 +206,8 @@ extern "C"
 ArrayType *ArrayXdDiv(ArrayType *a1, ArrayType *a2)
 {
     // MAP DATA TO EIGEN ARRAYS
-    ArrayXd arrayxd1 = arraytype_to_arrayxd(a1);
-    ArrayXd arrayxd2 = arraytype_to_arrayxd(a2);
+    ArrayXdMap arrayxd1 = arraytype_to_arrayxd(a1);
+    ArrayXdMap arrayxd2 = arraytype_to_arrayxd(a2);
 
     // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
     EigenBaseEqSize(arrayxd1,arrayxd2);
@@ -138,7 +221,7 @@ ArrayType *ArrayXdDiv(ArrayType *a1, ArrayType *a2)
 extern "C"
 ArrayType *ArrayXdAddScalar(ArrayType *array, double scalar)
 {
-    ArrayXd arrayxd = arraytype_to_arrayxd(array);
+    ArrayXdMap arrayxd = arraytype_to_arrayxd(array);
     
     return densebase_to_float8_arraytype(arrayxd + scalar);
 }
@@ -147,7 +230,7 @@ ArrayType *ArrayXdAddScalar(ArrayType *array, double scalar)
 extern "C"
 ArrayType *ArrayXdSubScalar(ArrayType *array, double scalar)
 {
-    ArrayXd arrayxd = arraytype_to_arrayxd(array);
+    ArrayXdMap arrayxd = arraytype_to_arrayxd(array);
 
     return densebase_to_float8_arraytype(arrayxd - scalar);
 }
@@ -156,7 +239,7 @@ ArrayType *ArrayXdSubScalar(ArrayType *array, double scalar)
 extern "C"
 ArrayType *ArrayXdMulScalar(ArrayType *array, double scalar)
 {
-    ArrayXd arrayxd = arraytype_to_arrayxd(array);
+    ArrayXdMap arrayxd = arraytype_to_arrayxd(array);
 
     return densebase_to_float8_arraytype(arrayxd * scalar);
 }
@@ -167,74 +250,220 @@ ArrayType *ArrayXdMulScalar(ArrayType *array, double scalar)
 extern "C"
 double ArrayXdEuclidean(ArrayType *a1, ArrayType *a2)
 {
-    // MAP DATA TO EIGEN ARRAYS
-    ArrayXd arrayxd1 = arraytype_to_arrayxd(a1);
-    ArrayXd arrayxd2 = arraytype_to_arrayxd(a2);
-
-    // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
-    EigenBaseEqSize(arrayxd1,arrayxd2);
-
-    return sqrt((arrayxd1-arrayxd2).square().sum());
+    return arraytype_apply<ArrayXd>(a1, a2, EuclideanKernel());
 }
 
 // RETURNS THE MANHATTAN DISTANCE BETWEEN BOTH ARRAYS
 extern "C"
 double ArrayXdManhattan(ArrayType *a1, ArrayType *a2)
 {
-    // MAP DATA TO EIGEN ARRAYS
-    ArrayXd arrayxd1 = arraytype_to_arrayxd(a1);
-    ArrayXd arrayxd2 = arraytype_to_arrayxd(a2);
-
-    // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
-    EigenBaseEqSize(arrayxd1,arrayxd2);
-
-    return (arrayxd1-arrayxd2).abs().sum();
+    return arraytype_apply<ArrayXd>(a1, a2, ManhattanKernel());
 }
 
-// RETURNS THE WEIGHTED USR MANHATTAN DISTANCE BETWEEN THE TWO ARRAYS
+// RETURNS THE WEIGHTED USR MANHATTAN DISTANCE BETWEEN THE TWO ARRAYS; ARRAYS THAT
+// ARE NOT USR DESCRIPTORS ARE COMPARED WITH THE GENERIC KERNEL
 extern "C"
 double ArrayXdUSRSim(ArrayType *a1, ArrayType *a2)
 {
-    // MAP DATA TO EIGEN ARRAYS
-    ArrayXd arrayxd1 = arraytype_to_arrayxd(a1);
-    ArrayXd arrayxd2 = arraytype_to_arrayxd(a2);
-
-    // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
-    EigenBaseEqSize(arrayxd1,arrayxd2);
+    if (arraytype_num_elems(a1) == USR_SIZE && arraytype_num_elems(a2) == USR_SIZE)
+    {
+        return usr_similarity((const double *) ARR_DATA_PTR(a1), (const double *) ARR_DATA_PTR(a2));
+    }
 
-    return 1.0 / (1.0 + (arrayxd1-arrayxd2).abs().sum() / arrayxd1.size());
+    return arraytype_apply<ArrayXd>(a1, a2, USRKernel());
 }
 
 // RETURNS THE WEIGHTED USR MANHATTAN DISTANCE BETWEEN THE TWO ARRAYS / USRCAT VERSION WITH 60 VALUES
 extern "C"
 double ArrayXdUSRCatSim(ArrayType *a1, ArrayType *a2, float ow, float hw, float rw, float aw, float dw)
 {
-    // MAP DATA TO EIGEN ARRAYS
-    ArrayXd arrayxd1 = arraytype_to_arrayxd(a1);
-    ArrayXd arrayxd2 = arraytype_to_arrayxd(a2);
+    usrcat_check_size(a1, a2);
 
-    // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
-    EigenBaseEqSize(arrayxd1,arrayxd2);
+    USRTypes<double>::Weights weights;
+    weights << ow, hw, rw, aw, dw;
 
-    // both arrays must have exactly 60 elements otherwise bad things happen
-    if (arrayxd1.size() != 60)
+    return usrcat_similarity((const double *) ARR_DATA_PTR(a1), (const double *) ARR_DATA_PTR(a2), weights);
+}
+
+// RETURNS THE USR SIMILARITY OF TWO SINGLE PRECISION DESCRIPTORS
+extern "C"
+double ArrayXfUSRSim(ArrayType *a1, ArrayType *a2)
+{
+    if (arraytype_num_elems(a1) != USR_SIZE || arraytype_num_elems(a2) != USR_SIZE)
     {
-        ereport(ERROR, (errcode(ERRCODE_DATA_EXCEPTION), 
-                        errmsg("cannot calculate USRCAT similarity: both arrays must have exactly 60 elements.")));
+        ereport(ERROR, (errcode(ERRCODE_DATA_EXCEPTION),
+                        errmsg("cannot calculate USR similarity: both arrays must have exactly 12 elements.")));
     }
 
-    // 
-    double weights = ow * (arrayxd1.segment(0,12) - arrayxd2.segment(0,12)).abs().sum() +
-                     hw * (arrayxd1.segment(12,12) - arrayxd2.segment(12,12)).abs().sum() +
-                     rw * (arrayxd1.segment(24,12) - arrayxd2.segment(24,12)).abs().sum() +
-                     aw * (arrayxd1.segment(36,12) - arrayxd2.segment(36,12)).abs().sum() +
-                     dw * (arrayxd1.segment(48,12) - arrayxd2.segment(48,12)).abs().sum();
-
-    /* the scale term is used to normalize the distance between the moments by 
-     * the USRCAT weights that were used. For example if all weights are 1.0 then
-     * the scale will be 60. On the other hand, if only ow is 1.0 and the rest 0
-     * then the scale will be 12, defaulting to classic USR. */
-    double scale = 12 * (ow+hw+rw+aw+dw);
-    
-    return  1.0 / (1.0 + weights / scale);
+    return usr_similarity((const float *) ARR_DATA_PTR(a1), (const float *) ARR_DATA_PTR(a2));
+}
+
+// RETURNS THE USRCAT SIMILARITY OF TWO SINGLE PRECISION DESCRIPTORS
+extern "C"
+double ArrayXfUSRCatSim(ArrayType *a1, ArrayType *a2, float ow, float hw, float rw, float aw, float dw)
+{
+    usrcat_check_size(a1, a2);
+
+    USRTypes<float>::Weights weights;
+    weights << ow, hw, rw, aw, dw;
+
+    return usrcat_similarity((const float *) ARR_DATA_PTR(a1), (const float *) ARR_DATA_PTR(a2), weights);
+}
+
+
+/////////////////////////////BATCH DISTANCE METRICS/////////////////////////////
+
+
+// RETURNS THE EUCLIDEAN DISTANCES BETWEEN THE QUERY AND EVERY ROW OF THE TARGETS
+extern "C"
+ArrayType *ArrayXdEuclideanMany(ArrayType *query, ArrayType *targets)
+{
+    return arraytype_apply_rows<ArrayXd>(query, targets, EuclideanKernel());
+}
+
+// RETURNS THE MANHATTAN DISTANCES BETWEEN THE QUERY AND EVERY ROW OF THE TARGETS
+extern "C"
+ArrayType *ArrayXdManhattanMany(ArrayType *query, ArrayType *targets)
+{
+    return arraytype_apply_rows<ArrayXd>(query, targets, ManhattanKernel());
+}
+
+// RETURNS THE USR SIMILARITIES BETWEEN THE QUERY AND EVERY ROW OF THE TARGETS
+extern "C"
+ArrayType *ArrayXdUSRSimMany(ArrayType *query, ArrayType *targets)
+{
+    return arraytype_apply_rows<ArrayXd>(query, targets, USRKernel());
+}
+
+
+////////////////////////////////USR DESCRIPTORS/////////////////////////////////
+
+
+// NUMBER OF MOMENTS PER REFERENCE POINT
+#define USR_NUM_MOMENTS 3
+
+// THE FOUR REFERENCE POINTS OF USR: THE CENTROID (CTD), THE ATOM CLOSEST TO THE
+// CENTROID (CST), THE ATOM FARTHEST FROM THE CENTROID (FCT) AND THE ATOM
+// FARTHEST FROM FCT (FTF). THE ROWS HOLD THE DISTANCES OF ALL ATOMS TO THEM
+typedef Array<double, 4, Dynamic, RowMajor> USRDistances;
+
+// CHECKS IF THE MATRIX CAN BE USED TO CALCULATE A USR DESCRIPTOR
+inline void usr_check_coords(const MatrixXdMap &coords)
+{
+    if (coords.size() == 0 || coords.cols() != 3)
+    {
+        ereport(ERROR, (errcode(ERRCODE_DATA_EXCEPTION),
+                        errmsg("cannot calculate USR descriptor: coordinates must be a non-empty matrix with exactly three columns.")));
+    }
+}
+
+// RETURNS THE DISTANCES OF ALL ATOMS TO THE FOUR USR REFERENCE POINTS
+inline USRDistances usr_distances(const MatrixXdMap &coords)
+{
+    USRDistances distances(4, coords.rows());
+    Index cst, fct, ftf;
+
+    RowVector3d ctd = coords.colwise().mean();
+
+    distances.row(0) = (coords.rowwise() - ctd).rowwise().norm().transpose();
+    distances.row(0).minCoeff(&cst);
+    distances.row(0).maxCoeff(&fct);
+
+    distances.row(1) = (coords.rowwise() - coords.row(cst)).rowwise().norm().transpose();
+    distances.row(2) = (coords.rowwise() - coords.row(fct)).rowwise().norm().transpose();
+    distances.row(2).maxCoeff(&ftf);
+
+    distances.row(3) = (coords.rowwise() - coords.row(ftf)).rowwise().norm().transpose();
+
+    return distances;
+}
+
+/* Writes the mean, the standard deviation and the cube root of the skewness of
+ * the distances of the atoms selected by the mask to each reference point.
+ * The mask holds ones for the selected atoms and zeros otherwise, so that all
+ * subsets are reduced with the same vectorized expressions. The moments of an
+ * empty subset are zero.
+ */
+inline void usr_moments(const USRDistances &distances, const RowVectorXd &mask, double *moments)
+{
+    double count = mask.sum();
+
+    Map<Array<double, 4, USR_NUM_MOMENTS, RowMajor> > result(moments);
+    result.setZero();
+
+    if (count == 0) return;
+
+    Array4d mean = (distances.rowwise() * mask.array()).rowwise().sum() / count;
+    USRDistances deviations = (distances.colwise() - mean).rowwise() * mask.array();
+
+    Array4d stddev = (deviations.square().rowwise().sum() / count).sqrt();
+    Array4d skewness = deviations.cube().rowwise().sum() / count;
+
+    result.col(0) = mean;
+    result.col(1) = stddev;
+
+    for (int i = 0; i < 4; i++)
+    {
+        if (stddev(i) > 0) result(i, 2) = std::cbrt(skewness(i) / std::pow(stddev(i), 3));
+    }
+}
+
+// RETURNS THE MASK OF AN ATOM SUBSET FROM AN ARRAY OF FLAGS, ONE PER ATOM
+inline RowVectorXd usr_mask(ArrayType *array, Index natoms)
+{
+    ArrayXiMap flags = arraytype_to_arrayxi(array);
+
+    if (flags.size() != natoms)
+    {
+        ereport(ERROR, (errcode(ERRCODE_DATA_EXCEPTION),
+                        errmsg("cannot calculate USRCAT descriptor: every mask must have one element per atom.")));
+    }
+
+    return (flags != 0).cast<double>().matrix().transpose();
+}
+
+// RETURNS THE 12 USR MOMENTS OF THE COORDINATES
+extern "C"
+ArrayType *ArrayXdUSRDescriptor(ArrayType *coords)
+{
+    MatrixXdMap matrixxd = arraytype_to_matrixxd(coords);
+
+    usr_check_coords(matrixxd);
+
+    ArrayType *array = arraytype_alloc<double>(1, 1, USR_SIZE);
+
+    usr_moments(usr_distances(matrixxd), RowVectorXd::Ones(matrixxd.rows()), (double *) ARR_DATA_PTR(array));
+
+    return array;
+}
+
+/* Returns the 60 USRCAT moments of the coordinates: the USR moments of all
+ * atoms followed by those of the hydrophobic, aromatic, acceptor and donor
+ * atoms, in the order of the weights of arrayxd_usrcatsim(). The reference
+ * points are always those of all atoms.
+ */
+extern "C"
+ArrayType *ArrayXdUSRCatDescriptor(ArrayType *coords, ArrayType *hydrophobic, ArrayType *aromatic,
+                                   ArrayType *acceptor, ArrayType *donor)
+{
+    MatrixXdMap matrixxd = arraytype_to_matrixxd(coords);
+
+    usr_check_coords(matrixxd);
+
+    Index natoms = matrixxd.rows();
+    ArrayType *subsets[4] = {hydrophobic, aromatic, acceptor, donor};
+
+    ArrayType *array = arraytype_alloc<double>(1, 1, USRCAT_SIZE);
+    double *data = (double *) ARR_DATA_PTR(array);
+
+    USRDistances distances = usr_distances(matrixxd);
+
+    usr_moments(distances, RowVectorXd::Ones(natoms), data);
+
+    for (int i = 0; i < 4; i++)
+    {
+        usr_moments(distances, usr_mask(subsets[i], natoms), data + (i + 1) * USR_SIZE);
+    }
+
+    return array;
 }
\ No newline at end of file
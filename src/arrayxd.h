@@ -36,6 +36,20 @@ extern "C"
     double     ArrayXdUSRSim(ArrayType *a1, ArrayType *a2);
     double     ArrayXdUSRCatSim(ArrayType *a1, ArrayType *a2, float ow, float hw, float rw, float aw, float dw);
 
+    // USR SIMILARITIES OF SINGLE PRECISION DESCRIPTORS
+    double     ArrayXfUSRSim(ArrayType *a1, ArrayType *a2);
+    double     ArrayXfUSRCatSim(ArrayType *a1, ArrayType *a2, float ow, float hw, float rw, float aw, float dw);
+
+    // USR DESCRIPTORS CALCULATED FROM NX3 COORDINATES
+    ArrayType *ArrayXdUSRDescriptor(ArrayType *coords);
+    ArrayType *ArrayXdUSRCatDescriptor(ArrayType *coords, ArrayType *hydrophobic, ArrayType *aromatic,
+                                       ArrayType *acceptor, ArrayType *donor);
+
+    // BATCH DISTANCE METRICS: ONE QUERY AGAINST EVERY ROW OF A MATRIX
+    ArrayType *ArrayXdEuclideanMany(ArrayType *query, ArrayType *targets);
+    ArrayType *ArrayXdManhattanMany(ArrayType *query, ArrayType *targets);
+    ArrayType *ArrayXdUSRSimMany(ArrayType *query, ArrayType *targets);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
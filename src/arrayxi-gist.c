@@ -0,0 +1,469 @@
+#include "arrayxi.h"
+#include "fmgr.h"
+#include "access/gist.h"
+#include "utils/memutils.h"
+
+
+/////////////////////////////ARRAYXI GIST SIGNATURE/////////////////////////////
+
+
+// GIST KEY OF AN ARRAYXI: ONE BIT PER POSITION THAT IS SET IF THE ELEMENT IS
+// NON-ZERO. LEAF KEYS CONTAIN THE SIGNATURE OF A SINGLE ARRAY, INNER KEYS THE
+// UNION OF ALL SIGNATURES BELOW THEM AND THE RANGE OF THEIR POPULATION COUNTS
+typedef struct
+{
+    int32  vl_len_;     // VARLENA HEADER, DO NOT TOUCH DIRECTLY
+    int32  nbits;       // NUMBER OF POSITIONS IN THE ARRAYS
+    int32  minA;        // SMALLEST NUMBER OF NON-ZERO ELEMENTS BELOW THE KEY
+    int32  maxA;        // LARGEST NUMBER OF NON-ZERO ELEMENTS BELOW THE KEY
+    uint64 words[FLEXIBLE_ARRAY_MEMBER];
+} ArrayXiGistKey;
+
+#define GIST_ARRAYXI_WORD_BITS        64
+#define GIST_ARRAYXI_NWORDS(nbits)    (((nbits) + GIST_ARRAYXI_WORD_BITS - 1) / GIST_ARRAYXI_WORD_BITS)
+#define GIST_ARRAYXI_SIZE(nbits)      (offsetof(ArrayXiGistKey, words) + GIST_ARRAYXI_NWORDS(nbits) * sizeof(uint64))
+
+#define DatumGetArrayXiGistKey(X)     ((ArrayXiGistKey *) PG_DETOAST_DATUM(X))
+
+// STRATEGIES 1-8 ARE THE THRESHOLD OPERATORS, 9-16 THE KNN ORDERING OPERATORS
+// OF THE SAME METRICS IN THE SAME ORDER
+#define GIST_ARRAYXI_NMETRICS         8
+
+static const ArrayXiMetric gist_arrayxi_metrics[GIST_ARRAYXI_NMETRICS] =
+{
+    ARRAYXI_DICE,
+    ARRAYXI_EUCLIDEAN,
+    ARRAYXI_KULCZYNSKI,
+    ARRAYXI_MANHATTAN,
+    ARRAYXI_OCHIAI,
+    ARRAYXI_RUSSELL_RAO,
+    ARRAYXI_SIMPSON,
+    ARRAYXI_TVERSKY
+};
+
+// QUERY SIGNATURE KEPT IN FN_EXTRA FOR THE DURATION OF THE INDEX SCAN
+typedef struct
+{
+    ArrayType      *query;
+    ArrayXiGistKey *key;
+} GistArrayXiQuery;
+
+// ALLOCATES AN EMPTY KEY WITH THE GIVEN NUMBER OF POSITIONS
+static ArrayXiGistKey *gist_arrayxi_key_alloc(int nbits)
+{
+    Size nbytes = GIST_ARRAYXI_SIZE(nbits);
+    ArrayXiGistKey *key = (ArrayXiGistKey *) palloc0(nbytes);
+
+    SET_VARSIZE(key, nbytes);
+    key->nbits = nbits;
+
+    return key;
+}
+
+// RETURNS A COPY OF THE KEY
+static ArrayXiGistKey *gist_arrayxi_key_copy(ArrayXiGistKey *key)
+{
+    ArrayXiGistKey *copy = (ArrayXiGistKey *) palloc(VARSIZE(key));
+
+    memcpy(copy, key, VARSIZE(key));
+
+    return copy;
+}
+
+// CREATES THE LEAF KEY OF AN ARRAY
+static ArrayXiGistKey *gist_arrayxi_key_from_array(ArrayType *array)
+{
+    ArrayXiGistKey *key;
+    int            *data = (int *) ARR_DATA_PTR(array);
+    int             nbits, i, count = 0;
+
+    if (ARR_NDIM(array) > 1 || ARR_HASNULL(array))
+    {
+        ereport(ERROR, (errcode(ERRCODE_DATA_EXCEPTION),
+                        errmsg("array must be one-dimensional without null elements.")));
+    }
+
+    nbits = ArrayGetNItems(ARR_NDIM(array), ARR_DIMS(array));
+    key = gist_arrayxi_key_alloc(nbits);
+
+    for (i = 0; i < nbits; i++)
+    {
+        if (data[i] != 0)
+        {
+            key->words[i / GIST_ARRAYXI_WORD_BITS] |= UINT64CONST(1) << (i % GIST_ARRAYXI_WORD_BITS);
+            count++;
+        }
+    }
+
+    key->minA = key->maxA = count;
+
+    return key;
+}
+
+// CHECKS IF THE KEYS HAVE THE SAME NUMBER OF POSITIONS
+static void gist_arrayxi_check_size(ArrayXiGistKey *k1, ArrayXiGistKey *k2)
+{
+    if (k1->nbits != k2->nbits)
+    {
+        ereport(ERROR, (errcode(ERRCODE_DATA_EXCEPTION),
+                        errmsg("eigen objects must have the same number of coefficients.")));
+    }
+}
+
+// MERGES THE KEY INTO THE RESULT
+static void gist_arrayxi_key_union(ArrayXiGistKey *result, ArrayXiGistKey *key)
+{
+    int i, nwords = GIST_ARRAYXI_NWORDS(key->nbits);
+
+    gist_arrayxi_check_size(result, key);
+
+    for (i = 0; i < nwords; i++) result->words[i] |= key->words[i];
+
+    result->minA = Min(result->minA, key->minA);
+    result->maxA = Max(result->maxA, key->maxA);
+}
+
+// RETURNS THE HAMMING DISTANCE BETWEEN THE SIGNATURES
+static int gist_arrayxi_hamming(ArrayXiGistKey *k1, ArrayXiGistKey *k2)
+{
+    int i, count = 0, nwords = GIST_ARRAYXI_NWORDS(k1->nbits);
+
+    for (i = 0; i < nwords; i++) count += __builtin_popcountll(k1->words[i] ^ k2->words[i]);
+
+    return count;
+}
+
+// RETURNS THE COST OF MERGING THE KEY INTO ORIG: THE NUMBER OF POSITIONS THAT
+// WOULD BE ADDED TO THE SIGNATURE PLUS THE GROWTH OF THE POPULATION COUNT RANGE
+static int gist_arrayxi_cost(ArrayXiGistKey *orig, ArrayXiGistKey *key)
+{
+    int i, count = 0, nwords = GIST_ARRAYXI_NWORDS(orig->nbits);
+
+    gist_arrayxi_check_size(orig, key);
+
+    for (i = 0; i < nwords; i++) count += __builtin_popcountll(key->words[i] & ~orig->words[i]);
+
+    count += Max(orig->minA - key->minA, 0) + Max(key->maxA - orig->maxA, 0);
+
+    return count;
+}
+
+// RETURNS THE SIGNATURE OF THE QUERY, WHICH IS ONLY CALCULATED AGAIN IF THE
+// QUERY CHANGES, E.G. IN THE INNER SIDE OF A NESTED LOOP
+static ArrayXiGistKey *gist_arrayxi_query_key(FunctionCallInfo fcinfo, ArrayType *query)
+{
+    GistArrayXiQuery *cache = (GistArrayXiQuery *) fcinfo->flinfo->fn_extra;
+    MemoryContext     oldcontext;
+
+    if (cache != NULL && VARSIZE(cache->query) == VARSIZE(query) &&
+        memcmp(cache->query, query, VARSIZE(query)) == 0)
+    {
+        return cache->key;
+    }
+
+    oldcontext = MemoryContextSwitchTo(fcinfo->flinfo->fn_mcxt);
+
+    if (cache == NULL)
+    {
+        cache = (GistArrayXiQuery *) palloc(sizeof(GistArrayXiQuery));
+        fcinfo->flinfo->fn_extra = cache;
+    }
+    else
+    {
+        pfree(cache->query);
+        pfree(cache->key);
+    }
+
+    cache->query = (ArrayType *) palloc(VARSIZE(query));
+    memcpy(cache->query, query, VARSIZE(query));
+    cache->key = gist_arrayxi_key_from_array(query);
+
+    MemoryContextSwitchTo(oldcontext);
+
+    return cache->key;
+}
+
+// RETURNS THE METRIC OF THE STRATEGY
+static ArrayXiMetric gist_arrayxi_metric(StrategyNumber strategy)
+{
+    if (strategy < 1 || strategy > 2 * GIST_ARRAYXI_NMETRICS)
+    {
+        ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR),
+                        errmsg("unrecognized strategy number: %d", strategy)));
+    }
+
+    return gist_arrayxi_metrics[(strategy - 1) % GIST_ARRAYXI_NMETRICS];
+}
+
+// RETURNS THE USER-SET LIMIT OF THE METRIC
+static double gist_arrayxi_limit(ArrayXiMetric metric)
+{
+    switch (metric)
+    {
+        case ARRAYXI_DICE:        return arrayxi_dice_limit;
+        case ARRAYXI_EUCLIDEAN:   return arrayxi_euclidean_limit;
+        case ARRAYXI_KULCZYNSKI:  return arrayxi_kulcz_limit;
+        case ARRAYXI_MANHATTAN:   return arrayxi_manhattan_limit;
+        case ARRAYXI_OCHIAI:      return arrayxi_ochiai_limit;
+        case ARRAYXI_RUSSELL_RAO: return arrayxi_russell_rao_limit;
+        case ARRAYXI_SIMPSON:     return arrayxi_simpson_limit;
+        case ARRAYXI_TVERSKY:     return arrayxi_tversky_limit;
+        default:                  break;
+    }
+
+    ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR),
+                    errmsg("no limit for arrayxi similarity metric: %d", (int) metric)));
+
+    return 0.0;
+}
+
+// RETURNS THE LARGEST SIMILARITY BETWEEN THE QUERY AND ANY ARRAY BELOW THE KEY
+static double gist_arrayxi_upper_bound(ArrayXiGistKey *key, ArrayXiGistKey *query, ArrayXiMetric metric)
+{
+    ArrayXiBounds bounds;
+    int           i, c = 0, nwords = GIST_ARRAYXI_NWORDS(key->nbits);
+
+    gist_arrayxi_check_size(key, query);
+
+    for (i = 0; i < nwords; i++) c += __builtin_popcountll(key->words[i] & query->words[i]);
+
+    bounds.minA = key->minA;
+    bounds.maxA = key->maxA;
+    bounds.B = query->maxA;
+    bounds.c = c;
+    bounds.n = key->nbits;
+
+    return SimilarityUpperBound(&bounds, metric);
+}
+
+
+///////////////////////////GIST SUPPORT FUNCTIONS///////////////////////////////
+
+
+// RETURNS FALSE IF NO ARRAY BELOW THE KEY CAN BE ABOVE THE LIMIT OF THE METRIC
+PG_FUNCTION_INFO_V1(gist_arrayxi_consistent);
+Datum gist_arrayxi_consistent(PG_FUNCTION_ARGS)
+{
+    GISTENTRY      *entry = (GISTENTRY *) PG_GETARG_POINTER(0);
+    ArrayType      *query = PG_GETARG_ARRAYTYPE_P(1);
+    StrategyNumber  strategy = (StrategyNumber) PG_GETARG_UINT16(2);
+    bool           *recheck = (bool *) PG_GETARG_POINTER(4);
+
+    ArrayXiGistKey *key = DatumGetArrayXiGistKey(entry->key);
+    ArrayXiMetric   metric = gist_arrayxi_metric(strategy);
+
+    // THE SIGNATURES ONLY TELL WHICH ELEMENTS ARE NON-ZERO BUT NOT IF THEY ARE
+    // EQUAL, SO EVEN LEAF KEYS ONLY GIVE AN UPPER BOUND
+    *recheck = true;
+
+    PG_RETURN_BOOL(gist_arrayxi_upper_bound(key, gist_arrayxi_query_key(fcinfo, query), metric)
+                   >= gist_arrayxi_limit(metric));
+}
+
+// RETURNS THE SMALLEST DISTANCE BETWEEN THE QUERY AND ANY ARRAY BELOW THE KEY
+PG_FUNCTION_INFO_V1(gist_arrayxi_distance);
+Datum gist_arrayxi_distance(PG_FUNCTION_ARGS)
+{
+    GISTENTRY      *entry = (GISTENTRY *) PG_GETARG_POINTER(0);
+    ArrayType      *query = PG_GETARG_ARRAYTYPE_P(1);
+    StrategyNumber  strategy = (StrategyNumber) PG_GETARG_UINT16(2);
+    bool           *recheck = (bool *) PG_GETARG_POINTER(4);
+
+    ArrayXiGistKey *key = DatumGetArrayXiGistKey(entry->key);
+    ArrayXiMetric   metric = gist_arrayxi_metric(strategy);
+
+    *recheck = true;
+
+    PG_RETURN_FLOAT8(1 - gist_arrayxi_upper_bound(key, gist_arrayxi_query_key(fcinfo, query), metric));
+}
+
+// RETURNS THE UNION OF ALL KEYS
+PG_FUNCTION_INFO_V1(gist_arrayxi_union);
+Datum gist_arrayxi_union(PG_FUNCTION_ARGS)
+{
+    GistEntryVector *entryvec = (GistEntryVector *) PG_GETARG_POINTER(0);
+    int             *size = (int *) PG_GETARG_POINTER(1);
+
+    ArrayXiGistKey  *result = gist_arrayxi_key_copy(DatumGetArrayXiGistKey(entryvec->vector[0].key));
+    int              i;
+
+    for (i = 1; i < entryvec->n; i++)
+    {
+        gist_arrayxi_key_union(result, DatumGetArrayXiGistKey(entryvec->vector[i].key));
+    }
+
+    *size = VARSIZE(result);
+
+    PG_RETURN_POINTER(result);
+}
+
+// CONVERTS A LEAF ARRAY INTO ITS SIGNATURE; INNER KEYS ARE ALREADY SIGNATURES
+PG_FUNCTION_INFO_V1(gist_arrayxi_compress);
+Datum gist_arrayxi_compress(PG_FUNCTION_ARGS)
+{
+    GISTENTRY *entry = (GISTENTRY *) PG_GETARG_POINTER(0);
+    GISTENTRY *retval;
+
+    if (entry->leafkey)
+    {
+        ArrayXiGistKey *key = gist_arrayxi_key_from_array(DatumGetArrayTypeP(entry->key));
+
+        retval = (GISTENTRY *) palloc(sizeof(GISTENTRY));
+        gistentryinit(*retval, PointerGetDatum(key), entry->rel, entry->page, entry->offset, false);
+
+        PG_RETURN_POINTER(retval);
+    }
+
+    PG_RETURN_POINTER(entry);
+}
+
+// DETOASTS THE KEY IF NECESSARY
+PG_FUNCTION_INFO_V1(gist_arrayxi_decompress);
+Datum gist_arrayxi_decompress(PG_FUNCTION_ARGS)
+{
+    GISTENTRY      *entry = (GISTENTRY *) PG_GETARG_POINTER(0);
+    ArrayXiGistKey *key = DatumGetArrayXiGistKey(entry->key);
+    GISTENTRY      *retval;
+
+    if (key != (ArrayXiGistKey *) DatumGetPointer(entry->key))
+    {
+        retval = (GISTENTRY *) palloc(sizeof(GISTENTRY));
+        gistentryinit(*retval, PointerGetDatum(key), entry->rel, entry->page, entry->offset, false);
+
+        PG_RETURN_POINTER(retval);
+    }
+
+    PG_RETURN_POINTER(entry);
+}
+
+// PENALTY FOR INSERTING THE NEW KEY BELOW THE ORIGINAL ONE
+PG_FUNCTION_INFO_V1(gist_arrayxi_penalty);
+Datum gist_arrayxi_penalty(PG_FUNCTION_ARGS)
+{
+    GISTENTRY *origentry = (GISTENTRY *) PG_GETARG_POINTER(0);
+    GISTENTRY *newentry = (GISTENTRY *) PG_GETARG_POINTER(1);
+    float     *penalty = (float *) PG_GETARG_POINTER(2);
+
+    *penalty = (float) gist_arrayxi_cost(DatumGetArrayXiGistKey(origentry->key),
+                                         DatumGetArrayXiGistKey(newentry->key));
+
+    PG_RETURN_POINTER(penalty);
+}
+
+// ENTRY OF THE PICKSPLIT ALGORITHM SORTED BY ITS PREFERENCE FOR ONE OF THE SEEDS
+typedef struct
+{
+    OffsetNumber offset;
+    int          cost;
+} GistArrayXiSplitCost;
+
+static int gist_arrayxi_split_cost_cmp(const void *a, const void *b)
+{
+    return ((const GistArrayXiSplitCost *) b)->cost - ((const GistArrayXiSplitCost *) a)->cost;
+}
+
+/* Splits the entries of a page into two groups. The seeds are the two keys with
+ * the largest Hamming distance; the remaining keys are distributed in the order
+ * of how strongly they prefer one seed over the other, each one to the group
+ * whose union grows least (ties go to the smaller group).
+ */
+PG_FUNCTION_INFO_V1(gist_arrayxi_picksplit);
+Datum gist_arrayxi_picksplit(PG_FUNCTION_ARGS)
+{
+    GistEntryVector      *entryvec = (GistEntryVector *) PG_GETARG_POINTER(0);
+    GIST_SPLITVEC        *v = (GIST_SPLITVEC *) PG_GETARG_POINTER(1);
+
+    OffsetNumber          i, j, maxoff = entryvec->n - 1;
+    OffsetNumber          seed_1 = FirstOffsetNumber, seed_2 = OffsetNumberNext(FirstOffsetNumber);
+    int                   distance, max_distance = -1, nentries = 0;
+    ArrayXiGistKey       *datum_l, *datum_r, *key;
+    GistArrayXiSplitCost *costs;
+    Size                  nbytes = (maxoff + 2) * sizeof(OffsetNumber);
+
+    // FIND THE TWO KEYS THAT ARE FURTHEST APART
+    for (i = FirstOffsetNumber; i < maxoff; i = OffsetNumberNext(i))
+    {
+        for (j = OffsetNumberNext(i); j <= maxoff; j = OffsetNumberNext(j))
+        {
+            distance = gist_arrayxi_hamming(DatumGetArrayXiGistKey(entryvec->vector[i].key),
+                                            DatumGetArrayXiGistKey(entryvec->vector[j].key));
+
+            if (distance > max_distance)
+            {
+                max_distance = distance;
+                seed_1 = i;
+                seed_2 = j;
+            }
+        }
+    }
+
+    v->spl_left = (OffsetNumber *) palloc(nbytes);
+    v->spl_right = (OffsetNumber *) palloc(nbytes);
+    v->spl_nleft = 0;
+    v->spl_nright = 0;
+
+    datum_l = gist_arrayxi_key_copy(DatumGetArrayXiGistKey(entryvec->vector[seed_1].key));
+    datum_r = gist_arrayxi_key_copy(DatumGetArrayXiGistKey(entryvec->vector[seed_2].key));
+
+    v->spl_left[v->spl_nleft++] = seed_1;
+    v->spl_right[v->spl_nright++] = seed_2;
+
+    // SORT THE REMAINING KEYS BY THE DIFFERENCE OF THEIR COSTS FOR BOTH SEEDS
+    costs = (GistArrayXiSplitCost *) palloc(sizeof(GistArrayXiSplitCost) * maxoff);
+
+    for (i = FirstOffsetNumber; i <= maxoff; i = OffsetNumberNext(i))
+    {
+        if (i == seed_1 || i == seed_2) continue;
+
+        key = DatumGetArrayXiGistKey(entryvec->vector[i].key);
+
+        costs[nentries].offset = i;
+        costs[nentries].cost = abs(gist_arrayxi_cost(datum_l, key) - gist_arrayxi_cost(datum_r, key));
+        nentries++;
+    }
+
+    qsort(costs, nentries, sizeof(GistArrayXiSplitCost), gist_arrayxi_split_cost_cmp);
+
+    for (j = 0; j < nentries; j++)
+    {
+        int cost_l, cost_r;
+
+        i = costs[j].offset;
+        key = DatumGetArrayXiGistKey(entryvec->vector[i].key);
+
+        cost_l = gist_arrayxi_cost(datum_l, key);
+        cost_r = gist_arrayxi_cost(datum_r, key);
+
+        if (cost_l < cost_r || (cost_l == cost_r && v->spl_nleft <= v->spl_nright))
+        {
+            gist_arrayxi_key_union(datum_l, key);
+            v->spl_left[v->spl_nleft++] = i;
+        }
+        else
+        {
+            gist_arrayxi_key_union(datum_r, key);
+            v->spl_right[v->spl_nright++] = i;
+        }
+    }
+
+    pfree(costs);
+
+    v->spl_ldatum = PointerGetDatum(datum_l);
+    v->spl_rdatum = PointerGetDatum(datum_r);
+
+    PG_RETURN_POINTER(v);
+}
+
+// RETURNS TRUE IF BOTH KEYS ARE IDENTICAL
+PG_FUNCTION_INFO_V1(gist_arrayxi_same);
+Datum gist_arrayxi_same(PG_FUNCTION_ARGS)
+{
+    ArrayXiGistKey *k1 = (ArrayXiGistKey *) PG_GETARG_POINTER(0);
+    ArrayXiGistKey *k2 = (ArrayXiGistKey *) PG_GETARG_POINTER(1);
+    bool           *result = (bool *) PG_GETARG_POINTER(2);
+
+    *result = k1->nbits == k2->nbits && k1->minA == k2->minA && k1->maxA == k2->maxA &&
+              memcmp(k1->words, k2->words, GIST_ARRAYXI_NWORDS(k1->nbits) * sizeof(uint64)) == 0;
+
+    PG_RETURN_POINTER(result);
+}
\ No newline at end of file
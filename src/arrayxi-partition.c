@@ -0,0 +1,479 @@
+#include "arrayxi.h"
+#include "fmgr.h"
+#include "catalog/pg_type.h"
+#include "utils/builtins.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+
+#if PG_VERSION_NUM >= 120000
+#include "access/table.h"
+#include "catalog/namespace.h"
+#include "catalog/pg_class.h"
+#include "catalog/pg_collation.h"
+#include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
+#include "nodes/supportnodes.h"
+#include "optimizer/optimizer.h"
+#include "optimizer/paths.h"
+#include "parser/parse_func.h"
+#include "parser/parsetree.h"
+#include "utils/fmgroids.h"
+#include "utils/partcache.h"
+#include "utils/rel.h"
+#endif
+
+
+/* Tables of fingerprints can be partitioned by the number of non-zero elements
+ * of their arrayxi column:
+ *
+ *     CREATE TABLE fps (id INTEGER, fp arrayxi) PARTITION BY RANGE (arrayxi_nonzeros(fp));
+ *
+ * The Swamidass-Baldi bounds limit the counts of the arrays that can reach a
+ * similarity threshold with a query (t * B <= A <= B / t for Tanimoto), so a
+ * threshold search only has to scan the partitions whose range intersects
+ * these bounds. The planner support function of the threshold operators adds
+ * the bounds to the query as conditions on the partition key, which lets the
+ * executor prune the other partitions when the scan starts. The threshold
+ * condition implies the bounds, so they are removed again from the scans of
+ * the partitions and do not count the non-zero elements of every row.
+ */
+
+
+// METRICS WHOSE THRESHOLD BOUNDS THE NUMBER OF NON-ZERO ELEMENTS AND THE THRESHOLD
+// OPERATORS THAT USE THEM; SIMPSON, EUCLIDEAN AND MANHATTAN ARE MISSING BECAUSE
+// THEIR BOUNDS NEVER OR HARDLY EVER EXCLUDE ANY COUNT
+typedef struct
+{
+    const char    *name;
+    ArrayXiMetric  metric;
+    double        *limit;
+    const char    *function;    // FUNCTION OF THE THRESHOLD OPERATOR OR NULL
+    const char    *operator;
+} ArrayXiPartitionMetric;
+
+static const ArrayXiPartitionMetric arrayxi_partition_metrics[] =
+{
+    {"dice",        ARRAYXI_DICE,        &arrayxi_dice_limit,        "arrayxi_dice_is_above_limit",        "#?"},
+    {"kulczynski",  ARRAYXI_KULCZYNSKI,  &arrayxi_kulcz_limit,       "arrayxi_kulcz_is_above_limit",       "%?"},
+    {"ochiai",      ARRAYXI_OCHIAI,      &arrayxi_ochiai_limit,      "arrayxi_ochiai_is_above_limit",      "@?"},
+    {"russell-rao", ARRAYXI_RUSSELL_RAO, &arrayxi_russell_rao_limit, "arrayxi_russell_rao_is_above_limit", "^?"},
+    {"tanimoto",    ARRAYXI_TANIMOTO,    &arrayxi_tanimoto_limit,    NULL,                                 NULL},
+    {"tversky",     ARRAYXI_TVERSKY,     &arrayxi_tversky_limit,     "arrayxi_tversky_is_above_limit",     "%^?"}
+};
+
+// RANGE OF NON-ZERO COUNTS OF A STABLE QUERY, CACHED IN FN_EXTRA TOGETHER WITH
+// THE PARAMETERS IT WAS CALCULATED WITH
+typedef struct
+{
+    double limit;
+    double alpha;
+    double beta;
+    int    min;
+    int    max;
+} ArrayXiNonZerosRange;
+
+
+// RETURNS THE METRIC WITH THE GIVEN NAME
+static const ArrayXiPartitionMetric *arrayxi_partition_metric(const char *name)
+{
+    int i;
+
+    for (i = 0; i < lengthof(arrayxi_partition_metrics); i++)
+    {
+        if (strcmp(name, arrayxi_partition_metrics[i].name) == 0) return &arrayxi_partition_metrics[i];
+    }
+
+    ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                 errmsg("unknown similarity metric: \"%s\"; valid values are dice, kulczynski, ochiai, russell-rao, tanimoto and tversky.", name)));
+
+    return NULL;
+}
+
+/* Calculates the smallest and largest number of non-zero elements an array can
+ * have to reach the limit with the query. Every count is checked against the
+ * upper bound of the similarity, which is reached if the smaller array is
+ * contained in the larger one. Tversky is not symmetric, so the query may be
+ * either operand. If no count can reach the limit, min is greater than max.
+ */
+static void arrayxi_nonzeros_bounds(ArrayType *query, const ArrayXiPartitionMetric *entry, int *min, int *max)
+{
+    ArrayXiBounds  bounds;
+    unsigned int   n = ArrayXiSize(query);
+    unsigned int   B = ArrayXiNonZeros(query);
+    unsigned int   A;
+    bool           reached;
+
+    *min = n + 1;
+    *max = -1;
+
+    for (A = 0; A <= n; A++)
+    {
+        bounds.minA = bounds.maxA = A;
+        bounds.B = B;
+        bounds.c = Min(A, B);
+        bounds.n = n;
+
+        reached = SimilarityUpperBound(&bounds, entry->metric) >= *entry->limit;
+
+        if (!reached && entry->metric == ARRAYXI_TVERSKY)
+        {
+            bounds.minA = bounds.maxA = B;
+            bounds.B = A;
+
+            reached = SimilarityUpperBound(&bounds, entry->metric) >= *entry->limit;
+        }
+
+        if (reached)
+        {
+            *min = Min(*min, (int) A);
+            *max = A;
+        }
+    }
+}
+
+/* Returns the range of non-zero counts that can reach the limit with the query
+ * for the function of a threshold operator, or false if the metric of the
+ * function does not bound the counts. Used by the selectivity estimators.
+ */
+bool arrayxi_threshold_nonzeros_bounds(const char *function, ArrayType *query, int *min, int *max)
+{
+    int i;
+
+    for (i = 0; i < lengthof(arrayxi_partition_metrics); i++)
+    {
+        const ArrayXiPartitionMetric *entry = &arrayxi_partition_metrics[i];
+
+        if (entry->function != NULL && strcmp(function, entry->function) == 0)
+        {
+            arrayxi_nonzeros_bounds(query, entry, min, max);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// RETURNS THE RANGE OF NON-ZERO COUNTS FOR THE ARGUMENTS (QUERY, METRIC); THE
+// RANGE IS CALCULATED ONLY ONCE IF BOTH ARGUMENTS ARE STABLE ACROSS CALLS
+static void arrayxi_nonzeros_range(FunctionCallInfo fcinfo, int *min, int *max)
+{
+    const ArrayXiPartitionMetric *entry = arrayxi_partition_metric(PG_GETARG_TEXT_AS_CSTRING(1));
+
+    FmgrInfo             *flinfo = fcinfo->flinfo;
+    ArrayXiNonZerosRange *range = flinfo != NULL ? (ArrayXiNonZerosRange *) flinfo->fn_extra : NULL;
+    bool                  stable;
+
+    // THE LIMIT OR THE TVERSKY WEIGHTS MIGHT HAVE BEEN CHANGED SINCE THE LAST CALL
+    if (range != NULL && range->limit == *entry->limit &&
+        range->alpha == arrayxi_tversky_alpha && range->beta == arrayxi_tversky_beta)
+    {
+        *min = range->min;
+        *max = range->max;
+        return;
+    }
+
+    arrayxi_nonzeros_bounds(PG_GETARG_ARRAYTYPE_P(0), entry, min, max);
+
+    stable = flinfo != NULL && get_fn_expr_arg_stable(flinfo, 0) && get_fn_expr_arg_stable(flinfo, 1);
+
+    if (stable)
+    {
+        if (range == NULL) range = (ArrayXiNonZerosRange *) MemoryContextAlloc(flinfo->fn_mcxt, sizeof(ArrayXiNonZerosRange));
+
+        range->limit = *entry->limit;
+        range->alpha = arrayxi_tversky_alpha;
+        range->beta = arrayxi_tversky_beta;
+        range->min = *min;
+        range->max = *max;
+
+        flinfo->fn_extra = range;
+    }
+}
+
+// SMALLEST NUMBER OF NON-ZERO ELEMENTS THAT CAN REACH THE CURRENT LIMIT
+PG_FUNCTION_INFO_V1(arrayxi_min_nonzeros);
+Datum arrayxi_min_nonzeros(PG_FUNCTION_ARGS)
+{
+    int min, max;
+
+    arrayxi_nonzeros_range(fcinfo, &min, &max);
+
+    PG_RETURN_INT32(min);
+}
+
+// LARGEST NUMBER OF NON-ZERO ELEMENTS THAT CAN REACH THE CURRENT LIMIT
+PG_FUNCTION_INFO_V1(arrayxi_max_nonzeros);
+Datum arrayxi_max_nonzeros(PG_FUNCTION_ARGS)
+{
+    int min, max;
+
+    arrayxi_nonzeros_range(fcinfo, &min, &max);
+
+    PG_RETURN_INT32(max);
+}
+
+
+///////////////////////////////PARTITION PRUNING////////////////////////////////
+
+
+#if PG_VERSION_NUM >= 120000
+
+static set_rel_pathlist_hook_type prev_set_rel_pathlist_hook = NULL;
+
+// RETURNS THE METRIC OF THE FUNCTION OF A THRESHOLD OPERATOR OR NULL
+static const ArrayXiPartitionMetric *arrayxi_partition_function_metric(Oid funcid)
+{
+    char *fname = get_func_name(funcid);
+    int   i;
+
+    if (fname == NULL) return NULL;
+
+    for (i = 0; i < lengthof(arrayxi_partition_metrics); i++)
+    {
+        const char *function = arrayxi_partition_metrics[i].function;
+
+        if (function != NULL && strcmp(fname, function) == 0) return &arrayxi_partition_metrics[i];
+    }
+
+    return NULL;
+}
+
+// RETURNS THE QUALIFIED NAME OF AN OPERATOR OR FUNCTION FOR THE LOOKUP FUNCTIONS
+static List *arrayxi_partition_name(const char *nspname, const char *name)
+{
+    return list_make2(makeString(pstrdup(nspname)), makeString(pstrdup(name)));
+}
+
+// RETURNS TRUE IF THE TABLE IS PARTITIONED BY RANGE OF ARRAYXI_NONZEROS() OF THE
+// COLUMN
+static bool arrayxi_partitioned_by_nonzeros(Oid relid, AttrNumber attno, Oid nonzeros)
+{
+    Relation      rel = table_open(relid, NoLock);
+    PartitionKey  key = RelationGetPartitionKey(rel);
+    bool          result = false;
+
+    if (key != NULL && key->strategy == PARTITION_STRATEGY_RANGE && key->partattrs[0] == 0)
+    {
+        Node *expr = (Node *) linitial(key->partexprs);
+
+        if (IsA(expr, FuncExpr) && ((FuncExpr *) expr)->funcid == nonzeros)
+        {
+            Node *arg = (Node *) linitial(((FuncExpr *) expr)->args);
+
+            result = IsA(arg, Var) && ((Var *) arg)->varattno == attno;
+        }
+    }
+
+    table_close(rel, NoLock);
+
+    return result;
+}
+
+/* Rewrites "column OP query" into
+ *
+ *     arrayxi_nonzeros(column) >= arrayxi_min_nonzeros(query, metric) AND
+ *     arrayxi_nonzeros(column) <= arrayxi_max_nonzeros(query, metric) AND
+ *     column OP query
+ *
+ * if the column belongs to a table that is partitioned by its non-zero count
+ * and the query is a constant or parameter. The bounds are stable functions
+ * that depend on the current limit, so the partitions are pruned when the
+ * executor starts, even for cached plans. The original condition is kept as
+ * operator clause so that it can still use a GiST index of the partitions.
+ * The bounds are removed from the partitions by arrayxi_partition_pathlist().
+ * Called by the planner support function of the threshold operators.
+ */
+Node *arrayxi_partition_simplify(SupportRequestSimplify *req)
+{
+    FuncExpr                     *fcall = req->fcall;
+    const ArrayXiPartitionMetric *entry;
+    char                         *nspname;
+    Node                         *column = NULL;
+    Node                         *query = NULL;
+    RangeTblEntry                *rte;
+    Oid                           argtypes[2];
+    Oid                           nonzeros, minfunc, maxfunc, opno, geopno, leopno;
+    Expr                         *count, *metric, *lower, *upper, *clause;
+    int                           argno;
+
+    if (req->root == NULL || list_length(fcall->args) != 2) return NULL;
+
+    entry = arrayxi_partition_function_metric(fcall->funcid);
+
+    if (entry == NULL) return NULL;
+
+    // THE COLUMN HAS TO BE A PLAIN COLUMN OF THIS QUERY LEVEL AND THE QUERY MUST
+    // NOT CHANGE DURING THE SCAN
+    for (argno = 0; argno < 2; argno++)
+    {
+        Node *arg = (Node *) list_nth(fcall->args, argno);
+        Node *other = (Node *) list_nth(fcall->args, 1 - argno);
+
+        if (IsA(arg, Var) && ((Var *) arg)->varlevelsup == 0 &&
+            !contain_var_clause(other) && !contain_volatile_functions(other))
+        {
+            column = arg;
+            query = other;
+            break;
+        }
+    }
+
+    if (column == NULL) return NULL;
+
+    rte = rt_fetch(((Var *) column)->varno, req->root->parse->rtable);
+
+    if (rte->rtekind != RTE_RELATION || rte->relkind != RELKIND_PARTITIONED_TABLE) return NULL;
+
+    // THE FUNCTIONS ARE LOOKED UP IN THE SCHEMA OF THE EXTENSION, WHICH NEED NOT
+    // BE IN THE SEARCH PATH
+    nspname = get_namespace_name(get_func_namespace(fcall->funcid));
+
+    argtypes[0] = exprType(column);
+    argtypes[1] = TEXTOID;
+
+    nonzeros = LookupFuncName(arrayxi_partition_name(nspname, "arrayxi_nonzeros"), 1, argtypes, true);
+    minfunc = LookupFuncName(arrayxi_partition_name(nspname, "arrayxi_min_nonzeros"), 2, argtypes, true);
+    maxfunc = LookupFuncName(arrayxi_partition_name(nspname, "arrayxi_max_nonzeros"), 2, argtypes, true);
+
+    geopno = OpernameGetOprid(arrayxi_partition_name("pg_catalog", ">="), INT4OID, INT4OID);
+    leopno = OpernameGetOprid(arrayxi_partition_name("pg_catalog", "<="), INT4OID, INT4OID);
+
+    opno = OpernameGetOprid(arrayxi_partition_name(nspname, entry->operator),
+                            exprType(linitial(fcall->args)), exprType(lsecond(fcall->args)));
+
+    if (!OidIsValid(nonzeros) || !OidIsValid(minfunc) || !OidIsValid(maxfunc) || !OidIsValid(opno) ||
+        !OidIsValid(geopno) || !OidIsValid(leopno))
+    {
+        return NULL;
+    }
+
+    if (!arrayxi_partitioned_by_nonzeros(rte->relid, ((Var *) column)->varattno, nonzeros)) return NULL;
+
+    count = (Expr *) makeFuncExpr(nonzeros, INT4OID, list_make1(copyObject(column)),
+                                  InvalidOid, InvalidOid, COERCE_EXPLICIT_CALL);
+
+    metric = (Expr *) makeConst(TEXTOID, -1, DEFAULT_COLLATION_OID, -1,
+                                PointerGetDatum(cstring_to_text(entry->name)), false, false);
+
+    lower = (Expr *) makeFuncExpr(minfunc, INT4OID, list_make2(copyObject(query), copyObject(metric)),
+                                  InvalidOid, DEFAULT_COLLATION_OID, COERCE_EXPLICIT_CALL);
+    upper = (Expr *) makeFuncExpr(maxfunc, INT4OID, list_make2(copyObject(query), metric),
+                                  InvalidOid, DEFAULT_COLLATION_OID, COERCE_EXPLICIT_CALL);
+
+    lower = make_opclause(geopno, BOOLOID, false, count, lower, InvalidOid, InvalidOid);
+    upper = make_opclause(leopno, BOOLOID, false, copyObject(count), upper, InvalidOid, InvalidOid);
+
+    clause = make_opclause(opno, BOOLOID, false, linitial(fcall->args), lsecond(fcall->args),
+                           InvalidOid, InvalidOid);
+
+    set_opfuncid((OpExpr *) lower);
+    set_opfuncid((OpExpr *) upper);
+    ((OpExpr *) clause)->opfuncid = fcall->funcid;
+
+    return (Node *) make_andclause(list_make3(lower, upper, clause));
+}
+
+/* Returns true if the clause is a bound on the non-zero count of a column as
+ * added by arrayxi_partition_simplify() and one of the clauses is a threshold
+ * condition with the same metric, column and query, which implies the bound.
+ */
+static bool arrayxi_partition_is_implied_bound(Expr *clause, List *clauses)
+{
+    OpExpr      *op = (OpExpr *) clause;
+    FuncExpr    *count, *bound;
+    Node        *column, *query;
+    char        *fname, *metric;
+    Oid          opfunc;
+    ListCell    *lc;
+
+    if (!IsA(clause, OpExpr) || list_length(op->args) != 2) return false;
+
+    count = (FuncExpr *) linitial(op->args);
+    bound = (FuncExpr *) lsecond(op->args);
+
+    if (!IsA(count, FuncExpr) || list_length(count->args) != 1 ||
+        !IsA(bound, FuncExpr) || list_length(bound->args) != 2 ||
+        !IsA(lsecond(bound->args), Const) || ((Const *) lsecond(bound->args))->constisnull)
+    {
+        return false;
+    }
+
+    fname = get_func_name(count->funcid);
+
+    if (fname == NULL || strcmp(fname, "arrayxi_nonzeros") != 0) return false;
+
+    fname = get_func_name(bound->funcid);
+    opfunc = get_opcode(op->opno);
+
+    if (fname == NULL || get_func_namespace(bound->funcid) != get_func_namespace(count->funcid)) return false;
+
+    if (!(opfunc == F_INT4GE && strcmp(fname, "arrayxi_min_nonzeros") == 0) &&
+        !(opfunc == F_INT4LE && strcmp(fname, "arrayxi_max_nonzeros") == 0))
+    {
+        return false;
+    }
+
+    column = (Node *) linitial(count->args);
+    query = (Node *) linitial(bound->args);
+    metric = TextDatumGetCString(((Const *) lsecond(bound->args))->constvalue);
+
+    foreach(lc, clauses)
+    {
+        OpExpr                       *other = (OpExpr *) ((RestrictInfo *) lfirst(lc))->clause;
+        const ArrayXiPartitionMetric *entry;
+        Node                         *left, *right;
+
+        if (!IsA(other, OpExpr) || list_length(other->args) != 2) continue;
+
+        entry = arrayxi_partition_function_metric(get_opcode(other->opno));
+
+        if (entry == NULL || strcmp(entry->name, metric) != 0) continue;
+
+        left = (Node *) linitial(other->args);
+        right = (Node *) lsecond(other->args);
+
+        if ((equal(left, column) && equal(right, query)) || (equal(left, query) && equal(right, column))) return true;
+    }
+
+    return false;
+}
+
+/* Removes the bounds of arrayxi_partition_simplify() from the conditions of a
+ * scanned partition once its paths are built. Run-time pruning takes the
+ * conditions of the partitioned table, which keeps them; sub-partitioned
+ * tables keep them as well because they are pruned the same way.
+ */
+static void arrayxi_partition_pathlist(PlannerInfo *root, RelOptInfo *rel, Index rti, RangeTblEntry *rte)
+{
+    List     *clauses = NIL;
+    ListCell *lc;
+
+    if (prev_set_rel_pathlist_hook) prev_set_rel_pathlist_hook(root, rel, rti, rte);
+
+    if (rel->reloptkind != RELOPT_OTHER_MEMBER_REL || rte->rtekind != RTE_RELATION ||
+        rte->relkind == RELKIND_PARTITIONED_TABLE || list_length(rel->baserestrictinfo) < 2)
+    {
+        return;
+    }
+
+    foreach(lc, rel->baserestrictinfo)
+    {
+        RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+
+        if (!arrayxi_partition_is_implied_bound(rinfo->clause, rel->baserestrictinfo)) clauses = lappend(clauses, rinfo);
+    }
+
+    rel->baserestrictinfo = clauses;
+}
+
+#endif
+
+// INSTALLS THE PLANNER HOOK THAT REMOVES THE BOUNDS FROM THE PARTITIONS
+void arrayxi_partition_init(void)
+{
+#if PG_VERSION_NUM >= 120000
+    prev_set_rel_pathlist_hook = set_rel_pathlist_hook;
+    set_rel_pathlist_hook = arrayxi_partition_pathlist;
+#endif
+}
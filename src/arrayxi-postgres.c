@@ -1,6 +1,9 @@
 #include "arrayxi.h"
+#include "arena.h"
+#include "abbrevkey.h"
 #include "fmgr.h"
 #include <utils/builtins.h>
+#include <utils/guc.h>
 
 
 ////////////////////////////ARRAY CREATION FUNCTIONS////////////////////////////
@@ -61,6 +64,15 @@ Datum arrayxi_nonzeros(PG_FUNCTION_ARGS)
     PG_RETURN_INT32(ArrayXiNonZeros(array));
 }
 
+// RETURNS THE POSITIONS OF THE NON-ZERO ELEMENTS IN THE ARRAY
+PG_FUNCTION_INFO_V1(arrayxi_positions);
+Datum arrayxi_positions(PG_FUNCTION_ARGS)
+{
+    ArrayType  *array = PG_GETARG_ARRAYTYPE_P(0);
+
+    PG_RETURN_ARRAYTYPE_P(ArrayXiPositions(array));
+}
+
 // RETURNS SMALLEST COEFFICIENT IN ARRAY
 PG_FUNCTION_INFO_V1(arrayxi_min);
 Datum arrayxi_min(PG_FUNCTION_ARGS)
@@ -211,6 +223,98 @@ Datum arrayxi_ne(PG_FUNCTION_ARGS)
     PG_RETURN_BOOL(ArrayXiEqual(a1,a2)==false);
 }
 
+// HASH SUPPORT FUNCTION OF THE HASH OPERATOR CLASS
+PG_FUNCTION_INFO_V1(arrayxi_hash);
+Datum arrayxi_hash(PG_FUNCTION_ARGS)
+{
+    ArrayType  *array = PG_GETARG_ARRAYTYPE_P(0);
+
+    PG_RETURN_UINT32(ArrayXiHash(array));
+}
+
+// COMPARISONS OF THE B-TREE OPERATOR CLASS: NUMBER OF NON-ZERO ELEMENTS FIRST
+PG_FUNCTION_INFO_V1(arrayxi_lt);
+Datum arrayxi_lt(PG_FUNCTION_ARGS)
+{
+    ArrayType  *a1 = PG_GETARG_ARRAYTYPE_P(0);
+    ArrayType  *a2 = PG_GETARG_ARRAYTYPE_P(1);
+
+    PG_RETURN_BOOL(ArrayXiCmp(a1,a2) < 0);
+}
+
+PG_FUNCTION_INFO_V1(arrayxi_le);
+Datum arrayxi_le(PG_FUNCTION_ARGS)
+{
+    ArrayType  *a1 = PG_GETARG_ARRAYTYPE_P(0);
+    ArrayType  *a2 = PG_GETARG_ARRAYTYPE_P(1);
+
+    PG_RETURN_BOOL(ArrayXiCmp(a1,a2) <= 0);
+}
+
+PG_FUNCTION_INFO_V1(arrayxi_gt);
+Datum arrayxi_gt(PG_FUNCTION_ARGS)
+{
+    ArrayType  *a1 = PG_GETARG_ARRAYTYPE_P(0);
+    ArrayType  *a2 = PG_GETARG_ARRAYTYPE_P(1);
+
+    PG_RETURN_BOOL(ArrayXiCmp(a1,a2) > 0);
+}
+
+PG_FUNCTION_INFO_V1(arrayxi_ge);
+Datum arrayxi_ge(PG_FUNCTION_ARGS)
+{
+    ArrayType  *a1 = PG_GETARG_ARRAYTYPE_P(0);
+    ArrayType  *a2 = PG_GETARG_ARRAYTYPE_P(1);
+
+    PG_RETURN_BOOL(ArrayXiCmp(a1,a2) >= 0);
+}
+
+// COMPARISON SUPPORT FUNCTION OF THE B-TREE OPERATOR CLASS
+PG_FUNCTION_INFO_V1(arrayxi_cmp);
+Datum arrayxi_cmp(PG_FUNCTION_ARGS)
+{
+    ArrayType  *a1 = PG_GETARG_ARRAYTYPE_P(0);
+    ArrayType  *a2 = PG_GETARG_ARRAYTYPE_P(1);
+
+    PG_RETURN_INT32(ArrayXiCmp(a1,a2));
+}
+
+// THE DETOASTED COPIES ARE FREED RIGHT AWAY, A SORT COMPARES MANY TIMES
+static int arrayxi_fastcmp(Datum x, Datum y, SortSupport ssup)
+{
+    ArrayType  *a1 = DatumGetArrayTypeP(x);
+    ArrayType  *a2 = DatumGetArrayTypeP(y);
+    int         result = ArrayXiCmp(a1,a2);
+
+    if ((Pointer) a1 != DatumGetPointer(x)) pfree(a1);
+    if ((Pointer) a2 != DatumGetPointer(y)) pfree(a2);
+
+    return result;
+}
+
+// THE ABBREVIATED KEY IS THE NUMBER OF NON-ZERO ELEMENTS AND THE LEADING BITS
+static Datum arrayxi_abbrev_convert(Datum original, SortSupport ssup)
+{
+    ArrayType  *array = DatumGetArrayTypeP(original);
+    uint64      key = ArrayXiSortKey(array);
+
+    if ((Pointer) array != DatumGetPointer(original)) pfree(array);
+
+    return abbrev_key_datum(key, ssup);
+}
+
+// SORT SUPPORT FUNCTION OF THE B-TREE OPERATOR CLASS
+PG_FUNCTION_INFO_V1(arrayxi_sortsupport);
+Datum arrayxi_sortsupport(PG_FUNCTION_ARGS)
+{
+    SortSupport ssup = (SortSupport) PG_GETARG_POINTER(0);
+
+    ssup->comparator = arrayxi_fastcmp;
+    abbrev_key_setup(ssup, arrayxi_abbrev_convert);
+
+    PG_RETURN_VOID();
+}
+
 // RETURNS TRUE IF THE FIRST ARRAY CONTAINS ALL ELEMENTS OF THE SECOND
 PG_FUNCTION_INFO_V1(arrayxi_contains);
 Datum arrayxi_contains(PG_FUNCTION_ARGS)
@@ -274,12 +378,32 @@ Datum arrayxi_binary_union(PG_FUNCTION_ARGS)
 ///////////////////////NORMALIZED SIMILARITY METRICS////////////////////////////
 
 
+// CALCULATES THE BINARY SIMILARITY BETWEEN THE ARGUMENTS. AN ARGUMENT THAT IS
+// STABLE ACROSS CALLS, I.E. THE QUERY OF A SCREENING, IS CACHED IN FN_EXTRA AND
+// COUNTED AGAIN ONLY WHEN ITS VALUE CHANGES
+static double arrayxi_similarity(FunctionCallInfo fcinfo, ArrayXiMetric metric)
+{
+    bool        isnew;
+    QueryCache *query = query_cache_get(fcinfo, &isnew);
+    
+    if (query == NULL) 
+    {
+        return ArrayXiSimilarity(PG_GETARG_ARRAYTYPE_P(0), PG_GETARG_ARRAYTYPE_P(1), metric);
+    }
+    
+    if (isnew) query->count = ArrayXiNonZeros(query->array);
+    
+    return ArrayXiQuerySimilarity(query, PG_GETARG_ARRAYTYPE_P(1 - query->argno), metric);
+}
+
+
 // RETURNS THE BRAY-CURTIS DISSIMILARITY
 PG_FUNCTION_INFO_V1(arrayxi_bray_curtis);
 Datum arrayxi_bray_curtis(PG_FUNCTION_ARGS)
 {
-    ArrayType  *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType  *a2 = PG_GETARG_ARRAYTYPE_P(1);
+    ArrayType  *a1, *a2;
+
+    query_cache_getargs(fcinfo, &a1, &a2);
 
     PG_RETURN_FLOAT8(ArrayXiBrayCurtis(a1,a2));
 }
@@ -288,110 +412,77 @@ Datum arrayxi_bray_curtis(PG_FUNCTION_ARGS)
 PG_FUNCTION_INFO_V1(arrayxi_dice);
 Datum arrayxi_dice(PG_FUNCTION_ARGS)
 {
-    ArrayType  *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType  *a2 = PG_GETARG_ARRAYTYPE_P(1);
-
-    PG_RETURN_FLOAT8(ArrayXiDice(a1,a2));
+    PG_RETURN_FLOAT8(arrayxi_similarity(fcinfo, ARRAYXI_DICE));
 }
 
 // 
 PG_FUNCTION_INFO_V1(arrayxi_euclidean);
 Datum arrayxi_euclidean(PG_FUNCTION_ARGS)
 {
-    ArrayType  *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType  *a2 = PG_GETARG_ARRAYTYPE_P(1);
-
-    PG_RETURN_FLOAT8(ArrayXiNormEuclidean(a1,a2));
+    PG_RETURN_FLOAT8(arrayxi_similarity(fcinfo, ARRAYXI_EUCLIDEAN));
 }
 
 // RETURNS THE BRAY-CURTIS DISSIMILARITY
 PG_FUNCTION_INFO_V1(arrayxi_kulcz);
 Datum arrayxi_kulcz(PG_FUNCTION_ARGS)
 {
-    ArrayType  *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType  *a2 = PG_GETARG_ARRAYTYPE_P(1);
-
-    PG_RETURN_FLOAT8(ArrayXiKulczynski(a1,a2));
+    PG_RETURN_FLOAT8(arrayxi_similarity(fcinfo, ARRAYXI_KULCZYNSKI));
 }
 
 // 
 PG_FUNCTION_INFO_V1(arrayxi_manhattan);
 Datum arrayxi_manhattan(PG_FUNCTION_ARGS)
 {
-    ArrayType  *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType  *a2 = PG_GETARG_ARRAYTYPE_P(1);
-
-    PG_RETURN_FLOAT8(ArrayXiNormManhattan(a1,a2));
+    PG_RETURN_FLOAT8(arrayxi_similarity(fcinfo, ARRAYXI_MANHATTAN));
 }
 
 // RETURNS THE BRAY-CURTIS DISSIMILARITY
 PG_FUNCTION_INFO_V1(arrayxi_ochiai);
 Datum arrayxi_ochiai(PG_FUNCTION_ARGS)
 {
-    ArrayType  *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType  *a2 = PG_GETARG_ARRAYTYPE_P(1);
-
-    PG_RETURN_FLOAT8(ArrayXiOchiai(a1,a2));
+    PG_RETURN_FLOAT8(arrayxi_similarity(fcinfo, ARRAYXI_OCHIAI));
 }
 
 // 
 PG_FUNCTION_INFO_V1(arrayxi_russell_rao);
 Datum arrayxi_russell_rao(PG_FUNCTION_ARGS)
 {
-    ArrayType  *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType  *a2 = PG_GETARG_ARRAYTYPE_P(1);
-
-    PG_RETURN_FLOAT8(ArrayXiRussellRao(a1,a2));
+    PG_RETURN_FLOAT8(arrayxi_similarity(fcinfo, ARRAYXI_RUSSELL_RAO));
 }
 
 // 
 PG_FUNCTION_INFO_V1(arrayxi_simpson);
 Datum arrayxi_simpson(PG_FUNCTION_ARGS)
 {
-    ArrayType  *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType  *a2 = PG_GETARG_ARRAYTYPE_P(1);
-
-    PG_RETURN_FLOAT8(ArrayXiSimpson(a1,a2));
+    PG_RETURN_FLOAT8(arrayxi_similarity(fcinfo, ARRAYXI_SIMPSON));
 }
 
 //
 PG_FUNCTION_INFO_V1(arrayxi_simpson_global);
 Datum arrayxi_simpson_global(PG_FUNCTION_ARGS)
 {
-    ArrayType  *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType  *a2 = PG_GETARG_ARRAYTYPE_P(1);
-
-    PG_RETURN_FLOAT8(ArrayXiSimpsonGlobal(a1,a2));
+    PG_RETURN_FLOAT8(arrayxi_similarity(fcinfo, ARRAYXI_SIMPSON_GLOBAL));
 }
 
 //
 PG_FUNCTION_INFO_V1(arrayxi_tanimoto);
 Datum arrayxi_tanimoto(PG_FUNCTION_ARGS)
 {
-    ArrayType  *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType  *a2 = PG_GETARG_ARRAYTYPE_P(1);
-
-    PG_RETURN_FLOAT8(ArrayXiTanimoto(a1,a2));
+    PG_RETURN_FLOAT8(arrayxi_similarity(fcinfo, ARRAYXI_TANIMOTO));
 }
 
 //
 PG_FUNCTION_INFO_V1(arrayxi_tversky);
 Datum arrayxi_tversky(PG_FUNCTION_ARGS)
 {
-    ArrayType  *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType  *a2 = PG_GETARG_ARRAYTYPE_P(1);
-
-    PG_RETURN_FLOAT8(ArrayXiTversky(a1,a2));
+    PG_RETURN_FLOAT8(arrayxi_similarity(fcinfo, ARRAYXI_TVERSKY));
 }
 
 //
 PG_FUNCTION_INFO_V1(arrayxi_fuzcavsim_global);
 Datum arrayxi_fuzcavsim_global(PG_FUNCTION_ARGS)
 {
-    ArrayType  *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType  *a2 = PG_GETARG_ARRAYTYPE_P(1);
-
-    PG_RETURN_FLOAT8(ArrayXiFuzCavSimGlobal(a1,a2));
+    PG_RETURN_FLOAT8(arrayxi_similarity(fcinfo, ARRAYXI_FUZCAV));
 }
 
 ///////////////// QUANTITATIVE / NON-BINARY METRICS /////////////
@@ -399,8 +490,9 @@ Datum arrayxi_fuzcavsim_global(PG_FUNCTION_ARGS)
 PG_FUNCTION_INFO_V1(arrayxi_tanimoto_nb);
 Datum arrayxi_tanimoto_nb(PG_FUNCTION_ARGS)
 {
-    ArrayType  *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType  *a2 = PG_GETARG_ARRAYTYPE_P(1);
+    ArrayType  *a1, *a2;
+
+    query_cache_getargs(fcinfo, &a1, &a2);
 
     PG_RETURN_FLOAT8(ArrayXiTanimotoNB(a1,a2));
 }
@@ -409,8 +501,9 @@ Datum arrayxi_tanimoto_nb(PG_FUNCTION_ARGS)
 PG_FUNCTION_INFO_V1(arrayxi_dice_nb);
 Datum arrayxi_dice_nb(PG_FUNCTION_ARGS)
 {
-    ArrayType  *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType  *a2 = PG_GETARG_ARRAYTYPE_P(1);
+    ArrayType  *a1, *a2;
+
+    query_cache_getargs(fcinfo, &a1, &a2);
 
     PG_RETURN_FLOAT8(ArrayXiDiceNB(a1,a2));
 }
@@ -419,8 +512,9 @@ Datum arrayxi_dice_nb(PG_FUNCTION_ARGS)
 PG_FUNCTION_INFO_V1(arrayxi_cosine_nb);
 Datum arrayxi_cosine_nb(PG_FUNCTION_ARGS)
 {
-    ArrayType  *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType  *a2 = PG_GETARG_ARRAYTYPE_P(1);
+    ArrayType  *a1, *a2;
+
+    query_cache_getargs(fcinfo, &a1, &a2);
 
     PG_RETURN_FLOAT8(ArrayXiCosineNB(a1,a2));
 }
@@ -433,88 +527,65 @@ Datum arrayxi_cosine_nb(PG_FUNCTION_ARGS)
 PG_FUNCTION_INFO_V1(arrayxi_dice_dist);
 Datum arrayxi_dice_dist(PG_FUNCTION_ARGS)
 {
-    ArrayType  *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType  *a2 = PG_GETARG_ARRAYTYPE_P(1);
-
-    PG_RETURN_FLOAT8(1 - ArrayXiDice(a1,a2));
+    PG_RETURN_FLOAT8(1 - arrayxi_similarity(fcinfo, ARRAYXI_DICE));
 }
 
 // 
 PG_FUNCTION_INFO_V1(arrayxi_euclidean_dist);
 Datum arrayxi_euclidean_dist(PG_FUNCTION_ARGS)
 {
-    ArrayType  *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType  *a2 = PG_GETARG_ARRAYTYPE_P(1);
-
-    PG_RETURN_FLOAT8(1 - ArrayXiNormEuclidean(a1,a2));
+    PG_RETURN_FLOAT8(1 - arrayxi_similarity(fcinfo, ARRAYXI_EUCLIDEAN));
 }
 
 // RETURNS THE BRAY-CURTIS DISSIMILARITY
 PG_FUNCTION_INFO_V1(arrayxi_kulcz_dist);
 Datum arrayxi_kulcz_dist(PG_FUNCTION_ARGS)
 {
-    ArrayType  *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType  *a2 = PG_GETARG_ARRAYTYPE_P(1);
-
-    PG_RETURN_FLOAT8(1 - ArrayXiKulczynski(a1,a2));
+    PG_RETURN_FLOAT8(1 - arrayxi_similarity(fcinfo, ARRAYXI_KULCZYNSKI));
 }
 
 // 
 PG_FUNCTION_INFO_V1(arrayxi_manhattan_dist);
 Datum arrayxi_manhattan_dist(PG_FUNCTION_ARGS)
 {
-    ArrayType  *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType  *a2 = PG_GETARG_ARRAYTYPE_P(1);
-
-    PG_RETURN_FLOAT8(1 - ArrayXiNormManhattan(a1,a2));
+    PG_RETURN_FLOAT8(1 - arrayxi_similarity(fcinfo, ARRAYXI_MANHATTAN));
 }
 
 // RETURNS THE BRAY-CURTIS DISSIMILARITY
 PG_FUNCTION_INFO_V1(arrayxi_ochiai_dist);
 Datum arrayxi_ochiai_dist(PG_FUNCTION_ARGS)
 {
-    ArrayType  *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType  *a2 = PG_GETARG_ARRAYTYPE_P(1);
-
-    PG_RETURN_FLOAT8(1 - ArrayXiOchiai(a1,a2));
+    PG_RETURN_FLOAT8(1 - arrayxi_similarity(fcinfo, ARRAYXI_OCHIAI));
 }
 
 // RETURNS THE INTERSECTION BETWEEN BOTH ARRAYS
 PG_FUNCTION_INFO_V1(arrayxi_russell_rao_dist);
 Datum arrayxi_russell_rao_dist(PG_FUNCTION_ARGS)
 {
-    ArrayType  *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType  *a2 = PG_GETARG_ARRAYTYPE_P(1);
-
-    PG_RETURN_FLOAT8(1 - ArrayXiRussellRao(a1,a2));
+    PG_RETURN_FLOAT8(1 - arrayxi_similarity(fcinfo, ARRAYXI_RUSSELL_RAO));
 }
 
 // RETURNS THE INTERSECTION BETWEEN BOTH ARRAYS
 PG_FUNCTION_INFO_V1(arrayxi_simpson_dist);
 Datum arrayxi_simpson_dist(PG_FUNCTION_ARGS)
 {
-    ArrayType  *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType  *a2 = PG_GETARG_ARRAYTYPE_P(1);
-
-    PG_RETURN_FLOAT8(1 - ArrayXiSimpson(a1,a2));
+    PG_RETURN_FLOAT8(1 - arrayxi_similarity(fcinfo, ARRAYXI_SIMPSON));
 }
 
 // RETURNS THE INTERSECTION BETWEEN BOTH ARRAYS
 PG_FUNCTION_INFO_V1(arrayxi_tversky_dist);
 Datum arrayxi_tversky_dist(PG_FUNCTION_ARGS)
 {
-    ArrayType  *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType  *a2 = PG_GETARG_ARRAYTYPE_P(1);
-
-    PG_RETURN_FLOAT8(1 - ArrayXiTversky(a1,a2));
+    PG_RETURN_FLOAT8(1 - arrayxi_similarity(fcinfo, ARRAYXI_TVERSKY));
 }
 
 // RETURNS THE MEAN HAMMING DISTANCE BETWEEN BOTH ARRAYS
 PG_FUNCTION_INFO_V1(arrayxi_mean_hamming_dist);
 Datum arrayxi_mean_hamming_dist(PG_FUNCTION_ARGS)
 {
-    ArrayType  *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType  *a2 = PG_GETARG_ARRAYTYPE_P(1);
+    ArrayType  *a1, *a2;
+
+    query_cache_getargs(fcinfo, &a1, &a2);
 
     PG_RETURN_FLOAT8(ArrayXiMeanHammingDist(a1,a2));
 }
@@ -523,58 +594,107 @@ Datum arrayxi_mean_hamming_dist(PG_FUNCTION_ARGS)
 ///////////////////DEFAULT METRIC CUTOFF GETTERS & SETTERS//////////////////////
 
 
-// DEFAULT LIMITS (USED MOSTLY FOR GIST FUNCTIONS)
+// DEFAULT LIMITS (USED MOSTLY FOR GIST FUNCTIONS); THE VALUES ARE OWNED BY THE
+// CONFIGURATION PARAMETERS BELOW SO THAT THEY ARE PASSED ON TO PARALLEL WORKERS
+
+double arrayxi_dice_limit        = 0.5;
+double arrayxi_euclidean_limit   = 0.8;
+double arrayxi_kulcz_limit       = 0.5;
+double arrayxi_manhattan_limit   = 0.9;
+double arrayxi_ochiai_limit      = 0.7;
+double arrayxi_russell_rao_limit = 0.5;
+double arrayxi_simpson_limit     = 0.16;
+double arrayxi_tanimoto_limit    = 0.6;
+double arrayxi_tversky_limit     = 0.5;
+double arrayxi_tversky_alpha     = 1.0;
+double arrayxi_tversky_beta      = 1.0;
+
+// CONFIGURATION PARAMETER OF A LIMIT
+typedef struct
+{
+    const char *metric;         // NAME USED BY SHOW/SET_ARRAYXI_SIMILARITY_LIMIT()
+    const char *name;           // NAME OF THE CONFIGURATION PARAMETER
+    const char *description;
+    double     *value;
+} ArrayXiLimit;
+
+static const ArrayXiLimit arrayxi_limits[] =
+{
+    {"dice",          "eigen.dice_threshold",        "Sets the lower limit of the Dice similarity for the #? operator.",         &arrayxi_dice_limit},
+    {"euclidean",     "eigen.euclidean_threshold",   "Sets the lower limit of the Euclidean similarity for the ->? operator.",   &arrayxi_euclidean_limit},
+    {"kulczynski",    "eigen.kulczynski_threshold",  "Sets the lower limit of the Kulczynski similarity for the %? operator.",   &arrayxi_kulcz_limit},
+    {"manhattan",     "eigen.manhattan_threshold",   "Sets the lower limit of the Manhattan similarity for the ~>? operator.",   &arrayxi_manhattan_limit},
+    {"ochiai",        "eigen.ochiai_threshold",      "Sets the lower limit of the Ochiai similarity for the @? operator.",       &arrayxi_ochiai_limit},
+    {"russell-rao",   "eigen.russell_rao_threshold", "Sets the lower limit of the Russell-Rao similarity for the ^? operator.",  &arrayxi_russell_rao_limit},
+    {"simpson",       "eigen.simpson_threshold",     "Sets the lower limit of the Simpson similarity for the ^^? operator.",     &arrayxi_simpson_limit},
+    {"tanimoto",      "eigen.tanimoto_threshold",    "Sets the lower limit of the Tanimoto similarity.",                          &arrayxi_tanimoto_limit},
+    {"tversky",       "eigen.tversky_threshold",     "Sets the lower limit of the Tversky similarity for the %^? operator.",     &arrayxi_tversky_limit},
+    {"tversky_alpha", "eigen.tversky_alpha",         "Sets the weight alpha of the Tversky similarity.",                          &arrayxi_tversky_alpha},
+    {"tversky_beta",  "eigen.tversky_beta",          "Sets the weight beta of the Tversky similarity.",                           &arrayxi_tversky_beta}
+};
+
+void _PG_init(void);
+
+// REGISTERS THE LIMITS, THE FINGERPRINT ARENA AND THE PLANNER HOOK WHEN THE
+// LIBRARY IS LOADED
+void _PG_init(void)
+{
+    int i;
+
+    for (i = 0; i < lengthof(arrayxi_limits); i++)
+    {
+        DefineCustomRealVariable(arrayxi_limits[i].name, arrayxi_limits[i].description, NULL,
+                                 arrayxi_limits[i].value, *arrayxi_limits[i].value, 0.0, 1.0,
+                                 PGC_USERSET, 0, NULL, NULL, NULL);
+    }
+
+    arena_init();
+    arrayxi_partition_init();
+
+    EmitWarningsOnPlaceholders("eigen");
+}
+
+// RETURNS THE LIMIT OF THE SPECIFIED METRIC
+static const ArrayXiLimit *arrayxi_limit(const char *metric)
+{
+    int i;
+
+    // EARLIER VERSIONS ONLY ACCEPTED THIS SPELLING
+    if (strcmp(metric, "rusell-rao") == 0) metric = "russell-rao";
+
+    for (i = 0; i < lengthof(arrayxi_limits); i++)
+    {
+        if (strcmp(metric, arrayxi_limits[i].metric) == 0) return &arrayxi_limits[i];
+    }
 
-float4 arrayxi_dice_limit        = 0.5f;
-float4 arrayxi_euclidean_limit   = 0.8f;
-float4 arrayxi_kulcz_limit       = 0.5f;
-float4 arrayxi_manhattan_limit   = 0.9f;
-float4 arrayxi_ochiai_limit      = 0.7f;
-float4 arrayxi_russell_rao_limit = 0.5f;
-float4 arrayxi_simpson_limit     = 0.16f;
-float4 arrayxi_tanimoto_limit    = 0.6f;
-float4 arrayxi_tversky_limit     = 0.5f;
-float4 arrayxi_tversky_alpha     = 1.0f;
-float4 arrayxi_tversky_beta      = 1.0f;
+    ereport(ERROR,
+                (errcode(ERRCODE_DATA_EXCEPTION),
+                 errmsg("unknown similarity metric or parameter: \"%s\"", metric))
+            );
+
+    return NULL;
+}
 
 // RETURNS THE CURRENT LIMIT FOR THE SPECIFIED METRIC
 PG_FUNCTION_INFO_V1(show_arrayxi_similarity_limit);
 Datum show_arrayxi_similarity_limit(PG_FUNCTION_ARGS)
 {
-    char  *metric = PG_GETARG_TEXT_AS_CSTRING(0);
-    float4  limit;
-
-    if (strcmp(metric, "dice") == 0) limit = arrayxi_dice_limit;
-    else if (strcmp(metric, "euclidean") == 0) limit = arrayxi_euclidean_limit;
-    else if (strcmp(metric, "kulczynski") == 0) limit = arrayxi_kulcz_limit;
-    else if (strcmp(metric, "manhattan") == 0) limit = arrayxi_manhattan_limit;
-    else if (strcmp(metric, "ochiai") == 0) limit = arrayxi_ochiai_limit;
-    else if (strcmp(metric, "rusell-rao") == 0) limit = arrayxi_russell_rao_limit;
-    else if (strcmp(metric, "simpson") == 0) limit = arrayxi_simpson_limit;
-    else if (strcmp(metric, "tanimoto") == 0) limit = arrayxi_tanimoto_limit;
-    else if (strcmp(metric, "tversky") == 0) limit = arrayxi_tversky_limit;
-    else if (strcmp(metric, "tversky_alpha") == 0) limit = arrayxi_tversky_alpha;
-    else if (strcmp(metric, "tversky_beta") == 0) limit = arrayxi_tversky_beta;
-
-    else
-    {
-        ereport(ERROR,
-                    (errcode(ERRCODE_DATA_EXCEPTION),
-                     errmsg("unknown similarity metric or parameter: \"%s\"", metric))
-                );
-    }
+    char   *metric = PG_GETARG_TEXT_AS_CSTRING(0);
+    float4  limit = (float4) *arrayxi_limit(metric)->value;
     
     elog(INFO, "Current %s limit: %f", metric, limit);
 
     PG_RETURN_FLOAT4(limit);
 }
 
-// SETS THE LIMIT FOR THE SPECIFIED METRIC
+// SETS THE LIMIT FOR THE SPECIFIED METRIC; THIS IS THE SAME AS SETTING THE
+// CONFIGURATION PARAMETER WITH SET
 PG_FUNCTION_INFO_V1(set_arrayxi_similarity_limit);
 Datum set_arrayxi_similarity_limit(PG_FUNCTION_ARGS)
 {
     float4  limit  = PG_GETARG_FLOAT4(0);
     char   *metric = PG_GETARG_TEXT_AS_CSTRING(1);
+    char    value[32];
 
     if (limit < 0 || limit > 1.0)
     {
@@ -584,121 +704,217 @@ Datum set_arrayxi_similarity_limit(PG_FUNCTION_ARGS)
                             limit, metric)));
     }
 
-    if (strcmp(metric, "dice") == 0) arrayxi_dice_limit = limit;
-    else if (strcmp(metric, "euclidean") == 0) arrayxi_euclidean_limit = limit;
-    else if (strcmp(metric, "kulczynski") == 0) arrayxi_kulcz_limit = limit;
-    else if (strcmp(metric, "manhattan") == 0) arrayxi_manhattan_limit = limit;
-    else if (strcmp(metric, "ochiai") == 0) arrayxi_ochiai_limit = limit;
-    else if (strcmp(metric, "rusell-rao") == 0) arrayxi_russell_rao_limit = limit;
-    else if (strcmp(metric, "simpson") == 0) arrayxi_simpson_limit = limit;
-    else if (strcmp(metric, "tanimoto") == 0) arrayxi_tanimoto_limit = limit;
-    else if (strcmp(metric, "tversky") == 0) arrayxi_tversky_limit = limit;
-    else if (strcmp(metric, "tversky_alpha") == 0) arrayxi_tversky_alpha = limit;
-    else if (strcmp(metric, "tversky_beta") == 0) arrayxi_tversky_beta = limit;
-
-    else
-    {
-        ereport(ERROR,
-                    (errcode(ERRCODE_DATA_EXCEPTION),
-                     errmsg("unknown similarity metric or parameter: \"%s\"", metric))
-                );
-    }
+    snprintf(value, sizeof(value), "%g", limit);
+    SetConfigOption(arrayxi_limit(metric)->name, value, PGC_USERSET, PGC_S_SESSION);
     
     elog(INFO, "Post setting limit: %f", limit);
 
     PG_RETURN_FLOAT4(limit);
- }
+}
  
 
 ///////////ARRAY SIMILARITY METRICS COMPARING WITH THE CUTOFF VALUES////////////
 
 
+/* Returns true if the binary similarity between the arguments reaches the
+ * limit. If one of the arguments is a cached query, the counts of the part of
+ * the array compared so far bound the similarity (the intersection cannot be
+ * larger than the smaller count), so most arrays of a screening with a high
+ * limit are rejected before they have been compared completely. The bound is
+ * taken for every metric but hardly ever rejects an array for the Simpson,
+ * Euclidean and Manhattan metrics.
+ */
+static bool arrayxi_is_above_limit(FunctionCallInfo fcinfo, ArrayXiMetric metric, double limit)
+{
+    bool           isnew;
+    QueryCache    *query = query_cache_get(fcinfo, &isnew);
+    
+    if (query == NULL) 
+    {
+        return ArrayXiSimilarity(PG_GETARG_ARRAYTYPE_P(0), PG_GETARG_ARRAYTYPE_P(1), metric) >= limit;
+    }
+    
+    if (isnew) query->count = ArrayXiNonZeros(query->array);
+    
+    return ArrayXiQuerySimilarityLimit(query, PG_GETARG_ARRAYTYPE_P(1 - query->argno), metric, limit) >= limit;
+}
+
+
 // 
 PG_FUNCTION_INFO_V1(arrayxi_dice_is_above_limit);
 Datum arrayxi_dice_is_above_limit(PG_FUNCTION_ARGS)
 {
-    ArrayType *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType *a2 = PG_GETARG_ARRAYTYPE_P(1);
-    
-    PG_RETURN_BOOL(ArrayXiDice(a1,a2) >= arrayxi_dice_limit);
+    PG_RETURN_BOOL(arrayxi_is_above_limit(fcinfo, ARRAYXI_DICE, arrayxi_dice_limit));
 }
 
 // 
 PG_FUNCTION_INFO_V1(arrayxi_euclidean_is_above_limit);
 Datum arrayxi_euclidean_is_above_limit(PG_FUNCTION_ARGS)
 {
-    ArrayType *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType *a2 = PG_GETARG_ARRAYTYPE_P(1);
-    
-    PG_RETURN_BOOL(ArrayXiNormEuclidean(a1,a2) >= arrayxi_euclidean_limit);
+    PG_RETURN_BOOL(arrayxi_is_above_limit(fcinfo, ARRAYXI_EUCLIDEAN, arrayxi_euclidean_limit));
 }
 
 // 
 PG_FUNCTION_INFO_V1(arrayxi_kulcz_is_above_limit);
 Datum arrayxi_kulcz_is_above_limit(PG_FUNCTION_ARGS)
 {
-    ArrayType *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType *a2 = PG_GETARG_ARRAYTYPE_P(1);
-    
-    PG_RETURN_BOOL(ArrayXiKulczynski(a1,a2) >= arrayxi_kulcz_limit);
+    PG_RETURN_BOOL(arrayxi_is_above_limit(fcinfo, ARRAYXI_KULCZYNSKI, arrayxi_kulcz_limit));
 }
 
 // 
 PG_FUNCTION_INFO_V1(arrayxi_manhattan_is_above_limit);
 Datum arrayxi_manhattan_is_above_limit(PG_FUNCTION_ARGS)
 {
-    ArrayType *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType *a2 = PG_GETARG_ARRAYTYPE_P(1);
-    
-    PG_RETURN_BOOL(ArrayXiNormManhattan(a1,a2) >= arrayxi_manhattan_limit);
+    PG_RETURN_BOOL(arrayxi_is_above_limit(fcinfo, ARRAYXI_MANHATTAN, arrayxi_manhattan_limit));
 }
 
 // 
 PG_FUNCTION_INFO_V1(arrayxi_ochiai_is_above_limit);
 Datum arrayxi_ochiai_is_above_limit(PG_FUNCTION_ARGS)
 {
-    ArrayType *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType *a2 = PG_GETARG_ARRAYTYPE_P(1);
-    
-    PG_RETURN_BOOL(ArrayXiOchiai(a1,a2) >= arrayxi_ochiai_limit);
+    PG_RETURN_BOOL(arrayxi_is_above_limit(fcinfo, ARRAYXI_OCHIAI, arrayxi_ochiai_limit));
 }
 
 // 
 PG_FUNCTION_INFO_V1(arrayxi_russell_rao_is_above_limit);
 Datum arrayxi_russell_rao_is_above_limit(PG_FUNCTION_ARGS)
 {
-    ArrayType *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType *a2 = PG_GETARG_ARRAYTYPE_P(1);
-    
-    PG_RETURN_BOOL(ArrayXiRussellRao(a1,a2) >= arrayxi_russell_rao_limit);
+    PG_RETURN_BOOL(arrayxi_is_above_limit(fcinfo, ARRAYXI_RUSSELL_RAO, arrayxi_russell_rao_limit));
 }
 
 // 
 PG_FUNCTION_INFO_V1(arrayxi_simpson_is_above_limit);
 Datum arrayxi_simpson_is_above_limit(PG_FUNCTION_ARGS)
 {
-    ArrayType *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType *a2 = PG_GETARG_ARRAYTYPE_P(1);
-    
-    PG_RETURN_BOOL(ArrayXiSimpson(a1,a2) >= arrayxi_simpson_limit);
+    PG_RETURN_BOOL(arrayxi_is_above_limit(fcinfo, ARRAYXI_SIMPSON, arrayxi_simpson_limit));
 }
 
 //
 PG_FUNCTION_INFO_V1(arrayxi_tanimoto_is_above_limit);
 Datum arrayxi_tanimoto_is_above_limit(PG_FUNCTION_ARGS)
 {
-    ArrayType *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType *a2 = PG_GETARG_ARRAYTYPE_P(1);
-    
-    PG_RETURN_BOOL(ArrayXiTversky(a1,a2) >= arrayxi_tanimoto_limit);
+    PG_RETURN_BOOL(arrayxi_is_above_limit(fcinfo, ARRAYXI_TANIMOTO, arrayxi_tanimoto_limit));
 }
 
 // 
 PG_FUNCTION_INFO_V1(arrayxi_tversky_is_above_limit);
 Datum arrayxi_tversky_is_above_limit(PG_FUNCTION_ARGS)
 {
-    ArrayType *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType *a2 = PG_GETARG_ARRAYTYPE_P(1);
-    
-    PG_RETURN_BOOL(ArrayXiTversky(a1,a2) >= arrayxi_tversky_limit);
+    PG_RETURN_BOOL(arrayxi_is_above_limit(fcinfo, ARRAYXI_TVERSKY, arrayxi_tversky_limit));
+}
+
+/////////////////////////BATCH SIMILARITY METRICS///////////////////////////////
+
+
+// THE TARGETS ARE THE ROWS OF A TWO-DIMENSIONAL INTEGER ARRAY; THE RESULT HAS 
+// ONE SIMILARITY PER ROW
+
+// RETURNS THE DICE SIMILARITY BETWEEN THE QUERY AND EVERY TARGET
+PG_FUNCTION_INFO_V1(arrayxi_dice_many);
+Datum arrayxi_dice_many(PG_FUNCTION_ARGS)
+{
+    ArrayType *query = PG_GETARG_ARRAYTYPE_P(0);
+    ArrayType *targets = PG_GETARG_ARRAYTYPE_P(1);
+
+    PG_RETURN_ARRAYTYPE_P(ArrayXiSimilarityMany(query, targets, ARRAYXI_DICE));
+}
+
+// RETURNS THE EUCLIDEAN SIMILARITY BETWEEN THE QUERY AND EVERY TARGET
+PG_FUNCTION_INFO_V1(arrayxi_euclidean_many);
+Datum arrayxi_euclidean_many(PG_FUNCTION_ARGS)
+{
+    ArrayType *query = PG_GETARG_ARRAYTYPE_P(0);
+    ArrayType *targets = PG_GETARG_ARRAYTYPE_P(1);
+
+    PG_RETURN_ARRAYTYPE_P(ArrayXiSimilarityMany(query, targets, ARRAYXI_EUCLIDEAN));
+}
+
+// RETURNS THE KULCZYNSKI SIMILARITY BETWEEN THE QUERY AND EVERY TARGET
+PG_FUNCTION_INFO_V1(arrayxi_kulcz_many);
+Datum arrayxi_kulcz_many(PG_FUNCTION_ARGS)
+{
+    ArrayType *query = PG_GETARG_ARRAYTYPE_P(0);
+    ArrayType *targets = PG_GETARG_ARRAYTYPE_P(1);
+
+    PG_RETURN_ARRAYTYPE_P(ArrayXiSimilarityMany(query, targets, ARRAYXI_KULCZYNSKI));
+}
+
+// RETURNS THE MANHATTAN SIMILARITY BETWEEN THE QUERY AND EVERY TARGET
+PG_FUNCTION_INFO_V1(arrayxi_manhattan_many);
+Datum arrayxi_manhattan_many(PG_FUNCTION_ARGS)
+{
+    ArrayType *query = PG_GETARG_ARRAYTYPE_P(0);
+    ArrayType *targets = PG_GETARG_ARRAYTYPE_P(1);
+
+    PG_RETURN_ARRAYTYPE_P(ArrayXiSimilarityMany(query, targets, ARRAYXI_MANHATTAN));
+}
+
+// RETURNS THE OCHIAI/COSINE SIMILARITY BETWEEN THE QUERY AND EVERY TARGET
+PG_FUNCTION_INFO_V1(arrayxi_ochiai_many);
+Datum arrayxi_ochiai_many(PG_FUNCTION_ARGS)
+{
+    ArrayType *query = PG_GETARG_ARRAYTYPE_P(0);
+    ArrayType *targets = PG_GETARG_ARRAYTYPE_P(1);
+
+    PG_RETURN_ARRAYTYPE_P(ArrayXiSimilarityMany(query, targets, ARRAYXI_OCHIAI));
+}
+
+// RETURNS THE RUSSELL-RAO SIMILARITY BETWEEN THE QUERY AND EVERY TARGET
+PG_FUNCTION_INFO_V1(arrayxi_russell_rao_many);
+Datum arrayxi_russell_rao_many(PG_FUNCTION_ARGS)
+{
+    ArrayType *query = PG_GETARG_ARRAYTYPE_P(0);
+    ArrayType *targets = PG_GETARG_ARRAYTYPE_P(1);
+
+    PG_RETURN_ARRAYTYPE_P(ArrayXiSimilarityMany(query, targets, ARRAYXI_RUSSELL_RAO));
+}
+
+// RETURNS THE SIMPSON SIMILARITY BETWEEN THE QUERY AND EVERY TARGET
+PG_FUNCTION_INFO_V1(arrayxi_simpson_many);
+Datum arrayxi_simpson_many(PG_FUNCTION_ARGS)
+{
+    ArrayType *query = PG_GETARG_ARRAYTYPE_P(0);
+    ArrayType *targets = PG_GETARG_ARRAYTYPE_P(1);
+
+    PG_RETURN_ARRAYTYPE_P(ArrayXiSimilarityMany(query, targets, ARRAYXI_SIMPSON));
+}
+
+// RETURNS THE GLOBAL SIMPSON SIMILARITY BETWEEN THE QUERY AND EVERY TARGET
+PG_FUNCTION_INFO_V1(arrayxi_simpson_global_many);
+Datum arrayxi_simpson_global_many(PG_FUNCTION_ARGS)
+{
+    ArrayType *query = PG_GETARG_ARRAYTYPE_P(0);
+    ArrayType *targets = PG_GETARG_ARRAYTYPE_P(1);
+
+    PG_RETURN_ARRAYTYPE_P(ArrayXiSimilarityMany(query, targets, ARRAYXI_SIMPSON_GLOBAL));
+}
+
+// RETURNS THE TANIMOTO SIMILARITY BETWEEN THE QUERY AND EVERY TARGET
+PG_FUNCTION_INFO_V1(arrayxi_tanimoto_many);
+Datum arrayxi_tanimoto_many(PG_FUNCTION_ARGS)
+{
+    ArrayType *query = PG_GETARG_ARRAYTYPE_P(0);
+    ArrayType *targets = PG_GETARG_ARRAYTYPE_P(1);
+
+    PG_RETURN_ARRAYTYPE_P(ArrayXiSimilarityMany(query, targets, ARRAYXI_TANIMOTO));
+}
+
+// RETURNS THE TVERSKY SIMILARITY BETWEEN THE QUERY AND EVERY TARGET
+PG_FUNCTION_INFO_V1(arrayxi_tversky_many);
+Datum arrayxi_tversky_many(PG_FUNCTION_ARGS)
+{
+    ArrayType *query = PG_GETARG_ARRAYTYPE_P(0);
+    ArrayType *targets = PG_GETARG_ARRAYTYPE_P(1);
+
+    PG_RETURN_ARRAYTYPE_P(ArrayXiSimilarityMany(query, targets, ARRAYXI_TVERSKY));
+}
+
+// RETURNS THE FUZCAV GLOBAL SIMILARITY BETWEEN THE QUERY AND EVERY TARGET
+PG_FUNCTION_INFO_V1(arrayxi_fuzcavsim_global_many);
+Datum arrayxi_fuzcavsim_global_many(PG_FUNCTION_ARGS)
+{
+    ArrayType *query = PG_GETARG_ARRAYTYPE_P(0);
+    ArrayType *targets = PG_GETARG_ARRAYTYPE_P(1);
+
+    PG_RETURN_ARRAYTYPE_P(ArrayXiSimilarityMany(query, targets, ARRAYXI_FUZCAV));
 }
\ No newline at end of file
@@ -0,0 +1,720 @@
+#include "arrayxi.h"
+#include "fmgr.h"
+#include "access/htup_details.h"
+#include "catalog/pg_collation.h"
+#include "catalog/pg_statistic.h"
+#include "catalog/pg_type.h"
+#include "nodes/makefuncs.h"
+#include "optimizer/cost.h"
+#include "parser/parse_func.h"
+#include "parser/parsetree.h"
+#include "utils/lsyscache.h"
+#include "utils/selfuncs.h"
+
+#if PG_VERSION_NUM >= 120000
+#include "nodes/supportnodes.h"
+#endif
+
+
+/* Selectivity and cost estimation of the threshold operators (#?, %?, ^?, ...).
+ * Whether an array reaches the limit with a query cannot be derived from any
+ * order of the arrays, so the estimators evaluate the operator itself against
+ * the arrays that ANALYZE stored for the column: the most common values with
+ * their frequencies and the bounds of the histogram, each of which stands for
+ * an equal share of the remaining rows. The operator reads the limit when it
+ * is called, so the estimates follow the current limit.
+ *
+ * ANALYZE skips arrays wider than 1kB for these statistics, so columns of
+ * longer fingerprints have none. arrayxi is a domain, which cannot have a
+ * typanalyze function of its own, so the statistics of the column are the
+ * ones of integer[]. The popcount histogram and the bit frequencies of such
+ * columns come from the statistics of expressions instead, which exist if the
+ * table has an index on them or, from PostgreSQL 14 on, after CREATE STATISTICS
+ * ... ON (expression); arrayxi_create_statistics() creates both:
+ *
+ *     arrayxi_positions(column): the positions of the set bits, whose integer[]
+ *         statistics are the histogram of the non-zero counts and the fraction
+ *         of the arrays that have each of the most common bits set. A constant
+ *         query without a sample is estimated from them.
+ *     arrayxi_nonzeros(column): the non-zero counts, whose histogram caps the
+ *         estimate for a constant query by the fraction of the rows whose count
+ *         can reach the limit at all.
+ */
+
+
+// SELECTIVITIES WITHOUT STATISTICS; THE SAME AS CONTSEL AND CONTJOINSEL, WHICH
+// THE OPERATORS USED BEFORE
+#define ARRAYXI_DEFAULT_THRESHOLD_SEL 0.001
+
+// LARGEST NUMBER OF ARRAYS OF A COLUMN THAT ARE COMPARED BY THE JOIN ESTIMATOR,
+// WHICH COMPARES EVERY ARRAY OF ONE SIDE WITH EVERY ARRAY OF THE OTHER
+#define ARRAYXI_MAX_JOIN_SAMPLE 100
+
+// NUMBER OF ELEMENTS THAT COST AS MUCH AS ONE OPERATOR CALL
+#define ARRAYXI_ELEMENTS_PER_COST_UNIT 64
+
+// THRESHOLD FUNCTIONS WHOSE SIMILARITY ONLY DEPENDS ON THE NON-ZERO COUNTS OF
+// BOTH ARRAYS AND THE NUMBER OF COMMON ONES; EUCLIDEAN AND MANHATTAN ALSO COUNT
+// THE COMMON ZEROS
+typedef struct
+{
+    const char    *function;
+    ArrayXiMetric  metric;
+    double        *limit;
+} ArrayXiThresholdFunction;
+
+static const ArrayXiThresholdFunction arrayxi_threshold_functions[] =
+{
+    {"arrayxi_dice_is_above_limit",        ARRAYXI_DICE,        &arrayxi_dice_limit},
+    {"arrayxi_kulcz_is_above_limit",       ARRAYXI_KULCZYNSKI,  &arrayxi_kulcz_limit},
+    {"arrayxi_ochiai_is_above_limit",      ARRAYXI_OCHIAI,      &arrayxi_ochiai_limit},
+    {"arrayxi_russell_rao_is_above_limit", ARRAYXI_RUSSELL_RAO, &arrayxi_russell_rao_limit},
+    {"arrayxi_simpson_is_above_limit",     ARRAYXI_SIMPSON,     &arrayxi_simpson_limit},
+    {"arrayxi_tversky_is_above_limit",     ARRAYXI_TVERSKY,     &arrayxi_tversky_limit}
+};
+
+#if PG_VERSION_NUM >= 110000
+typedef AttStatsSlot ArrayXiStatsSlot;
+#else
+typedef struct
+{
+    Datum  *values;
+    int     nvalues;
+    float4 *numbers;
+    int     nnumbers;
+} ArrayXiStatsSlot;
+#endif
+
+// ARRAYS OF THE STATISTICS OF A COLUMN
+typedef struct
+{
+    ArrayType  **arrays;
+    double      *weights;   // FRACTION OF THE ROWS THAT EVERY ARRAY STANDS FOR
+    int          count;
+    int          ncommon;   // THE FIRST ARRAYS ARE MOST COMMON VALUES OF THE ROWS
+} ArrayXiStatsSample;
+
+
+#if PG_VERSION_NUM < 110000
+// TYPE OF THE VALUES OF A STATISTICS SLOT; THE MOST COMMON ELEMENTS OF AN ARRAY
+// EXPRESSION ARE OF ITS ELEMENT TYPE. LATER VERSIONS TAKE IT FROM THE SLOT
+static Oid arrayxi_stats_slot_type(VariableStatData *vardata, int kind)
+{
+    return kind == STATISTIC_KIND_MCELEM ? get_element_type(vardata->atttype) : vardata->atttype;
+}
+#endif
+
+// FETCHES A STATISTICS SLOT OF THE COLUMN; THE API CHANGED IN POSTGRESQL 11
+static bool arrayxi_stats_slot(VariableStatData *vardata, int kind, bool values, bool numbers, ArrayXiStatsSlot *slot)
+{
+#if PG_VERSION_NUM >= 110000
+    return get_attstatsslot(slot, vardata->statsTuple, kind, InvalidOid,
+                            (values ? ATTSTATSSLOT_VALUES : 0) | (numbers ? ATTSTATSSLOT_NUMBERS : 0));
+#else
+    memset(slot, 0, sizeof(ArrayXiStatsSlot));
+
+    return get_attstatsslot(vardata->statsTuple, arrayxi_stats_slot_type(vardata, kind), vardata->atttypmod, kind,
+                            InvalidOid, NULL,
+                            values ? &slot->values : NULL, values ? &slot->nvalues : NULL,
+                            numbers ? &slot->numbers : NULL, numbers ? &slot->nnumbers : NULL);
+#endif
+}
+
+static void arrayxi_stats_slot_free(VariableStatData *vardata, int kind, ArrayXiStatsSlot *slot)
+{
+#if PG_VERSION_NUM >= 110000
+    free_attstatsslot(slot);
+#else
+    free_attstatsslot(arrayxi_stats_slot_type(vardata, kind), slot->values, slot->nvalues, slot->numbers, slot->nnumbers);
+#endif
+}
+
+/* Collects the most common arrays and the histogram bounds of the column with
+ * the fraction of the rows each of them represents. The arrays are detoasted
+ * copies, so the slots can be released right away. Returns false if the column
+ * has no statistics.
+ */
+static bool arrayxi_stats_sample(VariableStatData *vardata, ArrayXiStatsSample *sample)
+{
+    ArrayXiStatsSlot mcv, hist;
+    bool             hasmcv, hashist;
+    double           nullfrac, mcvfrac = 0.0;
+    int              i;
+
+    sample->count = 0;
+    sample->ncommon = 0;
+
+    if (!HeapTupleIsValid(vardata->statsTuple)) return false;
+
+    nullfrac = ((Form_pg_statistic) GETSTRUCT(vardata->statsTuple))->stanullfrac;
+
+    hasmcv = arrayxi_stats_slot(vardata, STATISTIC_KIND_MCV, true, true, &mcv);
+    hashist = arrayxi_stats_slot(vardata, STATISTIC_KIND_HISTOGRAM, true, false, &hist);
+
+    sample->arrays = (ArrayType **) palloc(sizeof(ArrayType *) * ((hasmcv ? mcv.nvalues : 0) + (hashist ? hist.nvalues : 0) + 1));
+    sample->weights = (double *) palloc(sizeof(double) * ((hasmcv ? mcv.nvalues : 0) + (hashist ? hist.nvalues : 0) + 1));
+
+    if (hasmcv)
+    {
+        for (i = 0; i < mcv.nvalues; i++)
+        {
+            sample->arrays[sample->count] = DatumGetArrayTypePCopy(mcv.values[i]);
+            sample->weights[sample->count++] = mcv.numbers[i];
+            mcvfrac += mcv.numbers[i];
+        }
+
+        sample->ncommon = sample->count;
+
+        arrayxi_stats_slot_free(vardata, STATISTIC_KIND_MCV, &mcv);
+    }
+
+    if (hashist)
+    {
+        for (i = 0; i < hist.nvalues; i++)
+        {
+            sample->arrays[sample->count] = DatumGetArrayTypePCopy(hist.values[i]);
+            sample->weights[sample->count++] = Max(1.0 - nullfrac - mcvfrac, 0.0) / hist.nvalues;
+        }
+
+        arrayxi_stats_slot_free(vardata, STATISTIC_KIND_HISTOGRAM, &hist);
+    }
+
+    return sample->count > 0;
+}
+
+// REDUCES THE SAMPLE TO EVERY K-TH ARRAY; THE WEIGHTS ARE SCALED SO THAT THE
+// SAMPLE STILL STANDS FOR THE SAME FRACTION OF THE ROWS
+static void arrayxi_stats_sample_limit(ArrayXiStatsSample *sample, int limit)
+{
+    double total = 0.0, kept = 0.0;
+    int    i, ncommon = 0;
+
+    if (sample->count <= limit) return;
+
+    for (i = 0; i < sample->count; i++) total += sample->weights[i];
+
+    for (i = 0; i < limit; i++)
+    {
+        int j = (int) ((int64) i * sample->count / limit);
+
+        if (j < sample->ncommon) ncommon++;
+
+        sample->arrays[i] = sample->arrays[j];
+        sample->weights[i] = sample->weights[j];
+        kept += sample->weights[i];
+    }
+
+    sample->count = limit;
+    sample->ncommon = ncommon;
+
+    for (i = 0; i < sample->count && kept > 0.0; i++) sample->weights[i] *= total / kept;
+}
+
+// RETURNS TRUE IF THE OPERATOR HOLDS FOR THE ARRAYS; ARRAYS OF DIFFERENT SIZES
+// WOULD RAISE AN ERROR AND NEVER MATCH
+static bool arrayxi_stats_match(FmgrInfo *opproc, ArrayType *a1, ArrayType *a2)
+{
+    if (ArrayXiSize(a1) != ArrayXiSize(a2)) return false;
+
+    return DatumGetBool(FunctionCall2Coll(opproc, InvalidOid, PointerGetDatum(a1), PointerGetDatum(a2)));
+}
+
+/* Returns the fraction of all pairs of rows of both samples for which the
+ * operator holds, with the arrays of the first sample as its first argument.
+ * If both samples are the same, an array is not paired with itself unless it is
+ * a most common value: it always matches, but it stands for distinct arrays of
+ * the column, so only the other pairs are counted and scaled up to all pairs.
+ * If none of the pairs matches, the selectivity is only known to be less than
+ * the weight of any pair; half of the smallest one is returned, which shrinks
+ * with larger statistics targets.
+ */
+static double arrayxi_stats_selectivity(Oid operator, ArrayXiStatsSample *left, ArrayXiStatsSample *right, bool same)
+{
+    FmgrInfo opproc;
+    double   selec = 0.0, smallest = 1.0, total = 0.0, counted = 0.0;
+    int      i, j;
+
+    fmgr_info(get_opcode(operator), &opproc);
+
+    for (i = 0; i < left->count; i++)
+    {
+        for (j = 0; j < right->count; j++)
+        {
+            double weight = left->weights[i] * right->weights[j];
+
+            total += weight;
+
+            if (same && i == j && i >= left->ncommon) continue;
+
+            counted += weight;
+
+            if (weight > 0.0) smallest = Min(smallest, weight);
+
+            if (arrayxi_stats_match(&opproc, left->arrays[i], right->arrays[j])) selec += weight;
+        }
+    }
+
+    // A SAMPLE OF A SINGLE ARRAY HAS NO OTHER PAIRS
+    if (counted == 0.0) return ARRAYXI_DEFAULT_THRESHOLD_SEL * total;
+
+    if (selec == 0.0) selec = smallest / 2.0;
+
+    return selec * total / counted;
+}
+
+// FRACTION OF THE HISTOGRAM OF NON-ZERO COUNTS THAT IS AT MOST THE COUNT
+static double arrayxi_count_fraction(Datum *bounds, int nbounds, int count)
+{
+    int i;
+
+    if (count < DatumGetInt32(bounds[0])) return 0.0;
+    if (count >= DatumGetInt32(bounds[nbounds - 1])) return 1.0;
+
+    for (i = 1; i < nbounds; i++)
+    {
+        double low = DatumGetInt32(bounds[i - 1]);
+        double high = DatumGetInt32(bounds[i]);
+
+        if (count < high) return (i - 1 + (count + 1 - low) / (high - low)) / (nbounds - 1);
+    }
+
+    return 1.0;
+}
+
+/* Examines the statistics of function(column) for a function of the extension
+ * that takes the column as its only argument. They exist if the table has an
+ * index on the expression or, from PostgreSQL 14 on, after CREATE STATISTICS
+ * on it. The function is looked up in the schema of the operator, which need
+ * not be in the search path. Returns false if there is no such function.
+ */
+static bool arrayxi_stats_expression(PlannerInfo *root, VariableStatData *vardata, int varRelid, Oid opfunc,
+                                     const char *name, Oid rettype, VariableStatData *exprdata)
+{
+    Oid   argtype = vardata->vartype;
+    Oid   function;
+    Node *expr;
+
+    function = LookupFuncName(list_make2(makeString(get_namespace_name(get_func_namespace(opfunc))),
+                                         makeString(pstrdup(name))),
+                              1, &argtype, true);
+
+    if (!OidIsValid(function)) return false;
+
+    // THE SAME EXPRESSION AS IN CREATE INDEX OR CREATE STATISTICS
+    expr = (Node *) makeFuncExpr(function, rettype, list_make1(copyObject(vardata->var)),
+                                 InvalidOid, InvalidOid, COERCE_EXPLICIT_CALL);
+
+    examine_variable(root, expr, varRelid, exprdata);
+
+    return true;
+}
+
+/* Returns the fraction of all rows whose non-zero count is in the range the
+ * operator can reach its limit in with the query, or 1 if the metric does not
+ * bound the counts or arrayxi_nonzeros(column) has no statistics.
+ */
+static double arrayxi_stats_nonzeros_selectivity(PlannerInfo *root, VariableStatData *vardata, int varRelid,
+                                                 Oid operator, ArrayType *query)
+{
+    VariableStatData    countdata;
+    ArrayXiStatsSlot    mcv, hist;
+    Oid                 opfunc = get_opcode(operator);
+    double              selec = 1.0, rest;
+    int                 min, max, i;
+
+    if (!arrayxi_threshold_nonzeros_bounds(get_func_name(opfunc), query, &min, &max)) return selec;
+
+    if (min > max) return 0.0;
+
+    if (!arrayxi_stats_expression(root, vardata, varRelid, opfunc, "arrayxi_nonzeros", INT4OID, &countdata))
+    {
+        return selec;
+    }
+
+    if (HeapTupleIsValid(countdata.statsTuple))
+    {
+        // ROWS THAT ARE NEITHER NULL NOR ONE OF THE MOST COMMON COUNTS
+        rest = 1.0 - ((Form_pg_statistic) GETSTRUCT(countdata.statsTuple))->stanullfrac;
+        selec = 0.0;
+
+        if (arrayxi_stats_slot(&countdata, STATISTIC_KIND_MCV, true, true, &mcv))
+        {
+            for (i = 0; i < mcv.nvalues; i++)
+            {
+                int c = DatumGetInt32(mcv.values[i]);
+
+                if (c >= min && c <= max) selec += mcv.numbers[i];
+
+                rest -= mcv.numbers[i];
+            }
+
+            arrayxi_stats_slot_free(&countdata, STATISTIC_KIND_MCV, &mcv);
+        }
+
+        rest = Max(rest, 0.0);
+
+        // WITHOUT A HISTOGRAM THE OTHER ROWS MIGHT ALL BE IN THE RANGE
+        if (arrayxi_stats_slot(&countdata, STATISTIC_KIND_HISTOGRAM, true, false, &hist))
+        {
+            if (hist.nvalues > 1)
+            {
+                rest *= arrayxi_count_fraction(hist.values, hist.nvalues, max) -
+                        arrayxi_count_fraction(hist.values, hist.nvalues, min - 1);
+            }
+
+            arrayxi_stats_slot_free(&countdata, STATISTIC_KIND_HISTOGRAM, &hist);
+        }
+
+        selec += rest;
+    }
+
+    ReleaseVariableStats(countdata);
+
+    return selec;
+}
+
+/* Estimates the fraction of all rows that reach the limit with a constant
+ * query from the statistics of arrayxi_positions(column). As an integer[]
+ * expression it gets the statistics of arrays: the histogram of the number of
+ * distinct elements, i.e. the non-zero counts of the arrays, and the fraction
+ * of the arrays that contain each of the most common elements, i.e. the
+ * frequency of every set bit. The bits are assumed to be independent, so an
+ * array with A non-zero elements shares A times the summed frequencies of the
+ * bits of the query divided by the average count with it. The operator is then
+ * evaluated for the count of every bin of the histogram. Returns -1 if the
+ * metric depends on more than the counts or there are no such statistics.
+ */
+static double arrayxi_stats_positions_selectivity(PlannerInfo *root, VariableStatData *vardata, int varRelid,
+                                                  Oid operator, ArrayType *query, bool varonleft)
+{
+    VariableStatData                 posdata;
+    ArrayXiStatsSlot                 mcelem, dechist;
+    const ArrayXiThresholdFunction  *entry = NULL;
+    Oid                              opfunc = get_opcode(operator);
+    char                            *fname = get_func_name(opfunc);
+    double                           selec = -1.0;
+    int                              i;
+
+    for (i = 0; i < lengthof(arrayxi_threshold_functions); i++)
+    {
+        if (fname != NULL && strcmp(fname, arrayxi_threshold_functions[i].function) == 0)
+        {
+            entry = &arrayxi_threshold_functions[i];
+        }
+    }
+
+    if (entry == NULL) return selec;
+
+    if (!arrayxi_stats_expression(root, vardata, varRelid, opfunc, "arrayxi_positions", INT4ARRAYOID, &posdata))
+    {
+        return selec;
+    }
+
+    if (HeapTupleIsValid(posdata.statsTuple) &&
+        arrayxi_stats_slot(&posdata, STATISTIC_KIND_DECHIST, false, true, &dechist))
+    {
+        // THE BOUNDS OF THE HISTOGRAM ARE FOLLOWED BY THE AVERAGE COUNT
+        int     nbounds = dechist.nnumbers - 1;
+        double  average = dechist.numbers[dechist.nnumbers - 1];
+        int     n = ArrayXiSize(query);
+        int    *elements = (int *) ARR_DATA_PTR(query);
+        double *frequencies = (double *) palloc(sizeof(double) * Max(n, 1));
+        double  other = n > 0 ? average / n : 0.0;
+        double  shared = 0.0;
+        int     B = 0, reached = 0;
+
+        if (arrayxi_stats_slot(&posdata, STATISTIC_KIND_MCELEM, true, true, &mcelem))
+        {
+            double common = 0.0;
+            int    ncommon = 0;
+
+            for (i = 0; i < mcelem.nvalues; i++)
+            {
+                int position = DatumGetInt32(mcelem.values[i]);
+
+                if (position < 1 || position > n) continue;
+
+                common += mcelem.numbers[i];
+                ncommon++;
+            }
+
+            // THE OTHER BITS SHARE THE REST OF THE AVERAGE COUNT, BUT NONE OF THEM
+            // IS MORE FREQUENT THAN THE LEAST COMMON ELEMENT
+            other = Max(average - common, 0.0) / Max(n - ncommon, 1);
+
+            if (mcelem.nnumbers == mcelem.nvalues + 3) other = Min(other, mcelem.numbers[mcelem.nvalues]);
+
+            for (i = 0; i < n; i++) frequencies[i] = other;
+
+            for (i = 0; i < mcelem.nvalues; i++)
+            {
+                int position = DatumGetInt32(mcelem.values[i]);
+
+                if (position >= 1 && position <= n) frequencies[position - 1] = mcelem.numbers[i];
+            }
+
+            arrayxi_stats_slot_free(&posdata, STATISTIC_KIND_MCELEM, &mcelem);
+        }
+        else
+        {
+            for (i = 0; i < n; i++) frequencies[i] = other;
+        }
+
+        for (i = 0; i < n; i++)
+        {
+            if (elements[i] == 0) continue;
+
+            shared += frequencies[i];
+            B++;
+        }
+
+        for (i = 0; i + 1 < nbounds; i++)
+        {
+            ArrayXiBounds bounds;
+            unsigned int  A = (unsigned int) ((dechist.numbers[i] + dechist.numbers[i + 1]) / 2.0 + 0.5);
+            unsigned int  c = average > 0.0 ? (unsigned int) (A * shared / average + 0.5) : 0;
+
+            A = Min(A, (unsigned int) n);
+
+            // THE ARGUMENTS KEEP THEIR ORDER SINCE TVERSKY IS NOT SYMMETRIC
+            bounds.minA = bounds.maxA = varonleft ? A : B;
+            bounds.B = varonleft ? B : A;
+            bounds.c = Min(c, Min(A, (unsigned int) B));
+            bounds.n = n;
+
+            if (SimilarityUpperBound(&bounds, entry->metric) >= *entry->limit) reached++;
+        }
+
+        // AS FOR THE SAMPLE, NO MATCHING BIN ONLY BOUNDS THE SELECTIVITY
+        if (nbounds > 1)
+        {
+            selec = (reached > 0 ? reached : 0.5) / (nbounds - 1);
+            selec *= 1.0 - ((Form_pg_statistic) GETSTRUCT(posdata.statsTuple))->stanullfrac;
+        }
+
+        pfree(frequencies);
+
+        arrayxi_stats_slot_free(&posdata, STATISTIC_KIND_DECHIST, &dechist);
+    }
+
+    ReleaseVariableStats(posdata);
+
+    return selec;
+}
+
+// TOTAL FRACTION OF THE ROWS THE ARRAYS OF THE SAMPLE STAND FOR
+static double arrayxi_stats_weight(ArrayXiStatsSample *sample)
+{
+    double total = 0.0;
+    int    i;
+
+    for (i = 0; i < sample->count; i++) total += sample->weights[i];
+
+    return total;
+}
+
+
+////////////////////////////SELECTIVITY ESTIMATORS//////////////////////////////
+
+
+/* Restriction selectivity of the threshold operators. A constant query is
+ * compared with the arrays of the statistics, or with the bit frequencies and
+ * non-zero counts of arrayxi_positions(column) if the column has no sample; a
+ * parameter or any other query that is only known at execution time is assumed
+ * to look like the arrays of the column, so the statistics are compared with
+ * themselves.
+ */
+PG_FUNCTION_INFO_V1(arrayxi_threshold_sel);
+Datum arrayxi_threshold_sel(PG_FUNCTION_ARGS)
+{
+    PlannerInfo        *root = (PlannerInfo *) PG_GETARG_POINTER(0);
+    Oid                 operator = PG_GETARG_OID(1);
+    List               *args = (List *) PG_GETARG_POINTER(2);
+    int                 varRelid = PG_GETARG_INT32(3);
+    VariableStatData    vardata;
+    Node               *other;
+    bool                varonleft;
+    ArrayXiStatsSample  sample, query;
+    ArrayType          *array;
+    double              weight = 1.0;
+    double              selec = ARRAYXI_DEFAULT_THRESHOLD_SEL;
+
+    if (!get_restriction_variable(root, args, varRelid, &vardata, &other, &varonleft))
+    {
+        PG_RETURN_FLOAT8(selec);
+    }
+
+    // THE OPERATORS ARE STRICT
+    if (IsA(other, Const) && ((Const *) other)->constisnull)
+    {
+        ReleaseVariableStats(vardata);
+        PG_RETURN_FLOAT8(0.0);
+    }
+
+    if (IsA(other, Const)) array = DatumGetArrayTypeP(((Const *) other)->constvalue);
+
+    if (arrayxi_stats_sample(&vardata, &sample))
+    {
+        if (IsA(other, Const))
+        {
+            query.arrays = &array;
+            query.weights = &weight;
+            query.count = 1;
+            query.ncommon = 0;
+        }
+        else
+        {
+            arrayxi_stats_sample_limit(&sample, ARRAYXI_MAX_JOIN_SAMPLE);
+            query = sample;
+        }
+
+        // THE ARGUMENTS KEEP THEIR ORDER SINCE TVERSKY IS NOT SYMMETRIC
+        selec = varonleft ? arrayxi_stats_selectivity(operator, &sample, &query, !IsA(other, Const))
+                          : arrayxi_stats_selectivity(operator, &query, &sample, !IsA(other, Const));
+
+        // THE SELECTIVITY FOR A SINGLE QUERY THAT IS NOT NULL
+        if (arrayxi_stats_weight(&query) > 0.0) selec /= arrayxi_stats_weight(&query);
+    }
+
+    // COLUMNS OF WIDE ARRAYS HAVE NO SAMPLE, BUT THE POSITIONS OF THEIR SET BITS
+    // ARE MUCH NARROWER
+    else if (IsA(other, Const))
+    {
+        double positions = arrayxi_stats_positions_selectivity(root, &vardata, varRelid, operator, array, varonleft);
+
+        if (positions >= 0.0) selec = positions;
+    }
+
+    if (IsA(other, Const)) selec = Min(selec, arrayxi_stats_nonzeros_selectivity(root, &vardata, varRelid, operator, array));
+
+    CLAMP_PROBABILITY(selec);
+
+    ReleaseVariableStats(vardata);
+
+    PG_RETURN_FLOAT8(selec);
+}
+
+// JOIN SELECTIVITY OF THE THRESHOLD OPERATORS: THE FRACTION OF ALL PAIRS OF THE
+// ARRAYS OF BOTH STATISTICS THAT MATCH
+PG_FUNCTION_INFO_V1(arrayxi_threshold_joinsel);
+Datum arrayxi_threshold_joinsel(PG_FUNCTION_ARGS)
+{
+    PlannerInfo        *root = (PlannerInfo *) PG_GETARG_POINTER(0);
+    Oid                 operator = PG_GETARG_OID(1);
+    List               *args = (List *) PG_GETARG_POINTER(2);
+    SpecialJoinInfo    *sjinfo = (SpecialJoinInfo *) PG_GETARG_POINTER(4);
+    VariableStatData    vardata1, vardata2;
+    bool                join_is_reversed;
+    ArrayXiStatsSample  sample1, sample2;
+    Form_pg_statistic   stats1, stats2;
+    bool                same;
+    double              selec = ARRAYXI_DEFAULT_THRESHOLD_SEL;
+
+    get_join_variables(root, args, sjinfo, &vardata1, &vardata2, &join_is_reversed);
+
+    if (arrayxi_stats_sample(&vardata1, &sample1) && arrayxi_stats_sample(&vardata2, &sample2))
+    {
+        arrayxi_stats_sample_limit(&sample1, ARRAYXI_MAX_JOIN_SAMPLE);
+        arrayxi_stats_sample_limit(&sample2, ARRAYXI_MAX_JOIN_SAMPLE);
+
+        // A SELF-JOIN ON THE COLUMN HAS THE SAME SAMPLE ON BOTH SIDES
+        stats1 = (Form_pg_statistic) GETSTRUCT(vardata1.statsTuple);
+        stats2 = (Form_pg_statistic) GETSTRUCT(vardata2.statsTuple);
+        same = stats1->starelid == stats2->starelid && stats1->staattnum == stats2->staattnum &&
+               stats1->stainherit == stats2->stainherit;
+
+        // THE WEIGHTS EXCLUDE THE NULLS OF BOTH SIDES, WHICH NEVER MATCH
+        selec = arrayxi_stats_selectivity(operator, &sample1, &sample2, same);
+
+        CLAMP_PROBABILITY(selec);
+    }
+
+    ReleaseVariableStats(vardata1);
+    ReleaseVariableStats(vardata2);
+
+    PG_RETURN_FLOAT8(selec);
+}
+
+
+/////////////////////////////PLANNER SUPPORT FUNCTION/////////////////////////////
+
+
+#if PG_VERSION_NUM >= 120000
+
+// RETURNS THE NUMBER OF ELEMENTS OF A CONSTANT ARRAY OR THE AVERAGE NUMBER OF
+// ELEMENTS OF A COLUMN, OR ZERO IF IT IS UNKNOWN
+static double arrayxi_cost_elements(PlannerInfo *root, Node *arg)
+{
+    if (IsA(arg, Const) && !((Const *) arg)->constisnull)
+    {
+        return ArrayXiSize(DatumGetArrayTypeP(((Const *) arg)->constvalue));
+    }
+
+    if (root != NULL && IsA(arg, Var) && ((Var *) arg)->varlevelsup == 0)
+    {
+        RangeTblEntry *rte = rt_fetch(((Var *) arg)->varno, root->parse->rtable);
+
+        if (rte->rtekind == RTE_RELATION)
+        {
+            int32 width = get_attavgwidth(rte->relid, ((Var *) arg)->varattno);
+
+            if (width > 0) return Max(width - (int32) ARR_OVERHEAD_NONULLS(1), 0) / (double) sizeof(int32);
+        }
+    }
+
+    return 0.0;
+}
+
+/* The cost of a threshold operator grows with the length of the arrays; the
+ * declared COST 16 of the functions fits arrays of about 1000 elements. The
+ * length is taken from a constant argument or from the average width of the
+ * column in the statistics.
+ */
+static Node *arrayxi_threshold_cost(SupportRequestCost *req)
+{
+    List   *args;
+    double  elements = 0.0;
+    int     i;
+
+    if (req->node == NULL) return NULL;
+
+    if (IsA(req->node, OpExpr)) args = ((OpExpr *) req->node)->args;
+    else if (IsA(req->node, FuncExpr)) args = ((FuncExpr *) req->node)->args;
+    else return NULL;
+
+    for (i = 0; i < list_length(args) && elements == 0.0; i++)
+    {
+        elements = arrayxi_cost_elements(req->root, (Node *) list_nth(args, i));
+    }
+
+    if (elements == 0.0) return NULL;
+
+    req->startup = 0;
+    req->per_tuple = cpu_operator_cost * (1.0 + elements / ARRAYXI_ELEMENTS_PER_COST_UNIT);
+
+    return (Node *) req;
+}
+
+#endif
+
+// PLANNER SUPPORT FUNCTION OF THE THRESHOLD OPERATORS; PLANNER SUPPORT FUNCTIONS
+// EXIST SINCE POSTGRESQL 12, EARLIER VERSIONS DO NOT CALL IT
+PG_FUNCTION_INFO_V1(arrayxi_threshold_support);
+Datum arrayxi_threshold_support(PG_FUNCTION_ARGS)
+{
+#if PG_VERSION_NUM >= 120000
+    Node *rawreq = (Node *) PG_GETARG_POINTER(0);
+
+    if (IsA(rawreq, SupportRequestSimplify))
+    {
+        PG_RETURN_POINTER(arrayxi_partition_simplify((SupportRequestSimplify *) rawreq));
+    }
+
+    if (IsA(rawreq, SupportRequestCost))
+    {
+        PG_RETURN_POINTER(arrayxi_threshold_cost((SupportRequestCost *) rawreq));
+    }
+#endif
+
+    PG_RETURN_POINTER(NULL);
+}
@@ -0,0 +1,301 @@
+#include "arrayxi.h"
+#include "fmgr.h"
+#include "funcapi.h"
+#include "access/htup_details.h"
+#include "catalog/pg_type.h"
+#include "executor/spi.h"
+#include "utils/builtins.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+
+
+// NUMBER OF ROWS THAT ARE FETCHED FROM THE CURSOR AT ONCE
+#define ARRAYXI_TOPK_BATCH_SIZE 1024
+
+// SIMILARITY METRICS THAT CAN BE USED FOR A TOP-K OR THRESHOLD SEARCH; ALL OF
+// THEM INCREASE WITH THE SIMILARITY OF THE ARRAYS
+typedef struct
+{
+    const char    *name;
+    ArrayXiMetric  metric;
+} ArrayXiTopKMetric;
+
+static const ArrayXiTopKMetric arrayxi_topk_metrics[] =
+{
+    {"dice",        ARRAYXI_DICE},
+    {"kulczynski",  ARRAYXI_KULCZYNSKI},
+    {"ochiai",      ARRAYXI_OCHIAI},
+    {"russell-rao", ARRAYXI_RUSSELL_RAO},
+    {"simpson",     ARRAYXI_SIMPSON},
+    {"tanimoto",    ARRAYXI_TANIMOTO},
+    {"tversky",     ARRAYXI_TVERSKY}
+};
+
+// A ROW OF THE RESULT
+typedef struct
+{
+    double          similarity;
+    ItemPointerData ctid;
+} ArrayXiTopKEntry;
+
+// MIN-HEAP OF THE K MOST SIMILAR ROWS FOUND SO FAR; THE ROOT IS THE LEAST SIMILAR
+// ONE AND THE SIMILARITY A NEW ROW HAS TO EXCEED. THE ENTRIES GROW WITH THE
+// NUMBER OF ROWS UP TO K, SO THAT A LARGE K DOES NOT ALLOCATE MORE THAN THE
+// RELATION NEEDS
+typedef struct
+{
+    ArrayXiTopKEntry *entries;
+    int               size;
+    int               allocated;
+    int               capacity;
+} ArrayXiTopKHeap;
+
+
+// RETURNS THE METRIC WITH THE GIVEN NAME
+ArrayXiMetric arrayxi_ranking_metric(const char *name)
+{
+    int i;
+
+    for (i = 0; i < lengthof(arrayxi_topk_metrics); i++)
+    {
+        if (strcmp(name, arrayxi_topk_metrics[i].name) == 0) return arrayxi_topk_metrics[i].metric;
+    }
+
+    ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                 errmsg("unknown similarity metric: \"%s\"; valid values are dice, kulczynski, ochiai, russell-rao, simpson, tanimoto and tversky.", name)));
+
+    return ARRAYXI_TANIMOTO;
+}
+
+// RAISES AN ERROR IF THE ARRAY IS NOT ONE-DIMENSIONAL OR HAS NULL ELEMENTS; THE
+// KERNELS MAP THE DATA OF THE ARRAY AS A DENSE VECTOR OF ALL ITS ELEMENTS
+void arrayxi_check_array(ArrayType *array)
+{
+    if (ARR_NDIM(array) > 1 || ARR_HASNULL(array))
+    {
+        ereport(ERROR, (errcode(ERRCODE_DATA_EXCEPTION),
+                        errmsg("array must be one-dimensional without null elements.")));
+    }
+}
+
+static void arrayxi_topk_swap(ArrayXiTopKEntry *a, ArrayXiTopKEntry *b)
+{
+    ArrayXiTopKEntry tmp = *a;
+
+    *a = *b;
+    *b = tmp;
+}
+
+// ADDS A ROW TO THE HEAP; ONCE THE HEAP IS FULL THE ROW REPLACES THE ROOT IF IT
+// IS MORE SIMILAR
+static void arrayxi_topk_push(ArrayXiTopKHeap *heap, double similarity, ItemPointer ctid)
+{
+    ArrayXiTopKEntry *entries;
+    int               i, child;
+
+    if (heap->size == heap->allocated && heap->size < heap->capacity)
+    {
+        heap->allocated = Min(heap->capacity, 2 * heap->allocated);
+        heap->entries = (ArrayXiTopKEntry *) repalloc(heap->entries, sizeof(ArrayXiTopKEntry) * heap->allocated);
+    }
+
+    entries = heap->entries;
+
+    if (heap->size < heap->capacity)
+    {
+        // SIFT UP
+        i = heap->size++;
+
+        entries[i].similarity = similarity;
+        ItemPointerCopy(ctid, &entries[i].ctid);
+
+        while (i > 0 && entries[i].similarity < entries[(i - 1) / 2].similarity)
+        {
+            arrayxi_topk_swap(&entries[i], &entries[(i - 1) / 2]);
+            i = (i - 1) / 2;
+        }
+
+        return;
+    }
+
+    if (similarity <= entries[0].similarity) return;
+
+    // REPLACE THE ROOT AND SIFT DOWN
+    entries[0].similarity = similarity;
+    ItemPointerCopy(ctid, &entries[0].ctid);
+
+    for (i = 0; (child = 2 * i + 1) < heap->size; i = child)
+    {
+        if (child + 1 < heap->size && entries[child + 1].similarity < entries[child].similarity) child++;
+
+        if (entries[i].similarity <= entries[child].similarity) break;
+
+        arrayxi_topk_swap(&entries[i], &entries[child]);
+    }
+}
+
+// SORTS THE RESULT BY DECREASING SIMILARITY
+static int arrayxi_topk_entry_cmp(const void *a, const void *b)
+{
+    double sa = ((const ArrayXiTopKEntry *) a)->similarity;
+    double sb = ((const ArrayXiTopKEntry *) b)->similarity;
+
+    return (sa < sb) - (sa > sb);
+}
+
+/* Scans the column of the relation and collects the k rows that are most
+ * similar to the query in the heap. Once the heap is full, its least similar
+ * row is the limit of the comparison with the query, which stops as soon as
+ * the counts of the part of the row compared so far show that the row cannot
+ * reach it (the intersection cannot be larger than the smaller of both
+ * counts). The counts come from the same pass as the similarity.
+ */
+static void arrayxi_topk_scan(ArrayXiTopKHeap *heap, Oid relid, const char *column,
+                              ArrayType *query, ArrayXiMetric metric)
+{
+    StringInfoData  sql;
+    Portal          portal;
+    MemoryContext   batchcontext, oldcontext;
+    QueryCache      cache;
+    uint64          i;
+
+    // THE QUERY IS THE SECOND ARGUMENT OF THE METRIC AS IN METRIC(COLUMN, QUERY)
+    cache.argno = 1;
+    cache.array = query;
+    cache.count = ArrayXiNonZeros(query);
+
+    initStringInfo(&sql);
+    appendStringInfo(&sql, "SELECT ctid, %s FROM %s", quote_identifier(column),
+                     DatumGetCString(DirectFunctionCall1(regclassout, ObjectIdGetDatum(relid))));
+
+    if (SPI_connect() != SPI_OK_CONNECT)
+    {
+        ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR), errmsg("SPI_connect failed")));
+    }
+
+    portal = SPI_cursor_open_with_args(NULL, sql.data, 0, NULL, NULL, NULL, true, 0);
+
+    // DETOASTED ARRAYS ARE FREED AFTER EVERY BATCH
+    batchcontext = AllocSetContextCreate(CurrentMemoryContext, "arrayxi_topk batch", ALLOCSET_DEFAULT_SIZES);
+
+    for (;;)
+    {
+        SPI_cursor_fetch(portal, true, ARRAYXI_TOPK_BATCH_SIZE);
+
+        if (SPI_processed == 0) break;
+
+        if (getBaseType(SPI_gettypeid(SPI_tuptable->tupdesc, 2)) != INT4ARRAYOID)
+        {
+            ereport(ERROR, (errcode(ERRCODE_DATATYPE_MISMATCH),
+                            errmsg("column \"%s\" must be of type arrayxi or integer[].", column)));
+        }
+
+        oldcontext = MemoryContextSwitchTo(batchcontext);
+
+        for (i = 0; i < SPI_processed; i++)
+        {
+            HeapTuple   tuple = SPI_tuptable->vals[i];
+            bool        isnull;
+            Datum       ctid = SPI_getbinval(tuple, SPI_tuptable->tupdesc, 1, &isnull);
+            Datum       value = SPI_getbinval(tuple, SPI_tuptable->tupdesc, 2, &isnull);
+            ArrayType  *array;
+            double      similarity;
+
+            if (isnull) continue;
+
+            // INTEGER[] COLUMNS ARE NOT CHECKED BY THE ARRAYXI DOMAIN
+            array = DatumGetArrayTypeP(value);
+            arrayxi_check_array(array);
+
+            // ROWS THAT ONLY TIE WITH THE LEAST SIMILAR ROW OF THE HEAP ARE NOT
+            // REJECTED EARLY; THE HEAP IGNORES THEM
+            similarity = ArrayXiQuerySimilarityLimit(&cache, array, metric,
+                                                     heap->size == heap->capacity ? heap->entries[0].similarity : 0.0);
+
+            if (similarity < 0.0) continue;
+
+            arrayxi_topk_push(heap, similarity, (ItemPointer) DatumGetPointer(ctid));
+        }
+
+        MemoryContextSwitchTo(oldcontext);
+        MemoryContextReset(batchcontext);
+
+        SPI_freetuptable(SPI_tuptable);
+    }
+
+    SPI_cursor_close(portal);
+    SPI_finish();
+}
+
+// RETURNS THE CTID AND SIMILARITY OF THE K ROWS OF THE RELATION THAT ARE MOST
+// SIMILAR TO THE QUERY, MOST SIMILAR FIRST
+PG_FUNCTION_INFO_V1(arrayxi_topk);
+Datum arrayxi_topk(PG_FUNCTION_ARGS)
+{
+    FuncCallContext *funcctx;
+    ArrayXiTopKHeap *heap;
+
+    if (SRF_IS_FIRSTCALL())
+    {
+        Oid            relid = PG_GETARG_OID(0);
+        Name           column = PG_GETARG_NAME(1);
+        ArrayType     *query = PG_GETARG_ARRAYTYPE_P(2);
+        int32          k = PG_GETARG_INT32(3);
+        ArrayXiMetric  metric = arrayxi_ranking_metric(PG_GETARG_TEXT_AS_CSTRING(4));
+
+        MemoryContext  oldcontext;
+        TupleDesc      tupdesc;
+
+        if (k <= 0)
+        {
+            ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                            errmsg("k must be greater than zero.")));
+        }
+
+        funcctx = SRF_FIRSTCALL_INIT();
+
+        // THE HEAP HAS TO SURVIVE UNTIL THE LAST CALL
+        oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+        if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+        {
+            ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                            errmsg("function returning record called in context that cannot accept type record")));
+        }
+
+        heap = (ArrayXiTopKHeap *) palloc(sizeof(ArrayXiTopKHeap));
+        heap->allocated = Min(k, ARRAYXI_TOPK_BATCH_SIZE);
+        heap->entries = (ArrayXiTopKEntry *) palloc(sizeof(ArrayXiTopKEntry) * heap->allocated);
+        heap->size = 0;
+        heap->capacity = k;
+
+        funcctx->tuple_desc = BlessTupleDesc(tupdesc);
+        funcctx->user_fctx = heap;
+
+        MemoryContextSwitchTo(oldcontext);
+
+        arrayxi_topk_scan(heap, relid, NameStr(*column), query, metric);
+
+        qsort(heap->entries, heap->size, sizeof(ArrayXiTopKEntry), arrayxi_topk_entry_cmp);
+
+        funcctx->max_calls = heap->size;
+    }
+
+    funcctx = SRF_PERCALL_SETUP();
+    heap = (ArrayXiTopKHeap *) funcctx->user_fctx;
+
+    if (funcctx->call_cntr < funcctx->max_calls)
+    {
+        ArrayXiTopKEntry *entry = &heap->entries[funcctx->call_cntr];
+        Datum             values[2];
+        bool              nulls[2] = {false, false};
+
+        values[0] = PointerGetDatum(&entry->ctid);
+        values[1] = Float8GetDatum(entry->similarity);
+
+        SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(heap_form_tuple(funcctx->tuple_desc, values, nulls)));
+    }
+
+    SRF_RETURN_DONE(funcctx);
+}
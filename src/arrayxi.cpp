@@ -1,38 +1,263 @@
 #include "eigen.h"
 #include "arrayxi.h"
+#include "similarity.h"
 
 using namespace Eigen;
 
-inline int intersect_size(const ArrayXi &a, const ArrayXi &b)
+template<typename Derived1, typename Derived2>
+inline int intersect_size(const ArrayBase<Derived1> &a, const ArrayBase<Derived2> &b)
 {
-    return (a == b).cast<int>().min(a).count();
+    return (a == b).template cast<int>().min(a.derived()).count();
 }
 
-inline int unique_left_size(const ArrayXi &a, const ArrayXi &b)
+template<typename Derived1, typename Derived2>
+inline int unique_left_size(const ArrayBase<Derived1> &a, const ArrayBase<Derived2> &b)
 {
-    return (a != b).cast<int>().min(a).count();
+    return (a != b).template cast<int>().min(a.derived()).count();
 }
 
-inline int unique_right_size(const ArrayXi &a, const ArrayXi &b)
+template<typename Derived1, typename Derived2>
+inline int unique_right_size(const ArrayBase<Derived1> &a, const ArrayBase<Derived2> &b)
 {
-    return (a != b).cast<int>().min(b).count();
+    return (a != b).template cast<int>().min(b.derived()).count();
 }
 
-// CONVERTS A POSTGRESQL ARRAYTYPE INTO AN EIGEN ARRAY OF INTEGERS
-inline ArrayXi arraytype_to_arrayxi(ArrayType *array)
+// KERNEL FOR THE BINARY SIMILARITY METRICS: RETURNS THE FULL CONTINGENCY OF
+// BOTH ARRAYS IN A SINGLE PASS. THE BRANCH-FREE LOOP BODY IS VECTORIZED BY THE 
+// COMPILER, SO EACH COEFFICIENT IS LOADED ONLY ONCE INSTEAD OF ONCE PER COUNT
+struct BinaryCountsKernel
 {
-    // MAP POSTGRESQL ARRAY TO EIGEN ARRAYXI
-    Map<ArrayXi> arrayxi((int *) ARR_DATA_PTR(array), arraytype_num_elems(array));
-    
-    return arrayxi;
+    typedef BinaryCounts Result;
+
+    template<typename Derived1, typename Derived2>
+    Result operator()(const ArrayBase<Derived1> &arrayxi1, const ArrayBase<Derived2> &arrayxi2) const
+    {
+        unsigned int A = 0, B = 0, c = 0, d = 0;
+        
+        for (Index i = 0; i < arrayxi1.size(); i++)
+        {
+            int x = arrayxi1.coeff(i), y = arrayxi2.coeff(i);
+            
+            A += (x != 0);
+            B += (y != 0);
+            c += (x == y) & (x != 0);
+            d += (x == 0) & (y == 0);
+        }
+
+        Result counts = {A, B, c, d, (unsigned int) arrayxi1.size()};
+
+        return counts;
+    }
+};
+
+// KERNEL FOR THE BINARY SIMILARITY METRICS AGAINST A QUERY WHOSE NUMBER OF 
+// NON-ZERO ELEMENTS IS ALREADY KNOWN; THE FIRST OPERAND IS THE QUERY
+struct QueryCountsKernel
+{
+    typedef BinaryCounts Result;
+
+    unsigned int count;     // NUMBER OF NON-ZERO ELEMENTS IN THE QUERY
+    bool         first;     // TRUE IF THE QUERY IS THE FIRST ARGUMENT OF THE METRIC
+
+    QueryCountsKernel(unsigned int count, bool first) : count(count), first(first) {}
+
+    template<typename Derived1, typename Derived2>
+    Result operator()(const ArrayBase<Derived1> &query, const ArrayBase<Derived2> &arrayxi) const
+    {
+        unsigned int T = 0, c = 0, d = 0;
+        
+        for (Index i = 0; i < query.size(); i++)
+        {
+            int q = query.coeff(i), x = arrayxi.coeff(i);
+            
+            T += (x != 0);
+            c += (q == x) & (q != 0);
+            d += (q == 0) & (x == 0);
+        }
+
+        // A AND B ARE NOT SYMMETRIC FOR ALL METRICS, E.G. TVERSKY
+        Result counts = {first ? count : T, first ? T : count, c, d, (unsigned int) query.size()};
+
+        return counts;
+    }
+};
+
+// NUMBER OF ELEMENTS AFTER WHICH THE LIMIT KERNEL CHECKS THE BOUND
+#define ARRAYXI_LIMIT_BLOCK 256
+
+/* Kernel for searches that only need the similarity if it reaches a limit: the
+ * counts of the query kernel are taken block by block, and after every block
+ * the similarity is bounded by the counts so far. The remaining r elements can
+ * add at most r to the count of the array and at most min(r, B - c) shared
+ * positions, so the array is rejected as soon as even the most favourable rest
+ * stays below the limit. The counts are never taken in a separate pass; arrays
+ * that are not rejected cost one bound per block more than the plain kernel.
+ * Returns the similarity or -1 if the array was rejected.
+ */
+struct QueryLimitKernel
+{
+    typedef double Result;
+
+    unsigned int  count;    // NUMBER OF NON-ZERO ELEMENTS IN THE QUERY
+    bool          first;    // TRUE IF THE QUERY IS THE FIRST ARGUMENT OF THE METRIC
+    ArrayXiMetric metric;
+    double        limit;
+
+    QueryLimitKernel(unsigned int count, bool first, ArrayXiMetric metric, double limit)
+        : count(count), first(first), metric(metric), limit(limit) {}
+
+    // LARGEST SIMILARITY THE ARRAY CAN STILL REACH; SEE SIMILARITYUPPERBOUND()
+    Result bound(unsigned int T, unsigned int c, unsigned int rest, unsigned int n) const
+    {
+        unsigned int maxc = c + std::min(rest, count - c);
+
+        if (metric == ARRAYXI_EUCLIDEAN || metric == ARRAYXI_MANHATTAN)
+        {
+            T += rest;
+        }
+        else
+        {
+            T = std::min(std::max(maxc, T), T + rest);
+            c = std::min(maxc, T);
+        }
+
+        BinaryCounts counts = {first ? count : T, first ? T : count, c, 0, n};
+
+        return binary_similarity(counts, metric);
+    }
+
+    template<typename Derived1, typename Derived2>
+    Result operator()(const ArrayBase<Derived1> &query, const ArrayBase<Derived2> &arrayxi) const
+    {
+        unsigned int T = 0, c = 0, d = 0, n = query.size();
+
+        for (Index start = 0; start < n; start += ARRAYXI_LIMIT_BLOCK)
+        {
+            Index end = std::min<Index>(start + ARRAYXI_LIMIT_BLOCK, n);
+
+            for (Index i = start; i < end; i++)
+            {
+                int q = query.coeff(i), x = arrayxi.coeff(i);
+
+                T += (x != 0);
+                c += (q == x) & (q != 0);
+                d += (q == 0) & (x == 0);
+            }
+
+            if (end < n && bound(T, c, n - end, n) < limit) return -1.0;
+        }
+
+        // A AND B ARE NOT SYMMETRIC FOR ALL METRICS, E.G. TVERSKY
+        BinaryCounts counts = {first ? count : T, first ? T : count, c, d, n};
+
+        return binary_similarity(counts, metric);
+    }
+};
+
+// KERNEL FOR THE QUANTITATIVE/NON-BINARY SIMILARITY METRICS
+struct InnerProductsKernel
+{
+    typedef BinaryCounts Result;
+
+    template<typename Derived1, typename Derived2>
+    Result operator()(const ArrayBase<Derived1> &arrayxi1, const ArrayBase<Derived2> &arrayxi2) const
+    {
+        Result counts;
+
+        // SQUARED NORMS OF THE INDIVIDUAL ARRAYS
+        counts.A = arrayxi1.square().sum();
+        counts.B = arrayxi2.square().sum();
+
+        // INNER PRODUCT
+        counts.c = (arrayxi1 * arrayxi2).sum();
+        counts.d = 0;
+        counts.n = arrayxi1.size();
+
+        return counts;
+    }
+};
+
+// KERNEL FOR THE BRAY-CURTIS DISSIMILARITY
+struct BrayCurtisKernel
+{
+    typedef double Result;
+
+    template<typename Derived1, typename Derived2>
+    Result operator()(const ArrayBase<Derived1> &arrayxi1, const ArrayBase<Derived2> &arrayxi2) const
+    {
+        return 1.0 - ((arrayxi1-arrayxi2).abs().sum() / (double) (arrayxi1+arrayxi2).sum());
+    }
+};
+
+// KERNEL FOR THE EUCLIDEAN DISTANCE
+struct EuclideanDistKernel
+{
+    typedef double Result;
+
+    template<typename Derived1, typename Derived2>
+    Result operator()(const ArrayBase<Derived1> &arrayxi1, const ArrayBase<Derived2> &arrayxi2) const
+    {
+        return sqrt((arrayxi1-arrayxi2).square().sum());
+    }
+};
+
+// KERNEL FOR THE MANHATTAN DISTANCE
+struct ManhattanDistKernel
+{
+    typedef double Result;
+
+    template<typename Derived1, typename Derived2>
+    Result operator()(const ArrayBase<Derived1> &arrayxi1, const ArrayBase<Derived2> &arrayxi2) const
+    {
+        return (arrayxi1-arrayxi2).abs().sum();
+    }
+};
+
+// KERNEL FOR THE MEAN HAMMING DISTANCE
+struct MeanHammingDistKernel
+{
+    typedef double Result;
+
+    template<typename Derived1, typename Derived2>
+    Result operator()(const ArrayBase<Derived1> &arrayxi1, const ArrayBase<Derived2> &arrayxi2) const
+    {
+        // UNIQUE COUNTS IN BOTH ARRAYS
+        unsigned int a = unique_left_size(arrayxi1,arrayxi2);
+        unsigned int b = unique_right_size(arrayxi1,arrayxi2);
+
+        return (a + b) / (double) arrayxi1.size();
+    }
+};
+
+// RETURNS THE BINARY COUNTS OF BOTH ARRAYS
+inline BinaryCounts arrayxi_binary_counts(ArrayType *a1, ArrayType *a2)
+{
+    return arraytype_apply<ArrayXi>(a1, a2, BinaryCountsKernel());
 }
 
+// KERNEL FOR THE BATCH SIMILARITY METRICS: THE NUMBER OF NON-ZERO ELEMENTS OF
+// THE QUERY IS COUNTED ONCE FOR ALL TARGETS
+struct BinarySimilarityKernel
+{
+    typedef double Result;
+
+    QueryCountsKernel counts;
+    ArrayXiMetric     metric;
+
+    BinarySimilarityKernel(unsigned int count, ArrayXiMetric metric) : counts(count, true), metric(metric) {}
+
+    template<typename Derived1, typename Derived2>
+    Result operator()(const ArrayBase<Derived1> &query, const ArrayBase<Derived2> &arrayxi) const
+    {
+        return binary_similarity(counts(query, arrayxi), metric);
+    }
+};
+
 // RETURNS ARRAY WITH GIVEN CONSTANT VALUE
 extern "C"
 ArrayType *ArrayXiCopy(ArrayType *array)
 {
-    // MAP POSTGRESQL ARRAY TO
-    Map<ArrayXi> arrayxi((int *) ARR_DATA_PTR(array), arraytype_num_elems(array));
+    ArrayXiMap arrayxi = arraytype_to_arrayxi(array);
 
     return densebase_to_int32_arraytype(arrayxi);
 }
@@ -71,7 +296,7 @@ ArrayType *ArrayXiLinSpaced(int size, int low, int high)
 extern "C"
 int ArrayXiSize(ArrayType *array)
 {
-    ArrayXi arrayxi = arraytype_to_arrayxi(array);
+    ArrayXiMap arrayxi = arraytype_to_arrayxi(array);
     
     // RETURNS THE SIZE FOR 1D ARRAY
     return arrayxi.innerSize();
@@ -81,16 +306,36 @@ int ArrayXiSize(ArrayType *array)
 extern "C"
 int ArrayXiNonZeros(ArrayType *array)
 {
-    ArrayXi arrayxi = arraytype_to_arrayxi(array);
+    ArrayXiMap arrayxi = arraytype_to_arrayxi(array);
 
     return arrayxi.count();
 }
 
+// RETURNS THE ONE-BASED POSITIONS OF THE NON-ZERO COEFFICIENTS
+extern "C"
+ArrayType *ArrayXiPositions(ArrayType *array)
+{
+    ArrayXiMap arrayxi = arraytype_to_arrayxi(array);
+    Index count = arrayxi.count();
+
+    if (count == 0) return construct_empty_array(INT4OID);
+
+    ArrayType *positions = arraytype_alloc<int>(1, 1, count);
+    int *data = (int *) ARR_DATA_PTR(positions);
+
+    for (Index i = 0; i < arrayxi.size(); i++)
+    {
+        if (arrayxi(i) != 0) *data++ = i + 1;
+    }
+
+    return positions;
+}
+
 // RETURNS THE SMALLEST COEFFICIENT OF THE ARRAY
 extern "C"
 int ArrayXiMinCoeff(ArrayType *array)
 {
-    ArrayXi arrayxi = arraytype_to_arrayxi(array);
+    ArrayXiMap arrayxi = arraytype_to_arrayxi(array);
 
     return arrayxi.minCoeff();
 }
@@ -99,7 +344,7 @@ int ArrayXiMinCoeff(ArrayType *array)
 extern "C"
 int ArrayXiMaxCoeff(ArrayType *array)
 {
-    ArrayXi arrayxi = arraytype_to_arrayxi(array);
+    ArrayXiMap arrayxi = arraytype_to_arrayxi(array);
 
     return arrayxi.maxCoeff();
 }
@@ -108,7 +353,7 @@ int ArrayXiMaxCoeff(ArrayType *array)
 extern "C"
 long ArrayXiSum(ArrayType *array)
 {
-    ArrayXi arrayxi = arraytype_to_arrayxi(array);
+    ArrayXiMap arrayxi = arraytype_to_arrayxi(array);
 
     return arrayxi.sum();
 }
@@ -117,7 +362,7 @@ long ArrayXiSum(ArrayType *array)
 extern "C"
 double ArrayXiMean(ArrayType *array)
 {
-    ArrayXi arrayxi = arraytype_to_arrayxi(array);
+    ArrayXiMap arrayxi = arraytype_to_arrayxi(array);
 
     return arrayxi.mean();
 }
@@ -126,7 +371,7 @@ double ArrayXiMean(ArrayType *array)
 extern "C"
 ArrayType *ArrayXiAbs(ArrayType *array)
 {
-    ArrayXi arrayxi = arraytype_to_arrayxi(array);
+    ArrayXiMap arrayxi = arraytype_to_arrayxi(array);
 
     return densebase_to_int32_arraytype(arrayxi.abs());
 }
@@ -135,7 +380,7 @@ ArrayType *ArrayXiAbs(ArrayType *array)
 extern "C"
 ArrayType *ArrayXiBinary(ArrayType *array)
 {
-    ArrayXi arrayxi = arraytype_to_arrayxi(array);
+    ArrayXiMap arrayxi = arraytype_to_arrayxi(array);
 
     return densebase_to_int32_arraytype((arrayxi > 0).cast<int>());
 }
@@ -145,8 +390,8 @@ extern "C"
 ArrayType *ArrayXiAdd(ArrayType *a1, ArrayType *a2)
 {
     // MAP DATA TO EIGEN ARRAYS
-    ArrayXi arrayxi1 = arraytype_to_arrayxi(a1);
-    ArrayXi arrayxi2 = arraytype_to_arrayxi(a2);
+    ArrayXiMap arrayxi1 = arraytype_to_arrayxi(a1);
+    ArrayXiMap arrayxi2 = arraytype_to_arrayxi(a2);
 
     // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
     EigenBaseEqSize(arrayxi1,arrayxi2);
@@ -159,8 +404,8 @@ extern "C"
 ArrayType *ArrayXiSub(ArrayType *a1, ArrayType *a2)
 {
     // MAP DATA TO EIGEN ARRAYS
-    ArrayXi arrayxi1 = arraytype_to_arrayxi(a1);
-    ArrayXi arrayxi2 = arraytype_to_arrayxi(a2);
+    ArrayXiMap arrayxi1 = arraytype_to_arrayxi(a1);
+    ArrayXiMap arrayxi2 = arraytype_to_arrayxi(a2);
 
     // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
     EigenBaseEqSize(arrayxi1,arrayxi2);
@@ -173,8 +418,8 @@ extern "C"
 ArrayType *ArrayXiMul(ArrayType *a1, ArrayType *a2)
 {
     // MAP DATA TO EIGEN ARRAYS
-    ArrayXi arrayxi1 = arraytype_to_arrayxi(a1);
-    ArrayXi arrayxi2 = arraytype_to_arrayxi(a2);
+    ArrayXiMap arrayxi1 = arraytype_to_arrayxi(a1);
+    ArrayXiMap arrayxi2 = arraytype_to_arrayxi(a2);
 
     // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
     EigenBaseEqSize(arrayxi1,arrayxi2);
@@ -187,8 +432,8 @@ extern "C"
 ArrayType *ArrayXiDiv(ArrayType *a1, ArrayType *a2)
 {
     // MAP DATA TO EIGEN ARRAYS
-    ArrayXi arrayxi1 = arraytype_to_arrayxi(a1);
-    ArrayXi arrayxi2 = arraytype_to_arrayxi(a2);
+    ArrayXiMap arrayxi1 = arraytype_to_arrayxi(a1);
+    ArrayXiMap arrayxi2 = arraytype_to_arrayxi(a2);
 
     // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
     EigenBaseEqSize(arrayxi1,arrayxi2);
@@ -204,7 +449,7 @@ ArrayType *ArrayXiDiv(ArrayType *a1, ArrayType *a2)
 extern "C"
 ArrayType *ArrayXiAddScalar(ArrayType *array, int scalar)
 {
-    ArrayXi arrayxi = arraytype_to_arrayxi(array);
+    ArrayXiMap arrayxi = arraytype_to_arrayxi(array);
 
     return densebase_to_int32_arraytype(arrayxi + scalar);
 }
@@ -213,7 +458,7 @@ ArrayType *ArrayXiAddScalar(ArrayType *array, int scalar)
 extern "C"
 ArrayType *ArrayXiSubScalar(ArrayType *array, int scalar)
 {
-    ArrayXi arrayxi = arraytype_to_arrayxi(array);
+    ArrayXiMap arrayxi = arraytype_to_arrayxi(array);
 
     return densebase_to_int32_arraytype(arrayxi - scalar);
 }
@@ -222,32 +467,104 @@ ArrayType *ArrayXiSubScalar(ArrayType *array, int scalar)
 extern "C"
 ArrayType *ArrayXiMulScalar(ArrayType *array, int scalar)
 {
-    ArrayXi arrayxi = arraytype_to_arrayxi(array);
+    ArrayXiMap arrayxi = arraytype_to_arrayxi(array);
 
     return densebase_to_int32_arraytype(arrayxi * scalar);
 }
 
-// RETURNS TRUE IF THE FIRST ARRAY CONTAINS ALL ELEMENTS OF THE SECOND
+// RETURNS TRUE IF BOTH ARRAYS HAVE THE SAME ELEMENTS. ARRAYS OF DIFFERENT SIZES
+// ARE NOT EQUAL, WHICH HASH JOINS RELY ON WHEN TWO HASHES COLLIDE
 extern "C"
 bool ArrayXiEqual(ArrayType *a1, ArrayType *a2)
 {
     // MAP DATA TO EIGEN ARRAYS
-    ArrayXi arrayxi1 = arraytype_to_arrayxi(a1);
-    ArrayXi arrayxi2 = arraytype_to_arrayxi(a2);
+    ArrayXiMap arrayxi1 = arraytype_to_arrayxi(a1);
+    ArrayXiMap arrayxi2 = arraytype_to_arrayxi(a2);
+
+    if (arrayxi1.size() != arrayxi2.size()) return false;
 
-    // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
-    EigenBaseEqSize(arrayxi1,arrayxi2);
-    
     return (arrayxi1==arrayxi2).all();
 }
 
+// RETURNS THE HASH OF THE ELEMENTS FOR THE HASH OPERATOR CLASS; LIKE EQUALITY IT
+// IGNORES THE DIMENSIONS OF THE ARRAY
+extern "C"
+uint32 ArrayXiHash(ArrayType *array)
+{
+    return hash_uint32_words((const uint32 *) ARR_DATA_PTR(array), arraytype_num_elems(array));
+}
+
+/* Total order of the B-tree operator class, which agrees with the abbreviated
+ * keys: arrays are ordered by their number of non-zero elements first, then by
+ * the pattern of non-zero elements (an array that has a non-zero element where
+ * the other has a zero is greater), then by the elements and finally by size.
+ * Like equality it ignores the dimensions of the array.
+ */
+extern "C"
+int ArrayXiCmp(ArrayType *a1, ArrayType *a2)
+{
+    // MAP DATA TO EIGEN ARRAYS
+    ArrayXiMap arrayxi1 = arraytype_to_arrayxi(a1);
+    ArrayXiMap arrayxi2 = arraytype_to_arrayxi(a2);
+
+    Index count1 = (arrayxi1 != 0).count();
+    Index count2 = (arrayxi2 != 0).count();
+
+    if (count1 != count2) return count1 < count2 ? -1 : 1;
+
+    Index size = std::max(arrayxi1.size(), arrayxi2.size());
+
+    // MISSING ELEMENTS OF THE SHORTER ARRAY COUNT AS ZEROS
+    for (Index i = 0; i < size; i++)
+    {
+        bool bit1 = i < arrayxi1.size() && arrayxi1(i) != 0;
+        bool bit2 = i < arrayxi2.size() && arrayxi2(i) != 0;
+
+        if (bit1 != bit2) return bit1 ? 1 : -1;
+    }
+
+    for (Index i = 0; i < std::min(arrayxi1.size(), arrayxi2.size()); i++)
+    {
+        if (arrayxi1(i) != arrayxi2(i)) return arrayxi1(i) < arrayxi2(i) ? -1 : 1;
+    }
+
+    if (arrayxi1.size() != arrayxi2.size()) return arrayxi1.size() < arrayxi2.size() ? -1 : 1;
+
+    return 0;
+}
+
+/* Returns the abbreviated sort key of the array: the number of non-zero
+ * elements in the upper 16 bits followed by the pattern of non-zero elements
+ * among the first 48, the first element being the most significant bit. Arrays
+ * with 65535 or more non-zero elements all get the largest key, so that their
+ * order is left to the full comparator.
+ */
+extern "C"
+uint64 ArrayXiSortKey(ArrayType *array)
+{
+    ArrayXiMap arrayxi = arraytype_to_arrayxi(array);
+
+    Index count = (arrayxi != 0).count();
+
+    if (count >= 0xFFFF) return ~UINT64CONST(0);
+
+    uint64 key = (uint64) count << 48;
+
+    for (Index i = 0; i < std::min(arrayxi.size(), (Index) 48); i++)
+    {
+        if (arrayxi(i) != 0) key |= UINT64CONST(1) << (47 - i);
+    }
+
+    return key;
+}
+
 // RETURNS TRUE IF THE FIRST ARRAY CONTAINS ALL ELEMENTS OF THE SECOND
 extern "C"
 bool ArrayXiContains(ArrayType *a1, ArrayType *a2)
 {
     // MAP DATA TO EIGEN ARRAYS
-    ArrayXi arrayxi1 = arraytype_to_arrayxi(a1);
-    ArrayXi arrayxi2 = arraytype_to_arrayxi(a2);
+    ArrayXiMap arrayxi1 = arraytype_to_arrayxi(a1);
+    ArrayXiMap arrayxi2 = arraytype_to_arrayxi(a2);
 
     // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
     EigenBaseEqSize(arrayxi1,arrayxi2);
@@ -260,8 +577,8 @@ extern "C"
 bool ArrayXiOverlaps(ArrayType *a1, ArrayType *a2)
 {
     // MAP DATA TO EIGEN ARRAYS
-    ArrayXi arrayxi1 = arraytype_to_arrayxi(a1);
-    ArrayXi arrayxi2 = arraytype_to_arrayxi(a2);
+    ArrayXiMap arrayxi1 = arraytype_to_arrayxi(a1);
+    ArrayXiMap arrayxi2 = arraytype_to_arrayxi(a2);
 
     // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
     EigenBaseEqSize(arrayxi1,arrayxi2);
@@ -274,8 +591,8 @@ extern "C"
 ArrayType *ArrayXiIntersection(ArrayType *a1, ArrayType *a2)
 {
     // MAP DATA TO EIGEN ARRAYS
-    ArrayXi arrayxi1 = arraytype_to_arrayxi(a1);
-    ArrayXi arrayxi2 = arraytype_to_arrayxi(a2);
+    ArrayXiMap arrayxi1 = arraytype_to_arrayxi(a1);
+    ArrayXiMap arrayxi2 = arraytype_to_arrayxi(a2);
 
     // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
     EigenBaseEqSize(arrayxi1,arrayxi2);
@@ -288,8 +605,8 @@ extern "C"
 ArrayType *ArrayXiUnion(ArrayType *a1, ArrayType *a2)
 {
     // MAP DATA TO EIGEN ARRAYS
-    ArrayXi arrayxi1 = arraytype_to_arrayxi(a1);
-    ArrayXi arrayxi2 = arraytype_to_arrayxi(a2);
+    ArrayXiMap arrayxi1 = arraytype_to_arrayxi(a1);
+    ArrayXiMap arrayxi2 = arraytype_to_arrayxi(a2);
 
     // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
     EigenBaseEqSize(arrayxi1,arrayxi2);
@@ -303,15 +620,13 @@ extern "C"
 ArrayType *ArrayXiBinaryUnion(ArrayType *a1, ArrayType *a2)
 {
     // MAP DATA TO EIGEN ARRAYS
-    ArrayXi arrayxi1 = arraytype_to_arrayxi(a1);
-    ArrayXi arrayxi2 = arraytype_to_arrayxi(a2);
+    ArrayXiMap arrayxi1 = arraytype_to_arrayxi(a1);
+    ArrayXiMap arrayxi2 = arraytype_to_arrayxi(a2);
 
     // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
     EigenBaseEqSize(arrayxi1,arrayxi2);
 
-    ArrayXi binary_union = (arrayxi1.max(arrayxi2) > 0).cast<int>();
-    
-    return densebase_to_int32_arraytype(binary_union);
+    return densebase_to_int32_arraytype((arrayxi1.max(arrayxi2) > 0).cast<int>());
 }
 
 
@@ -322,259 +637,115 @@ ArrayType *ArrayXiBinaryUnion(ArrayType *a1, ArrayType *a2)
 extern "C"
 double ArrayXiBrayCurtis(ArrayType *a1, ArrayType *a2)
 {
-    // MAP DATA TO EIGEN ARRAYS
-    ArrayXi arrayxi1 = arraytype_to_arrayxi(a1);
-    ArrayXi arrayxi2 = arraytype_to_arrayxi(a2);
-
-    // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
-    EigenBaseEqSize(arrayxi1,arrayxi2);
-
-    return 1.0 - ((arrayxi1-arrayxi2).abs().sum() / (double) (arrayxi1+arrayxi2).sum());
+    return arraytype_apply<ArrayXi>(a1, a2, BrayCurtisKernel());
 }
 
 // RETURNS THE DICE SIMILARITY
 extern "C"
 double ArrayXiDice(ArrayType *a1, ArrayType *a2)
 {
-    double similarity = 0.0;
-    
-    // MAP DATA TO EIGEN ARRAYS
-    ArrayXi arrayxi1 = arraytype_to_arrayxi(a1);
-    ArrayXi arrayxi2 = arraytype_to_arrayxi(a2);
-
-    // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
-    EigenBaseEqSize(arrayxi1,arrayxi2);
-    
-    // SET COUNTS ON THE INDIVIDUAL ARRAYS
-    unsigned int A = arrayxi1.count();
-    unsigned int B = arrayxi2.count();
-
-    // COMMON COUNTS
-    unsigned int c = intersect_size(arrayxi1,arrayxi2);
-
-    if (A != 0 && B != 0) similarity = 2 * c / (double) (A+B);
-    
-    return similarity;
+    return dice_similarity(arrayxi_binary_counts(a1, a2));
 }
 
 // RETURNS THE KULCZYNSKI SIMILARITY
 extern "C"
 double ArrayXiKulczynski(ArrayType *a1, ArrayType *a2)
 {
-    double similarity = 0.0;
-    
-    // MAP DATA TO EIGEN ARRAYS
-    ArrayXi arrayxi1 = arraytype_to_arrayxi(a1);
-    ArrayXi arrayxi2 = arraytype_to_arrayxi(a2);
-
-    // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
-    EigenBaseEqSize(arrayxi1,arrayxi2);
-
-    // SET COUNTS ON THE INDIVIDUAL ARRAYS
-    unsigned int A = arrayxi1.count();
-    unsigned int B = arrayxi2.count();
-    
-    // COMMON COUNTS
-    unsigned int c = intersect_size(arrayxi1,arrayxi2);
-
-    // AVOID DIVISION BY ZERO
-    if (A != 0 && B != 0) similarity = c * (A + B) / (double) (2 * A * B);
-    
-    return similarity;
+    return kulczynski_similarity(arrayxi_binary_counts(a1, a2));
 }
 
 // RETURNS THE NORMALIZED EUCLIDEAN SIMILARITY
 extern "C"
 double ArrayXiNormEuclidean(ArrayType *a1, ArrayType *a2)
 {
-    // MAP DATA TO EIGEN ARRAYS
-    ArrayXi arrayxi1 = arraytype_to_arrayxi(a1);
-    ArrayXi arrayxi2 = arraytype_to_arrayxi(a2);
-
-    // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
-    EigenBaseEqSize(arrayxi1,arrayxi2);
-
-    // SET COUNTS ON THE INDIVIDUAL ARRAYS
-    unsigned int A = arrayxi1.count();
-    unsigned int B = arrayxi2.count();
-
-    // COMMON COUNTS
-    unsigned int c = intersect_size(arrayxi1,arrayxi2);
-
-    return sqrt((A + B - 2 * c) / (double) arrayxi1.size());
+    return euclidean_similarity(arrayxi_binary_counts(a1, a2));
 }
 
 // RETURNS THE NORMALIZED MANHATTAN SIMILARITY
 extern "C"
 double ArrayXiNormManhattan(ArrayType *a1, ArrayType *a2)
 {
-    // MAP DATA TO EIGEN ARRAYS
-    ArrayXi arrayxi1 = arraytype_to_arrayxi(a1);
-    ArrayXi arrayxi2 = arraytype_to_arrayxi(a2);
-
-    // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
-    EigenBaseEqSize(arrayxi1,arrayxi2);
-
-    // SET COUNTS ON THE INDIVIDUAL ARRAYS
-    unsigned int A = arrayxi1.count();
-    unsigned int B = arrayxi2.count();
-
-    // COMMON COUNTS
-    unsigned int c = intersect_size(arrayxi1,arrayxi2);
-
-    return (A + B - 2 * c) / (double) arrayxi1.size();
+    return manhattan_similarity(arrayxi_binary_counts(a1, a2));
 }
 
 // RETURNS THE OCHIAI/COSINE SIMILARITY
 extern "C"
 double ArrayXiOchiai(ArrayType *a1, ArrayType *a2)
 {
-    double similarity = 0.0;
-    
-    // MAP DATA TO EIGEN ARRAYS
-    ArrayXi arrayxi1 = arraytype_to_arrayxi(a1);
-    ArrayXi arrayxi2 = arraytype_to_arrayxi(a2);
-
-    // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
-    EigenBaseEqSize(arrayxi1,arrayxi2);
-
-    // SET COUNTS ON THE INDIVIDUAL ARRAYS
-    unsigned int A = arrayxi1.count();
-    unsigned int B = arrayxi2.count();
-
-    // COMMON COUNTS
-    unsigned int c = intersect_size(arrayxi1,arrayxi2);
-
-    // AVOID DIVISION BY ZERO
-    if (A != 0 && B != 0) similarity = c / sqrt(A*B);
-    
-    return similarity;
+    return ochiai_similarity(arrayxi_binary_counts(a1, a2));
 }
 
 // RETURNS THE RUSSELL-RAO SIMILARITY
 extern "C"
 double ArrayXiRussellRao(ArrayType *a1, ArrayType *a2)
 {
-    // MAP DATA TO EIGEN ARRAYS
-    ArrayXi arrayxi1 = arraytype_to_arrayxi(a1);
-    ArrayXi arrayxi2 = arraytype_to_arrayxi(a2);
-
-    // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
-    EigenBaseEqSize(arrayxi1,arrayxi2);
-
-    // COMMON COUNTS
-    unsigned int c = intersect_size(arrayxi1,arrayxi2);
-
-    return c / (double) arrayxi1.size();
+    return russell_rao_similarity(arrayxi_binary_counts(a1, a2));
 }
 
 // RETURNS THE SIMPSON SIMILARITY - FUZCAV DEFAULT SIMILARITY
 extern "C"
 double ArrayXiSimpson(ArrayType *a1, ArrayType *a2)
 {
-    double similarity = 0.0;
-    
-    // MAP DATA TO EIGEN ARRAYS
-    ArrayXi arrayxi1 = arraytype_to_arrayxi(a1);
-    ArrayXi arrayxi2 = arraytype_to_arrayxi(a2);
-
-    // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
-    EigenBaseEqSize(arrayxi1,arrayxi2);
-
-    // SET COUNTS ON THE INDIVIDUAL ARRAYS
-    unsigned int A = arrayxi1.count();
-    unsigned int B = arrayxi2.count();
-
-    // COMMON COUNTS
-    unsigned int c = intersect_size(arrayxi1,arrayxi2);
-
-    // AVOID DIVISION BY ZERO
-    if (A != 0 && B != 0) similarity = c / (double) std::min(A,B);
-    
-    return similarity;
+    return simpson_similarity(arrayxi_binary_counts(a1, a2));
 }
 
 // RETURNS THE SIMPSON SIMILARITY WITH MAX() INSTEAD OF MIN()
 extern "C"
 double ArrayXiSimpsonGlobal(ArrayType *a1, ArrayType *a2)
 {
-    double similarity = 0.0;
-    
-    // MAP DATA TO EIGEN ARRAYS
-    ArrayXi arrayxi1 = arraytype_to_arrayxi(a1);
-    ArrayXi arrayxi2 = arraytype_to_arrayxi(a2);
-
-    // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
-    EigenBaseEqSize(arrayxi1,arrayxi2);
-
-    // SET COUNTS ON THE INDIVIDUAL ARRAYS
-    unsigned int A = arrayxi1.count();
-    unsigned int B = arrayxi2.count();
-
-    // COMMON COUNTS
-    unsigned int c = intersect_size(arrayxi1,arrayxi2);
-
-    // AVOID DIVISION BY ZERO
-    if (A != 0 && B != 0) similarity = c / (double) std::max(A,B);
-    
-    return similarity;
+    return simpson_global_similarity(arrayxi_binary_counts(a1, a2));
 }
 
 // RETURNS THE TANIMOTO/JACCARD SIMILARITY (I.E. TVERSKY ALPHA=1, BETA=1)
 extern "C"
 double ArrayXiTanimoto(ArrayType *a1, ArrayType *a2)
 {
-    double similarity = 0.0;
-    
-    // MAP DATA TO EIGEN ARRAYS
-    ArrayXi arrayxi1 = arraytype_to_arrayxi(a1);
-    ArrayXi arrayxi2 = arraytype_to_arrayxi(a2);
-
-    // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
-    EigenBaseEqSize(arrayxi1,arrayxi2);
-
-    // SET COUNTS ON THE INDIVIDUAL ARRAYS
-    unsigned int A = arrayxi1.count();
-    unsigned int B = arrayxi2.count();
-
-    // COMMON COUNTS
-    unsigned int c = intersect_size(arrayxi1,arrayxi2);
-
-    // AVOID DIVISION BY ZERO
-    if (A != 0 && B != 0) similarity = c / (double) (A + B - c);
-
-    return similarity;
+    return tanimoto_similarity(arrayxi_binary_counts(a1, a2));
 }
 
 // RETURNS THE TVERSKY SIMILARITY
 extern "C"
 double ArrayXiTversky(ArrayType *a1, ArrayType *a2)
 {
-    double similarity = 0.0;
-    
-    // MAP DATA TO EIGEN ARRAYS
-    ArrayXi arrayxi1 = arraytype_to_arrayxi(a1);
-    ArrayXi arrayxi2 = arraytype_to_arrayxi(a2);
+    return tversky_similarity(arrayxi_binary_counts(a1, a2), 
+                              arrayxi_tversky_alpha, arrayxi_tversky_beta);
+}
 
-    // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
-    EigenBaseEqSize(arrayxi1,arrayxi2);
+// RETURNS THE GIVEN BINARY SIMILARITY METRIC
+extern "C"
+double ArrayXiSimilarity(ArrayType *a1, ArrayType *a2, ArrayXiMetric metric)
+{
+    return binary_similarity(arrayxi_binary_counts(a1, a2), metric);
+}
+
+// RETURNS THE GIVEN BINARY SIMILARITY METRIC BETWEEN THE CACHED QUERY AND THE 
+// ARRAY; THE NUMBER OF NON-ZERO ELEMENTS OF THE QUERY IS NOT COUNTED AGAIN
+extern "C"
+double ArrayXiQuerySimilarity(QueryCache *query, ArrayType *array, ArrayXiMetric metric)
+{
+    QueryCountsKernel kernel(query->count, query->argno == 0);
+    
+    return binary_similarity(arraytype_apply<ArrayXi>(query->array, array, kernel), metric);
+}
 
-    // SET COUNTS ON THE INDIVIDUAL ARRAYS
-    unsigned int A = arrayxi1.count();
-    unsigned int B = arrayxi2.count();
+// RETURNS THE GIVEN BINARY SIMILARITY METRIC BETWEEN THE CACHED QUERY AND THE
+// ARRAY, OR -1 AS SOON AS THE COUNTS SHOW THAT IT STAYS BELOW THE LIMIT
+extern "C"
+double ArrayXiQuerySimilarityLimit(QueryCache *query, ArrayType *array, ArrayXiMetric metric, double limit)
+{
+    QueryLimitKernel kernel(query->count, query->argno == 0, metric, limit);
 
-    // COMMON COUNTS
-    unsigned int c = intersect_size(arrayxi1,arrayxi2);
+    return arraytype_apply<ArrayXi>(query->array, array, kernel);
+}
 
-    // AVOID DIVISION BY ZERO
-    if (A != 0 && B != 0) 
-    {
-        similarity = c / (double) (arrayxi_tversky_alpha * A + 
-                                  arrayxi_tversky_beta * B + 
-                                  (1 - arrayxi_tversky_alpha - arrayxi_tversky_beta) * c);
-    }
-        
-    return similarity;
+// RETURNS THE GIVEN BINARY SIMILARITY METRIC BETWEEN THE QUERY AND EVERY ROW OF
+// THE TARGETS
+extern "C"
+ArrayType *ArrayXiSimilarityMany(ArrayType *query, ArrayType *targets, ArrayXiMetric metric)
+{
+    BinarySimilarityKernel kernel(ArrayXiNonZeros(query), metric);
+    
+    return arraytype_apply_rows<ArrayXi>(query, targets, kernel);
 }
 
 ////////////////////////////////QUANTITATIVE/NON-BINARY METRICS///////////////////////////////
@@ -583,88 +754,20 @@ double ArrayXiTversky(ArrayType *a1, ArrayType *a2)
 extern "C"
 double ArrayXiTanimotoNB(ArrayType *a1, ArrayType *a2)
 {
-    double similarity = 0.0;
-    
-    // MAP DATA TO EIGEN ARRAYS
-    ArrayXi arrayxi1 = arraytype_to_arrayxi(a1);
-    ArrayXi arrayxi2 = arraytype_to_arrayxi(a2);
-
-    // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
-    EigenBaseEqSize(arrayxi1,arrayxi2);
-    
-    ArrayXi arrayxi1_sq = arrayxi1 * arrayxi1;
-    ArrayXi arrayxi2_sq = arrayxi2 * arrayxi2;
-    ArrayXi arrayxiC_sq = arrayxi1 * arrayxi2;
-
-    unsigned int A = arrayxi1_sq.sum();
-    unsigned int B = arrayxi2_sq.sum();
-
-    unsigned int c = arrayxiC_sq.sum();
-
-    // AVOID DIVISION BY ZERO
-    if (A != 0 && B != 0) similarity = c / (double) (A + B - c);
-
-    return similarity;
+    return tanimoto_similarity(arraytype_apply<ArrayXi>(a1, a2, InnerProductsKernel()));
 }
 
 // RETURNS THE DICE SIMILARITY
 extern "C"
 double ArrayXiDiceNB(ArrayType *a1, ArrayType *a2)
 {
-    double similarity = 0.0;
-    
-    // MAP DATA TO EIGEN ARRAYS
-    ArrayXi arrayxi1 = arraytype_to_arrayxi(a1);
-    ArrayXi arrayxi2 = arraytype_to_arrayxi(a2);
-    
-    // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
-    EigenBaseEqSize(arrayxi1,arrayxi2);
-    
-    // MAP DATA TO EIGEN ARRAYS
-    ArrayXi arrayxi1_sq = arrayxi1 * arrayxi1;
-    ArrayXi arrayxi2_sq = arrayxi2 * arrayxi2;
-    ArrayXi arrayxiC_sq = arrayxi1 * arrayxi2;
-    
-    // SET COUNTS ON THE INDIVIDUAL ARRAYS
-    unsigned int A = arrayxi1_sq.sum();
-    unsigned int B = arrayxi2_sq.sum();
-
-    // COMMON COUNTS
-    unsigned int c = arrayxiC_sq.sum();
-
-    if (A != 0 && B != 0) similarity = 2 * c / (double) (A+B);
-    
-    return similarity;
+    return dice_similarity(arraytype_apply<ArrayXi>(a1, a2, InnerProductsKernel()));
 }
 
 extern "C"
 double ArrayXiCosineNB(ArrayType *a1, ArrayType *a2)
 {
-    double similarity = 0.0;
-    
-    // MAP DATA TO EIGEN ARRAYS
-    ArrayXi arrayxi1 = arraytype_to_arrayxi(a1);
-    ArrayXi arrayxi2 = arraytype_to_arrayxi(a2);
-    
-    // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
-    EigenBaseEqSize(arrayxi1,arrayxi2);    
-    
-    // MAP DATA TO EIGEN ARRAYS
-    ArrayXi arrayxi1_sq = arrayxi1 * arrayxi1;
-    ArrayXi arrayxi2_sq = arrayxi2 * arrayxi2;
-    ArrayXi arrayxiC_sq = arrayxi1 * arrayxi2;
-
-    // SET COUNTS ON THE INDIVIDUAL ARRAYS
-    unsigned int A = arrayxi1_sq.sum();
-    unsigned int B = arrayxi2_sq.sum();
-
-    // COMMON COUNTS
-    unsigned int c = arrayxiC_sq.sum();
-
-    // AVOID DIVISION BY ZERO
-    if (A != 0 && B != 0) similarity = c / sqrt(A*B);
-    
-    return similarity;
+    return ochiai_similarity(arraytype_apply<ArrayXi>(a1, a2, InnerProductsKernel()));
 }
 
 
@@ -675,46 +778,21 @@ double ArrayXiCosineNB(ArrayType *a1, ArrayType *a2)
 extern "C"
 double ArrayXiEuclideanDist(ArrayType *a1, ArrayType *a2)
 {
-    // MAP DATA TO EIGEN ARRAYS
-    ArrayXi arrayxi1 = arraytype_to_arrayxi(a1);
-    ArrayXi arrayxi2 = arraytype_to_arrayxi(a2);
-
-    // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
-    EigenBaseEqSize(arrayxi1,arrayxi2);
-
-    return sqrt((arrayxi1-arrayxi2).square().sum());
+    return arraytype_apply<ArrayXi>(a1, a2, EuclideanDistKernel());
 }
 
 // RETURNS THE MANHATTAN DISTANCE BETWEEN BOTH ARRAYS
 extern "C"
 double ArrayXiManhattanDist(ArrayType *a1, ArrayType *a2)
 {
-    // MAP DATA TO EIGEN ARRAYS
-    ArrayXi arrayxi1 = arraytype_to_arrayxi(a1);
-    ArrayXi arrayxi2 = arraytype_to_arrayxi(a2);
-
-    // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
-    EigenBaseEqSize(arrayxi1,arrayxi2);
-
-    return (arrayxi1-arrayxi2).abs().sum();
+    return arraytype_apply<ArrayXi>(a1, a2, ManhattanDistKernel());
 }
 
 // RETURNS THE MEAN HAMMING DISTANCE
 extern "C"
 double ArrayXiMeanHammingDist(ArrayType *a1, ArrayType *a2)
 {
-    // MAP DATA TO EIGEN ARRAYS
-    ArrayXi arrayxi1 = arraytype_to_arrayxi(a1);
-    ArrayXi arrayxi2 = arraytype_to_arrayxi(a2);
-
-    // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
-    EigenBaseEqSize(arrayxi1,arrayxi2);
-
-    // UNIQUE COUNTS IN BOTH ARRAYS
-    unsigned int a = unique_left_size(arrayxi1,arrayxi2);
-    unsigned int b = unique_right_size(arrayxi1,arrayxi2);
-    
-    return (a + b) / (double) arrayxi1.size();
+    return arraytype_apply<ArrayXi>(a1, a2, MeanHammingDistKernel());
 }
 
 
@@ -725,105 +803,52 @@ double ArrayXiMeanHammingDist(ArrayType *a1, ArrayType *a2)
 extern "C"
 double ArrayXiFuzCavSimGlobal(ArrayType *a1, ArrayType *a2)
 {
-    // MAP DATA TO EIGEN ARRAYS
-    ArrayXi arrayxi1 = arraytype_to_arrayxi(a1);
-    ArrayXi arrayxi2 = arraytype_to_arrayxi(a2);
-
-    // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
-    EigenBaseEqSize(arrayxi1,arrayxi2);
-
     // COUNTS THAT ARE SHARED BETWEEN THE FUZCAV FINGERPRINTS
-    unsigned int c = intersect_size(arrayxi1,arrayxi2);
-
-    return (c / (double) std::max(arrayxi1.count(), arrayxi2.count()));
+    return fuzcav_similarity(arrayxi_binary_counts(a1, a2));
 }
 
-/* Returns the maximum possible similarity value between two arrays for a given 
- * metric. This is necessary to calculate similarity values for inner gist nodes, 
- * which are not real fingerprints.
+/* Returns the maximum possible similarity value between a query and any array
+ * below a GiST key for a given metric. This is necessary to calculate similarity
+ * values for inner gist nodes, which are not real fingerprints but the union of
+ * all the fingerprints below them.
  * 
  * From: Swamidass SJ, Baldi P. Bounds and algorithms for fast exact searches of 
  *       chemical fingerprints in linear and sublinear time.    
  *       j chem inf model. 2007 mar-apr;47(2):302-17 
  * 
  * Where:
- *        a is the count of values > 0 in array A but not in array B.
- *        b is the count of values > 0 in array B but not in array A.
- *        c is the count of equal position in both array A and array B.
- *        d is the count of the zeros in both array A and array B.
- *      
- *        In addition:
- * 
- *        n = ( a + b + c + d ) total number of positions in arrays A or B.
- *        A = ( a + c ) the count of the values > 0 in object A.
- *        B = ( b + c ) the count of the values > 0 in object B.
+ *        A is the count of values > 0 in the arrays below the key; only its
+ *          range [minA, maxA] is known.
+ *        B is the count of values > 0 in the query.
+ *        c is the count of positions set in both the key and the query, which
+ *          is an upper bound of the intersection of any array below the key.
+ *        n is the total number of positions.
+ *
+ * All metrics except the Euclidean and Manhattan ones increase with c and 
+ * decrease with A, so the maximum is reached by an array that is as small as
+ * possible while sharing as many positions as possible with the query. The 
+ * Euclidean and Manhattan metrics are largest for the largest array without any
+ * shared positions.
  */
 extern "C"
-float SimilarityUpperBound(ArrayType *a1, ArrayType *a2, char *metric)
+double SimilarityUpperBound(ArrayXiBounds *bounds, ArrayXiMetric metric)
 {
-    float upper_bound = 0.0;
-    
-    // MAP DATA TO EIGEN ARRAYS
-    ArrayXi arrayxi1 = arraytype_to_arrayxi(a1);
-    ArrayXi arrayxi2 = arraytype_to_arrayxi(a2);
+    BinaryCounts counts;
 
-    // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
-    EigenBaseEqSize(arrayxi1,arrayxi2);
-    
-    // QUERY ARRAY HAS TO BE CONVERTED TO BINARY VERSION TO BE COMPATIBLE WITH
-    // THE GIST INTERNAL NODES
-    unsigned int c = intersect_size(arrayxi1, (arrayxi2 > 0).cast<int>());
-    unsigned int A = arrayxi1.count();
-    unsigned int B = arrayxi2.count();
-    
-    // IN GIST CONTEXT, A1 IS KEY A2 IS QUERY
+    counts.B = bounds->B;
+    counts.d = 0;
+    counts.n = bounds->n;
 
-    if (strcmp(metric,"dice") == 0) 
-    {
-        upper_bound = 2 * c / (float) B;
-    }
-    
-    else if (strcmp(metric,"euclidean") == 0) 
-    {
-        upper_bound = sqrt((B - 2 * c) / (float) arrayxi1.size());
-    }
-    
-    else if (strcmp(metric,"kulczynski") == 0) 
-    {
-        upper_bound = A + B / (float) (2 * std::max(A,B));
-    }
-    
-    else if (strcmp(metric,"manhattan") == 0) 
-    {
-        upper_bound = (B - 2 * c) / (float) arrayxi1.size();
-    }
-    
-    else if (strcmp(metric,"ochiai") == 0) 
+    if (metric == ARRAYXI_EUCLIDEAN || metric == ARRAYXI_MANHATTAN)
     {
-        upper_bound = c / sqrt(B);
+        counts.A = bounds->maxA;
+        counts.c = 0;
     }
-    
-    else if (strcmp(metric,"russell-rao") == 0) 
+    else
     {
-        upper_bound = B / (float) arrayxi1.size();
+        counts.A = std::min(std::max(bounds->c, bounds->minA), bounds->maxA);
+        counts.c = std::min(bounds->c, counts.A);
     }
-    
-    // NO REDUCTION OF SEARCH SPACE HERE
-    else if (strcmp(metric,"simpson") == 0) 
-    {
-        upper_bound = c / (float) std::min(A,B);
-    }
-    
-    else if (strcmp(metric,"tversky") == 0) 
-    {
-        upper_bound = c / (arrayxi_tversky_beta * B);
-    }
-    
-    else 
-    {
-        ereport(ERROR, (errcode(ERRCODE_DATA_EXCEPTION), 
-                        errmsg("unknown metric for similarity upper bound calculation: %s", metric)));
-    }
-    
-    return upper_bound;
+
+    return binary_similarity(counts, metric);
 }
\ No newline at end of file
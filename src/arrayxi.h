@@ -1,3 +1,6 @@
+#ifndef ARRAYXI_H
+#define ARRAYXI_H
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -5,24 +8,53 @@ extern "C"
 
     #include "postgres.h"
     #include "utils/array.h"
+    #include "querycache.h"
 
     #define PG_GETARG_TEXT_AS_CSTRING(x)    (text_to_cstring(PG_GETARG_TEXT_PP(x)))
     
     // ARRAYXI SIMILARITY METRICS DEFAULT VALUES
-    extern float4 arrayxi_dice_limit;
-    extern float4 arrayxi_euclidean_limit;
-    extern float4 arrayxi_kulcz_limit;
-    extern float4 arrayxi_manhattan_limit;
-    extern float4 arrayxi_ochiai_limit;
-    extern float4 arrayxi_russell_rao_limit;
-    extern float4 arrayxi_simpson_limit;
-    extern float4 arrayxi_tversky_limit;
-    extern float4 arrayxi_tversky_alpha;
-    extern float4 arrayxi_tversky_beta;
+    extern double arrayxi_dice_limit;
+    extern double arrayxi_euclidean_limit;
+    extern double arrayxi_kulcz_limit;
+    extern double arrayxi_manhattan_limit;
+    extern double arrayxi_ochiai_limit;
+    extern double arrayxi_russell_rao_limit;
+    extern double arrayxi_simpson_limit;
+    extern double arrayxi_tanimoto_limit;
+    extern double arrayxi_tversky_limit;
+    extern double arrayxi_tversky_alpha;
+    extern double arrayxi_tversky_beta;
+    
+    // BINARY SIMILARITY METRICS THAT CAN BE CALCULATED AGAINST A CACHED QUERY
+    typedef enum
+    {
+        ARRAYXI_DICE,
+        ARRAYXI_EUCLIDEAN,
+        ARRAYXI_KULCZYNSKI,
+        ARRAYXI_MANHATTAN,
+        ARRAYXI_OCHIAI,
+        ARRAYXI_RUSSELL_RAO,
+        ARRAYXI_SIMPSON,
+        ARRAYXI_SIMPSON_GLOBAL,
+        ARRAYXI_TANIMOTO,
+        ARRAYXI_TVERSKY,
+        ARRAYXI_FUZCAV
+    } ArrayXiMetric;
+    
+    // COUNTS OF A GIST KEY AGAINST A QUERY FOR THE SIMILARITY UPPER BOUNDS
+    typedef struct
+    {
+        unsigned int minA;
+        unsigned int maxA;
+        unsigned int B;
+        unsigned int c;
+        unsigned int n;
+    } ArrayXiBounds;
     
     // ARRAY PROPERTIES
     int        ArrayXiSize(ArrayType *array);
     int        ArrayXiNonZeros(ArrayType *array);
+    ArrayType *ArrayXiPositions(ArrayType *array);
     int        ArrayXiMinCoeff(ArrayType *array);
     int        ArrayXiMinCoeff(ArrayType *array);
     long       ArrayXiSum(ArrayType *array);
@@ -48,6 +80,9 @@ extern "C"
 
     // SET ALGEBRA
     bool       ArrayXiEqual(ArrayType *a1, ArrayType *a2);
+    uint32     ArrayXiHash(ArrayType *array);
+    int        ArrayXiCmp(ArrayType *a1, ArrayType *a2);
+    uint64     ArrayXiSortKey(ArrayType *array);
     bool       ArrayXiContains(ArrayType *a1, ArrayType *a2);
     bool       ArrayXiOverlaps(ArrayType *a1, ArrayType *a2);
     ArrayType *ArrayXiIntersection(ArrayType *a1, ArrayType *a2);
@@ -67,7 +102,27 @@ extern "C"
     double     ArrayXiTanimoto(ArrayType *a1, ArrayType *a2);
     double     ArrayXiTversky(ArrayType *a1, ArrayType *a2);
 
-    float      SimilarityUpperBound(ArrayType *a1, ArrayType *a2, char *metric);
+    double     ArrayXiSimilarity(ArrayType *a1, ArrayType *a2, ArrayXiMetric metric);
+    double     ArrayXiQuerySimilarity(QueryCache *query, ArrayType *array, ArrayXiMetric metric);
+    double     ArrayXiQuerySimilarityLimit(QueryCache *query, ArrayType *array, ArrayXiMetric metric, double limit);
+    ArrayType *ArrayXiSimilarityMany(ArrayType *query, ArrayType *targets, ArrayXiMetric metric);
+
+    double     SimilarityUpperBound(ArrayXiBounds *bounds, ArrayXiMetric metric);
+
+    // METRIC OF A TOP-K OR THRESHOLD SEARCH BY NAME, E.G. 'tanimoto'
+    ArrayXiMetric arrayxi_ranking_metric(const char *name);
+
+    // REJECTS INTEGER[] VALUES THAT ARE NOT VALID ARRAYXI, I.E. NOT ONE-DIMENSIONAL
+    // OR WITH NULL ELEMENTS; ONLY THE ARRAYXI DOMAIN CHECKS THIS ITSELF
+    void       arrayxi_check_array(ArrayType *array);
+
+    // RANGE OF NON-ZERO COUNTS THAT CAN REACH THE LIMIT OF A THRESHOLD FUNCTION
+    bool       arrayxi_threshold_nonzeros_bounds(const char *function, ArrayType *query, int *min, int *max);
+
+    // PLANNER SUPPORT OF THE THRESHOLD OPERATORS, POSTGRESQL 12 OR LATER
+    struct SupportRequestSimplify;
+    struct Node *arrayxi_partition_simplify(struct SupportRequestSimplify *req);
+    void       arrayxi_partition_init(void);
     
     // FUZCAV METRIC
     double     ArrayXiFuzCavSimGlobal(ArrayType *a1, ArrayType *a2);
@@ -86,3 +141,5 @@ extern "C"
 #ifdef __cplusplus
 }
 #endif
+
+#endif
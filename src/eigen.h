@@ -5,6 +5,7 @@ extern "C"
 
     #include "postgres.h"
     #include "utils/array.h"
+    #include "utils/memutils.h"
     #include "catalog/pg_type.h"
 
 #ifdef __cplusplus
@@ -21,6 +22,16 @@ using namespace Eigen;
 // Arrays are stored in a RowMajor manner by PostgreSQL
 typedef Matrix<double, Dynamic, Dynamic, RowMajor> MatrixRowMajorXd;
 
+// READ-ONLY VIEWS ON THE DATA OF POSTGRESQL ARRAYS: THE COEFFICIENTS ARE NEVER
+// COPIED INTO EIGEN-OWNED MEMORY
+typedef Map<const ArrayXi>          ArrayXiMap;
+typedef Map<const ArrayXd>          ArrayXdMap;
+typedef Map<const MatrixRowMajorXd> MatrixXdMap;
+typedef Map<const RowVector3d>      Vector3dMap;
+
+// DATA POINTERS HAVE TO BE ALIGNED TO THIS BOUNDARY TO USE THE ALIGNED MAPS
+#define PG_EIGEN_ALIGNMENT 16
+
 /////////////////////POSTGRESQL ARRAYTYPE FUNCTIONS/////////////////////////////
 
 
@@ -48,6 +59,96 @@ inline int arraytype_dim_num_elems(int dim, int *dmns, int *lbds)
     return dmns[dim - 1] + lbds[dim - 1] - 1;
 }
 
+// RETURNS TRUE IF THE DATA OF THE ARRAY STARTS ON A PACKET BOUNDARY
+inline bool arraytype_is_aligned(ArrayType *array)
+{
+    return ((size_t) ARR_DATA_PTR(array) % PG_EIGEN_ALIGNMENT) == 0;
+}
+
+
+/////////////////////POSTGRESQL ARRAYTYPE TO EIGEN VIEWS////////////////////////
+
+
+// MAPS A POSTGRESQL ARRAY ONTO A READ-ONLY EIGEN ARRAYXI
+inline ArrayXiMap arraytype_to_arrayxi(ArrayType *array)
+{
+    return ArrayXiMap((const int *) ARR_DATA_PTR(array), arraytype_num_elems(array));
+}
+
+// MAPS A POSTGRESQL ARRAY ONTO A READ-ONLY EIGEN ARRAYXD
+inline ArrayXdMap arraytype_to_arrayxd(ArrayType *array)
+{
+    return ArrayXdMap((const double *) ARR_DATA_PTR(array), arraytype_num_elems(array));
+}
+
+// MAPS A POSTGRESQL ARRAY ONTO A READ-ONLY ROW-MAJOR EIGEN MATRIX OF DOUBLES.
+// ONE-DIMENSIONAL ARRAYS ARE TREATED AS MATRICES WITH A SINGLE ROW
+inline MatrixXdMap arraytype_to_matrixxd(ArrayType *array)
+{
+    int rows = 0, cols = 0;
+
+    // CHECK IF ARRAY IS NOT EMPTY
+    if (!arraytype_is_empty(array))
+    {
+        int *dmns = ARR_DIMS(array);
+        int *lbds = ARR_LBOUND(array);
+
+        if (ARR_NDIM(array) == 1)
+        {
+            rows = 1;
+            cols = arraytype_dim_num_elems(1, dmns, lbds);
+        }
+
+        else
+        {
+            // EXTRACT THE MATRIX DIMENSIONS FROM THE POSTGRESQL ARRAYTYPE
+            rows = arraytype_dim_num_elems(1, dmns, lbds);
+            cols = arraytype_dim_num_elems(2, dmns, lbds);
+        }
+    }
+
+    return MatrixXdMap((const double *) ARR_DATA_PTR(array), rows, cols);
+}
+
+// MAPS A POSTGRESQL ARRAY ONTO A READ-ONLY EIGEN VECTOR3D
+inline Vector3dMap arraytype_to_vector3d(ArrayType *array)
+{
+    return Vector3dMap((const double *) ARR_DATA_PTR(array));
+}
+
+// CALLS THE KERNEL WITH READ-ONLY VIEWS ON TWO ONE-DIMENSIONAL ARRAYS OF THE SAME
+// SIZE AND RETURNS ITS RESULT. IF THE DATA OF BOTH ARRAYS STARTS ON A PACKET
+// BOUNDARY, ALIGNED MAPS ARE USED SO THAT THE VECTORIZED LOOPS OF EIGEN DO NOT
+// HAVE TO PEEL OFF UNALIGNED COEFFICIENTS FIRST.
+// THE KERNEL IS A FUNCTOR WITH A RESULT TYPEDEF AND A TEMPLATED CALL OPERATOR
+// THAT TAKES TWO ARRAYBASE OBJECTS
+template<typename PlainObject, typename Kernel>
+inline typename Kernel::Result arraytype_apply(ArrayType *a1, ArrayType *a2, const Kernel &kernel)
+{
+    typedef typename PlainObject::Scalar Scalar;
+
+    const Scalar *data1 = (const Scalar *) ARR_DATA_PTR(a1);
+    const Scalar *data2 = (const Scalar *) ARR_DATA_PTR(a2);
+
+    Index size1 = arraytype_num_elems(a1);
+    Index size2 = arraytype_num_elems(a2);
+
+    // CHECK IF ARRAYS HAVE THE SAME NUMBER OF COEFFICIENTS
+    if (size1 != size2)
+    {
+        ereport(ERROR, (errcode(ERRCODE_DATA_EXCEPTION),
+                        errmsg("eigen objects must have the same number of coefficients.")));
+    }
+
+    if (arraytype_is_aligned(a1) && arraytype_is_aligned(a2))
+    {
+        return kernel(Map<const PlainObject, Aligned16>(data1, size1),
+                      Map<const PlainObject, Aligned16>(data2, size2));
+    }
+
+    return kernel(Map<const PlainObject>(data1, size1), Map<const PlainObject>(data2, size2));
+}
+
 // CHECKS IF EIGEN OBJECTS HAVE THE SAME NUMBER OF COEFFICIENTS
 template<typename Derived1, typename Derived2>
 inline void EigenBaseEqSize(const DenseBase<Derived1>& d1, const DenseBase<Derived2>& d2)
@@ -59,76 +160,220 @@ inline void EigenBaseEqSize(const DenseBase<Derived1>& d1, const DenseBase<Deriv
     }
 }
 
-// CONSTRUCTS A POSTGRESQL ARRAY FROM AN EIGEN DENSEBASE
-template<typename Derived>
-ArrayType *densebase_to_float8_arraytype(const DenseBase<Derived> &densebase)
+/////////////////////EIGEN EXPRESSIONS TO POSTGRESQL ARRAYTYPE///////////////////
+
+
+// ELEMENT TYPE INFORMATION OF THE POSTGRESQL ARRAYS THAT CAN BE CONSTRUCTED
+template<typename Scalar> struct arraytype_element;
+template<> struct arraytype_element<double> { static const Oid oid = FLOAT8OID; };
+template<> struct arraytype_element<int>    { static const Oid oid = INT4OID; };
+
+// ALLOCATES A POSTGRESQL ARRAY WITH THE GIVEN SHAPE WHOSE COEFFICIENTS STILL HAVE
+// TO BE WRITTEN TO ARR_DATA_PTR. TWO-DIMENSIONAL ARRAYS ARE STORED ROW-MAJOR
+template<typename Scalar>
+ArrayType *arraytype_alloc(int ndims, Index rows, Index cols)
 {
-    // NUMBER OF DIMENSIONS: IF MORE THAN ONE COLUMN THAN 2
-    int ndims = densebase.rows() > 1 ? 2 : 1;
-    
     // LOWER AND UPPER BOUNDS OF DIMENSIONS
-    int lbs[ndims], dims[ndims];
+    int lbs[2] = {1, 1}, dims[2];
     
-    // LOWER BOUNDS ALWAYS START AT ONE
-    std::fill_n(lbs, ndims, 1);
+    if (ndims == 1) dims[0] = rows * cols;
     
-    // SET THE UPPER BOUNDS OF THE ARRAY DIMENSIONS
-    if (ndims==1) dims[0] = densebase.size();
-
     else
     {
-        dims[0] = densebase.rows();
-        dims[1] = densebase.cols();
+        dims[0] = rows;
+        dims[1] = cols;
     }
     
-    Datum *datums = (Datum *) palloc(sizeof(Datum) * densebase.size());
+    Size overhead = ARR_OVERHEAD_NONULLS(ndims);
+    Size nbytes = overhead + (Size) rows * cols * sizeof(Scalar);
     
-    // THE STORAGE ORDER OF EIGEN OBJECTS DOES NOT NECESSARILY CORRESPOND
-    // TO THE ACTUAL ORDER OF COEFFICIENTS
-    for (int row = 0; row < densebase.rows(); row++)
+    if (!AllocSizeIsValid(nbytes))
     {
-        for (int col = 0; col < densebase.cols(); col++) 
-        {
-            datums[row*densebase.cols() + col] = Float8GetDatum(densebase(row,col));
-        }
+        ereport(ERROR, (errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED), 
+                        errmsg("array size exceeds the maximum allowed (%d)", (int) MaxAllocSize)));
     }
     
-    return construct_md_array(datums, NULL, ndims, dims, lbs, FLOAT8OID, 8, true, 'd');
+    ArrayType *array = (ArrayType *) palloc(nbytes);
+    
+    // ONLY THE HEADER IS ZEROED, INCLUDING THE PADDING IN FRONT OF THE DATA
+    memset(array, 0, overhead);
+    
+    SET_VARSIZE(array, nbytes);
+    array->ndim = ndims;
+    array->dataoffset = 0;
+    array->elemtype = arraytype_element<Scalar>::oid;
+    
+    memcpy(ARR_DIMS(array), dims, ndims * sizeof(int));
+    memcpy(ARR_LBOUND(array), lbs, ndims * sizeof(int));
+    
+    return array;
 }
 
-// CONSTRUCTS A POSTGRESQL ARRAY FROM AN EIGEN DENSEBASE
-template<typename Derived>
-ArrayType *densebase_to_int32_arraytype(const DenseBase<Derived> &densebase)
+// CONSTRUCTS A ONE-DIMENSIONAL POSTGRESQL ARRAY BY EVALUATING THE EIGEN ARRAY
+// EXPRESSION DIRECTLY INTO THE DATA OF THE NEW ARRAY
+template<typename Scalar, typename Derived>
+ArrayType *arraybase_to_arraytype(const ArrayBase<Derived> &arraybase)
 {
-    // NUMBER OF DIMENSIONS: IF MORE THAN ONE COLUMN THAN 2
-    int ndims = densebase.rows() > 1 ? 1 : 2;
+    if (arraybase.size() == 0) return construct_empty_array(arraytype_element<Scalar>::oid);
     
-    // LOWER AND UPPER BOUNDS OF DIMENSIONS
-    int lbs[ndims], dims[ndims];
+    ArrayType *array = arraytype_alloc<Scalar>(1, arraybase.rows(), arraybase.cols());
+    
+    // EIGEN ARRAYS ARE VECTORS, THE STORAGE ORDER ONLY MATTERS FOR THE SHAPE
+    Map<Array<Scalar, Dynamic, Dynamic, RowMajor> > data((Scalar *) ARR_DATA_PTR(array), 
+                                                        arraybase.rows(), arraybase.cols());
     
-    // LOWER BOUNDS ALWAYS START AT ONE
-    std::fill_n(lbs, ndims, 1); // memset(lbs, 1, ndims);
+    data = arraybase.template cast<Scalar>();
     
-    // SET THE UPPER BOUNDS OF THE ARRAY DIMENSIONS
-    if (ndims==1) dims[0] = densebase.size();
+    return array;
+}
 
-    else
+// CONSTRUCTS A POSTGRESQL ARRAY BY EVALUATING THE EIGEN MATRIX EXPRESSION 
+// DIRECTLY INTO THE DATA OF THE NEW ARRAY: TWO-DIMENSIONAL IF THE MATRIX HAS MORE
+// THAN ONE ROW, ONE-DIMENSIONAL OTHERWISE
+template<typename Scalar, typename Derived>
+ArrayType *matrixbase_to_arraytype(const MatrixBase<Derived> &matrixbase)
+{
+    if (matrixbase.size() == 0) return construct_empty_array(arraytype_element<Scalar>::oid);
+    
+    int ndims = matrixbase.rows() > 1 ? 2 : 1;
+    
+    ArrayType *array = arraytype_alloc<Scalar>(ndims, matrixbase.rows(), matrixbase.cols());
+    
+    // POSTGRESQL STORES THE COEFFICIENTS IN ROW-MAJOR ORDER; THE MAP TAKES CARE
+    // OF THE STORAGE ORDER OF THE EXPRESSION. THE TARGET IS FRESHLY ALLOCATED 
+    // MEMORY SO PRODUCTS CAN BE EVALUATED WITHOUT A TEMPORARY
+    Map<Matrix<Scalar, Dynamic, Dynamic, RowMajor> > data((Scalar *) ARR_DATA_PTR(array), 
+                                                         matrixbase.rows(), matrixbase.cols());
+    
+    data.noalias() = matrixbase.template cast<Scalar>();
+    
+    return array;
+}
+
+// CONSTRUCTS A POSTGRESQL ARRAY OF DOUBLES FROM AN EIGEN ARRAY EXPRESSION
+template<typename Derived>
+inline ArrayType *densebase_to_float8_arraytype(const ArrayBase<Derived> &arraybase)
+{
+    return arraybase_to_arraytype<double>(arraybase);
+}
+
+// CONSTRUCTS A POSTGRESQL ARRAY OF DOUBLES FROM AN EIGEN MATRIX EXPRESSION
+template<typename Derived>
+inline ArrayType *densebase_to_float8_arraytype(const MatrixBase<Derived> &matrixbase)
+{
+    return matrixbase_to_arraytype<double>(matrixbase);
+}
+
+// CONSTRUCTS A POSTGRESQL ARRAY OF INTEGERS FROM AN EIGEN ARRAY EXPRESSION
+template<typename Derived>
+inline ArrayType *densebase_to_int32_arraytype(const ArrayBase<Derived> &arraybase)
+{
+    return arraybase_to_arraytype<int>(arraybase);
+}
+
+// CONSTRUCTS A POSTGRESQL ARRAY OF INTEGERS FROM AN EIGEN MATRIX EXPRESSION
+template<typename Derived>
+inline ArrayType *densebase_to_int32_arraytype(const MatrixBase<Derived> &matrixbase)
+{
+    return matrixbase_to_arraytype<int>(matrixbase);
+}
+
+// CALLS THE KERNEL WITH THE QUERY AND EVERY ROW OF THE TARGET MATRIX AND RETURNS
+// THE RESULTS AS ONE-DIMENSIONAL ARRAY OF DOUBLES. A ONE-DIMENSIONAL TARGET ARRAY
+// IS A SINGLE ROW. THE ROWS ARE CONTIGUOUS IN MEMORY, SO THE LOOP STREAMS THROUGH
+// THE TARGETS AND THE NEXT ROW IS PREFETCHED WHILE THE CURRENT ONE IS PROCESSED
+template<typename PlainObject, typename Kernel>
+ArrayType *arraytype_apply_rows(ArrayType *query, ArrayType *targets, const Kernel &kernel)
+{
+    typedef typename PlainObject::Scalar Scalar;
+
+    if (ARR_NDIM(targets) > 2 || ARR_HASNULL(targets))
     {
-        dims[0] = densebase.rows();
-        dims[1] = densebase.cols();
+        ereport(ERROR, (errcode(ERRCODE_DATA_EXCEPTION),
+                        errmsg("targets must be a one- or two-dimensional array without null elements.")));
     }
 
-    Datum *datums = (Datum *) palloc(sizeof(Datum) * densebase.size());
-    
-    // THE STORAGE ORDER OF EIGEN OBJECTS DOES NOT NECESSARILY CORRESPOND
-    // TO THE ACTUAL ORDER OF COEFFICIENTS
-    for (int row = 0; row < densebase.rows(); row++)
+    if (arraytype_is_empty(targets)) return construct_empty_array(FLOAT8OID);
+
+    Index size = arraytype_num_elems(query);
+    Index cols = ARR_DIMS(targets)[ARR_NDIM(targets) - 1];
+    Index rows = arraytype_num_elems(targets) / cols;
+
+    if (cols != size)
     {
-        for (int col = 0; col < densebase.cols(); col++) 
+        ereport(ERROR, (errcode(ERRCODE_DATA_EXCEPTION),
+                        errmsg("eigen objects must have the same number of coefficients.")));
+    }
+
+    Map<const PlainObject> map((const Scalar *) ARR_DATA_PTR(query), size);
+    const Scalar *data = (const Scalar *) ARR_DATA_PTR(targets);
+
+    ArrayType *array = arraytype_alloc<double>(1, 1, rows);
+    double *results = (double *) ARR_DATA_PTR(array);
+
+    for (Index row = 0; row < rows; row++)
+    {
+        if (row + 1 < rows) __builtin_prefetch(data + (row + 1) * cols);
+
+        results[row] = kernel(map, Map<const PlainObject>(data + row * cols, cols));
+    }
+
+    return array;
+}
+
+//////////////////////////////////////HASHING/////////////////////////////////////
+
+
+// NUMBER OF INDEPENDENT LANES OF THE WORD HASH; WITH -msse4.2 OR -march=native
+// THE LOOP OVER THE LANES BECOMES ONE OR TWO SIMD MULTIPLICATIONS
+#define PG_EIGEN_HASH_LANES 8
+
+inline uint32 hash_rotl32(uint32 x, int r)
+{
+    return (x << r) | (x >> (32 - r));
+}
+
+/* Hashes 32-bit words for the hash operator classes. Every lane is a
+ * MurmurHash3 stream over every eighth word, so that the lanes do not depend
+ * on each other and can be computed side by side; the lanes and the number of
+ * words are combined with the MurmurHash3 finalizer at the end.
+ */
+inline uint32 hash_uint32_words(const uint32 *words, Size nwords)
+{
+    const uint32 c1 = 0xcc9e2d51, c2 = 0x1b873593;
+
+    uint32 lanes[PG_EIGEN_HASH_LANES];
+    Size   i = 0;
+
+    for (int l = 0; l < PG_EIGEN_HASH_LANES; l++) lanes[l] = 0x9e3779b9 * (l + 1);
+
+    for (; i + PG_EIGEN_HASH_LANES <= nwords; i += PG_EIGEN_HASH_LANES)
+    {
+        for (int l = 0; l < PG_EIGEN_HASH_LANES; l++)
         {
-            datums[row*densebase.cols() + col] = Int32GetDatum(densebase(row,col));
+            uint32 k = hash_rotl32(words[i + l] * c1, 15) * c2;
+
+            lanes[l] = hash_rotl32(lanes[l] ^ k, 13) * 5 + 0xe6546b64;
         }
     }
-    
-    return construct_md_array(datums, NULL, ndims, dims, lbs, INT4OID, 4, true, 'i');
-}
\ No newline at end of file
+
+    // THE REMAINING WORDS GO INTO THE FIRST LANES
+    for (int l = 0; i < nwords; i++, l++)
+    {
+        uint32 k = hash_rotl32(words[i] * c1, 15) * c2;
+
+        lanes[l] = hash_rotl32(lanes[l] ^ k, 13) * 5 + 0xe6546b64;
+    }
+
+    uint32 hash = (uint32) nwords;
+
+    for (int l = 0; l < PG_EIGEN_HASH_LANES; l++) hash = hash_rotl32(hash ^ lanes[l], 13) * 5 + 0xe6546b64;
+
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35;
+    hash ^= hash >> 16;
+
+    return hash;
+}
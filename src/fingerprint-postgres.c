@@ -0,0 +1,390 @@
+#include "arrayxi.h"
+#include "fingerprint.h"
+#include "fmgr.h"
+#include "libpq/pqformat.h"
+#include "utils/builtins.h"
+
+
+
+///////////////////////////////INPUT/OUTPUT/////////////////////////////////////
+
+
+// PARSES A FINGERPRINT FROM A STRING OF ZEROS AND ONES
+PG_FUNCTION_INFO_V1(fingerprint_in);
+Datum fingerprint_in(PG_FUNCTION_ARGS)
+{
+    char            *str = PG_GETARG_CSTRING(0);
+    int              nbits = strlen(str);
+    int              i;
+    FingerprintType *fp = FingerprintAlloc(nbits);
+
+    for (i = 0; i < nbits; i++)
+    {
+        if (str[i] == '1') fp->words[i / FINGERPRINT_WORD_BITS] |= UINT64CONST(1) << (i % FINGERPRINT_WORD_BITS);
+
+        else if (str[i] != '0')
+        {
+            ereport(ERROR, (errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
+                            errmsg("invalid input syntax for type fingerprint: \"%s\"", str),
+                            errdetail("\"%c\" is not a valid binary digit.", str[i])));
+        }
+    }
+
+    PG_RETURN_FINGERPRINT_P(fp);
+}
+
+// RETURNS THE FINGERPRINT AS STRING OF ZEROS AND ONES
+PG_FUNCTION_INFO_V1(fingerprint_out);
+Datum fingerprint_out(PG_FUNCTION_ARGS)
+{
+    FingerprintType *fp = PG_GETARG_FINGERPRINT_P(0);
+    char            *str = (char *) palloc(fp->nbits + 1);
+    int              i;
+
+    for (i = 0; i < fp->nbits; i++)
+    {
+        str[i] = (fp->words[i / FINGERPRINT_WORD_BITS] >> (i % FINGERPRINT_WORD_BITS)) & 1 ? '1' : '0';
+    }
+
+    str[fp->nbits] = '\0';
+
+    PG_RETURN_CSTRING(str);
+}
+
+// BINARY INPUT: THE NUMBER OF BITS FOLLOWED BY THE 64-BIT WORDS
+PG_FUNCTION_INFO_V1(fingerprint_recv);
+Datum fingerprint_recv(PG_FUNCTION_ARGS)
+{
+    StringInfo       buf = (StringInfo) PG_GETARG_POINTER(0);
+    int              nbits = pq_getmsgint(buf, 4);
+    int              nwords, i;
+    FingerprintType *fp = FingerprintAlloc(nbits);
+
+    nwords = FINGERPRINT_NWORDS(nbits);
+
+    for (i = 0; i < nwords; i++) fp->words[i] = (uint64) pq_getmsgint64(buf);
+
+    // THE UNUSED BITS OF THE LAST WORD HAVE TO BE ZERO
+    if (nbits % FINGERPRINT_WORD_BITS != 0 &&
+        fp->words[nwords - 1] >> (nbits % FINGERPRINT_WORD_BITS) != 0)
+    {
+        ereport(ERROR, (errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+                        errmsg("invalid external fingerprint value: padding bits are set.")));
+    }
+
+    PG_RETURN_FINGERPRINT_P(fp);
+}
+
+// BINARY OUTPUT
+PG_FUNCTION_INFO_V1(fingerprint_send);
+Datum fingerprint_send(PG_FUNCTION_ARGS)
+{
+    FingerprintType *fp = PG_GETARG_FINGERPRINT_P(0);
+    int              nwords = FINGERPRINT_NWORDS(fp->nbits);
+    int              i;
+    StringInfoData   buf;
+
+    pq_begintypsend(&buf);
+    pq_sendint(&buf, fp->nbits, 4);
+
+    for (i = 0; i < nwords; i++) pq_sendint64(&buf, (int64) fp->words[i]);
+
+    PG_RETURN_BYTEA_P(pq_endtypsend(&buf));
+}
+
+
+//////////////////////////////////CASTS/////////////////////////////////////////
+
+
+// CAST FROM INTEGER[]/ARRAYXI
+PG_FUNCTION_INFO_V1(fingerprint_from_array);
+Datum fingerprint_from_array(PG_FUNCTION_ARGS)
+{
+    ArrayType *array = PG_GETARG_ARRAYTYPE_P(0);
+
+    PG_RETURN_FINGERPRINT_P(FingerprintFromArray(array));
+}
+
+// CAST TO INTEGER[]
+PG_FUNCTION_INFO_V1(fingerprint_to_array);
+Datum fingerprint_to_array(PG_FUNCTION_ARGS)
+{
+    FingerprintType *fp = PG_GETARG_FINGERPRINT_P(0);
+
+    PG_RETURN_ARRAYTYPE_P(FingerprintToArray(fp));
+}
+
+
+///////////////////////////FINGERPRINT PROPERTIES///////////////////////////////
+
+
+// RETURNS THE NUMBER OF BITS IN THE FINGERPRINT
+PG_FUNCTION_INFO_V1(fingerprint_size);
+Datum fingerprint_size(PG_FUNCTION_ARGS)
+{
+    FingerprintType *fp = PG_GETARG_FINGERPRINT_P(0);
+
+    PG_RETURN_INT32(FingerprintSize(fp));
+}
+
+// RETURNS THE NUMBER OF BITS THAT ARE SET
+PG_FUNCTION_INFO_V1(fingerprint_nonzeros);
+Datum fingerprint_nonzeros(PG_FUNCTION_ARGS)
+{
+    FingerprintType *fp = PG_GETARG_FINGERPRINT_P(0);
+
+    PG_RETURN_INT32(FingerprintNonZeros(fp));
+}
+
+
+//////////////////////////////EQUALITY AND HASHING//////////////////////////////
+
+
+// RETURNS TRUE IF BOTH FINGERPRINTS HAVE THE SAME BITS
+PG_FUNCTION_INFO_V1(fingerprint_eq);
+Datum fingerprint_eq(PG_FUNCTION_ARGS)
+{
+    FingerprintType *fp1 = PG_GETARG_FINGERPRINT_P(0);
+    FingerprintType *fp2 = PG_GETARG_FINGERPRINT_P(1);
+
+    PG_RETURN_BOOL(FingerprintEqual(fp1, fp2));
+}
+
+// RETURNS TRUE IF THE FINGERPRINTS ARE DISTINCT
+PG_FUNCTION_INFO_V1(fingerprint_ne);
+Datum fingerprint_ne(PG_FUNCTION_ARGS)
+{
+    FingerprintType *fp1 = PG_GETARG_FINGERPRINT_P(0);
+    FingerprintType *fp2 = PG_GETARG_FINGERPRINT_P(1);
+
+    PG_RETURN_BOOL(FingerprintEqual(fp1, fp2) == false);
+}
+
+// HASH SUPPORT FUNCTION OF THE HASH OPERATOR CLASS
+PG_FUNCTION_INFO_V1(fingerprint_hash);
+Datum fingerprint_hash(PG_FUNCTION_ARGS)
+{
+    FingerprintType *fp = PG_GETARG_FINGERPRINT_P(0);
+
+    PG_RETURN_UINT32(FingerprintHash(fp));
+}
+
+
+///////////////////////NORMALIZED SIMILARITY METRICS////////////////////////////
+
+
+// RETURNS THE DICE SIMILARITY
+PG_FUNCTION_INFO_V1(fingerprint_dice);
+Datum fingerprint_dice(PG_FUNCTION_ARGS)
+{
+    FingerprintType *fp1 = PG_GETARG_FINGERPRINT_P(0);
+    FingerprintType *fp2 = PG_GETARG_FINGERPRINT_P(1);
+
+    PG_RETURN_FLOAT8(FingerprintDice(fp1,fp2));
+}
+
+// RETURNS THE NORMALIZED EUCLIDEAN SIMILARITY
+PG_FUNCTION_INFO_V1(fingerprint_euclidean);
+Datum fingerprint_euclidean(PG_FUNCTION_ARGS)
+{
+    FingerprintType *fp1 = PG_GETARG_FINGERPRINT_P(0);
+    FingerprintType *fp2 = PG_GETARG_FINGERPRINT_P(1);
+
+    PG_RETURN_FLOAT8(FingerprintNormEuclidean(fp1,fp2));
+}
+
+// RETURNS THE KULCZYNSKI SIMILARITY
+PG_FUNCTION_INFO_V1(fingerprint_kulcz);
+Datum fingerprint_kulcz(PG_FUNCTION_ARGS)
+{
+    FingerprintType *fp1 = PG_GETARG_FINGERPRINT_P(0);
+    FingerprintType *fp2 = PG_GETARG_FINGERPRINT_P(1);
+
+    PG_RETURN_FLOAT8(FingerprintKulczynski(fp1,fp2));
+}
+
+// RETURNS THE NORMALIZED MANHATTAN SIMILARITY
+PG_FUNCTION_INFO_V1(fingerprint_manhattan);
+Datum fingerprint_manhattan(PG_FUNCTION_ARGS)
+{
+    FingerprintType *fp1 = PG_GETARG_FINGERPRINT_P(0);
+    FingerprintType *fp2 = PG_GETARG_FINGERPRINT_P(1);
+
+    PG_RETURN_FLOAT8(FingerprintNormManhattan(fp1,fp2));
+}
+
+// RETURNS THE OCHIAI/COSINE SIMILARITY
+PG_FUNCTION_INFO_V1(fingerprint_ochiai);
+Datum fingerprint_ochiai(PG_FUNCTION_ARGS)
+{
+    FingerprintType *fp1 = PG_GETARG_FINGERPRINT_P(0);
+    FingerprintType *fp2 = PG_GETARG_FINGERPRINT_P(1);
+
+    PG_RETURN_FLOAT8(FingerprintOchiai(fp1,fp2));
+}
+
+// RETURNS THE RUSSELL-RAO SIMILARITY
+PG_FUNCTION_INFO_V1(fingerprint_russell_rao);
+Datum fingerprint_russell_rao(PG_FUNCTION_ARGS)
+{
+    FingerprintType *fp1 = PG_GETARG_FINGERPRINT_P(0);
+    FingerprintType *fp2 = PG_GETARG_FINGERPRINT_P(1);
+
+    PG_RETURN_FLOAT8(FingerprintRussellRao(fp1,fp2));
+}
+
+// RETURNS THE SIMPSON SIMILARITY
+PG_FUNCTION_INFO_V1(fingerprint_simpson);
+Datum fingerprint_simpson(PG_FUNCTION_ARGS)
+{
+    FingerprintType *fp1 = PG_GETARG_FINGERPRINT_P(0);
+    FingerprintType *fp2 = PG_GETARG_FINGERPRINT_P(1);
+
+    PG_RETURN_FLOAT8(FingerprintSimpson(fp1,fp2));
+}
+
+// RETURNS THE GLOBAL SIMPSON SIMILARITY
+PG_FUNCTION_INFO_V1(fingerprint_simpson_global);
+Datum fingerprint_simpson_global(PG_FUNCTION_ARGS)
+{
+    FingerprintType *fp1 = PG_GETARG_FINGERPRINT_P(0);
+    FingerprintType *fp2 = PG_GETARG_FINGERPRINT_P(1);
+
+    PG_RETURN_FLOAT8(FingerprintSimpsonGlobal(fp1,fp2));
+}
+
+// RETURNS THE TANIMOTO SIMILARITY
+PG_FUNCTION_INFO_V1(fingerprint_tanimoto);
+Datum fingerprint_tanimoto(PG_FUNCTION_ARGS)
+{
+    FingerprintType *fp1 = PG_GETARG_FINGERPRINT_P(0);
+    FingerprintType *fp2 = PG_GETARG_FINGERPRINT_P(1);
+
+    PG_RETURN_FLOAT8(FingerprintTanimoto(fp1,fp2));
+}
+
+// RETURNS THE TVERSKY SIMILARITY
+PG_FUNCTION_INFO_V1(fingerprint_tversky);
+Datum fingerprint_tversky(PG_FUNCTION_ARGS)
+{
+    FingerprintType *fp1 = PG_GETARG_FINGERPRINT_P(0);
+    FingerprintType *fp2 = PG_GETARG_FINGERPRINT_P(1);
+
+    PG_RETURN_FLOAT8(FingerprintTversky(fp1,fp2));
+}
+
+// RETURNS THE FUZCAV SIMILARITY
+PG_FUNCTION_INFO_V1(fingerprint_fuzcavsim_global);
+Datum fingerprint_fuzcavsim_global(PG_FUNCTION_ARGS)
+{
+    FingerprintType *fp1 = PG_GETARG_FINGERPRINT_P(0);
+    FingerprintType *fp2 = PG_GETARG_FINGERPRINT_P(1);
+
+    PG_RETURN_FLOAT8(FingerprintFuzCavSimGlobal(fp1,fp2));
+}
+
+// RETURNS THE MEAN HAMMING DISTANCE
+PG_FUNCTION_INFO_V1(fingerprint_mean_hamming_dist);
+Datum fingerprint_mean_hamming_dist(PG_FUNCTION_ARGS)
+{
+    FingerprintType *fp1 = PG_GETARG_FINGERPRINT_P(0);
+    FingerprintType *fp2 = PG_GETARG_FINGERPRINT_P(1);
+
+    PG_RETURN_FLOAT8(FingerprintMeanHammingDist(fp1,fp2));
+}
+
+
+/////////FINGERPRINT SIMILARITY METRICS COMPARING WITH THE CUTOFF VALUES////////
+
+
+// THE LIMITS ARE SHARED WITH THE ARRAYXI METRICS
+
+//
+PG_FUNCTION_INFO_V1(fingerprint_dice_is_above_limit);
+Datum fingerprint_dice_is_above_limit(PG_FUNCTION_ARGS)
+{
+    FingerprintType *fp1 = PG_GETARG_FINGERPRINT_P(0);
+    FingerprintType *fp2 = PG_GETARG_FINGERPRINT_P(1);
+
+    PG_RETURN_BOOL(FingerprintDice(fp1,fp2) >= arrayxi_dice_limit);
+}
+
+//
+PG_FUNCTION_INFO_V1(fingerprint_euclidean_is_above_limit);
+Datum fingerprint_euclidean_is_above_limit(PG_FUNCTION_ARGS)
+{
+    FingerprintType *fp1 = PG_GETARG_FINGERPRINT_P(0);
+    FingerprintType *fp2 = PG_GETARG_FINGERPRINT_P(1);
+
+    PG_RETURN_BOOL(FingerprintNormEuclidean(fp1,fp2) >= arrayxi_euclidean_limit);
+}
+
+//
+PG_FUNCTION_INFO_V1(fingerprint_kulcz_is_above_limit);
+Datum fingerprint_kulcz_is_above_limit(PG_FUNCTION_ARGS)
+{
+    FingerprintType *fp1 = PG_GETARG_FINGERPRINT_P(0);
+    FingerprintType *fp2 = PG_GETARG_FINGERPRINT_P(1);
+
+    PG_RETURN_BOOL(FingerprintKulczynski(fp1,fp2) >= arrayxi_kulcz_limit);
+}
+
+//
+PG_FUNCTION_INFO_V1(fingerprint_manhattan_is_above_limit);
+Datum fingerprint_manhattan_is_above_limit(PG_FUNCTION_ARGS)
+{
+    FingerprintType *fp1 = PG_GETARG_FINGERPRINT_P(0);
+    FingerprintType *fp2 = PG_GETARG_FINGERPRINT_P(1);
+
+    PG_RETURN_BOOL(FingerprintNormManhattan(fp1,fp2) >= arrayxi_manhattan_limit);
+}
+
+//
+PG_FUNCTION_INFO_V1(fingerprint_ochiai_is_above_limit);
+Datum fingerprint_ochiai_is_above_limit(PG_FUNCTION_ARGS)
+{
+    FingerprintType *fp1 = PG_GETARG_FINGERPRINT_P(0);
+    FingerprintType *fp2 = PG_GETARG_FINGERPRINT_P(1);
+
+    PG_RETURN_BOOL(FingerprintOchiai(fp1,fp2) >= arrayxi_ochiai_limit);
+}
+
+//
+PG_FUNCTION_INFO_V1(fingerprint_russell_rao_is_above_limit);
+Datum fingerprint_russell_rao_is_above_limit(PG_FUNCTION_ARGS)
+{
+    FingerprintType *fp1 = PG_GETARG_FINGERPRINT_P(0);
+    FingerprintType *fp2 = PG_GETARG_FINGERPRINT_P(1);
+
+    PG_RETURN_BOOL(FingerprintRussellRao(fp1,fp2) >= arrayxi_russell_rao_limit);
+}
+
+//
+PG_FUNCTION_INFO_V1(fingerprint_simpson_is_above_limit);
+Datum fingerprint_simpson_is_above_limit(PG_FUNCTION_ARGS)
+{
+    FingerprintType *fp1 = PG_GETARG_FINGERPRINT_P(0);
+    FingerprintType *fp2 = PG_GETARG_FINGERPRINT_P(1);
+
+    PG_RETURN_BOOL(FingerprintSimpson(fp1,fp2) >= arrayxi_simpson_limit);
+}
+
+//
+PG_FUNCTION_INFO_V1(fingerprint_tanimoto_is_above_limit);
+Datum fingerprint_tanimoto_is_above_limit(PG_FUNCTION_ARGS)
+{
+    FingerprintType *fp1 = PG_GETARG_FINGERPRINT_P(0);
+    FingerprintType *fp2 = PG_GETARG_FINGERPRINT_P(1);
+
+    PG_RETURN_BOOL(FingerprintTanimoto(fp1,fp2) >= arrayxi_tanimoto_limit);
+}
+
+//
+PG_FUNCTION_INFO_V1(fingerprint_tversky_is_above_limit);
+Datum fingerprint_tversky_is_above_limit(PG_FUNCTION_ARGS)
+{
+    FingerprintType *fp1 = PG_GETARG_FINGERPRINT_P(0);
+    FingerprintType *fp2 = PG_GETARG_FINGERPRINT_P(1);
+
+    PG_RETURN_BOOL(FingerprintTversky(fp1,fp2) >= arrayxi_tversky_limit);
+}
@@ -0,0 +1,258 @@
+#include "eigen.h"
+#include "arrayxi.h"
+#include "fingerprint.h"
+#include "similarity.h"
+
+using namespace Eigen;
+
+// NUMBER OF BITS SET IN A 64-BIT WORD; COMPILES TO A SINGLE POPCNT INSTRUCTION
+// WITH -msse4.2 OR -march=native
+inline unsigned int popcount64(uint64 word)
+{
+    return __builtin_popcountll(word);
+}
+
+// CHECKS IF THE FINGERPRINTS HAVE THE SAME NUMBER OF BITS
+inline void fingerprint_check_size(FingerprintType *fp1, FingerprintType *fp2)
+{
+    if (fp1->nbits != fp2->nbits)
+    {
+        ereport(ERROR, (errcode(ERRCODE_DATA_EXCEPTION),
+                        errmsg("fingerprints must have the same number of bits.")));
+    }
+}
+
+// RETURNS THE BINARY COUNTS OF BOTH FINGERPRINTS: THE INTERSECTION IS THE
+// POPULATION COUNT OF THE BITWISE AND OF THE WORDS
+inline BinaryCounts fingerprint_binary_counts(FingerprintType *fp1, FingerprintType *fp2)
+{
+    fingerprint_check_size(fp1, fp2);
+
+    const uint64 *words1 = fp1->words;
+    const uint64 *words2 = fp2->words;
+
+    int nwords = FINGERPRINT_NWORDS(fp1->nbits);
+    unsigned int A = 0, B = 0, c = 0;
+
+    for (int i = 0; i < nwords; i++)
+    {
+        A += popcount64(words1[i]);
+        B += popcount64(words2[i]);
+        c += popcount64(words1[i] & words2[i]);
+    }
+
+    // EVERY BIT THAT IS NOT SET IN EITHER FINGERPRINT IS A SHARED ZERO
+    unsigned int n = fp1->nbits;
+    BinaryCounts counts = {A, B, c, n - (A + B - c), n};
+
+    return counts;
+}
+
+
+////////////////////////////CREATION AND CONVERSION/////////////////////////////
+
+
+// ALLOCATES A FINGERPRINT WITH THE GIVEN NUMBER OF BITS, ALL OF THEM UNSET
+extern "C"
+FingerprintType *FingerprintAlloc(int nbits)
+{
+    if (nbits < 0 || nbits > FINGERPRINT_MAX_BITS)
+    {
+        ereport(ERROR, (errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+                        errmsg("fingerprint size %d is out of range [0, %d].", nbits, FINGERPRINT_MAX_BITS)));
+    }
+
+    Size nbytes = FINGERPRINT_SIZE(nbits);
+    FingerprintType *fp = (FingerprintType *) palloc0(nbytes);
+
+    SET_VARSIZE(fp, nbytes);
+    fp->nbits = nbits;
+
+    return fp;
+}
+
+// CREATES A FINGERPRINT FROM AN ARRAY OF INTEGERS: ALL ELEMENTS > 0 WILL BE SET,
+// I.E. THE SAME SEMANTICS AS ARRAYXI_BINARY()
+extern "C"
+FingerprintType *FingerprintFromArray(ArrayType *array)
+{
+    if (ARR_NDIM(array) > 1 || ARR_HASNULL(array))
+    {
+        ereport(ERROR, (errcode(ERRCODE_DATA_EXCEPTION),
+                        errmsg("cannot cast array to fingerprint: array must be one-dimensional without null elements.")));
+    }
+
+    ArrayXiMap arrayxi = arraytype_to_arrayxi(array);
+    FingerprintType *fp = FingerprintAlloc(arrayxi.size());
+
+    for (Index i = 0; i < arrayxi.size(); i++)
+    {
+        if (arrayxi(i) > 0) fp->words[i / FINGERPRINT_WORD_BITS] |= UINT64CONST(1) << (i % FINGERPRINT_WORD_BITS);
+    }
+
+    return fp;
+}
+
+// RETURNS THE FINGERPRINT AS ONE-DIMENSIONAL ARRAY OF ZEROS AND ONES
+extern "C"
+ArrayType *FingerprintToArray(FingerprintType *fp)
+{
+    if (fp->nbits == 0) return construct_empty_array(INT4OID);
+
+    ArrayType *array = arraytype_alloc<int>(1, 1, fp->nbits);
+    int *data = (int *) ARR_DATA_PTR(array);
+
+    for (int i = 0; i < fp->nbits; i++)
+    {
+        data[i] = (fp->words[i / FINGERPRINT_WORD_BITS] >> (i % FINGERPRINT_WORD_BITS)) & 1;
+    }
+
+    return array;
+}
+
+
+/////////////////////////////FINGERPRINT PROPERTIES/////////////////////////////
+
+
+// RETURNS THE NUMBER OF BITS
+extern "C"
+int FingerprintSize(FingerprintType *fp)
+{
+    return fp->nbits;
+}
+
+// RETURNS THE NUMBER OF BITS THAT ARE SET
+extern "C"
+int FingerprintNonZeros(FingerprintType *fp)
+{
+    int nwords = FINGERPRINT_NWORDS(fp->nbits);
+    int count = 0;
+
+    for (int i = 0; i < nwords; i++) count += popcount64(fp->words[i]);
+
+    return count;
+}
+
+
+//////////////////////////////EQUALITY AND HASHING//////////////////////////////
+
+
+// RETURNS TRUE IF BOTH FINGERPRINTS HAVE THE SAME BITS; THE PADDING BITS ARE
+// ALWAYS ZERO, SO WHOLE WORDS CAN BE COMPARED
+extern "C"
+bool FingerprintEqual(FingerprintType *fp1, FingerprintType *fp2)
+{
+    if (fp1->nbits != fp2->nbits) return false;
+
+    return memcmp(fp1->words, fp2->words, FINGERPRINT_NWORDS(fp1->nbits) * sizeof(uint64)) == 0;
+}
+
+// RETURNS THE HASH OF THE WORDS FOR THE HASH OPERATOR CLASS, WITH THE SAME
+// KERNEL AS THE HASH OF ARRAYXI
+extern "C"
+uint32 FingerprintHash(FingerprintType *fp)
+{
+    uint32 hash = hash_uint32_words((const uint32 *) fp->words, FINGERPRINT_NWORDS(fp->nbits) * 2);
+
+    return hash ^ (uint32) fp->nbits;
+}
+
+
+///////////////////////NORMALIZED SIMILARITY METRICS////////////////////////////
+
+
+// RETURNS THE DICE SIMILARITY
+extern "C"
+double FingerprintDice(FingerprintType *fp1, FingerprintType *fp2)
+{
+    return dice_similarity(fingerprint_binary_counts(fp1, fp2));
+}
+
+// RETURNS THE KULCZYNSKI SIMILARITY
+extern "C"
+double FingerprintKulczynski(FingerprintType *fp1, FingerprintType *fp2)
+{
+    return kulczynski_similarity(fingerprint_binary_counts(fp1, fp2));
+}
+
+// RETURNS THE NORMALIZED EUCLIDEAN SIMILARITY
+extern "C"
+double FingerprintNormEuclidean(FingerprintType *fp1, FingerprintType *fp2)
+{
+    return euclidean_similarity(fingerprint_binary_counts(fp1, fp2));
+}
+
+// RETURNS THE NORMALIZED MANHATTAN SIMILARITY
+extern "C"
+double FingerprintNormManhattan(FingerprintType *fp1, FingerprintType *fp2)
+{
+    return manhattan_similarity(fingerprint_binary_counts(fp1, fp2));
+}
+
+// RETURNS THE OCHIAI/COSINE SIMILARITY
+extern "C"
+double FingerprintOchiai(FingerprintType *fp1, FingerprintType *fp2)
+{
+    return ochiai_similarity(fingerprint_binary_counts(fp1, fp2));
+}
+
+// RETURNS THE RUSSELL-RAO SIMILARITY
+extern "C"
+double FingerprintRussellRao(FingerprintType *fp1, FingerprintType *fp2)
+{
+    return russell_rao_similarity(fingerprint_binary_counts(fp1, fp2));
+}
+
+// RETURNS THE SIMPSON SIMILARITY - FUZCAV DEFAULT SIMILARITY
+extern "C"
+double FingerprintSimpson(FingerprintType *fp1, FingerprintType *fp2)
+{
+    return simpson_similarity(fingerprint_binary_counts(fp1, fp2));
+}
+
+// RETURNS THE SIMPSON SIMILARITY WITH MAX() INSTEAD OF MIN()
+extern "C"
+double FingerprintSimpsonGlobal(FingerprintType *fp1, FingerprintType *fp2)
+{
+    return simpson_global_similarity(fingerprint_binary_counts(fp1, fp2));
+}
+
+// RETURNS THE TANIMOTO/JACCARD SIMILARITY
+extern "C"
+double FingerprintTanimoto(FingerprintType *fp1, FingerprintType *fp2)
+{
+    return tanimoto_similarity(fingerprint_binary_counts(fp1, fp2));
+}
+
+// RETURNS THE TVERSKY SIMILARITY
+extern "C"
+double FingerprintTversky(FingerprintType *fp1, FingerprintType *fp2)
+{
+    return tversky_similarity(fingerprint_binary_counts(fp1, fp2),
+                              arrayxi_tversky_alpha, arrayxi_tversky_beta);
+}
+
+// RETURNS THE FUZCAV SIMILARITY
+extern "C"
+double FingerprintFuzCavSimGlobal(FingerprintType *fp1, FingerprintType *fp2)
+{
+    return fuzcav_similarity(fingerprint_binary_counts(fp1, fp2));
+}
+
+
+////////////////////////////////DISTANCE METRICS////////////////////////////////
+
+
+// RETURNS THE MEAN HAMMING DISTANCE: THE FRACTION OF BITS THAT DIFFER
+extern "C"
+double FingerprintMeanHammingDist(FingerprintType *fp1, FingerprintType *fp2)
+{
+    fingerprint_check_size(fp1, fp2);
+
+    int nwords = FINGERPRINT_NWORDS(fp1->nbits);
+    unsigned int count = 0;
+
+    for (int i = 0; i < nwords; i++) count += popcount64(fp1->words[i] ^ fp2->words[i]);
+
+    return count / (double) fp1->nbits;
+}
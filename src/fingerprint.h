@@ -0,0 +1,65 @@
+#ifndef FINGERPRINT_H
+#define FINGERPRINT_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    #include "postgres.h"
+    #include "fmgr.h"
+    #include "utils/array.h"
+
+    // BIT-PACKED BINARY FINGERPRINT. THE BITS ARE STORED IN 64-BIT WORDS THAT
+    // START ON A DOUBLE BOUNDARY; UNUSED BITS OF THE LAST WORD ARE ALWAYS ZERO
+    // SO THAT THEY DO NOT CONTRIBUTE TO THE POPULATION COUNTS
+    typedef struct
+    {
+        int32  vl_len_;     // VARLENA HEADER, DO NOT TOUCH DIRECTLY
+        int32  nbits;       // NUMBER OF BITS IN THE FINGERPRINT
+        uint64 words[FLEXIBLE_ARRAY_MEMBER];
+    } FingerprintType;
+
+    #define FINGERPRINT_WORD_BITS        64
+    #define FINGERPRINT_NWORDS(nbits)    (((nbits) + FINGERPRINT_WORD_BITS - 1) / FINGERPRINT_WORD_BITS)
+    #define FINGERPRINT_SIZE(nbits)      (offsetof(FingerprintType, words) + FINGERPRINT_NWORDS(nbits) * sizeof(uint64))
+    #define FINGERPRINT_MAX_BITS         (1 << 24)
+
+    #define DatumGetFingerprintP(X)      ((FingerprintType *) PG_DETOAST_DATUM(X))
+    #define PG_GETARG_FINGERPRINT_P(n)   DatumGetFingerprintP(PG_GETARG_DATUM(n))
+    #define PG_RETURN_FINGERPRINT_P(x)   PG_RETURN_POINTER(x)
+
+    // CREATION AND CONVERSION
+    FingerprintType *FingerprintAlloc(int nbits);
+    FingerprintType *FingerprintFromArray(ArrayType *array);
+    ArrayType       *FingerprintToArray(FingerprintType *fp);
+
+    // FINGERPRINT PROPERTIES
+    int              FingerprintSize(FingerprintType *fp);
+    int              FingerprintNonZeros(FingerprintType *fp);
+
+    // EQUALITY AND HASHING
+    bool             FingerprintEqual(FingerprintType *fp1, FingerprintType *fp2);
+    uint32           FingerprintHash(FingerprintType *fp);
+
+    // NORMALIZED SIMILARITY METRICS
+    double           FingerprintDice(FingerprintType *fp1, FingerprintType *fp2);
+    double           FingerprintKulczynski(FingerprintType *fp1, FingerprintType *fp2);
+    double           FingerprintNormEuclidean(FingerprintType *fp1, FingerprintType *fp2);
+    double           FingerprintNormManhattan(FingerprintType *fp1, FingerprintType *fp2);
+    double           FingerprintOchiai(FingerprintType *fp1, FingerprintType *fp2);
+    double           FingerprintRussellRao(FingerprintType *fp1, FingerprintType *fp2);
+    double           FingerprintSimpson(FingerprintType *fp1, FingerprintType *fp2);
+    double           FingerprintSimpsonGlobal(FingerprintType *fp1, FingerprintType *fp2);
+    double           FingerprintTanimoto(FingerprintType *fp1, FingerprintType *fp2);
+    double           FingerprintTversky(FingerprintType *fp1, FingerprintType *fp2);
+    double           FingerprintFuzCavSimGlobal(FingerprintType *fp1, FingerprintType *fp2);
+
+    // DISTANCE METRICS
+    double           FingerprintMeanHammingDist(FingerprintType *fp1, FingerprintType *fp2);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
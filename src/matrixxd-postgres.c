@@ -1,5 +1,7 @@
 #include "arrayxi.h"
 #include "fmgr.h"
+#include "funcapi.h"
+#include "access/htup_details.h"
 #include <utils/builtins.h>
 #include "matrixxd.h"
 
@@ -190,18 +192,164 @@ Datum matrixxd_vstack(PG_FUNCTION_ARGS)
 PG_FUNCTION_INFO_V1(matrixxd_hstack_vector3d);
 Datum matrixxd_hstack_vector3d(PG_FUNCTION_ARGS)
 {
-    ArrayType *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType *a2 = PG_GETARG_ARRAYTYPE_P(1);
+    ArrayType    *matrix = PG_GETARG_ARRAYTYPE_P(0);
+    Vector3dType *vector = PG_GETARG_VECTOR3D_P(1);
 
-    PG_RETURN_ARRAYTYPE_P(MatrixXdHStackVector3d(a1, a2));
+    PG_RETURN_ARRAYTYPE_P(MatrixXdHStackVector3d(matrix, vector));
 }
 
 // VERTICALLY STACKS VECTOR3D ONTO MATRIX
 PG_FUNCTION_INFO_V1(matrixxd_vstack_vector3d);
 Datum matrixxd_vstack_vector3d(PG_FUNCTION_ARGS)
+{
+    ArrayType    *matrix = PG_GETARG_ARRAYTYPE_P(0);
+    Vector3dType *vector = PG_GETARG_VECTOR3D_P(1);
+
+    PG_RETURN_ARRAYTYPE_P(MatrixXdVStackVector3d(matrix, vector));
+}
+
+/////////////////////////////////SUPERPOSITION//////////////////////////////////
+
+
+// RETURNS THE ROTATION AND TRANSLATION THAT OPTIMALLY SUPERPOSE THE FIRST SET OF
+// COORDINATES ONTO THE SECOND
+PG_FUNCTION_INFO_V1(matrixxd_kabsch);
+Datum matrixxd_kabsch(PG_FUNCTION_ARGS)
+{
+    ArrayType    *a1 = PG_GETARG_ARRAYTYPE_P(0);
+    ArrayType    *a2 = PG_GETARG_ARRAYTYPE_P(1);
+
+    Vector3dType *translation = (Vector3dType *) palloc(sizeof(Vector3dType));
+    TupleDesc     tupdesc;
+    Datum         values[2];
+    bool          nulls[2] = {false, false};
+
+    if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+    {
+        ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                        errmsg("function returning record called in context that cannot accept type record")));
+    }
+
+    values[0] = PointerGetDatum(MatrixXdKabsch(a1, a2, translation));
+    values[1] = Vector3dPGetDatum(translation);
+
+    PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(BlessTupleDesc(tupdesc), values, nulls)));
+}
+
+// RETURNS THE ROOT-MEAN-SQUARE DEVIATION OF TWO SETS OF COORDINATES
+PG_FUNCTION_INFO_V1(matrixxd_rmsd);
+Datum matrixxd_rmsd(PG_FUNCTION_ARGS)
+{
+    ArrayType *a1 = PG_GETARG_ARRAYTYPE_P(0);
+    ArrayType *a2 = PG_GETARG_ARRAYTYPE_P(1);
+    bool       superpose = PG_GETARG_BOOL(2);
+
+    PG_RETURN_FLOAT8(MatrixXdRmsd(a1, a2, superpose));
+}
+
+// RETURNS THE RMSD OF THE REFERENCE AGAINST ALL STACKED SETS OF COORDINATES
+PG_FUNCTION_INFO_V1(matrixxd_rmsd_many);
+Datum matrixxd_rmsd_many(PG_FUNCTION_ARGS)
+{
+    ArrayType *reference = PG_GETARG_ARRAYTYPE_P(0);
+    ArrayType *targets = PG_GETARG_ARRAYTYPE_P(1);
+    bool       superpose = PG_GETARG_BOOL(2);
+
+    PG_RETURN_ARRAYTYPE_P(MatrixXdRmsdMany(reference, targets, superpose));
+}
+
+
+////////////////////////////////PAIRWISE DISTANCES//////////////////////////////
+
+
+// RETURNS THE DISTANCE METRIC WITH THE GIVEN NAME
+static MatrixXdDistanceMetric matrixxd_distance_metric(const char *metric)
+{
+    if (strcmp(metric, "euclidean") == 0) return MATRIXXD_EUCLIDEAN;
+    else if (strcmp(metric, "manhattan") == 0) return MATRIXXD_MANHATTAN;
+
+    ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                 errmsg("unknown distance metric: \"%s\"; valid values are euclidean and manhattan.", metric)));
+
+    return MATRIXXD_EUCLIDEAN;
+}
+
+// RETURNS THE MATRIX OF DISTANCES BETWEEN ALL ROWS OF BOTH MATRICES
+PG_FUNCTION_INFO_V1(matrixxd_pairwise_distance);
+Datum matrixxd_pairwise_distance(PG_FUNCTION_ARGS)
 {
     ArrayType *a1 = PG_GETARG_ARRAYTYPE_P(0);
     ArrayType *a2 = PG_GETARG_ARRAYTYPE_P(1);
+    char      *metric = PG_GETARG_TEXT_AS_CSTRING(2);
+
+    PG_RETURN_ARRAYTYPE_P(MatrixXdPairwiseDistance(a1, a2, matrixxd_distance_metric(metric)));
+}
+
+
+///////////////////////////////////CONTACTS/////////////////////////////////////
+
+
+// STATE OF THE CONTACTS SET-RETURNING FUNCTION BETWEEN CALLS
+typedef struct
+{
+    MatrixXdContact *contacts;
+    int              ncontacts;
+} MatrixXdContactsState;
+
+// RETURNS ALL PAIRS OF ROWS OF TWO COORDINATE MATRICES THAT ARE CLOSER THAN THE
+// CUTOFF AS (I, J, DISTANCE)
+PG_FUNCTION_INFO_V1(matrixxd_contacts);
+Datum matrixxd_contacts(PG_FUNCTION_ARGS)
+{
+    FuncCallContext       *funcctx;
+    MatrixXdContactsState *state;
 
-    PG_RETURN_ARRAYTYPE_P(MatrixXdVStackVector3d(a1, a2));
-}
\ No newline at end of file
+    if (SRF_IS_FIRSTCALL())
+    {
+        MemoryContext oldcontext;
+        TupleDesc     tupdesc;
+
+        funcctx = SRF_FIRSTCALL_INIT();
+
+        // THE CONTACTS HAVE TO SURVIVE UNTIL THE LAST CALL
+        oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+        if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+        {
+            ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                            errmsg("function returning record called in context that cannot accept type record")));
+        }
+
+        state = (MatrixXdContactsState *) palloc(sizeof(MatrixXdContactsState));
+        state->contacts = MatrixXdContacts(PG_GETARG_ARRAYTYPE_P(0), PG_GETARG_ARRAYTYPE_P(1),
+                                           PG_GETARG_FLOAT8(2), &state->ncontacts);
+
+        funcctx->tuple_desc = BlessTupleDesc(tupdesc);
+        funcctx->max_calls = state->ncontacts;
+        funcctx->user_fctx = state;
+
+        MemoryContextSwitchTo(oldcontext);
+    }
+
+    funcctx = SRF_PERCALL_SETUP();
+    state = (MatrixXdContactsState *) funcctx->user_fctx;
+
+    if (funcctx->call_cntr < funcctx->max_calls)
+    {
+        MatrixXdContact *contact = &state->contacts[funcctx->call_cntr];
+        Datum            values[3];
+        bool             nulls[3] = {false, false, false};
+        HeapTuple        tuple;
+
+        values[0] = Int32GetDatum(contact->i);
+        values[1] = Int32GetDatum(contact->j);
+        values[2] = Float8GetDatum(contact->distance);
+
+        tuple = heap_form_tuple(funcctx->tuple_desc, values, nulls);
+
+        SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+    }
+
+    SRF_RETURN_DONE(funcctx);
+}
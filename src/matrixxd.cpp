@@ -1,46 +1,14 @@
 #include "eigen.h"
-#include "hvstack.h"
 #include "matrixxd.h"
 
-#include <iostream>
-
-using namespace Eigen;
-
-// CONVERTS A POSTGRESQL ARRAYTYPE INTO AN EIGEN MATRIX OF DOUBLES
-MatrixRowMajorXd arraytype_to_matrixxd(ArrayType *array)
+extern "C"
 {
-    MatrixRowMajorXd matrixxd;
-    
-    // CHECK IF ARRAY IS NOT EMPTY
-    if (!arraytype_is_empty(array))
-    {
-        int rows, cols;
-        
-        int *dmns = ARR_DIMS(array);
-        int *lbds = ARR_LBOUND(array);
-
-        if (ARR_NDIM(array) == 1)
-        {
-            rows = 1;
-            cols = arraytype_dim_num_elems(1, dmns, lbds);
-        }
-        
-        else
-        {
-            // EXTRACT THE MATRIX DIMENSIONS FROM THE POSTGRESQL ARRAYTYPE
-            rows = arraytype_dim_num_elems(1, dmns, lbds); 
-            cols = arraytype_dim_num_elems(2, dmns, lbds); 
-        }
-        
-        // MAP POSTGRESQL ARRAY TO MATRIX
-        Map<MatrixRowMajorXd> matrixxd((double *) ARR_DATA_PTR(array), rows, cols);
-        
-        return matrixxd;
-    }
-  
-    return matrixxd;
+    #include "miscadmin.h"
 }
 
+#include <iostream>
+
+using namespace Eigen;
 
 /////////////////////////MATRIX CONSTRUCTION METHODS////////////////////////////
 
@@ -83,7 +51,7 @@ ArrayType *MatrixXdRandom(int rows, int cols)
 extern "C"
 unsigned int MatrixXdSize(ArrayType *array)
 {
-    MatrixRowMajorXd matrixxd = arraytype_to_matrixxd(array);
+    MatrixXdMap matrixxd = arraytype_to_matrixxd(array);
 
     // RETURNS THE TOTAL NUMBER OF COEFFICIENTS
     return matrixxd.size();
@@ -94,7 +62,7 @@ unsigned int MatrixXdSize(ArrayType *array)
 extern "C"
 bool MatrixXdIsIdentity(ArrayType *array, double precision)
 {
-    MatrixRowMajorXd matrixxd = arraytype_to_matrixxd(array);
+    MatrixXdMap matrixxd = arraytype_to_matrixxd(array);
     
     return matrixxd.isIdentity(precision);
 }
@@ -107,8 +75,8 @@ bool MatrixXdIsIdentity(ArrayType *array, double precision)
 extern "C"
 ArrayType *MatrixXdAdd(ArrayType *a1, ArrayType *a2)
 {
-    MatrixRowMajorXd m1 = arraytype_to_matrixxd(a1);
-    MatrixRowMajorXd m2 = arraytype_to_matrixxd(a2);
+    MatrixXdMap m1 = arraytype_to_matrixxd(a1);
+    MatrixXdMap m2 = arraytype_to_matrixxd(a2);
     
     return densebase_to_float8_arraytype(m1 + m2);
 }
@@ -117,8 +85,8 @@ ArrayType *MatrixXdAdd(ArrayType *a1, ArrayType *a2)
 extern "C"
 ArrayType *MatrixXdSubtract(ArrayType *a1, ArrayType *a2)
 {
-    MatrixRowMajorXd m1 = arraytype_to_matrixxd(a1);
-    MatrixRowMajorXd m2 = arraytype_to_matrixxd(a2);
+    MatrixXdMap m1 = arraytype_to_matrixxd(a1);
+    MatrixXdMap m2 = arraytype_to_matrixxd(a2);
     
     return densebase_to_float8_arraytype(m1 - m2);
 }
@@ -127,8 +95,8 @@ ArrayType *MatrixXdSubtract(ArrayType *a1, ArrayType *a2)
 extern "C"
 ArrayType *MatrixXdMultiply(ArrayType *a1, ArrayType *a2)
 {
-    MatrixRowMajorXd m1 = arraytype_to_matrixxd(a1);
-    MatrixRowMajorXd m2 = arraytype_to_matrixxd(a2);
+    MatrixXdMap m1 = arraytype_to_matrixxd(a1);
+    MatrixXdMap m2 = arraytype_to_matrixxd(a2);
     
     return densebase_to_float8_arraytype(m1 * m2);
 }
@@ -137,7 +105,7 @@ ArrayType *MatrixXdMultiply(ArrayType *a1, ArrayType *a2)
 extern "C"
 ArrayType *MatrixXdScalarProduct(ArrayType *array, double scalar)
 {
-    MatrixRowMajorXd matrixxd = arraytype_to_matrixxd(array);
+    MatrixXdMap matrixxd = arraytype_to_matrixxd(array);
     
     return densebase_to_float8_arraytype(matrixxd * scalar);
 }
@@ -146,7 +114,7 @@ ArrayType *MatrixXdScalarProduct(ArrayType *array, double scalar)
 extern "C"
 ArrayType *MatrixXdScalarDivision(ArrayType *array, double scalar)
 {
-    MatrixRowMajorXd matrixxd = arraytype_to_matrixxd(array);
+    MatrixXdMap matrixxd = arraytype_to_matrixxd(array);
     
     return densebase_to_float8_arraytype(matrixxd / scalar);
 }
@@ -159,7 +127,7 @@ ArrayType *MatrixXdScalarDivision(ArrayType *array, double scalar)
 extern "C"
 ArrayType *MatrixXdColWiseSum(ArrayType *array)
 {
-    MatrixRowMajorXd matrixxd = arraytype_to_matrixxd(array);
+    MatrixXdMap matrixxd = arraytype_to_matrixxd(array);
     
     return densebase_to_float8_arraytype(matrixxd.colwise().sum());
 }
@@ -168,7 +136,7 @@ ArrayType *MatrixXdColWiseSum(ArrayType *array)
 extern "C"
 ArrayType *MatrixXdColWiseMean(ArrayType *array)
 {
-    MatrixRowMajorXd matrixxd = arraytype_to_matrixxd(array);
+    MatrixXdMap matrixxd = arraytype_to_matrixxd(array);
     
     return densebase_to_float8_arraytype(matrixxd.colwise().mean());
 }
@@ -181,7 +149,7 @@ ArrayType *MatrixXdColWiseMean(ArrayType *array)
 extern "C"
 ArrayType *MatrixXdRowWiseSum(ArrayType *array)
 {
-    MatrixRowMajorXd matrixxd = arraytype_to_matrixxd(array);
+    MatrixXdMap matrixxd = arraytype_to_matrixxd(array);
     
     return densebase_to_float8_arraytype(matrixxd.rowwise().sum());
 }
@@ -190,7 +158,7 @@ ArrayType *MatrixXdRowWiseSum(ArrayType *array)
 extern "C"
 ArrayType *MatrixXdRowWiseMean(ArrayType *array)
 {
-    MatrixRowMajorXd matrixxd = arraytype_to_matrixxd(array);
+    MatrixXdMap matrixxd = arraytype_to_matrixxd(array);
     
     return densebase_to_float8_arraytype(matrixxd.rowwise().mean());
 }
@@ -203,8 +171,8 @@ ArrayType *MatrixXdRowWiseMean(ArrayType *array)
 extern "C"
 ArrayType *MatrixXdHStack(ArrayType *a1, ArrayType *a2)
 {
-    MatrixRowMajorXd m1 = arraytype_to_matrixxd(a1);
-    MatrixRowMajorXd m2 = arraytype_to_matrixxd(a2);
+    MatrixXdMap m1 = arraytype_to_matrixxd(a1);
+    MatrixXdMap m2 = arraytype_to_matrixxd(a2);
 
     // RETURN THE OTHER MATRIX IF ONE OF THEM IS EMPTY
     if (m1.size() == 0) return a2;
@@ -216,15 +184,22 @@ ArrayType *MatrixXdHStack(ArrayType *a1, ArrayType *a2)
                         errmsg("cannot hstack matrixxd: matrices must have the same number of rows.")));
     }
     
-    return densebase_to_float8_arraytype(HStack(m1,m2));
+    // WRITE BOTH MATRICES DIRECTLY INTO THE RESULT ARRAY
+    ArrayType *array = arraytype_alloc<double>(m1.rows() > 1 ? 2 : 1, m1.rows(), m1.cols() + m2.cols());
+    Map<MatrixRowMajorXd> stacked((double *) ARR_DATA_PTR(array), m1.rows(), m1.cols() + m2.cols());
+    
+    stacked.leftCols(m1.cols()) = m1;
+    stacked.rightCols(m2.cols()) = m2;
+    
+    return array;
 }
 
 // VERTICAL STACKS TWO MATRICES
 extern "C"
 ArrayType *MatrixXdVStack(ArrayType *a1, ArrayType *a2)
 {
-    MatrixRowMajorXd m1 = arraytype_to_matrixxd(a1);
-    MatrixRowMajorXd m2 = arraytype_to_matrixxd(a2);
+    MatrixXdMap m1 = arraytype_to_matrixxd(a1);
+    MatrixXdMap m2 = arraytype_to_matrixxd(a2);
     
     // RETURN THE OTHER MATRIX IF ONE OF THEM IS EMPTY
     if (m1.size() == 0) return a2;
@@ -236,19 +211,25 @@ ArrayType *MatrixXdVStack(ArrayType *a1, ArrayType *a2)
                         errmsg("cannot vstack matrixxd: matrices must have the same number of columns.")));
     }
     
-    return densebase_to_float8_arraytype(VStack(m1,m2));
+    // THE ROWS OF BOTH MATRICES ARE CONTIGUOUS IN ROW-MAJOR ORDER
+    ArrayType *array = arraytype_alloc<double>(2, m1.rows() + m2.rows(), m1.cols());
+    double *data = (double *) ARR_DATA_PTR(array);
+    
+    memcpy(data, m1.data(), m1.size() * sizeof(double));
+    memcpy(data + m1.size(), m2.data(), m2.size() * sizeof(double));
+    
+    return array;
 }
 
 // HORIZONTALLY STACKS A VECTOR3D ONTO A MATRIX
 extern "C"
-ArrayType *MatrixXdHStackVector3d(ArrayType *matrix, ArrayType *vector)
+ArrayType *MatrixXdHStackVector3d(ArrayType *matrix, Vector3dType *vector)
 {
-    MatrixRowMajorXd matrixxd = arraytype_to_matrixxd(matrix);
-    Map<RowVector3d> vector3d((double *) ARR_DATA_PTR(vector), 3);
+    MatrixXdMap matrixxd = arraytype_to_matrixxd(matrix);
+    Vector3dMap vector3d(vector->xyz);
 
-    // RETURN THE OTHER TYPE IF ONE OF THEM IS EMPTY
+    // RETURN THE VECTOR IF THE MATRIX IS EMPTY
     if (matrixxd.size() == 0) return densebase_to_float8_arraytype(vector3d);
-    else if (vector3d.size() == 0) return densebase_to_float8_arraytype(matrixxd);
     
     // ROW VECTOR!
     if (matrixxd.rows() > 1)
@@ -257,25 +238,471 @@ ArrayType *MatrixXdHStackVector3d(ArrayType *matrix, ArrayType *vector)
                         errmsg("cannot hstack vector3d: matrix must not have more than one row.")));
     }
     
-    return densebase_to_float8_arraytype(HStack(matrixxd,vector3d));
+    ArrayType *array = arraytype_alloc<double>(1, 1, matrixxd.cols() + 3);
+    Map<RowVectorXd> stacked((double *) ARR_DATA_PTR(array), matrixxd.cols() + 3);
+    
+    stacked.head(matrixxd.cols()) = matrixxd;
+    stacked.tail<3>() = vector3d;
+    
+    return array;
 }
 
 // VERTICALLY STACKS A VECTOR3D ONTO A MATRIX
 extern "C"
-ArrayType *MatrixXdVStackVector3d(ArrayType *matrix, ArrayType *vector)
+ArrayType *MatrixXdVStackVector3d(ArrayType *matrix, Vector3dType *vector)
 {
-    MatrixRowMajorXd matrixxd = arraytype_to_matrixxd(matrix);
-    Map<RowVector3d> vector3d((double *) ARR_DATA_PTR(vector), 3);
+    MatrixXdMap matrixxd = arraytype_to_matrixxd(matrix);
+    Vector3dMap vector3d(vector->xyz);
 
-    // RETURN THE OTHER TYPE IF ONE OF THEM IS EMPTY
-    if (matrixxd.size() == 0) return vector;
-    else if (vector3d.size() == 0) return matrix;
+    // RETURN THE VECTOR IF THE MATRIX IS EMPTY
+    if (matrixxd.size() == 0) return densebase_to_float8_arraytype(vector3d);
     
-    else if (matrixxd.cols() > 3)
+    else if (matrixxd.cols() != 3)
     {
         ereport(ERROR, (errcode(ERRCODE_DATA_EXCEPTION), 
-                        errmsg("cannot vstack vector3d: matrix must not have more than three columns.")));
+                        errmsg("cannot vstack vector3d: matrix must have exactly three columns.")));
     }
     
-    return densebase_to_float8_arraytype(VStack(matrixxd,vector3d));
+    // APPEND THE VECTOR AS LAST ROW
+    ArrayType *array = arraytype_alloc<double>(2, matrixxd.rows() + 1, 3);
+    double *data = (double *) ARR_DATA_PTR(array);
+    
+    memcpy(data, matrixxd.data(), matrixxd.size() * sizeof(double));
+    memcpy(data + matrixxd.size(), vector3d.data(), 3 * sizeof(double));
+    
+    return array;
+}
+
+
+/////////////////////////////////SUPERPOSITION//////////////////////////////////
+
+
+// CENTROID OF A SET OF COORDINATES AND THE SUM OF THE SQUARED DISTANCES OF ALL
+// COORDINATES FROM IT
+struct CoordsCentroid
+{
+    RowVector3d centroid;
+    double      spread;
+};
+
+// CHECKS IF BOTH MATRICES ARE NON-EMPTY LISTS OF COORDINATES OF THE SAME LENGTH
+inline void matrixxd_check_superposition(const MatrixXdMap &m1, const MatrixXdMap &m2)
+{
+    if (m1.size() == 0 || m1.cols() != 3 || m2.cols() != 3)
+    {
+        ereport(ERROR, (errcode(ERRCODE_DATA_EXCEPTION),
+                        errmsg("cannot superpose coordinates: matrices must not be empty and have exactly three columns.")));
+    }
+
+    else if (m1.rows() != m2.rows())
+    {
+        ereport(ERROR, (errcode(ERRCODE_DATA_EXCEPTION),
+                        errmsg("cannot superpose coordinates: matrices must have the same number of rows.")));
+    }
+}
+
+inline CoordsCentroid coords_centroid(const MatrixXdMap &coords)
+{
+    CoordsCentroid result;
+
+    result.centroid = coords.colwise().mean();
+    result.spread = 0;
+
+    for (Index i = 0; i < coords.rows(); i++)
+    {
+        RowVector3d centered = coords.row(i) - result.centroid;
+        result.spread += centered.squaredNorm();
+    }
+
+    return result;
+}
+
+// RETURNS THE 3X3 COVARIANCE MATRIX OF THE CENTERED COORDINATES; THE ROWS ARE
+// CENTERED ONE AT A TIME SO THAT NO CENTERED COPY OF EITHER MATRIX IS NEEDED
+inline Matrix3d coords_covariance(const MatrixXdMap &m1, const RowVector3d &c1,
+                                  const MatrixXdMap &m2, const RowVector3d &c2)
+{
+    Matrix3d covariance = Matrix3d::Zero();
+
+    for (Index i = 0; i < m1.rows(); i++)
+    {
+        RowVector3d p1 = m1.row(i) - c1;
+        RowVector3d p2 = m2.row(i) - c2;
+
+        covariance.noalias() += p1.transpose() * p2;
+    }
+
+    return covariance;
+}
+
+// RETURNS THE RMSD OF BOTH COORDINATE SETS, OPTIONALLY AFTER THEIR OPTIMAL
+// SUPERPOSITION. THE MINIMAL SUM OF SQUARED DEVIATIONS FOLLOWS FROM THE SINGULAR
+// VALUES OF THE COVARIANCE MATRIX ALONE, SO THE ROTATION IS NEVER CONSTRUCTED
+inline double coords_rmsd(const MatrixXdMap &m1, const CoordsCentroid &c1, const MatrixXdMap &m2, bool superpose)
+{
+    if (!superpose) return std::sqrt((m1 - m2).squaredNorm() / m1.rows());
+
+    CoordsCentroid c2 = coords_centroid(m2);
+    Matrix3d covariance = coords_covariance(m1, c1.centroid, m2, c2.centroid);
+
+    JacobiSVD<Matrix3d> svd(covariance);
+    Vector3d sigma = svd.singularValues();
+
+    // AVOID REFLECTIONS: THE SMALLEST SINGULAR VALUE CHANGES SIGN IF THE OPTIMAL
+    // ORTHOGONAL TRANSFORMATION IS AN IMPROPER ROTATION
+    if (covariance.determinant() < 0) sigma(2) = -sigma(2);
+
+    double deviation = c1.spread + c2.spread - 2 * sigma.sum();
+
+    return std::sqrt(Max(deviation, 0.0) / m1.rows());
+}
+
+/* Returns the rotation matrix of the optimal superposition of the first onto
+ * the second set of coordinates with the Kabsch algorithm and stores the
+ * translation. A row r of the first matrix is superposed onto the second with
+ * r * rotation^T + translation.
+ */
+extern "C"
+ArrayType *MatrixXdKabsch(ArrayType *a1, ArrayType *a2, Vector3dType *translation)
+{
+    MatrixXdMap m1 = arraytype_to_matrixxd(a1);
+    MatrixXdMap m2 = arraytype_to_matrixxd(a2);
+
+    matrixxd_check_superposition(m1, m2);
+
+    RowVector3d c1 = m1.colwise().mean();
+    RowVector3d c2 = m2.colwise().mean();
+
+    JacobiSVD<Matrix3d> svd(coords_covariance(m1, c1, m2, c2), ComputeFullU | ComputeFullV);
+
+    // CORRECT THE HANDEDNESS OF THE ROTATION TO AVOID REFLECTIONS
+    Vector3d signs(1, 1, (svd.matrixV() * svd.matrixU().transpose()).determinant() < 0 ? -1 : 1);
+    Matrix3d rotation = svd.matrixV() * signs.asDiagonal() * svd.matrixU().transpose();
+
+    Map<RowVector3d>(translation->xyz) = c2 - c1 * rotation.transpose();
+
+    return densebase_to_float8_arraytype(rotation);
+}
+
+// RETURNS THE ROOT-MEAN-SQUARE DEVIATION OF BOTH SETS OF COORDINATES
+extern "C"
+double MatrixXdRmsd(ArrayType *a1, ArrayType *a2, bool superpose)
+{
+    MatrixXdMap m1 = arraytype_to_matrixxd(a1);
+    MatrixXdMap m2 = arraytype_to_matrixxd(a2);
+
+    matrixxd_check_superposition(m1, m2);
+
+    return coords_rmsd(m1, coords_centroid(m1), m2, superpose);
+}
+
+// RETURNS THE RMSD OF THE REFERENCE AGAINST EVERY SET OF COORDINATES IN A
+// THREE-DIMENSIONAL ARRAY OF STACKED MATRICES, E.G. FROM ARRAY_AGG(MATRIXXD)
+extern "C"
+ArrayType *MatrixXdRmsdMany(ArrayType *reference, ArrayType *targets, bool superpose)
+{
+    MatrixXdMap m1 = arraytype_to_matrixxd(reference);
+
+    if (arraytype_is_empty(targets)) return construct_empty_array(FLOAT8OID);
+
+    if (ARR_NDIM(targets) != 3 || ARR_HASNULL(targets))
+    {
+        ereport(ERROR, (errcode(ERRCODE_DATA_EXCEPTION),
+                        errmsg("targets must be a three-dimensional array of stacked coordinate matrices without null elements.")));
+    }
+
+    int    *dims = ARR_DIMS(targets);
+    Index   rows = dims[1], cols = dims[2];
+    double *data = (double *) ARR_DATA_PTR(targets);
+
+    ArrayType *array = arraytype_alloc<double>(1, 1, dims[0]);
+    double    *result = (double *) ARR_DATA_PTR(array);
+
+    // ALL TARGETS HAVE THE SAME SHAPE
+    matrixxd_check_superposition(m1, MatrixXdMap(data, rows, cols));
+
+    CoordsCentroid c1 = coords_centroid(m1);
+
+    for (int k = 0; k < dims[0]; k++)
+    {
+        MatrixXdMap m2(data + k * rows * cols, rows, cols);
+
+        result[k] = coords_rmsd(m1, c1, m2, superpose);
+    }
+
+    return array;
+}
+
+
+////////////////////////////////PAIRWISE DISTANCES//////////////////////////////
+
+
+// NUMBER OF ROWS OF THE SECOND MATRIX THAT ARE PROCESSED AT ONCE BY THE TILED
+// KERNELS; A TILE OF EVERY COLUMN AND OF THE RESULT ROW STAYS IN THE L1 CACHE
+#define MATRIXXD_TILE_ROWS 256
+
+/* Writes the euclidean distances between all rows of both matrices into the
+ * result, using ||a - b||^2 = ||a||^2 + ||b||^2 - 2ab so that the bulk of the
+ * work is a single matrix product. Both matrices are centered on the mean of
+ * the second one first, which keeps the cancellation in the identity small for
+ * coordinates far away from the origin.
+ */
+static void matrixxd_pairwise_euclidean(const MatrixXdMap &m1, const MatrixXdMap &m2,
+                                        Map<MatrixRowMajorXd> &distances)
+{
+    RowVectorXd center = m2.colwise().mean();
+
+    MatrixRowMajorXd c1 = m1.rowwise() - center;
+    MatrixRowMajorXd c2 = m2.rowwise() - center;
+
+    distances.noalias() = -2.0 * c1 * c2.transpose();
+    distances.colwise() += c1.rowwise().squaredNorm();
+    distances.rowwise() += c2.rowwise().squaredNorm().transpose();
+
+    // ROUNDING CAN LEAVE TINY NEGATIVE VALUES FOR (NEARLY) IDENTICAL ROWS
+    distances = distances.cwiseMax(0.0).cwiseSqrt();
+}
+
+/* Writes the manhattan distances between all rows of both matrices into the
+ * result. The second matrix is transposed into column-major order so that, for
+ * a tile of its rows, the contribution of one column to a row of the result is
+ * an operation on two contiguous vectors that Eigen vectorizes.
+ */
+static void matrixxd_pairwise_manhattan(const MatrixXdMap &m1, const MatrixXdMap &m2,
+                                        Map<MatrixRowMajorXd> &distances)
+{
+    MatrixXd columns = m2;
+
+    distances.setZero();
+
+    for (Index start = 0; start < m2.rows(); start += MATRIXXD_TILE_ROWS)
+    {
+        Index size = Min(MATRIXXD_TILE_ROWS, m2.rows() - start);
+
+        for (Index i = 0; i < m1.rows(); i++)
+        {
+            for (Index k = 0; k < m1.cols(); k++)
+            {
+                distances.row(i).segment(start, size).array() +=
+                    (columns.col(k).segment(start, size).transpose().array() - m1(i, k)).abs();
+            }
+        }
+    }
+}
+
+// RETURNS THE MATRIX OF DISTANCES BETWEEN ALL ROWS OF THE FIRST AND ALL ROWS OF
+// THE SECOND MATRIX
+extern "C"
+ArrayType *MatrixXdPairwiseDistance(ArrayType *a1, ArrayType *a2, MatrixXdDistanceMetric metric)
+{
+    MatrixXdMap m1 = arraytype_to_matrixxd(a1);
+    MatrixXdMap m2 = arraytype_to_matrixxd(a2);
+
+    if (m1.size() == 0 || m2.size() == 0) return construct_empty_array(FLOAT8OID);
+
+    if (m1.cols() != m2.cols())
+    {
+        ereport(ERROR, (errcode(ERRCODE_DATA_EXCEPTION),
+                        errmsg("cannot calculate pairwise distances: matrices must have the same number of columns.")));
+    }
+
+    // THE DISTANCES ARE WRITTEN DIRECTLY INTO THE RESULT ARRAY
+    ArrayType *array = arraytype_alloc<double>(2, m1.rows(), m2.rows());
+    Map<MatrixRowMajorXd> distances((double *) ARR_DATA_PTR(array), m1.rows(), m2.rows());
+
+    switch (metric)
+    {
+        case MATRIXXD_EUCLIDEAN:
+            matrixxd_pairwise_euclidean(m1, m2, distances);
+            break;
+
+        case MATRIXXD_MANHATTAN:
+            matrixxd_pairwise_manhattan(m1, m2, distances);
+            break;
+    }
+
+    return array;
+}
+
+
+///////////////////////////////////CONTACTS/////////////////////////////////////
+
+
+// LARGEST NUMBER OF TIMES THE CELLS OF THE CONTACT SEARCH ARE WIDENED
+#define MATRIXXD_MAX_CELL_DOUBLINGS 4096
+
+// CHECKS IF THE MATRIX CAN BE INTERPRETED AS A LIST OF COORDINATES
+inline void matrixxd_check_coords(const MatrixXdMap &coords)
+{
+    if (coords.size() > 0 && coords.cols() != 3)
+    {
+        ereport(ERROR, (errcode(ERRCODE_DATA_EXCEPTION),
+                        errmsg("coordinate matrix must have exactly three columns.")));
+    }
+}
+
+/* Returns all pairs of rows of both coordinate matrices that are closer than
+ * the cutoff. The rows of the second matrix are binned into a uniform grid
+ * whose cells are at least as wide as the cutoff, so that the partners of a
+ * row of the first matrix can only lie in the 27 cells around it. The rows of
+ * the grid are sorted by cell with a counting sort, which makes the members of
+ * every cell a contiguous range.
+ *
+ * Row numbers of the contacts are 1-based like the subscripts of the arrays.
+ */
+extern "C"
+MatrixXdContact *MatrixXdContacts(ArrayType *a1, ArrayType *a2, double cutoff, int *ncontacts)
+{
+    MatrixXdMap m1 = arraytype_to_matrixxd(a1);
+    MatrixXdMap m2 = arraytype_to_matrixxd(a2);
+
+    matrixxd_check_coords(m1);
+    matrixxd_check_coords(m2);
+
+    if (!(cutoff > 0))
+    {
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                        errmsg("contact cutoff must be greater than zero.")));
+    }
+
+    // NAN OR INFINITE COORDINATES HAVE NO CELL AND NAN DISTANCES WOULD NEVER
+    // COMPARE AS BEYOND THE CUTOFF
+    if (!m1.allFinite() || !m2.allFinite())
+    {
+        ereport(ERROR, (errcode(ERRCODE_DATA_EXCEPTION),
+                        errmsg("coordinate matrix must not contain NaN or infinite values.")));
+    }
+
+    *ncontacts = 0;
+
+    if (m1.size() == 0 || m2.size() == 0) return NULL;
+
+    // BOUNDING BOX OF THE GRID
+    RowVector3d low = m2.colwise().minCoeff();
+    RowVector3d extent = m2.colwise().maxCoeff() - low;
+
+    if (!extent.allFinite())
+    {
+        ereport(ERROR, (errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+                        errmsg("coordinates span too large a range for a contact search.")));
+    }
+
+    // SPARSE STRUCTURES WITH A SMALL CUTOFF WOULD NEED MORE CELLS THAN POINTS;
+    // WIDER CELLS ONLY MEAN MORE DISTANCES TO CHECK PER CELL
+    double cellsize = cutoff;
+    double maxcells = Max(64.0, 8.0 * m2.rows());
+    int    dims[3];
+
+    // A FINITE EXTENT FITS INTO A SINGLE CELL AFTER FEWER DOUBLINGS THAN THE
+    // EXPONENT RANGE OF A DOUBLE; THE CAP ONLY GUARDS AGAINST ENDLESS LOOPS
+    for (int doubling = 0; ; doubling++)
+    {
+        RowVector3d cells = (extent / cellsize).array().floor() + 1;
+
+        CHECK_FOR_INTERRUPTS();
+
+        if (cells.prod() <= maxcells)
+        {
+            for (int k = 0; k < 3; k++) dims[k] = (int) cells(k);
+            break;
+        }
+
+        if (doubling == MATRIXXD_MAX_CELL_DOUBLINGS)
+        {
+            ereport(ERROR, (errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+                            errmsg("cannot size the grid of the contact search.")));
+        }
+
+        cellsize *= 2;
+    }
+
+    int ncells = dims[0] * dims[1] * dims[2];
+
+    // CELL OF EVERY ROW OF THE SECOND MATRIX AND START OF EVERY CELL IN THE
+    // SORTED ORDER; CELLSTART[C + 1] - CELLSTART[C] IS THE SIZE OF CELL C
+    int *cellof = (int *) palloc(sizeof(int) * m2.rows());
+    int *cellstart = (int *) palloc0(sizeof(int) * (ncells + 1));
+    int *sorted = (int *) palloc(sizeof(int) * m2.rows());
+
+    for (Index row = 0; row < m2.rows(); row++)
+    {
+        int cell = 0;
+
+        for (int k = 0; k < 3; k++)
+        {
+            int index = Min((int) ((m2(row, k) - low(k)) / cellsize), dims[k] - 1);
+            cell = cell * dims[k] + index;
+        }
+
+        cellof[row] = cell;
+        cellstart[cell + 1]++;
+    }
+
+    for (int cell = 0; cell < ncells; cell++) cellstart[cell + 1] += cellstart[cell];
+
+    // FILL THE CELLS; USES THE STARTS AS INSERTION CURSORS AND SHIFTS THEM BACK
+    for (Index row = 0; row < m2.rows(); row++) sorted[cellstart[cellof[row]]++] = row;
+    for (int cell = ncells; cell > 0; cell--) cellstart[cell] = cellstart[cell - 1];
+    cellstart[0] = 0;
+
+    int              capacity = 64;
+    MatrixXdContact *contacts = (MatrixXdContact *) palloc(sizeof(MatrixXdContact) * capacity);
+    double           cutoff2 = cutoff * cutoff;
+
+    for (Index i = 0; i < m1.rows(); i++)
+    {
+        int lo[3], hi[3];
+        bool outside = false;
+
+        CHECK_FOR_INTERRUPTS();
+
+        // RANGE OF NEIGHBOURING CELLS, CLIPPED TO THE GRID
+        for (int k = 0; k < 3; k++)
+        {
+            double position = (m1(i, k) - low(k)) / cellsize;
+
+            lo[k] = (int) Min(Max(std::floor(position) - 1, 0.0), (double) dims[k]);
+            hi[k] = (int) Max(Min(std::floor(position) + 1, (double) dims[k] - 1), -1.0);
+
+            if (lo[k] > hi[k]) outside = true;
+        }
+
+        if (outside) continue;
+
+        for (int x = lo[0]; x <= hi[0]; x++)
+        {
+            for (int y = lo[1]; y <= hi[1]; y++)
+            {
+                for (int z = lo[2]; z <= hi[2]; z++)
+                {
+                    int cell = (x * dims[1] + y) * dims[2] + z;
+
+                    for (int s = cellstart[cell]; s < cellstart[cell + 1]; s++)
+                    {
+                        int j = sorted[s];
+                        double distance2 = (m1.row(i) - m2.row(j)).squaredNorm();
+
+                        if (distance2 >= cutoff2) continue;
+
+                        if (*ncontacts == capacity)
+                        {
+                            capacity *= 2;
+                            contacts = (MatrixXdContact *) repalloc(contacts, sizeof(MatrixXdContact) * capacity);
+                        }
+
+                        contacts[*ncontacts].i = i + 1;
+                        contacts[*ncontacts].j = j + 1;
+                        contacts[*ncontacts].distance = std::sqrt(distance2);
+                        (*ncontacts)++;
+                    }
+                }
+            }
+        }
+    }
+
+    pfree(cellof);
+    pfree(cellstart);
+    pfree(sorted);
+
+    return contacts;
 }
@@ -5,6 +5,22 @@ extern "C"
 
     #include "postgres.h"
     #include "utils/array.h"
+    #include "vector3d.h"
+
+    // DISTANCE METRICS BETWEEN THE ROWS OF TWO MATRICES
+    typedef enum
+    {
+        MATRIXXD_EUCLIDEAN,
+        MATRIXXD_MANHATTAN
+    } MatrixXdDistanceMetric;
+
+    // PAIR OF ROWS OF TWO COORDINATE MATRICES THAT ARE IN CONTACT
+    typedef struct
+    {
+        int32  i;
+        int32  j;
+        double distance;
+    } MatrixXdContact;
 
     ArrayType    *MatrixXdConstant(int rows, int cols, double value);
     ArrayType    *MatrixXdIdentity(int rows, int cols);
@@ -26,8 +42,16 @@ extern "C"
     
     ArrayType    *MatrixXdHStack(ArrayType *a1, ArrayType *a2);
     ArrayType    *MatrixXdVStack(ArrayType *a1, ArrayType *a2);
-    ArrayType    *MatrixXdHStackVector3d(ArrayType *matrix, ArrayType *vector);
-    ArrayType    *MatrixXdVStackVector3d(ArrayType *matrix, ArrayType *vector);
+    ArrayType    *MatrixXdHStackVector3d(ArrayType *matrix, Vector3dType *vector);
+    ArrayType    *MatrixXdVStackVector3d(ArrayType *matrix, Vector3dType *vector);
+    
+    ArrayType    *MatrixXdKabsch(ArrayType *a1, ArrayType *a2, Vector3dType *translation);
+    double        MatrixXdRmsd(ArrayType *a1, ArrayType *a2, bool superpose);
+    ArrayType    *MatrixXdRmsdMany(ArrayType *reference, ArrayType *targets, bool superpose);
+    
+    ArrayType    *MatrixXdPairwiseDistance(ArrayType *a1, ArrayType *a2, MatrixXdDistanceMetric metric);
+    
+    MatrixXdContact *MatrixXdContacts(ArrayType *a1, ArrayType *a2, double cutoff, int *ncontacts);
     
 #ifdef __cplusplus
 }
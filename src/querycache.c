@@ -0,0 +1,72 @@
+#include "querycache.h"
+#include "utils/memutils.h"
+
+
+// RETURNS THE CACHED QUERY OPERAND OF A BINARY FUNCTION OR NULL IF NEITHER OF
+// THE FIRST TWO ARGUMENTS IS STABLE ACROSS CALLS. THE STABLE ARGUMENT IS 
+// DETOASTED AND COPIED INTO THE MEMORY CONTEXT OF THE FUNCTION; ISNEW IS SET IF
+// THE CACHE WAS (RE)BUILT BY THIS CALL SO THAT THE CALLER CAN PREPARE IT FURTHER
+QueryCache *query_cache_get(FunctionCallInfo fcinfo, bool *isnew)
+{
+    FmgrInfo     *flinfo = fcinfo->flinfo;
+    QueryCache   *cache;
+    ArrayType    *array;
+    MemoryContext oldcontext;
+    
+    *isnew = false;
+    
+    // DIRECT FUNCTION CALLS HAVE NO FUNCTION INFO TO HOLD THE CACHE
+    if (flinfo == NULL) return NULL;
+    
+    cache = (QueryCache *) flinfo->fn_extra;
+    
+    if (cache == NULL)
+    {
+        cache = (QueryCache *) MemoryContextAllocZero(flinfo->fn_mcxt, sizeof(QueryCache));
+        
+        // THE QUERY IS THE SECOND ARGUMENT IN MOST SCREENING QUERIES
+        if (get_fn_expr_arg_stable(flinfo, 1)) cache->argno = 1;
+        else if (get_fn_expr_arg_stable(flinfo, 0)) cache->argno = 0;
+        else cache->argno = -1;
+        
+        flinfo->fn_extra = cache;
+    }
+    
+    if (cache->argno < 0) return NULL;
+    
+    /* External parameters are stable within one execution only: PL/pgSQL and
+     * prepared statements keep the function info across executions with other
+     * values, so the operand is compared with the cached copy on every call.
+     */
+    array = PG_GETARG_ARRAYTYPE_P(cache->argno);
+    
+    if (cache->array != NULL && VARSIZE(cache->array) == VARSIZE(array) &&
+        memcmp(cache->array, array, VARSIZE(array)) == 0)
+    {
+        return cache;
+    }
+    
+    oldcontext = MemoryContextSwitchTo(flinfo->fn_mcxt);
+    
+    if (cache->array != NULL) pfree(cache->array);
+    
+    cache->array = (ArrayType *) palloc(VARSIZE(array));
+    memcpy(cache->array, array, VARSIZE(array));
+    
+    MemoryContextSwitchTo(oldcontext);
+    
+    *isnew = true;
+    
+    return cache;
+}
+
+// RETURNS THE FIRST TWO ARRAY ARGUMENTS OF THE FUNCTION, THE STABLE ONE (IF ANY)
+// FROM THE CACHE
+void query_cache_getargs(FunctionCallInfo fcinfo, ArrayType **a1, ArrayType **a2)
+{
+    bool        isnew;
+    QueryCache *cache = query_cache_get(fcinfo, &isnew);
+    
+    *a1 = cache && cache->argno == 0 ? cache->array : PG_GETARG_ARRAYTYPE_P(0);
+    *a2 = cache && cache->argno == 1 ? cache->array : PG_GETARG_ARRAYTYPE_P(1);
+}
@@ -0,0 +1,30 @@
+#ifndef QUERYCACHE_H
+#define QUERYCACHE_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    #include "postgres.h"
+    #include "fmgr.h"
+    #include "utils/array.h"
+
+    // QUERY OPERAND OF A BINARY FUNCTION THAT IS STABLE ACROSS CALLS (A CONSTANT
+    // OR AN EXTERNAL PARAMETER); IT IS KEPT IN FN_EXTRA AND PREPARED AGAIN ONLY
+    // WHEN ITS VALUE CHANGES
+    typedef struct
+    {
+        int           argno;    // POSITION OF THE STABLE ARGUMENT OR -1
+        ArrayType    *array;    // DETOASTED COPY IN THE MEMORY CONTEXT OF THE FUNCTION
+        unsigned int  count;    // NUMBER OF NON-ZERO ELEMENTS, SET BY THE CALLER
+    } QueryCache;
+
+    QueryCache *query_cache_get(FunctionCallInfo fcinfo, bool *isnew);
+    void        query_cache_getargs(FunctionCallInfo fcinfo, ArrayType **a1, ArrayType **a2);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,155 @@
+#ifndef SIMILARITY_H
+#define SIMILARITY_H
+
+#include <algorithm>
+#include <cmath>
+
+#include "arrayxi.h"
+
+/* Counts from which the binary similarity metrics are calculated. The same
+ * formulas are shared by the arrayxi and the fingerprint metrics, only the way
+ * the counts are obtained differs.
+ *
+ * Where:
+ *        A is the count of values > 0 in object A.
+ *        B is the count of values > 0 in object B.
+ *        c is the count of equal non-zero positions in both objects.
+ *        d is the count of the zeros in both object A and object B.
+ *        n is the total number of positions.
+ */
+struct BinaryCounts
+{
+    unsigned int A;
+    unsigned int B;
+    unsigned int c;
+    unsigned int d;
+    unsigned int n;
+};
+
+// DICE SIMILARITY
+inline double dice_similarity(const BinaryCounts &counts)
+{
+    unsigned int A = counts.A, B = counts.B, c = counts.c;
+
+    if (A == 0 || B == 0) return 0.0;
+
+    return 2 * c / (double) (A+B);
+}
+
+// KULCZYNSKI SIMILARITY
+inline double kulczynski_similarity(const BinaryCounts &counts)
+{
+    unsigned int A = counts.A, B = counts.B, c = counts.c;
+
+    // AVOID DIVISION BY ZERO
+    if (A == 0 || B == 0) return 0.0;
+
+    return c * (A + B) / (double) (2 * A * B);
+}
+
+// NORMALIZED EUCLIDEAN SIMILARITY
+inline double euclidean_similarity(const BinaryCounts &counts)
+{
+    return sqrt((counts.A + counts.B - 2 * counts.c) / (double) counts.n);
+}
+
+// NORMALIZED MANHATTAN SIMILARITY
+inline double manhattan_similarity(const BinaryCounts &counts)
+{
+    return (counts.A + counts.B - 2 * counts.c) / (double) counts.n;
+}
+
+// OCHIAI/COSINE SIMILARITY
+inline double ochiai_similarity(const BinaryCounts &counts)
+{
+    unsigned int A = counts.A, B = counts.B, c = counts.c;
+
+    // AVOID DIVISION BY ZERO
+    if (A == 0 || B == 0) return 0.0;
+
+    return c / sqrt(A*B);
+}
+
+// RUSSELL-RAO SIMILARITY
+inline double russell_rao_similarity(const BinaryCounts &counts)
+{
+    return counts.c / (double) counts.n;
+}
+
+// SIMPSON SIMILARITY - FUZCAV DEFAULT SIMILARITY
+inline double simpson_similarity(const BinaryCounts &counts)
+{
+    unsigned int A = counts.A, B = counts.B, c = counts.c;
+
+    // AVOID DIVISION BY ZERO
+    if (A == 0 || B == 0) return 0.0;
+
+    return c / (double) std::min(A,B);
+}
+
+// SIMPSON SIMILARITY WITH MAX() INSTEAD OF MIN()
+inline double simpson_global_similarity(const BinaryCounts &counts)
+{
+    unsigned int A = counts.A, B = counts.B, c = counts.c;
+
+    // AVOID DIVISION BY ZERO
+    if (A == 0 || B == 0) return 0.0;
+
+    return c / (double) std::max(A,B);
+}
+
+// TANIMOTO/JACCARD SIMILARITY (I.E. TVERSKY ALPHA=1, BETA=1)
+inline double tanimoto_similarity(const BinaryCounts &counts)
+{
+    unsigned int A = counts.A, B = counts.B, c = counts.c;
+
+    // AVOID DIVISION BY ZERO
+    if (A == 0 || B == 0) return 0.0;
+
+    return c / (double) (A + B - c);
+}
+
+// TVERSKY SIMILARITY
+inline double tversky_similarity(const BinaryCounts &counts, float alpha, float beta)
+{
+    unsigned int A = counts.A, B = counts.B, c = counts.c;
+
+    // AVOID DIVISION BY ZERO
+    if (A == 0 || B == 0) return 0.0;
+
+    return c / (double) (alpha * A + beta * B + (1 - alpha - beta) * c);
+}
+
+// FUZCAV SIMILARITY
+inline double fuzcav_similarity(const BinaryCounts &counts)
+{
+    return counts.c / (double) std::max(counts.A, counts.B);
+}
+
+// CALCULATES THE GIVEN BINARY SIMILARITY METRIC FROM THE COUNTS
+inline double binary_similarity(const BinaryCounts &counts, ArrayXiMetric metric)
+{
+    switch (metric)
+    {
+        case ARRAYXI_DICE:           return dice_similarity(counts);
+        case ARRAYXI_EUCLIDEAN:      return euclidean_similarity(counts);
+        case ARRAYXI_KULCZYNSKI:     return kulczynski_similarity(counts);
+        case ARRAYXI_MANHATTAN:      return manhattan_similarity(counts);
+        case ARRAYXI_OCHIAI:         return ochiai_similarity(counts);
+        case ARRAYXI_RUSSELL_RAO:    return russell_rao_similarity(counts);
+        case ARRAYXI_SIMPSON:        return simpson_similarity(counts);
+        case ARRAYXI_SIMPSON_GLOBAL: return simpson_global_similarity(counts);
+        case ARRAYXI_TANIMOTO:       return tanimoto_similarity(counts);
+        case ARRAYXI_FUZCAV:         return fuzcav_similarity(counts);
+        
+        case ARRAYXI_TVERSKY:        
+            return tversky_similarity(counts, arrayxi_tversky_alpha, arrayxi_tversky_beta);
+    }
+    
+    ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR), 
+                    errmsg("unknown arrayxi similarity metric: %d", (int) metric)));
+    
+    return 0.0;
+}
+
+#endif
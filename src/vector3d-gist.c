@@ -0,0 +1,296 @@
+#include "vector3d.h"
+#include "fmgr.h"
+#include "access/gist.h"
+
+
+// STRATEGY NUMBERS OF THE OPERATORS, THE SAME AS FOR THE BUILT-IN GEOMETRIC TYPES
+#define VECTOR3D_WITHIN_STRATEGY      8     // <@
+#define VECTOR3D_DISTANCE_STRATEGY    15    // ->
+
+
+/////////////////////////////BOUNDING BOX HELPERS///////////////////////////////
+
+
+// RETURNS THE SUM OF THE EDGE LENGTHS OF THE BOX; UNLIKE THE VOLUME IT DOES NOT
+// VANISH FOR THE FLAT OR DEGENERATE BOXES OF SINGLE POINTS
+static double vector3d_box_margin(Vector3dBoxType *box)
+{
+    return (box->high[0] - box->low[0]) + (box->high[1] - box->low[1]) + (box->high[2] - box->low[2]);
+}
+
+// EXTENDS THE RESULT TO INCLUDE THE BOX
+static void vector3d_box_union(Vector3dBoxType *result, Vector3dBoxType *box)
+{
+    int i;
+
+    for (i = 0; i < 3; i++)
+    {
+        result->low[i] = Min(result->low[i], box->low[i]);
+        result->high[i] = Max(result->high[i], box->high[i]);
+    }
+}
+
+// RETURNS A COPY OF THE BOX
+static Vector3dBoxType *vector3d_box_copy(Vector3dBoxType *box)
+{
+    Vector3dBoxType *copy = (Vector3dBoxType *) palloc(sizeof(Vector3dBoxType));
+
+    memcpy(copy, box, sizeof(Vector3dBoxType));
+
+    return copy;
+}
+
+// RETURNS THE CORNER OF A LEAF KEY, WHICH IS THE INDEXED VECTOR ITSELF
+static Vector3dType *vector3d_box_point(Vector3dBoxType *box)
+{
+    return (Vector3dType *) box->low;
+}
+
+
+///////////////////////////GIST SUPPORT FUNCTIONS///////////////////////////////
+
+
+// RETURNS FALSE IF NO VECTOR IN THE BOX CAN BE WITHIN THE SPHERE
+PG_FUNCTION_INFO_V1(gist_vector3d_consistent);
+Datum gist_vector3d_consistent(PG_FUNCTION_ARGS)
+{
+    GISTENTRY          *entry = (GISTENTRY *) PG_GETARG_POINTER(0);
+    StrategyNumber      strategy = (StrategyNumber) PG_GETARG_UINT16(2);
+    bool               *recheck = (bool *) PG_GETARG_POINTER(4);
+
+    Vector3dBoxType    *box = DatumGetVector3dBoxP(entry->key);
+    Vector3dSphereType *sphere;
+
+    if (strategy != VECTOR3D_WITHIN_STRATEGY)
+    {
+        ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR),
+                        errmsg("unrecognized strategy number: %d", strategy)));
+    }
+
+    sphere = PG_GETARG_VECTOR3D_SPHERE_P(1);
+
+    // LEAF KEYS STORE THE EXACT COORDINATES
+    *recheck = false;
+
+    if (GIST_LEAF(entry))
+    {
+        PG_RETURN_BOOL(Vector3dDistance(vector3d_box_point(box), &sphere->center) <= sphere->radius);
+    }
+
+    PG_RETURN_BOOL(Vector3dBoxDistance(box, &sphere->center) <= sphere->radius);
+}
+
+// RETURNS THE SMALLEST DISTANCE BETWEEN THE QUERY AND ANY VECTOR IN THE BOX
+PG_FUNCTION_INFO_V1(gist_vector3d_distance);
+Datum gist_vector3d_distance(PG_FUNCTION_ARGS)
+{
+    GISTENTRY       *entry = (GISTENTRY *) PG_GETARG_POINTER(0);
+    Vector3dType    *query = PG_GETARG_VECTOR3D_P(1);
+    StrategyNumber   strategy = (StrategyNumber) PG_GETARG_UINT16(2);
+    bool            *recheck = (bool *) PG_GETARG_POINTER(4);
+
+    Vector3dBoxType *box = DatumGetVector3dBoxP(entry->key);
+
+    if (strategy != VECTOR3D_DISTANCE_STRATEGY)
+    {
+        ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR),
+                        errmsg("unrecognized strategy number: %d", strategy)));
+    }
+
+    *recheck = false;
+
+    if (GIST_LEAF(entry)) PG_RETURN_FLOAT8(Vector3dDistance(vector3d_box_point(box), query));
+
+    PG_RETURN_FLOAT8(Vector3dBoxDistance(box, query));
+}
+
+// RETURNS THE BOUNDING BOX OF ALL KEYS
+PG_FUNCTION_INFO_V1(gist_vector3d_union);
+Datum gist_vector3d_union(PG_FUNCTION_ARGS)
+{
+    GistEntryVector *entryvec = (GistEntryVector *) PG_GETARG_POINTER(0);
+    int             *size = (int *) PG_GETARG_POINTER(1);
+
+    Vector3dBoxType *result = vector3d_box_copy(DatumGetVector3dBoxP(entryvec->vector[0].key));
+    int              i;
+
+    for (i = 1; i < entryvec->n; i++)
+    {
+        vector3d_box_union(result, DatumGetVector3dBoxP(entryvec->vector[i].key));
+    }
+
+    *size = sizeof(Vector3dBoxType);
+
+    PG_RETURN_VECTOR3D_BOX_P(result);
+}
+
+// CONVERTS A LEAF VECTOR INTO A BOX WITHOUT EXTENT
+PG_FUNCTION_INFO_V1(gist_vector3d_compress);
+Datum gist_vector3d_compress(PG_FUNCTION_ARGS)
+{
+    GISTENTRY *entry = (GISTENTRY *) PG_GETARG_POINTER(0);
+    GISTENTRY *retval;
+
+    if (entry->leafkey)
+    {
+        Vector3dType    *vector = DatumGetVector3dP(entry->key);
+        Vector3dBoxType *box = (Vector3dBoxType *) palloc(sizeof(Vector3dBoxType));
+
+        memcpy(box->low, vector->xyz, sizeof(box->low));
+        memcpy(box->high, vector->xyz, sizeof(box->high));
+
+        retval = (GISTENTRY *) palloc(sizeof(GISTENTRY));
+        gistentryinit(*retval, PointerGetDatum(box), entry->rel, entry->page, entry->offset, false);
+
+        PG_RETURN_POINTER(retval);
+    }
+
+    PG_RETURN_POINTER(entry);
+}
+
+// THE KEYS ARE STORED AS THEY ARE
+PG_FUNCTION_INFO_V1(gist_vector3d_decompress);
+Datum gist_vector3d_decompress(PG_FUNCTION_ARGS)
+{
+    PG_RETURN_POINTER(PG_GETARG_POINTER(0));
+}
+
+// RETURNS THE ORIGINAL VECTOR OF A LEAF KEY FOR INDEX-ONLY SCANS
+PG_FUNCTION_INFO_V1(gist_vector3d_fetch);
+Datum gist_vector3d_fetch(PG_FUNCTION_ARGS)
+{
+    GISTENTRY    *entry = (GISTENTRY *) PG_GETARG_POINTER(0);
+    Vector3dType *vector = (Vector3dType *) palloc(sizeof(Vector3dType));
+    GISTENTRY    *retval;
+
+    memcpy(vector->xyz, DatumGetVector3dBoxP(entry->key)->low, sizeof(vector->xyz));
+
+    retval = (GISTENTRY *) palloc(sizeof(GISTENTRY));
+    gistentryinit(*retval, Vector3dPGetDatum(vector), entry->rel, entry->page, entry->offset, false);
+
+    PG_RETURN_POINTER(retval);
+}
+
+// PENALTY FOR INSERTING THE NEW KEY INTO THE ORIGINAL BOX: THE GROWTH OF ITS MARGIN
+PG_FUNCTION_INFO_V1(gist_vector3d_penalty);
+Datum gist_vector3d_penalty(PG_FUNCTION_ARGS)
+{
+    GISTENTRY       *origentry = (GISTENTRY *) PG_GETARG_POINTER(0);
+    GISTENTRY       *newentry = (GISTENTRY *) PG_GETARG_POINTER(1);
+    float           *penalty = (float *) PG_GETARG_POINTER(2);
+
+    Vector3dBoxType *orig = DatumGetVector3dBoxP(origentry->key);
+    Vector3dBoxType  merged = *orig;
+
+    vector3d_box_union(&merged, DatumGetVector3dBoxP(newentry->key));
+
+    *penalty = (float) (vector3d_box_margin(&merged) - vector3d_box_margin(orig));
+
+    PG_RETURN_POINTER(penalty);
+}
+
+// ENTRY OF THE PICKSPLIT ALGORITHM SORTED BY THE CENTER OF ITS BOX
+typedef struct
+{
+    OffsetNumber offset;
+    double       center;
+} GistVector3dSplitEntry;
+
+static int gist_vector3d_split_entry_cmp(const void *a, const void *b)
+{
+    double ca = ((const GistVector3dSplitEntry *) a)->center;
+    double cb = ((const GistVector3dSplitEntry *) b)->center;
+
+    return (ca > cb) - (ca < cb);
+}
+
+/* Splits the entries of a page into two halves along the axis in which the
+ * union of all boxes has its largest extent, ordered by the centers of the
+ * boxes. For points this is the split of a k-d tree and gives compact boxes
+ * that barely overlap.
+ */
+PG_FUNCTION_INFO_V1(gist_vector3d_picksplit);
+Datum gist_vector3d_picksplit(PG_FUNCTION_ARGS)
+{
+    GistEntryVector        *entryvec = (GistEntryVector *) PG_GETARG_POINTER(0);
+    GIST_SPLITVEC          *v = (GIST_SPLITVEC *) PG_GETARG_POINTER(1);
+
+    OffsetNumber            i, maxoff = entryvec->n - 1;
+    int                     j, axis = 0, nentries = maxoff - FirstOffsetNumber + 1;
+    Vector3dBoxType        *box, *datum_l, *datum_r, bounds;
+    GistVector3dSplitEntry *entries;
+    Size                    nbytes = (maxoff + 2) * sizeof(OffsetNumber);
+
+    // BOUNDING BOX OF ALL ENTRIES AND ITS LONGEST AXIS
+    bounds = *DatumGetVector3dBoxP(entryvec->vector[FirstOffsetNumber].key);
+
+    for (i = OffsetNumberNext(FirstOffsetNumber); i <= maxoff; i = OffsetNumberNext(i))
+    {
+        vector3d_box_union(&bounds, DatumGetVector3dBoxP(entryvec->vector[i].key));
+    }
+
+    for (j = 1; j < 3; j++)
+    {
+        if (bounds.high[j] - bounds.low[j] > bounds.high[axis] - bounds.low[axis]) axis = j;
+    }
+
+    entries = (GistVector3dSplitEntry *) palloc(sizeof(GistVector3dSplitEntry) * nentries);
+
+    for (i = FirstOffsetNumber, j = 0; i <= maxoff; i = OffsetNumberNext(i), j++)
+    {
+        box = DatumGetVector3dBoxP(entryvec->vector[i].key);
+
+        entries[j].offset = i;
+        entries[j].center = (box->low[axis] + box->high[axis]) / 2;
+    }
+
+    qsort(entries, nentries, sizeof(GistVector3dSplitEntry), gist_vector3d_split_entry_cmp);
+
+    v->spl_left = (OffsetNumber *) palloc(nbytes);
+    v->spl_right = (OffsetNumber *) palloc(nbytes);
+    v->spl_nleft = 0;
+    v->spl_nright = 0;
+
+    datum_l = NULL;
+    datum_r = NULL;
+
+    for (j = 0; j < nentries; j++)
+    {
+        box = DatumGetVector3dBoxP(entryvec->vector[entries[j].offset].key);
+
+        if (j < nentries / 2)
+        {
+            if (datum_l == NULL) datum_l = vector3d_box_copy(box);
+            else vector3d_box_union(datum_l, box);
+
+            v->spl_left[v->spl_nleft++] = entries[j].offset;
+        }
+        else
+        {
+            if (datum_r == NULL) datum_r = vector3d_box_copy(box);
+            else vector3d_box_union(datum_r, box);
+
+            v->spl_right[v->spl_nright++] = entries[j].offset;
+        }
+    }
+
+    pfree(entries);
+
+    v->spl_ldatum = PointerGetDatum(datum_l);
+    v->spl_rdatum = PointerGetDatum(datum_r);
+
+    PG_RETURN_POINTER(v);
+}
+
+// RETURNS TRUE IF BOTH BOXES ARE IDENTICAL
+PG_FUNCTION_INFO_V1(gist_vector3d_same);
+Datum gist_vector3d_same(PG_FUNCTION_ARGS)
+{
+    Vector3dBoxType *b1 = PG_GETARG_VECTOR3D_BOX_P(0);
+    Vector3dBoxType *b2 = PG_GETARG_VECTOR3D_BOX_P(1);
+    bool            *result = (bool *) PG_GETARG_POINTER(2);
+
+    *result = memcmp(b1, b2, sizeof(Vector3dBoxType)) == 0;
+
+    PG_RETURN_POINTER(result);
+}
\ No newline at end of file
@@ -1,5 +1,148 @@
+#include <ctype.h>
+
 #include "vector3d.h"
+#include "abbrevkey.h"
 #include "fmgr.h"
+#include "libpq/pqformat.h"
+#include "utils/builtins.h"
+#include "utils/memutils.h"
+
+
+
+///////////////////////////////INPUT/OUTPUT/////////////////////////////////////
+
+
+// PARSES THE COORDINATES (X,Y,Z) OR {X,Y,Z} AT THE START OF THE STRING AND 
+// RETURNS A POINTER BEHIND THEM OR NULL IF THE SYNTAX IS INVALID
+static char *vector3d_parse(char *cur, double *xyz)
+{
+    char close;
+    int  i;
+    
+    while (isspace((unsigned char) *cur)) cur++;
+    
+    if (*cur == '(') close = ')';
+    else if (*cur == '{') close = '}';
+    else return NULL;
+    
+    cur++;
+    
+    for (i = 0; i < 3; i++)
+    {
+        char *end;
+        
+        errno = 0;
+        xyz[i] = strtod(cur, &end);
+        
+        if (end == cur || errno == ERANGE) return NULL;
+        
+        cur = end;
+        while (isspace((unsigned char) *cur)) cur++;
+        
+        // COORDINATES ARE SEPARATED BY COMMAS
+        if (i < 2)
+        {
+            if (*cur != ',') return NULL;
+            cur++;
+        }
+    }
+    
+    if (*cur != close) return NULL;
+    cur++;
+    
+    while (isspace((unsigned char) *cur)) cur++;
+    
+    return cur;
+}
+
+// RETURNS THE COORDINATES AS TEXT (X,Y,Z)
+static char *vector3d_format(const double *xyz)
+{
+    // USE THE FLOAT8 OUTPUT FUNCTION TO HONOUR EXTRA_FLOAT_DIGITS
+    char *x = DatumGetCString(DirectFunctionCall1(float8out, Float8GetDatum(xyz[0])));
+    char *y = DatumGetCString(DirectFunctionCall1(float8out, Float8GetDatum(xyz[1])));
+    char *z = DatumGetCString(DirectFunctionCall1(float8out, Float8GetDatum(xyz[2])));
+    
+    return psprintf("(%s,%s,%s)", x, y, z);
+}
+
+// PARSES A VECTOR3D FROM ITS TEXT REPRESENTATION (X,Y,Z); CURLY BRACES ARE
+// ACCEPTED AS WELL SO THAT LITERALS OF THE OLD ARRAY DOMAIN STILL WORK
+PG_FUNCTION_INFO_V1(vector3d_in);
+Datum vector3d_in(PG_FUNCTION_ARGS)
+{
+    char         *str = PG_GETARG_CSTRING(0);
+    Vector3dType *result = (Vector3dType *) palloc(sizeof(Vector3dType));
+    char         *cur = vector3d_parse(str, result->xyz);
+    
+    if (cur == NULL || *cur != '\0')
+    {
+        ereport(ERROR, (errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
+                        errmsg("invalid input syntax for type vector3d: \"%s\"", str)));
+    }
+    
+    PG_RETURN_VECTOR3D_P(result);
+}
+
+// RETURNS THE TEXT REPRESENTATION (X,Y,Z) OF A VECTOR3D
+PG_FUNCTION_INFO_V1(vector3d_out);
+Datum vector3d_out(PG_FUNCTION_ARGS)
+{
+    Vector3dType *vector = PG_GETARG_VECTOR3D_P(0);
+    
+    PG_RETURN_CSTRING(vector3d_format(vector->xyz));
+}
+
+// BINARY INPUT
+PG_FUNCTION_INFO_V1(vector3d_recv);
+Datum vector3d_recv(PG_FUNCTION_ARGS)
+{
+    StringInfo    buf = (StringInfo) PG_GETARG_POINTER(0);
+    Vector3dType *result = (Vector3dType *) palloc(sizeof(Vector3dType));
+    
+    result->xyz[0] = pq_getmsgfloat8(buf);
+    result->xyz[1] = pq_getmsgfloat8(buf);
+    result->xyz[2] = pq_getmsgfloat8(buf);
+    
+    PG_RETURN_VECTOR3D_P(result);
+}
+
+// BINARY OUTPUT
+PG_FUNCTION_INFO_V1(vector3d_send);
+Datum vector3d_send(PG_FUNCTION_ARGS)
+{
+    Vector3dType  *vector = PG_GETARG_VECTOR3D_P(0);
+    StringInfoData buf;
+    
+    pq_begintypsend(&buf);
+    pq_sendfloat8(&buf, vector->xyz[0]);
+    pq_sendfloat8(&buf, vector->xyz[1]);
+    pq_sendfloat8(&buf, vector->xyz[2]);
+    
+    PG_RETURN_BYTEA_P(pq_endtypsend(&buf));
+}
+
+
+//////////////////////////////////CASTS/////////////////////////////////////////
+
+
+// CAST FROM FLOAT8[]
+PG_FUNCTION_INFO_V1(vector3d_from_array);
+Datum vector3d_from_array(PG_FUNCTION_ARGS)
+{
+    ArrayType *array = PG_GETARG_ARRAYTYPE_P(0);
+    
+    PG_RETURN_VECTOR3D_P(Vector3dFromArray(array));
+}
+
+// CAST TO FLOAT8[]
+PG_FUNCTION_INFO_V1(vector3d_to_array);
+Datum vector3d_to_array(PG_FUNCTION_ARGS)
+{
+    Vector3dType *vector = PG_GETARG_VECTOR3D_P(0);
+    
+    PG_RETURN_ARRAYTYPE_P(Vector3dToArray(vector));
+}
 
 
 
@@ -12,14 +155,14 @@ Datum vector3d_constant(PG_FUNCTION_ARGS)
 {
     double value = PG_GETARG_FLOAT8(0);
     
-    PG_RETURN_ARRAYTYPE_P(Vector3dConstant(value));
+    PG_RETURN_VECTOR3D_P(Vector3dConstant(value));
 }
 
 // 
 PG_FUNCTION_INFO_V1(vector3d_random);
 Datum vector3d_random(PG_FUNCTION_ARGS)
 {
-    PG_RETURN_ARRAYTYPE_P(Vector3dRandom());
+    PG_RETURN_VECTOR3D_P(Vector3dRandom());
 }
 
 
@@ -30,106 +173,666 @@ Datum vector3d_random(PG_FUNCTION_ARGS)
 PG_FUNCTION_INFO_V1(vector3d_add);
 Datum vector3d_add(PG_FUNCTION_ARGS)
 {
-    ArrayType *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType *a2 = PG_GETARG_ARRAYTYPE_P(1);
+    Vector3dType *v1 = PG_GETARG_VECTOR3D_P(0);
+    Vector3dType *v2 = PG_GETARG_VECTOR3D_P(1);
 
-    PG_RETURN_ARRAYTYPE_P(Vector3dAdd(a1,a2));
+    PG_RETURN_VECTOR3D_P(Vector3dAdd(v1, v2));
 }
 
 // VECTOR SUBTRACTION
 PG_FUNCTION_INFO_V1(vector3d_subtract);
 Datum vector3d_subtract(PG_FUNCTION_ARGS)
 {
-    ArrayType *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType *a2 = PG_GETARG_ARRAYTYPE_P(1);
+    Vector3dType *v1 = PG_GETARG_VECTOR3D_P(0);
+    Vector3dType *v2 = PG_GETARG_VECTOR3D_P(1);
 
-    PG_RETURN_ARRAYTYPE_P(Vector3dSubtract(a1,a2));
+    PG_RETURN_VECTOR3D_P(Vector3dSubtract(v1, v2));
 }
 
 // VECTOR DIVISION BY SCALAR
 PG_FUNCTION_INFO_V1(vector3d_scalar_division);
 Datum vector3d_scalar_division(PG_FUNCTION_ARGS)
 {
-    ArrayType *array = PG_GETARG_ARRAYTYPE_P(0);
-    double     scalar = PG_GETARG_FLOAT8(1);
+    Vector3dType *vector = PG_GETARG_VECTOR3D_P(0);
+    double        scalar = PG_GETARG_FLOAT8(1);
     
-    PG_RETURN_ARRAYTYPE_P(Vector3dScalarDivision(array, scalar));
+    PG_RETURN_VECTOR3D_P(Vector3dScalarDivision(vector, scalar));
 }
 
 // VECTOR MULTIPLICATION BY SCALAR
 PG_FUNCTION_INFO_V1(vector3d_scalar_product);
 Datum vector3d_scalar_product(PG_FUNCTION_ARGS)
 {
-    ArrayType *array = PG_GETARG_ARRAYTYPE_P(0);
-    double     scalar = PG_GETARG_FLOAT8(1);
+    Vector3dType *vector = PG_GETARG_VECTOR3D_P(0);
+    double        scalar = PG_GETARG_FLOAT8(1);
     
-    PG_RETURN_ARRAYTYPE_P(Vector3dScalarProduct(array, scalar));
+    PG_RETURN_VECTOR3D_P(Vector3dScalarProduct(vector, scalar));
 }
 
 // VECTOR DOT PRODUCT
 PG_FUNCTION_INFO_V1(vector3d_dot);
 Datum vector3d_dot(PG_FUNCTION_ARGS)
 {
-    ArrayType *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType *a2 = PG_GETARG_ARRAYTYPE_P(1);
+    Vector3dType *v1 = PG_GETARG_VECTOR3D_P(0);
+    Vector3dType *v2 = PG_GETARG_VECTOR3D_P(1);
 
-    PG_RETURN_FLOAT8(Vector3dDot(a1,a2));
+    PG_RETURN_FLOAT8(Vector3dDot(v1, v2));
 }
 
 // VECTOR CROSS PRODUCT
 PG_FUNCTION_INFO_V1(vector3d_cross);
 Datum vector3d_cross(PG_FUNCTION_ARGS)
 {
-    ArrayType *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType *a2 = PG_GETARG_ARRAYTYPE_P(1);
+    Vector3dType *v1 = PG_GETARG_VECTOR3D_P(0);
+    Vector3dType *v2 = PG_GETARG_VECTOR3D_P(1);
 
-    PG_RETURN_ARRAYTYPE_P(Vector3dCross(a1, a2));
+    PG_RETURN_VECTOR3D_P(Vector3dCross(v1, v2));
 }
 
 // CALCULATES THE NORM/LENGTH OF THE VECTOR
 PG_FUNCTION_INFO_V1(vector3d_norm);
 Datum vector3d_norm(PG_FUNCTION_ARGS)
 {
-    ArrayType *vector3d = PG_GETARG_ARRAYTYPE_P(0);
+    Vector3dType *vector = PG_GETARG_VECTOR3D_P(0);
 
-    PG_RETURN_FLOAT8(Vector3dNorm(vector3d));
+    PG_RETURN_FLOAT8(Vector3dNorm(vector));
 }
 
 // RETURNS THE NORMALIZED VECTOR
 PG_FUNCTION_INFO_V1(vector3d_normalized);
 Datum vector3d_normalized(PG_FUNCTION_ARGS)
 {
-    ArrayType *array = PG_GETARG_ARRAYTYPE_P(0);
+    Vector3dType *vector = PG_GETARG_VECTOR3D_P(0);
 
-    PG_RETURN_ARRAYTYPE_P(Vector3dNormalized(array));
+    PG_RETURN_VECTOR3D_P(Vector3dNormalized(vector));
 }
 
 // DISTANCE BETWEEN VECTORS
 PG_FUNCTION_INFO_V1(vector3d_distance);
 Datum vector3d_distance(PG_FUNCTION_ARGS)
 {
-    ArrayType *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType *a2 = PG_GETARG_ARRAYTYPE_P(1);
+    Vector3dType *v1 = PG_GETARG_VECTOR3D_P(0);
+    Vector3dType *v2 = PG_GETARG_VECTOR3D_P(1);
 
-    PG_RETURN_FLOAT8(Vector3dDistance(a1,a2));
+    PG_RETURN_FLOAT8(Vector3dDistance(v1, v2));
 }
 
 // ANGLE BETWEEN VECTORS
 PG_FUNCTION_INFO_V1(vector3d_angle);
 Datum vector3d_angle(PG_FUNCTION_ARGS)
 {
-    ArrayType *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType *a2 = PG_GETARG_ARRAYTYPE_P(1);
+    Vector3dType *v1 = PG_GETARG_VECTOR3D_P(0);
+    Vector3dType *v2 = PG_GETARG_VECTOR3D_P(1);
 
-    PG_RETURN_FLOAT8(Vector3dAngle(a1,a2));
+    PG_RETURN_FLOAT8(Vector3dAngle(v1, v2));
 }
 
 // ABSOLUTE ANGLE BETWEEN VECTORS
 PG_FUNCTION_INFO_V1(vector3d_abs_angle);
 Datum vector3d_abs_angle(PG_FUNCTION_ARGS)
 {
-    ArrayType *a1 = PG_GETARG_ARRAYTYPE_P(0);
-    ArrayType *a2 = PG_GETARG_ARRAYTYPE_P(1);
+    Vector3dType *v1 = PG_GETARG_VECTOR3D_P(0);
+    Vector3dType *v2 = PG_GETARG_VECTOR3D_P(1);
+
+    PG_RETURN_FLOAT8(Vector3dAbsAngle(v1, v2));
+}
+
+///////////////////////////////////ORDERING/////////////////////////////////////
+
+
+// RETURNS TRUE IF BOTH VECTORS HAVE THE SAME COORDINATES
+PG_FUNCTION_INFO_V1(vector3d_eq);
+Datum vector3d_eq(PG_FUNCTION_ARGS)
+{
+    Vector3dType *v1 = PG_GETARG_VECTOR3D_P(0);
+    Vector3dType *v2 = PG_GETARG_VECTOR3D_P(1);
+
+    PG_RETURN_BOOL(Vector3dCmp(v1, v2) == 0);
+}
+
+// RETURNS TRUE IF THE VECTORS ARE DISTINCT
+PG_FUNCTION_INFO_V1(vector3d_ne);
+Datum vector3d_ne(PG_FUNCTION_ARGS)
+{
+    Vector3dType *v1 = PG_GETARG_VECTOR3D_P(0);
+    Vector3dType *v2 = PG_GETARG_VECTOR3D_P(1);
+
+    PG_RETURN_BOOL(Vector3dCmp(v1, v2) != 0);
+}
+
+// Z-ORDER COMPARISONS OF THE B-TREE OPERATOR CLASS
+PG_FUNCTION_INFO_V1(vector3d_lt);
+Datum vector3d_lt(PG_FUNCTION_ARGS)
+{
+    Vector3dType *v1 = PG_GETARG_VECTOR3D_P(0);
+    Vector3dType *v2 = PG_GETARG_VECTOR3D_P(1);
+
+    PG_RETURN_BOOL(Vector3dCmp(v1, v2) < 0);
+}
+
+PG_FUNCTION_INFO_V1(vector3d_le);
+Datum vector3d_le(PG_FUNCTION_ARGS)
+{
+    Vector3dType *v1 = PG_GETARG_VECTOR3D_P(0);
+    Vector3dType *v2 = PG_GETARG_VECTOR3D_P(1);
+
+    PG_RETURN_BOOL(Vector3dCmp(v1, v2) <= 0);
+}
+
+PG_FUNCTION_INFO_V1(vector3d_gt);
+Datum vector3d_gt(PG_FUNCTION_ARGS)
+{
+    Vector3dType *v1 = PG_GETARG_VECTOR3D_P(0);
+    Vector3dType *v2 = PG_GETARG_VECTOR3D_P(1);
+
+    PG_RETURN_BOOL(Vector3dCmp(v1, v2) > 0);
+}
+
+PG_FUNCTION_INFO_V1(vector3d_ge);
+Datum vector3d_ge(PG_FUNCTION_ARGS)
+{
+    Vector3dType *v1 = PG_GETARG_VECTOR3D_P(0);
+    Vector3dType *v2 = PG_GETARG_VECTOR3D_P(1);
+
+    PG_RETURN_BOOL(Vector3dCmp(v1, v2) >= 0);
+}
+
+// COMPARISON SUPPORT FUNCTION OF THE B-TREE OPERATOR CLASS
+PG_FUNCTION_INFO_V1(vector3d_cmp);
+Datum vector3d_cmp(PG_FUNCTION_ARGS)
+{
+    Vector3dType *v1 = PG_GETARG_VECTOR3D_P(0);
+    Vector3dType *v2 = PG_GETARG_VECTOR3D_P(1);
+
+    PG_RETURN_INT32(Vector3dCmp(v1, v2));
+}
+
+static int vector3d_fastcmp(Datum x, Datum y, SortSupport ssup)
+{
+    return Vector3dCmp(DatumGetVector3dP(x), DatumGetVector3dP(y));
+}
+
+// THE ABBREVIATED KEY IS THE MORTON CODE OF THE LEADING BITS OF THE COORDINATES
+static Datum vector3d_abbrev_convert(Datum original, SortSupport ssup)
+{
+    return abbrev_key_datum(Vector3dMortonCode(DatumGetVector3dP(original)), ssup);
+}
+
+// SORT SUPPORT FUNCTION OF THE B-TREE OPERATOR CLASS
+PG_FUNCTION_INFO_V1(vector3d_sortsupport);
+Datum vector3d_sortsupport(PG_FUNCTION_ARGS)
+{
+    SortSupport ssup = (SortSupport) PG_GETARG_POINTER(0);
+
+    ssup->comparator = vector3d_fastcmp;
+    abbrev_key_setup(ssup, vector3d_abbrev_convert);
+
+    PG_RETURN_VOID();
+}
+
+
+//////////////////////////////////AGGREGATES////////////////////////////////////
+
+
+// TRANSITION STATE OF SUM(VECTOR3D) AND AVG(VECTOR3D)
+typedef struct
+{
+    int64  count;
+    double sum[3];
+} Vector3dSumState;
+
+// TRANSITION STATE OF CONCAT(VECTOR3D): THE COORDINATES OF ALL VECTORS IN A
+// BUFFER THAT DOUBLES IN SIZE WHENEVER IT IS FULL
+typedef struct
+{
+    int     count;
+    int     capacity;
+    double *coords;
+} Vector3dConcatState;
+
+#define VECTOR3D_CONCAT_MIN_CAPACITY  64
+#define VECTOR3D_CONCAT_MAX_CAPACITY  ((int) (MaxAllocSize / (3 * sizeof(double))))
+
+// RETURNS THE MEMORY CONTEXT OF THE AGGREGATE THAT HOLDS THE TRANSITION STATE
+static MemoryContext vector3d_aggcontext(FunctionCallInfo fcinfo)
+{
+    MemoryContext aggcontext;
+
+    if (!AggCheckCallContext(fcinfo, &aggcontext))
+    {
+        ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR),
+                        errmsg("vector3d aggregate function called in non-aggregate context")));
+    }
+
+    return aggcontext;
+}
+
+// MAKES ROOM FOR AT LEAST THE GIVEN NUMBER OF ADDITIONAL VECTORS
+static void vector3d_concat_reserve(Vector3dConcatState *state, int count, MemoryContext aggcontext)
+{
+    int capacity = Max(state->capacity, VECTOR3D_CONCAT_MIN_CAPACITY);
+
+    if (count > VECTOR3D_CONCAT_MAX_CAPACITY - state->count)
+    {
+        ereport(ERROR, (errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+                        errmsg("too many vectors to concatenate")));
+    }
+
+    if (state->count + count <= state->capacity) return;
+
+    while (capacity < state->count + count) capacity = Min(2 * (Size) capacity, VECTOR3D_CONCAT_MAX_CAPACITY);
+
+    if (state->coords == NULL)
+    {
+        state->coords = (double *) MemoryContextAlloc(aggcontext, capacity * 3 * sizeof(double));
+    }
+    else state->coords = (double *) repalloc(state->coords, capacity * 3 * sizeof(double));
+
+    state->capacity = capacity;
+}
+
+// ADDS THE VECTOR TO THE RUNNING SUM
+PG_FUNCTION_INFO_V1(vector3d_sum_accum);
+Datum vector3d_sum_accum(PG_FUNCTION_ARGS)
+{
+    MemoryContext     aggcontext = vector3d_aggcontext(fcinfo);
+    Vector3dSumState *state = PG_ARGISNULL(0) ? NULL : (Vector3dSumState *) PG_GETARG_POINTER(0);
+
+    if (state == NULL) state = (Vector3dSumState *) MemoryContextAllocZero(aggcontext, sizeof(Vector3dSumState));
+
+    if (!PG_ARGISNULL(1))
+    {
+        Vector3dType *vector = PG_GETARG_VECTOR3D_P(1);
+
+        state->count++;
+        state->sum[0] += vector->xyz[0];
+        state->sum[1] += vector->xyz[1];
+        state->sum[2] += vector->xyz[2];
+    }
+
+    PG_RETURN_POINTER(state);
+}
+
+// MERGES TWO PARTIAL SUMS
+PG_FUNCTION_INFO_V1(vector3d_sum_combine);
+Datum vector3d_sum_combine(PG_FUNCTION_ARGS)
+{
+    MemoryContext     aggcontext = vector3d_aggcontext(fcinfo);
+    Vector3dSumState *state1 = PG_ARGISNULL(0) ? NULL : (Vector3dSumState *) PG_GETARG_POINTER(0);
+    Vector3dSumState *state2 = PG_ARGISNULL(1) ? NULL : (Vector3dSumState *) PG_GETARG_POINTER(1);
+
+    if (state2 == NULL)
+    {
+        if (state1 == NULL) PG_RETURN_NULL();
 
-    PG_RETURN_FLOAT8(Vector3dAbsAngle(a1,a2));
-}
\ No newline at end of file
+        PG_RETURN_POINTER(state1);
+    }
+
+    if (state1 == NULL)
+    {
+        state1 = (Vector3dSumState *) MemoryContextAlloc(aggcontext, sizeof(Vector3dSumState));
+        memcpy(state1, state2, sizeof(Vector3dSumState));
+
+        PG_RETURN_POINTER(state1);
+    }
+
+    state1->count += state2->count;
+    state1->sum[0] += state2->sum[0];
+    state1->sum[1] += state2->sum[1];
+    state1->sum[2] += state2->sum[2];
+
+    PG_RETURN_POINTER(state1);
+}
+
+// SERIALIZES THE PARTIAL SUM FOR THE TRANSFER FROM A PARALLEL WORKER
+PG_FUNCTION_INFO_V1(vector3d_sum_serialize);
+Datum vector3d_sum_serialize(PG_FUNCTION_ARGS)
+{
+    Vector3dSumState *state = (Vector3dSumState *) PG_GETARG_POINTER(0);
+    StringInfoData    buf;
+
+    vector3d_aggcontext(fcinfo);
+
+    pq_begintypsend(&buf);
+    pq_sendint64(&buf, state->count);
+    pq_sendfloat8(&buf, state->sum[0]);
+    pq_sendfloat8(&buf, state->sum[1]);
+    pq_sendfloat8(&buf, state->sum[2]);
+
+    PG_RETURN_BYTEA_P(pq_endtypsend(&buf));
+}
+
+// DESERIALIZES A PARTIAL SUM
+PG_FUNCTION_INFO_V1(vector3d_sum_deserialize);
+Datum vector3d_sum_deserialize(PG_FUNCTION_ARGS)
+{
+    bytea            *sstate = PG_GETARG_BYTEA_PP(0);
+    Vector3dSumState *state;
+    StringInfoData    buf;
+
+    vector3d_aggcontext(fcinfo);
+
+    buf.data = VARDATA_ANY(sstate);
+    buf.len = VARSIZE_ANY_EXHDR(sstate);
+    buf.maxlen = 0;
+    buf.cursor = 0;
+
+    state = (Vector3dSumState *) palloc(sizeof(Vector3dSumState));
+
+    state->count = pq_getmsgint64(&buf);
+    state->sum[0] = pq_getmsgfloat8(&buf);
+    state->sum[1] = pq_getmsgfloat8(&buf);
+    state->sum[2] = pq_getmsgfloat8(&buf);
+
+    pq_getmsgend(&buf);
+
+    PG_RETURN_POINTER(state);
+}
+
+// RETURNS THE SUM OF ALL VECTORS OR NULL IF THERE WERE NONE
+PG_FUNCTION_INFO_V1(vector3d_sum_final);
+Datum vector3d_sum_final(PG_FUNCTION_ARGS)
+{
+    Vector3dSumState *state = PG_ARGISNULL(0) ? NULL : (Vector3dSumState *) PG_GETARG_POINTER(0);
+    Vector3dType     *vector;
+
+    if (state == NULL || state->count == 0) PG_RETURN_NULL();
+
+    vector = (Vector3dType *) palloc(sizeof(Vector3dType));
+    memcpy(vector->xyz, state->sum, sizeof(vector->xyz));
+
+    PG_RETURN_VECTOR3D_P(vector);
+}
+
+// RETURNS THE MEAN OF ALL VECTORS (E.G. THE CENTROID OF A SET OF COORDINATES)
+// OR NULL IF THERE WERE NONE
+PG_FUNCTION_INFO_V1(vector3d_avg_final);
+Datum vector3d_avg_final(PG_FUNCTION_ARGS)
+{
+    Vector3dSumState *state = PG_ARGISNULL(0) ? NULL : (Vector3dSumState *) PG_GETARG_POINTER(0);
+    Vector3dType      mean;
+
+    if (state == NULL || state->count == 0) PG_RETURN_NULL();
+
+    mean.xyz[0] = state->sum[0] / state->count;
+    mean.xyz[1] = state->sum[1] / state->count;
+    mean.xyz[2] = state->sum[2] / state->count;
+
+    PG_RETURN_ARRAYTYPE_P(Vector3dToArray(&mean));
+}
+
+// APPENDS THE VECTOR TO THE BUFFER
+PG_FUNCTION_INFO_V1(vector3d_concat_accum);
+Datum vector3d_concat_accum(PG_FUNCTION_ARGS)
+{
+    MemoryContext        aggcontext = vector3d_aggcontext(fcinfo);
+    Vector3dConcatState *state = PG_ARGISNULL(0) ? NULL : (Vector3dConcatState *) PG_GETARG_POINTER(0);
+
+    if (state == NULL) state = (Vector3dConcatState *) MemoryContextAllocZero(aggcontext, sizeof(Vector3dConcatState));
+
+    if (!PG_ARGISNULL(1))
+    {
+        Vector3dType *vector = PG_GETARG_VECTOR3D_P(1);
+
+        vector3d_concat_reserve(state, 1, aggcontext);
+        memcpy(state->coords + 3 * state->count, vector->xyz, sizeof(vector->xyz));
+        state->count++;
+    }
+
+    PG_RETURN_POINTER(state);
+}
+
+// APPENDS THE VECTORS OF THE SECOND PARTIAL RESULT TO THE FIRST ONE
+PG_FUNCTION_INFO_V1(vector3d_concat_combine);
+Datum vector3d_concat_combine(PG_FUNCTION_ARGS)
+{
+    MemoryContext        aggcontext = vector3d_aggcontext(fcinfo);
+    Vector3dConcatState *state1 = PG_ARGISNULL(0) ? NULL : (Vector3dConcatState *) PG_GETARG_POINTER(0);
+    Vector3dConcatState *state2 = PG_ARGISNULL(1) ? NULL : (Vector3dConcatState *) PG_GETARG_POINTER(1);
+
+    if (state2 == NULL)
+    {
+        if (state1 == NULL) PG_RETURN_NULL();
+
+        PG_RETURN_POINTER(state1);
+    }
+
+    if (state1 == NULL) state1 = (Vector3dConcatState *) MemoryContextAllocZero(aggcontext, sizeof(Vector3dConcatState));
+
+    if (state2->count > 0)
+    {
+        vector3d_concat_reserve(state1, state2->count, aggcontext);
+        memcpy(state1->coords + 3 * state1->count, state2->coords, state2->count * 3 * sizeof(double));
+        state1->count += state2->count;
+    }
+
+    PG_RETURN_POINTER(state1);
+}
+
+// SERIALIZES THE BUFFER; PARALLEL WORKERS RUN ON THE SAME MACHINE SO THE 
+// COORDINATES ARE COPIED AS THEY ARE
+PG_FUNCTION_INFO_V1(vector3d_concat_serialize);
+Datum vector3d_concat_serialize(PG_FUNCTION_ARGS)
+{
+    Vector3dConcatState *state = (Vector3dConcatState *) PG_GETARG_POINTER(0);
+    Size                 nbytes = state->count * 3 * sizeof(double);
+    bytea               *sstate;
+
+    vector3d_aggcontext(fcinfo);
+
+    sstate = (bytea *) palloc(VARHDRSZ + nbytes);
+    SET_VARSIZE(sstate, VARHDRSZ + nbytes);
+
+    if (nbytes > 0) memcpy(VARDATA(sstate), state->coords, nbytes);
+
+    PG_RETURN_BYTEA_P(sstate);
+}
+
+// DESERIALIZES THE BUFFER
+PG_FUNCTION_INFO_V1(vector3d_concat_deserialize);
+Datum vector3d_concat_deserialize(PG_FUNCTION_ARGS)
+{
+    bytea               *sstate = PG_GETARG_BYTEA_PP(0);
+    Size                 nbytes = VARSIZE_ANY_EXHDR(sstate);
+    Vector3dConcatState *state;
+
+    vector3d_aggcontext(fcinfo);
+
+    if (nbytes % (3 * sizeof(double)) != 0)
+    {
+        ereport(ERROR, (errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+                        errmsg("invalid vector3d concat aggregate state")));
+    }
+
+    state = (Vector3dConcatState *) palloc0(sizeof(Vector3dConcatState));
+    state->count = state->capacity = nbytes / (3 * sizeof(double));
+
+    if (nbytes > 0)
+    {
+        state->coords = (double *) palloc(nbytes);
+        memcpy(state->coords, VARDATA_ANY(sstate), nbytes);
+    }
+
+    PG_RETURN_POINTER(state);
+}
+
+// RETURNS ALL VECTORS AS MATRIX WITH ONE ROW PER VECTOR
+PG_FUNCTION_INFO_V1(vector3d_concat_final);
+Datum vector3d_concat_final(PG_FUNCTION_ARGS)
+{
+    Vector3dConcatState *state = PG_ARGISNULL(0) ? NULL : (Vector3dConcatState *) PG_GETARG_POINTER(0);
+
+    if (state == NULL) PG_RETURN_ARRAYTYPE_P(Vector3dStack(NULL, 0));
+
+    PG_RETURN_ARRAYTYPE_P(Vector3dStack(state->coords, state->count));
+}
+
+
+//////////////////////////////BOXES AND SPHERES/////////////////////////////////
+
+
+// PARSES A BOX FROM TWO OPPOSITE CORNERS (X,Y,Z),(X,Y,Z)
+PG_FUNCTION_INFO_V1(vector3d_box_in);
+Datum vector3d_box_in(PG_FUNCTION_ARGS)
+{
+    char            *str = PG_GETARG_CSTRING(0);
+    Vector3dBoxType *box = (Vector3dBoxType *) palloc(sizeof(Vector3dBoxType));
+    double           corner[3];
+    char            *cur;
+    int              i;
+    
+    cur = vector3d_parse(str, box->low);
+    
+    if (cur == NULL || *cur++ != ',') goto invalid;
+    
+    cur = vector3d_parse(cur, corner);
+    
+    if (cur == NULL || *cur != '\0') goto invalid;
+    
+    // THE CORNERS CAN BE GIVEN IN ANY ORDER
+    for (i = 0; i < 3; i++)
+    {
+        box->high[i] = Max(box->low[i], corner[i]);
+        box->low[i] = Min(box->low[i], corner[i]);
+    }
+    
+    PG_RETURN_VECTOR3D_BOX_P(box);
+    
+invalid:
+    ereport(ERROR, (errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
+                    errmsg("invalid input syntax for type vector3d_box: \"%s\"", str)));
+    
+    PG_RETURN_NULL();
+}
+
+// RETURNS THE TEXT REPRESENTATION (X,Y,Z),(X,Y,Z) OF THE LOWER AND UPPER CORNER
+PG_FUNCTION_INFO_V1(vector3d_box_out);
+Datum vector3d_box_out(PG_FUNCTION_ARGS)
+{
+    Vector3dBoxType *box = PG_GETARG_VECTOR3D_BOX_P(0);
+    
+    PG_RETURN_CSTRING(psprintf("%s,%s", vector3d_format(box->low), vector3d_format(box->high)));
+}
+
+// PARSES A SPHERE <(X,Y,Z),R>
+PG_FUNCTION_INFO_V1(vector3d_sphere_in);
+Datum vector3d_sphere_in(PG_FUNCTION_ARGS)
+{
+    char               *str = PG_GETARG_CSTRING(0);
+    Vector3dSphereType *sphere = (Vector3dSphereType *) palloc(sizeof(Vector3dSphereType));
+    char               *cur = str, *end;
+    
+    while (isspace((unsigned char) *cur)) cur++;
+    if (*cur++ != '<') goto invalid;
+    
+    cur = vector3d_parse(cur, sphere->center.xyz);
+    if (cur == NULL || *cur++ != ',') goto invalid;
+    
+    errno = 0;
+    sphere->radius = strtod(cur, &end);
+    
+    if (end == cur || errno == ERANGE || sphere->radius < 0) goto invalid;
+    
+    cur = end;
+    while (isspace((unsigned char) *cur)) cur++;
+    if (*cur++ != '>') goto invalid;
+    
+    while (isspace((unsigned char) *cur)) cur++;
+    if (*cur != '\0') goto invalid;
+    
+    PG_RETURN_VECTOR3D_SPHERE_P(sphere);
+    
+invalid:
+    ereport(ERROR, (errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
+                    errmsg("invalid input syntax for type vector3d_sphere: \"%s\"", str)));
+    
+    PG_RETURN_NULL();
+}
+
+// RETURNS THE TEXT REPRESENTATION <(X,Y,Z),R> OF THE SPHERE
+PG_FUNCTION_INFO_V1(vector3d_sphere_out);
+Datum vector3d_sphere_out(PG_FUNCTION_ARGS)
+{
+    Vector3dSphereType *sphere = PG_GETARG_VECTOR3D_SPHERE_P(0);
+    char               *radius = DatumGetCString(DirectFunctionCall1(float8out, Float8GetDatum(sphere->radius)));
+    
+    PG_RETURN_CSTRING(psprintf("<%s,%s>", vector3d_format(sphere->center.xyz), radius));
+}
+
+// BINARY INPUT
+PG_FUNCTION_INFO_V1(vector3d_sphere_recv);
+Datum vector3d_sphere_recv(PG_FUNCTION_ARGS)
+{
+    StringInfo          buf = (StringInfo) PG_GETARG_POINTER(0);
+    Vector3dSphereType *sphere = (Vector3dSphereType *) palloc(sizeof(Vector3dSphereType));
+    
+    sphere->center.xyz[0] = pq_getmsgfloat8(buf);
+    sphere->center.xyz[1] = pq_getmsgfloat8(buf);
+    sphere->center.xyz[2] = pq_getmsgfloat8(buf);
+    sphere->radius = pq_getmsgfloat8(buf);
+    
+    if (sphere->radius < 0)
+    {
+        ereport(ERROR, (errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+                        errmsg("invalid radius in external \"vector3d_sphere\" value")));
+    }
+    
+    PG_RETURN_VECTOR3D_SPHERE_P(sphere);
+}
+
+// BINARY OUTPUT
+PG_FUNCTION_INFO_V1(vector3d_sphere_send);
+Datum vector3d_sphere_send(PG_FUNCTION_ARGS)
+{
+    Vector3dSphereType *sphere = PG_GETARG_VECTOR3D_SPHERE_P(0);
+    StringInfoData      buf;
+    
+    pq_begintypsend(&buf);
+    pq_sendfloat8(&buf, sphere->center.xyz[0]);
+    pq_sendfloat8(&buf, sphere->center.xyz[1]);
+    pq_sendfloat8(&buf, sphere->center.xyz[2]);
+    pq_sendfloat8(&buf, sphere->radius);
+    
+    PG_RETURN_BYTEA_P(pq_endtypsend(&buf));
+}
+
+// CREATES A SPHERE FROM ITS CENTER AND RADIUS
+PG_FUNCTION_INFO_V1(vector3d_sphere);
+Datum vector3d_sphere(PG_FUNCTION_ARGS)
+{
+    Vector3dType       *center = PG_GETARG_VECTOR3D_P(0);
+    double              radius = PG_GETARG_FLOAT8(1);
+    Vector3dSphereType *sphere;
+    
+    if (radius < 0)
+    {
+        ereport(ERROR, (errcode(ERRCODE_DATA_EXCEPTION),
+                        errmsg("the radius of a sphere cannot be negative.")));
+    }
+    
+    sphere = (Vector3dSphereType *) palloc(sizeof(Vector3dSphereType));
+    sphere->center = *center;
+    sphere->radius = radius;
+    
+    PG_RETURN_VECTOR3D_SPHERE_P(sphere);
+}
+
+// RETURNS TRUE IF THE VECTOR LIES WITHIN THE SPHERE
+PG_FUNCTION_INFO_V1(vector3d_within);
+Datum vector3d_within(PG_FUNCTION_ARGS)
+{
+    Vector3dType       *vector = PG_GETARG_VECTOR3D_P(0);
+    Vector3dSphereType *sphere = PG_GETARG_VECTOR3D_SPHERE_P(1);
+    
+    PG_RETURN_BOOL(Vector3dDistance(vector, &sphere->center) <= sphere->radius);
+}
+
+// RETURNS TRUE IF THE SPHERE CONTAINS THE VECTOR
+PG_FUNCTION_INFO_V1(vector3d_sphere_contains);
+Datum vector3d_sphere_contains(PG_FUNCTION_ARGS)
+{
+    Vector3dSphereType *sphere = PG_GETARG_VECTOR3D_SPHERE_P(0);
+    Vector3dType       *vector = PG_GETARG_VECTOR3D_P(1);
+    
+    PG_RETURN_BOOL(Vector3dDistance(vector, &sphere->center) <= sphere->radius);
+}
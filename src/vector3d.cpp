@@ -3,34 +3,22 @@
 
 using namespace Eigen;
 
-// CONVERTS A POSTGRESQL ARRAY INTO AN EIGEN VECTOR3D
-RowVector3d arraytype_to_vector3d(ArrayType *array)
+// MAPS A VECTOR3D ONTO A READ-ONLY EIGEN ROW VECTOR
+inline Vector3dMap vector3d_to_eigen(Vector3dType *vector)
 {
-    // MAP POSTGRESQL ARRAY TO MATRIX
-    Map<RowVector3d> vector3d((double *) ARR_DATA_PTR(array), 3);
+    return Vector3dMap(vector->xyz);
+}
+
+// ALLOCATES A NEW VECTOR3D AND EVALUATES THE EIGEN EXPRESSION DIRECTLY INTO IT
+template<typename Derived>
+Vector3dType *matrixbase_to_vector3d(const MatrixBase<Derived> &matrixbase)
+{
+    Vector3dType *vector = (Vector3dType *) palloc(sizeof(Vector3dType));
     
-    return vector3d;
-}
-
-// // HORIZONTALLY STACKS TWO MATRICES
-// extern "C"
-// ArrayType *matrixxd_to_vector3d(ArrayType *array)
-// {
-//     int *dmns = ARR_DIMS(array);
-//     int *lbds = ARR_LBOUND(array);
-//     
-//     // EXTRACT THE MATRIX DIMENSIONS FROM THE POSTGRESQL ARRAYTYPE
-//     int rows = arraytype_num_rows(dmns, lbds);
-//     int cols = arraytype_num_cols(dmns, lbds);
-//     
-//     if (rows != 1 || cols != 3)
-//     {
-//         ereport(ERROR, (errcode(ERRCODE_DATA_EXCEPTION), 
-//                         errmsg("cannot cast matrixxd to vector3d: incompatible matrix dimensions (%i,%i).", rows, cols)));
-//     }
-//     
-//     return densebase_to_float8_arraytype(array);
-// }
+    Map<RowVector3d>(vector->xyz) = matrixbase;
+    
+    return vector;
+}
 
 
 ///////////////////////////VECTOR GENERATION METHODS////////////////////////////
@@ -38,129 +26,233 @@ RowVector3d arraytype_to_vector3d(ArrayType *array)
 
 // RETURNS VECTOR OF THE GIVEN SIZE WITH RANDOM COEFFICIENTS
 extern "C"
-ArrayType *Vector3dRandom()
+Vector3dType *Vector3dRandom()
 {
-    // INITIALIZE ARRAY ACCORDING TO THE GIVEN SIZE
-    RowVector3d vector3d = RowVector3d::Random();
-
-    return densebase_to_float8_arraytype(vector3d);
+    return matrixbase_to_vector3d(RowVector3d::Random());
 }
 
 // RETURNS VECTOR OF THE GIVEN SIZE WITH RANDOM COEFFICIENTS
 extern "C"
-ArrayType *Vector3dConstant(double value)
+Vector3dType *Vector3dConstant(double value)
+{
+    return matrixbase_to_vector3d(RowVector3d::Constant(value));
+}
+
+
+///////////////////////////CONVERSION FROM/TO ARRAYS////////////////////////////
+
+
+// CREATES A VECTOR3D FROM A ONE-DIMENSIONAL ARRAY OF DOUBLES WITH THREE ELEMENTS
+extern "C"
+Vector3dType *Vector3dFromArray(ArrayType *array)
 {
-    // INITIALIZE ARRAY ACCORDING TO THE GIVEN SIZE
-    RowVector3d vector3d = RowVector3d::Constant(value);
+    if (ARR_NDIM(array) != 1 || arraytype_num_elems(array) != 3 || ARR_HASNULL(array))
+    {
+        ereport(ERROR, (errcode(ERRCODE_DATA_EXCEPTION), 
+                        errmsg("cannot cast array to vector3d: array must be one-dimensional with exactly three non-null elements.")));
+    }
+    
+    return matrixbase_to_vector3d(arraytype_to_vector3d(array));
+}
 
-    return densebase_to_float8_arraytype(vector3d);
+// RETURNS THE VECTOR AS ONE-DIMENSIONAL ARRAY OF DOUBLES
+extern "C"
+ArrayType *Vector3dToArray(Vector3dType *vector)
+{
+    return densebase_to_float8_arraytype(vector3d_to_eigen(vector));
 }
 
+
 //////////////////////////////VECTOR ARITHMETIC/////////////////////////////////
 
 
 //
 extern "C"
-ArrayType *Vector3dAdd(ArrayType *a1, ArrayType *a2)
+Vector3dType *Vector3dAdd(Vector3dType *v1, Vector3dType *v2)
 {
-    RowVector3d v1 = arraytype_to_vector3d(a1);
-    RowVector3d v2 = arraytype_to_vector3d(a2);
-    
-    return densebase_to_float8_arraytype(v1 + v2);
+    return matrixbase_to_vector3d(vector3d_to_eigen(v1) + vector3d_to_eigen(v2));
 }
 
 //
 extern "C"
-ArrayType *Vector3dSubtract(ArrayType *a1, ArrayType *a2)
+Vector3dType *Vector3dSubtract(Vector3dType *v1, Vector3dType *v2)
 {
-    RowVector3d v1 = arraytype_to_vector3d(a1);
-    RowVector3d v2 = arraytype_to_vector3d(a2);
-    
-    return densebase_to_float8_arraytype(v1 - v2);
+    return matrixbase_to_vector3d(vector3d_to_eigen(v1) - vector3d_to_eigen(v2));
 }
 
 //
 extern "C"
-ArrayType *Vector3dScalarProduct(ArrayType *array, double scalar)
+Vector3dType *Vector3dScalarProduct(Vector3dType *vector, double scalar)
 {
-    RowVector3d vector3d = arraytype_to_vector3d(array);
-    
-    return densebase_to_float8_arraytype(vector3d * scalar);
+    return matrixbase_to_vector3d(vector3d_to_eigen(vector) * scalar);
 }
 
 //
 extern "C"
-ArrayType *Vector3dScalarDivision(ArrayType *array, double scalar)
+Vector3dType *Vector3dScalarDivision(Vector3dType *vector, double scalar)
 {
-    RowVector3d vector3d = arraytype_to_vector3d(array);
-    
-    return densebase_to_float8_arraytype(vector3d / scalar);
+    return matrixbase_to_vector3d(vector3d_to_eigen(vector) / scalar);
 }
 
 // RETURNS THE DOT PRODUCT
 extern "C"
-double Vector3dDot(ArrayType *a1, ArrayType *a2)
+double Vector3dDot(Vector3dType *v1, Vector3dType *v2)
 {
-    RowVector3d v1 = arraytype_to_vector3d(a1);
-    RowVector3d v2 = arraytype_to_vector3d(a2);
-    
-    return v1.dot(v2);
+    return vector3d_to_eigen(v1).dot(vector3d_to_eigen(v2));
 }
 
 // RETURNS THE CROSS PRODUCT
 extern "C"
-ArrayType *Vector3dCross(ArrayType *a1, ArrayType *a2)
+Vector3dType *Vector3dCross(Vector3dType *v1, Vector3dType *v2)
 {
-    RowVector3d v1 = arraytype_to_vector3d(a1);
-    RowVector3d v2 = arraytype_to_vector3d(a2);
-    
-    return densebase_to_float8_arraytype(v1.cross(v2));
+    return matrixbase_to_vector3d(vector3d_to_eigen(v1).cross(vector3d_to_eigen(v2)));
 }
 
 // RETURNS THE VECTOR NORM/LENGTH
 extern "C"
-double Vector3dNorm(ArrayType *array)
+double Vector3dNorm(Vector3dType *vector)
 {
-    RowVector3d vector3d = arraytype_to_vector3d(array);
-    
-    return vector3d.norm();
+    return vector3d_to_eigen(vector).norm();
 }
 
 // RETURNS THE NORMALIZED VECTOR
 extern "C"
-ArrayType *Vector3dNormalized(ArrayType *array)
+Vector3dType *Vector3dNormalized(Vector3dType *vector)
 {
-    RowVector3d vector3d = arraytype_to_vector3d(array);
-    
-    return densebase_to_float8_arraytype(vector3d.normalized());
+    return matrixbase_to_vector3d(vector3d_to_eigen(vector).normalized());
 }
 
 // RETURNS THE DISTANCE BETWEEN TWO VECTORS
 extern "C"
-double Vector3dDistance(ArrayType *a1, ArrayType *a2)
+double Vector3dDistance(Vector3dType *v1, Vector3dType *v2)
 {
-    RowVector3d v1 = arraytype_to_vector3d(a1);
-    RowVector3d v2 = arraytype_to_vector3d(a2);
-    
-    return (v1-v2).norm();
+    return (vector3d_to_eigen(v1) - vector3d_to_eigen(v2)).norm();
 }
 
 // RETURNS THE ANGLE BETWEEN TWO VECTORS
 extern "C"
-double Vector3dAngle(ArrayType *a1, ArrayType *a2)
+double Vector3dAngle(Vector3dType *v1, Vector3dType *v2)
 {
-    RowVector3d v1 = arraytype_to_vector3d(a1);
-    RowVector3d v2 = arraytype_to_vector3d(a2);
+    Vector3dMap e1 = vector3d_to_eigen(v1);
+    Vector3dMap e2 = vector3d_to_eigen(v2);
     
-    return acos(v1.dot(v2) / (v1.norm() * v2.norm()));
+    return acos(e1.dot(e2) / (e1.norm() * e2.norm()));
 }
 
 // RETURNS THE ABSOLUTE ANGLE BETWEEN TWO VECTORS
 extern "C"
-double Vector3dAbsAngle(ArrayType *a1, ArrayType *a2)
+double Vector3dAbsAngle(Vector3dType *v1, Vector3dType *v2)
 {
-    RowVector3d v1 = arraytype_to_vector3d(a1);
-    RowVector3d v2 = arraytype_to_vector3d(a2);
+    Vector3dMap e1 = vector3d_to_eigen(v1);
+    Vector3dMap e2 = vector3d_to_eigen(v2);
     
-    return acos(fabs(v1.dot(v2) / (v1.norm() * v2.norm())));
-}
\ No newline at end of file
+    return acos(fabs(e1.dot(e2) / (e1.norm() * e2.norm())));
+}
+
+
+
+///////////////////////////////////ORDERING/////////////////////////////////////
+
+
+/* Maps a coordinate onto an unsigned integer with the same order: the sign bit
+ * is flipped for positive numbers and all bits for negative ones. Like the
+ * float8 operators, -0 equals 0 and all NaNs are equal and greater than
+ * infinity.
+ */
+inline uint64 vector3d_order_key(double value)
+{
+    uint64 bits;
+
+    if (value == 0.0) value = 0.0;
+    else if (std::isnan(value)) value = std::numeric_limits<double>::quiet_NaN();
+
+    memcpy(&bits, &value, sizeof(bits));
+
+    return (bits & UINT64CONST(0x8000000000000000)) ? ~bits : bits | UINT64CONST(0x8000000000000000);
+}
+
+// SPREADS THE LOWER 21 BITS OF THE VALUE SO THAT TWO ZERO BITS FOLLOW EACH OF THEM
+inline uint64 vector3d_spread_bits(uint64 value)
+{
+    value &= UINT64CONST(0x1fffff);
+    value = (value | value << 32) & UINT64CONST(0x1f00000000ffff);
+    value = (value | value << 16) & UINT64CONST(0x1f0000ff0000ff);
+    value = (value | value << 8) & UINT64CONST(0x100f00f00f00f00f);
+    value = (value | value << 4) & UINT64CONST(0x10c30c30c30c30c3);
+    value = (value | value << 2) & UINT64CONST(0x1249249249249249);
+
+    return value;
+}
+
+/* Total order of the B-tree operator class: the Z-order (Morton order) of the
+ * coordinates, which keeps points that are close in space close in an index.
+ * The full codes would interleave the 64 bits of the order keys of x, y and z,
+ * so the vectors are ordered by the axis whose keys differ in the most
+ * significant bit, with x before y before z if the bit is the same.
+ */
+extern "C"
+int Vector3dCmp(Vector3dType *v1, Vector3dType *v2)
+{
+    uint64 key1 = 0, key2 = 0, highest = 0;
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        uint64 k1 = vector3d_order_key(v1->xyz[axis]);
+        uint64 k2 = vector3d_order_key(v2->xyz[axis]);
+        uint64 diff = k1 ^ k2;
+
+        // THE MOST SIGNIFICANT BIT OF DIFF IS HIGHER THAN THE ONE OF HIGHEST
+        if (highest < diff && highest < (highest ^ diff))
+        {
+            highest = diff;
+            key1 = k1;
+            key2 = k2;
+        }
+    }
+
+    if (key1 == key2) return 0;
+
+    return key1 < key2 ? -1 : 1;
+}
+
+// RETURNS THE 63-BIT MORTON CODE OF THE UPPER 21 BITS OF THE ORDER KEYS OF THE
+// COORDINATES; IT IS THE ABBREVIATED SORT KEY OF THE VECTOR
+extern "C"
+uint64 Vector3dMortonCode(Vector3dType *vector)
+{
+    uint64 code = 0;
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        code |= vector3d_spread_bits(vector3d_order_key(vector->xyz[axis]) >> 43) << (2 - axis);
+    }
+
+    return code << 1;
+}
+
+
+//////////////////////////////////AGGREGATES////////////////////////////////////
+
+
+// RETURNS THE VECTORS IN THE BUFFER AS MATRIX WITH ONE ROW PER VECTOR; A SINGLE
+// VECTOR IS RETURNED AS ONE-DIMENSIONAL ARRAY
+extern "C"
+ArrayType *Vector3dStack(double *coords, int count)
+{
+    return densebase_to_float8_arraytype(Map<const Matrix<double, Dynamic, 3, RowMajor> >(coords, count, 3));
+}
+
+
+///////////////////////////////BOUNDING BOXES///////////////////////////////////
+
+
+// RETURNS THE SMALLEST DISTANCE BETWEEN THE VECTOR AND ANY POINT IN THE BOX,
+// WHICH IS ZERO IF THE VECTOR LIES INSIDE
+extern "C"
+double Vector3dBoxDistance(Vector3dBoxType *box, Vector3dType *vector)
+{
+    Vector3dMap low(box->low), high(box->high);
+    Vector3dMap point = vector3d_to_eigen(vector);
+    
+    return ((low - point).cwiseMax(0.0) + (point - high).cwiseMax(0.0)).norm();
+}
@@ -7,28 +7,71 @@ extern "C"
 #endif
 
     #include "postgres.h"
+    #include "fmgr.h"
     #include "utils/array.h"
     
-    int        Vector3dCmp(ArrayType *a1, ArrayType *a2);
+    // FIXED-LENGTH THREE-DIMENSIONAL VECTOR; THE COORDINATES ARE STORED WITHOUT
+    // ANY HEADER SO THAT THE TYPE TAKES EXACTLY 24 BYTES ON DISK
+    typedef struct
+    {
+        double xyz[3];
+    } Vector3dType;
     
-    ArrayType *Vector3dConstant(double value);
-    ArrayType *Vector3dRandom();
+    #define DatumGetVector3dP(X)      ((Vector3dType *) DatumGetPointer(X))
+    #define Vector3dPGetDatum(X)      PointerGetDatum(X)
+    #define PG_GETARG_VECTOR3D_P(n)   DatumGetVector3dP(PG_GETARG_DATUM(n))
+    #define PG_RETURN_VECTOR3D_P(x)   return Vector3dPGetDatum(x)
     
-    ArrayType *Vector3dAdd(ArrayType *a1, ArrayType *a2);
-    ArrayType *Vector3dSubtract(ArrayType *a1, ArrayType *a2);
-    ArrayType *Vector3dScalarProduct(ArrayType *array, double scalar);
-    ArrayType *Vector3dScalarDivision(ArrayType *array, double scalar);
-    ArrayType *Vector3dCross(ArrayType *a1, ArrayType *a2);
-    ArrayType *Vector3dNormalized(ArrayType *array);
+    // AXIS-ALIGNED BOUNDING BOX; USED AS KEY OF THE GIST OPERATOR CLASS
+    typedef struct
+    {
+        double low[3];
+        double high[3];
+    } Vector3dBoxType;
     
-    double     Vector3dDot(ArrayType *a1, ArrayType *a2);
-    double     Vector3dNorm(ArrayType *array);
-    double     Vector3dDistance(ArrayType *a1, ArrayType *a2);
-    double     Vector3dAngle(ArrayType *a1, ArrayType *a2);
-    double     Vector3dAbsAngle(ArrayType *a1, ArrayType *a2);
+    #define DatumGetVector3dBoxP(X)       ((Vector3dBoxType *) DatumGetPointer(X))
+    #define PG_GETARG_VECTOR3D_BOX_P(n)   DatumGetVector3dBoxP(PG_GETARG_DATUM(n))
+    #define PG_RETURN_VECTOR3D_BOX_P(x)   return PointerGetDatum(x)
+    
+    // SPHERE AROUND A CENTER; THE QUERY OF THE WITHIN-RADIUS OPERATOR
+    typedef struct
+    {
+        Vector3dType center;
+        double       radius;
+    } Vector3dSphereType;
+    
+    #define DatumGetVector3dSphereP(X)       ((Vector3dSphereType *) DatumGetPointer(X))
+    #define PG_GETARG_VECTOR3D_SPHERE_P(n)   DatumGetVector3dSphereP(PG_GETARG_DATUM(n))
+    #define PG_RETURN_VECTOR3D_SPHERE_P(x)   return PointerGetDatum(x)
+    
+    int           Vector3dCmp(Vector3dType *v1, Vector3dType *v2);
+    uint64        Vector3dMortonCode(Vector3dType *vector);
+    
+    Vector3dType *Vector3dConstant(double value);
+    Vector3dType *Vector3dRandom();
+    
+    Vector3dType *Vector3dFromArray(ArrayType *array);
+    ArrayType    *Vector3dToArray(Vector3dType *vector);
+    
+    Vector3dType *Vector3dAdd(Vector3dType *v1, Vector3dType *v2);
+    Vector3dType *Vector3dSubtract(Vector3dType *v1, Vector3dType *v2);
+    Vector3dType *Vector3dScalarProduct(Vector3dType *vector, double scalar);
+    Vector3dType *Vector3dScalarDivision(Vector3dType *vector, double scalar);
+    Vector3dType *Vector3dCross(Vector3dType *v1, Vector3dType *v2);
+    Vector3dType *Vector3dNormalized(Vector3dType *vector);
+    
+    double        Vector3dDot(Vector3dType *v1, Vector3dType *v2);
+    double        Vector3dNorm(Vector3dType *vector);
+    double        Vector3dDistance(Vector3dType *v1, Vector3dType *v2);
+    double        Vector3dAngle(Vector3dType *v1, Vector3dType *v2);
+    double        Vector3dAbsAngle(Vector3dType *v1, Vector3dType *v2);
+    
+    ArrayType    *Vector3dStack(double *coords, int count);
+    
+    double        Vector3dBoxDistance(Vector3dBoxType *box, Vector3dType *vector);
 
 #ifdef __cplusplus
 }
 #endif
 
-#endif
\ No newline at end of file
+#endif
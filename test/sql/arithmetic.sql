@@ -0,0 +1,10 @@
+SET client_min_messages = warning;
+CREATE EXTENSION IF NOT EXISTS eigen;
+RESET client_min_messages;
+
+-- ELEMENT-WISE OPERATORS AND COUNTS
+SELECT '{1,2,3}'::arrayxi + '{1,1,1}'::arrayxi AS sum,
+       '{1,2,3}'::arrayxi * '{2,2,2}'::arrayxi AS product,
+       arrayxi_size('{0,5,0,7}') AS size,
+       arrayxi_nonzeros('{0,5,0,7}') AS nonzeros;
+SELECT '{1,2,3}'::arrayxi + '{1,1}'::arrayxi;
@@ -0,0 +1,39 @@
+SET client_min_messages = warning;
+CREATE EXTENSION IF NOT EXISTS eigen;
+RESET client_min_messages;
+
+CREATE TABLE btree_fps (id INTEGER, fp arrayxi);
+INSERT INTO btree_fps VALUES
+    (1, '{1,1,1,1,0,0,0,0}'),
+    (2, '{1,1,1,0,0,0,0,0}'),
+    (3, '{1,1,0,0,1,1,0,0}'),
+    (4, '{0,0,0,0,1,1,1,1}'),
+    (5, '{1,1,1,1,1,1,0,0}'),
+    (6, '{1,0,0,0,0,0,0,0}'),
+    (7, NULL);
+
+-- B-TREE ORDER: NUMBER OF NON-ZERO ELEMENTS FIRST, THEN THE FIRST DIFFERENCE
+SELECT array_agg(id ORDER BY fp USING <) AS ordered FROM btree_fps;
+SELECT array_agg(id ORDER BY fp USING <) AS smaller FROM btree_fps WHERE fp < '{1,1,1,1,0,0,0,0}';
+CREATE INDEX btree_fps_fp ON btree_fps (fp arrayxi_btree_ops);
+SET enable_seqscan = off;
+SELECT array_agg(id ORDER BY fp USING <) AS smaller FROM btree_fps WHERE fp < '{1,1,1,1,0,0,0,0}';
+SELECT id FROM btree_fps WHERE fp = '{1,1,0,0,1,1,0,0}';
+RESET enable_seqscan;
+
+-- OPERATOR AND OPERATOR CLASS DEFINITIONS
+SELECT oprname, oprcanmerge AS merges
+  FROM pg_operator
+ WHERE oprleft = 'arrayxi'::regtype AND oprright = 'arrayxi'::regtype AND oprname IN ('=', '<>')
+ ORDER BY oprname;
+SELECT c.opcname, a.amname, c.opcdefault
+  FROM pg_opclass c
+  JOIN pg_am a ON a.oid = c.opcmethod
+ WHERE c.opcintype = 'arrayxi'::regtype AND a.amname = 'btree';
+SELECT o.amopstrategy, o.amopopr::regoperator AS operator
+  FROM pg_amop o
+  JOIN pg_opclass c ON c.opcfamily = o.amopfamily
+ WHERE c.opcname = 'arrayxi_btree_ops'
+ ORDER BY o.amopstrategy;
+
+DROP TABLE btree_fps;
@@ -0,0 +1,9 @@
+SET client_min_messages = warning;
+CREATE EXTENSION IF NOT EXISTS eigen;
+RESET client_min_messages;
+
+-- CONTACTS ARE THE PAIRS OF ROWS THAT ARE CLOSER THAN THE CUTOFF
+SELECT * FROM matrixxd_contacts('{{0,0,0},{10,10,10}}', '{{3,4,0},{0,0,1},{10,10,12},{20,20,20}}', 5.5) ORDER BY i, j;
+SELECT * FROM matrixxd_contacts('{{0,0,0},{10,10,10}}', '{{3,4,0},{0,0,1},{10,10,12},{20,20,20}}', 5) ORDER BY i, j;
+SELECT * FROM matrixxd_contacts('{{0,0,0},{10,10,10}}', '{{3,4,0},{0,0,1},{10,10,12},{20,20,20}}', 0);
+SELECT * FROM matrixxd_contacts('{{0,0,0},{NaN,0,0}}', '{{3,4,0},{0,0,1},{10,10,12},{20,20,20}}', 5);
@@ -0,0 +1,47 @@
+SET client_min_messages = warning;
+CREATE EXTENSION IF NOT EXISTS eigen;
+RESET client_min_messages;
+
+CREATE TABLE gist_fps (id INTEGER, fp arrayxi);
+INSERT INTO gist_fps VALUES
+    (1, '{1,1,1,1,0,0,0,0}'),
+    (2, '{1,1,1,0,0,0,0,0}'),
+    (3, '{1,1,0,0,1,1,0,0}'),
+    (4, '{0,0,0,0,1,1,1,1}'),
+    (5, '{1,1,1,1,1,1,0,0}'),
+    (6, '{1,0,0,0,0,0,0,0}'),
+    (7, NULL);
+
+-- THRESHOLD OPERATORS
+SET eigen.dice_threshold = 0.75;
+SET eigen.kulczynski_threshold = 0.6;
+SET eigen.ochiai_threshold = 0.8;
+SET eigen.russell_rao_threshold = 0.5;
+SET eigen.simpson_threshold = 1.0;
+SET eigen.tversky_threshold = 0.6;
+SELECT array_agg(id ORDER BY id) AS dice FROM gist_fps WHERE fp #? '{1,1,1,1,0,0,0,0}';
+SELECT array_agg(id ORDER BY id) AS kulczynski FROM gist_fps WHERE fp %? '{1,1,1,1,0,0,0,0}';
+SELECT array_agg(id ORDER BY id) AS ochiai FROM gist_fps WHERE fp @? '{1,1,1,1,0,0,0,0}';
+SELECT array_agg(id ORDER BY id) AS russell_rao FROM gist_fps WHERE fp ^? '{1,1,1,1,0,0,0,0}';
+SELECT array_agg(id ORDER BY id) AS simpson FROM gist_fps WHERE fp ^^? '{1,1,1,1,0,0,0,0}';
+SELECT array_agg(id ORDER BY id) AS tversky FROM gist_fps WHERE fp %^? '{1,1,1,1,0,0,0,0}';
+SELECT array_agg(id ORDER BY id) AS commuted FROM gist_fps WHERE '{1,1,1,1,0,0,0,0}' #? fp;
+
+-- THE GIST INDEX MUST RETURN THE SAME ROWS
+CREATE INDEX gist_fps_fp ON gist_fps USING gist (fp arrayxi_gist_ops);
+SET enable_seqscan = off;
+SELECT array_agg(id ORDER BY id) AS dice FROM gist_fps WHERE fp #? '{1,1,1,1,0,0,0,0}';
+SELECT array_agg(id ORDER BY id) AS kulczynski FROM gist_fps WHERE fp %? '{1,1,1,1,0,0,0,0}';
+SELECT array_agg(id ORDER BY id) AS ochiai FROM gist_fps WHERE fp @? '{1,1,1,1,0,0,0,0}';
+SELECT array_agg(id ORDER BY id) AS russell_rao FROM gist_fps WHERE fp ^? '{1,1,1,1,0,0,0,0}';
+SELECT array_agg(id ORDER BY id) AS simpson FROM gist_fps WHERE fp ^^? '{1,1,1,1,0,0,0,0}';
+SELECT array_agg(id ORDER BY id) AS tversky FROM gist_fps WHERE fp %^? '{1,1,1,1,0,0,0,0}';
+RESET enable_seqscan;
+
+-- THE OPERATOR CLASS OF THE DOMAIN IS NOT ITS DEFAULT
+SELECT c.opcname, a.amname, c.opcdefault
+  FROM pg_opclass c
+  JOIN pg_am a ON a.oid = c.opcmethod
+ WHERE c.opcintype = 'arrayxi'::regtype AND a.amname = 'gist';
+
+DROP TABLE gist_fps;
@@ -0,0 +1,35 @@
+SET client_min_messages = warning;
+CREATE EXTENSION IF NOT EXISTS eigen;
+RESET client_min_messages;
+
+CREATE TABLE hash_fps (id INTEGER, fp arrayxi);
+INSERT INTO hash_fps VALUES
+    (1, '{1,1,1,1,0,0,0,0}'),
+    (2, '{1,1,1,0,0,0,0,0}'),
+    (3, '{1,1,0,0,1,1,0,0}'),
+    (4, '{0,0,0,0,1,1,1,1}'),
+    (5, '{1,1,1,1,1,1,0,0}'),
+    (6, '{1,0,0,0,0,0,0,0}'),
+    (7, NULL);
+INSERT INTO hash_fps VALUES (8, '{1,1,0,0,1,1,0,0}');
+
+-- EQUAL ARRAYS HAVE EQUAL HASHES
+SELECT arrayxi_hash('{0,1,2}') = arrayxi_hash('{0,1,2}') AS equal;
+SET enable_mergejoin = off;
+SET enable_nestloop = off;
+SELECT count(*) AS pairs FROM hash_fps a JOIN hash_fps b ON a.fp = b.fp;
+RESET enable_mergejoin;
+RESET enable_nestloop;
+
+-- OPERATOR AND OPERATOR CLASS DEFINITIONS
+SELECT oprname, oprcom::regoperator AS commutator, oprnegate::regoperator AS negator,
+       oprcanhash AS hashes
+  FROM pg_operator
+ WHERE oprleft = 'arrayxi'::regtype AND oprright = 'arrayxi'::regtype AND oprname IN ('=', '<>')
+ ORDER BY oprname;
+SELECT c.opcname, a.amname, c.opcdefault
+  FROM pg_opclass c
+  JOIN pg_am a ON a.oid = c.opcmethod
+ WHERE c.opcintype = 'arrayxi'::regtype AND a.amname = 'hash';
+
+DROP TABLE hash_fps;
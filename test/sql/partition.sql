@@ -0,0 +1,14 @@
+SET client_min_messages = warning;
+CREATE EXTENSION IF NOT EXISTS eigen;
+RESET client_min_messages;
+
+-- NON-ZERO BOUNDS OF THE PARTITIONS THAT CAN HOLD MATCHES
+SET eigen.tanimoto_threshold = 0.5;
+SELECT arrayxi_min_nonzeros('{1,1,1,1,0,0,0,0}', 'tanimoto') AS min,
+       arrayxi_max_nonzeros('{1,1,1,1,0,0,0,0}', 'tanimoto') AS max;
+SET eigen.dice_threshold = 0.75;
+SELECT arrayxi_min_nonzeros('{1,1,1,1,0,0,0,0}', 'dice') AS min,
+       arrayxi_max_nonzeros('{1,1,1,1,0,0,0,0}', 'dice') AS max;
+RESET eigen.tanimoto_threshold;
+RESET eigen.dice_threshold;
+SELECT arrayxi_min_nonzeros('{1,1,1,1,0,0,0,0}', 'simpson');
@@ -0,0 +1,22 @@
+SET client_min_messages = warning;
+CREATE EXTENSION IF NOT EXISTS eigen;
+RESET client_min_messages;
+
+CREATE TABLE similarity_fps (id INTEGER, fp arrayxi);
+INSERT INTO similarity_fps VALUES
+    (1, '{1,1,1,1,0,0,0,0}'),
+    (2, '{1,1,1,0,0,0,0,0}'),
+    (3, '{1,1,0,0,1,1,0,0}'),
+    (4, '{0,0,0,0,1,1,1,1}'),
+    (5, '{1,1,1,1,1,1,0,0}'),
+    (6, '{1,0,0,0,0,0,0,0}'),
+    (7, NULL);
+
+-- SIMILARITY FUNCTIONS
+SELECT id, round(arrayxi_tanimoto(fp, '{1,1,1,1,0,0,0,0}')::numeric, 4) AS tanimoto,
+       round(arrayxi_dice(fp, '{1,1,1,1,0,0,0,0}')::numeric, 4) AS dice,
+       round(arrayxi_russell_rao(fp, '{1,1,1,1,0,0,0,0}')::numeric, 4) AS russell_rao
+  FROM similarity_fps
+ ORDER BY id;
+
+DROP TABLE similarity_fps;
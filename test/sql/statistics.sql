@@ -0,0 +1,15 @@
+SET client_min_messages = warning;
+CREATE EXTENSION IF NOT EXISTS eigen;
+RESET client_min_messages;
+
+-- POSITIONS OF THE SET BITS, WHOSE STATISTICS HOLD THE POPCOUNT HISTOGRAM AND
+-- THE BIT FREQUENCIES
+SELECT arrayxi_positions('{0,5,0,7,1}') AS positions,
+       arrayxi_positions('{0,0,0}') AS empty;
+
+-- STATISTICS ARE ONLY CREATED FOR ARRAYXI COLUMNS
+CREATE TABLE statistics_fps (id INTEGER, fp arrayxi);
+\set VERBOSITY terse
+SELECT arrayxi_create_statistics('statistics_fps', 'id');
+\set VERBOSITY default
+DROP TABLE statistics_fps;
@@ -0,0 +1,15 @@
+SET client_min_messages = warning;
+CREATE EXTENSION IF NOT EXISTS eigen;
+RESET client_min_messages;
+
+-- B IS A ROTATED BY 90 DEGREES ABOUT THE Z AXIS AND MOVED BY (1,2,3)
+SELECT abs(rotation[1][1]) < 1e-9 AS r11, abs(rotation[1][2] + 1) < 1e-9 AS r12,
+       abs(rotation[2][1] - 1) < 1e-9 AS r21, abs(rotation[3][3] - 1) < 1e-9 AS r33
+  FROM matrixxd_kabsch('{{0,0,0},{1,0,0},{0,2,0},{0,0,3}}', '{{1,2,3},{1,3,3},{-1,2,3},{1,2,6}}');
+SELECT array_agg(round(x::numeric, 6)) AS translation
+  FROM matrixxd_kabsch('{{0,0,0},{1,0,0},{0,2,0},{0,0,3}}', '{{1,2,3},{1,3,3},{-1,2,3},{1,2,6}}'), unnest(float8_array(translation)) x;
+SELECT matrixxd_rmsd('{{0,0,0},{1,0,0},{0,2,0},{0,0,3}}', '{{1,2,3},{1,3,3},{-1,2,3},{1,2,6}}') < 1e-6 AS superposed,
+       round(matrixxd_rmsd('{{0,0,0},{1,0,0},{0,2,0},{0,0,3}}', '{{1,2,3},{1,3,3},{-1,2,3},{1,2,6}}', false)::numeric, 6) AS unsuperposed;
+SELECT array_agg(round(x::numeric, 6)) AS rmsd
+  FROM unnest(matrixxd_rmsd_many('{{0,0,0},{1,0,0},{0,2,0},{0,0,3}}', ARRAY['{{0,0,0},{1,0,0},{0,2,0},{0,0,3}}'::float8[], '{{1,2,3},{1,3,3},{-1,2,3},{1,2,6}}'::float8[]], false)) x;
+SELECT matrixxd_rmsd('{{0,0,0},{1,0,0},{0,2,0},{0,0,3}}', '{{0,0,0},{1,0,0}}');
@@ -0,0 +1,46 @@
+SET client_min_messages = warning;
+CREATE EXTENSION IF NOT EXISTS eigen;
+RESET client_min_messages;
+
+CREATE TABLE topk_fps (id INTEGER, fp arrayxi);
+INSERT INTO topk_fps VALUES
+    (1, '{1,1,1,1,0,0,0,0}'),
+    (2, '{1,1,1,0,0,0,0,0}'),
+    (3, '{1,1,0,0,1,1,0,0}'),
+    (4, '{0,0,0,0,1,1,1,1}'),
+    (5, '{1,1,1,1,1,1,0,0}'),
+    (6, '{1,0,0,0,0,0,0,0}'),
+    (7, NULL);
+
+-- THE TOP-K SEARCH MUST RETURN THE SAME ROWS AS A SORT OF THE SIMILARITIES
+SELECT f.id, round(t.similarity::numeric, 4) AS similarity
+  FROM arrayxi_topk('topk_fps', 'fp', '{1,1,1,1,0,0,0,0}', 3) t
+  JOIN topk_fps f ON f.ctid = t.ctid
+ ORDER BY t.similarity DESC;
+SELECT id, round(arrayxi_tanimoto(fp, '{1,1,1,1,0,0,0,0}')::numeric, 4) AS similarity
+  FROM topk_fps
+ WHERE fp IS NOT NULL
+ ORDER BY 2 DESC, id
+ LIMIT 3;
+SELECT f.id, round(t.similarity::numeric, 4) AS similarity
+  FROM arrayxi_topk('topk_fps', 'fp', '{1,1,1,1,0,0,0,0}', 2, 'dice') t
+  JOIN topk_fps f ON f.ctid = t.ctid
+ ORDER BY t.similarity DESC;
+
+-- K LARGER THAN THE TABLE RETURNS EVERY ROW THAT IS NOT NULL
+SELECT count(*) AS rows FROM arrayxi_topk('topk_fps', 'fp', '{1,1,1,1,0,0,0,0}', 1000000);
+
+-- INVALID ARGUMENTS
+SELECT * FROM arrayxi_topk('topk_fps', 'fp', '{1,1,1,1,0,0,0,0}', 0);
+SELECT * FROM arrayxi_topk('topk_fps', 'fp', '{1,1,1,1,0,0,0,0}', 3, 'jaccard');
+SELECT * FROM arrayxi_topk('topk_fps', 'id', '{1,1,1,1,0,0,0,0}', 3);
+
+-- INTEGER[] COLUMNS ARE NOT CHECKED BY THE DOMAIN
+CREATE TABLE topk_ints (fp INTEGER[]);
+INSERT INTO topk_ints VALUES ('{1,1,0,0,0,0,0,0}'), ('{1,NULL,0,0,0,0,0,0}');
+SELECT * FROM arrayxi_topk('topk_ints', 'fp', '{1,1,1,1,0,0,0,0}', 3);
+TRUNCATE topk_ints;
+INSERT INTO topk_ints VALUES ('{{1,1,0,0},{0,0,0,0}}');
+SELECT * FROM arrayxi_topk('topk_ints', 'fp', '{1,1,1,1,0,0,0,0}', 3);
+
+DROP TABLE topk_fps, topk_ints;